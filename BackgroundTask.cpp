@@ -1,4 +1,18 @@
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <cstring>
+#include <deque>
+#include <list>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <unordered_map>
+#include <condition_variable>
+#include <atomic>
+#include <cmath>
 #include <BaseUtils/Logger.h>
+#include <BaseUtils/FileSystemUtils.h>
 #include "BackgroundTask.h"
 
 namespace json = imgui_json;
@@ -9,6 +23,7 @@ namespace MEC
 {
 BackgroundTask::Holder CreateBgtask_Vidstab(const json::value& jnTask, MediaCore::SharedSettings::Holder hSettings, RenderUtils::TextureManager::Holder hTxMgr);
 BackgroundTask::Holder CreateBgtask_SceneDetect(const json::value& jnTask, MediaCore::SharedSettings::Holder hSettings, RenderUtils::TextureManager::Holder hTxMgr);
+BackgroundTask::Holder CreateBgtask_Proxy(const json::value& jnTask, MediaCore::SharedSettings::Holder hSettings, RenderUtils::TextureManager::Holder hTxMgr);
 
 BackgroundTask::Holder BackgroundTask::CreateBackgroundTask(const json::value& jnTask, MediaCore::SharedSettings::Holder hSettings, RenderUtils::TextureManager::Holder hTxMgr)
 {
@@ -22,10 +37,817 @@ BackgroundTask::Holder BackgroundTask::CreateBackgroundTask(const json::value& j
         return CreateBgtask_Vidstab(jnTask, hSettings, hTxMgr);
     else if (strTaskType == "SceneDetect")
         return CreateBgtask_SceneDetect(jnTask, hSettings, hTxMgr);
+    else if (strTaskType == "Proxy")
+        return CreateBgtask_Proxy(jnTask, hSettings, hTxMgr);
     else
     {
         Log(Error) << "FAILED to create 'BackgroundTask'! Unsupported task type '" << strTaskType << "'." << endl;
         return nullptr;
     }
 }
-}
\ No newline at end of file
+
+static atomic<size_t> _ANALYSIS_SOURCE_MEMORY_BUDGET{512*1024*1024};
+static atomic<size_t> _ANALYSIS_SOURCE_MEMORY_USAGE{0};
+
+class AnalysisSource_Impl : public enable_shared_from_this<AnalysisSource_Impl>
+{
+public:
+    AnalysisSource_Impl(const string& strKey, MediaCore::VideoClip::Holder hVclip)
+        : m_strKey(strKey), m_hVclip(hVclip)
+    {
+        m_pLogger = GetLogger("AnalysisSource");
+        m_tFrameRate = m_hVclip->GetSharedSettings()->VideoOutFrameRate();
+    }
+
+    ~AnalysisSource_Impl()
+    {
+        lock_guard<mutex> _lk(m_mtxLock);
+        while (!m_aFrameWindow.empty())
+            PopFrontFrame();
+    }
+
+    const string& GetKey() const { return m_strKey; }
+
+    bool AddSubscriber(const void* pSubscriber, int64_t i64StartFrameIdx)
+    {
+        lock_guard<mutex> _lk(m_mtxLock);
+        if (m_aSubscribers.empty() && !m_bDecoding)
+        {
+            // no one is using this source, so it can be repositioned freely
+            while (!m_aFrameWindow.empty())
+                PopFrontFrame();
+            if (i64StartFrameIdx != m_i64NextDecodeIdx)
+            {
+                m_hVclip->SeekTo(FrameIndexToPos(i64StartFrameIdx));
+                m_bEof = false;
+                m_bDecodeFailed = false;
+                m_u32NullDecodeCount = 0;
+            }
+            m_i64WindowStartIdx = m_i64NextDecodeIdx = i64StartFrameIdx;
+        }
+        else if (i64StartFrameIdx < m_i64WindowStartIdx || i64StartFrameIdx > m_i64NextDecodeIdx)
+        {
+            return false;
+        }
+        m_aSubscribers[pSubscriber] = i64StartFrameIdx;
+        return true;
+    }
+
+    void RemoveSubscriber(const void* pSubscriber)
+    {
+        lock_guard<mutex> _lk(m_mtxLock);
+        m_aSubscribers.erase(pSubscriber);
+        ReleaseConsumedFrames();
+    }
+
+    uint32_t GetSubscriberCount() const
+    {
+        lock_guard<mutex> _lk(m_mtxLock);
+        return (uint32_t)m_aSubscribers.size();
+    }
+
+    int64_t GetNextFrameIndex(const void* pSubscriber) const
+    {
+        lock_guard<mutex> _lk(m_mtxLock);
+        auto iter = m_aSubscribers.find(pSubscriber);
+        return iter != m_aSubscribers.end() ? iter->second : -1;
+    }
+
+    AnalysisSource::ReadResult ReadFrame(const void* pSubscriber, SelfFreeAVFramePtr& hAvfrm)
+    {
+        unique_lock<mutex> _lk(m_mtxLock);
+        auto iter = m_aSubscribers.find(pSubscriber);
+        if (iter == m_aSubscribers.end())
+            return AnalysisSource::READ_FAILED;
+        const int64_t i64FrmIdx = iter->second;
+        if (i64FrmIdx >= m_i64NextDecodeIdx)
+        {
+            if (m_bEof)
+                return AnalysisSource::READ_EOF;
+            if (m_bDecodeFailed)
+                return AnalysisSource::READ_FAILED;
+            // wait for the decoding subscriber, or for the frames in the window to be consumed by the slower ones
+            if (m_bDecoding || (!m_aFrameWindow.empty() && _ANALYSIS_SOURCE_MEMORY_USAGE+m_szLastFrameBytes > _ANALYSIS_SOURCE_MEMORY_BUDGET))
+            {
+                m_cvFrameReady.wait_for(_lk, chrono::milliseconds(THREAD_IDLE_TIME));
+                return AnalysisSource::READ_AGAIN;
+            }
+
+            // decode the next frame without holding the lock, other subscribers can still read the frames in the window
+            m_bDecoding = true;
+            const int64_t i64DecodeIdx = m_i64NextDecodeIdx;
+            _lk.unlock();
+            bool bEof = false;
+            auto hDecfrm = DecodeFrame(i64DecodeIdx, bEof);
+            _lk.lock();
+            m_bDecoding = false;
+            if (hDecfrm)
+            {
+                hDecfrm->pts = i64DecodeIdx;
+                m_szLastFrameBytes = CalcFrameBytes(hDecfrm.get());
+                _ANALYSIS_SOURCE_MEMORY_USAGE += m_szLastFrameBytes;
+                m_aFrameWindow.push_back({hDecfrm, m_szLastFrameBytes});
+                m_i64NextDecodeIdx++;
+                m_u32NullDecodeCount = 0;
+            }
+            else if (!bEof && ++m_u32NullDecodeCount >= MAX_NULL_DECODE_COUNT)
+            {
+                m_pLogger->Log(Error) << "[" << m_strKey << "] FAILED to decode frame #" << i64DecodeIdx << " after " << m_u32NullDecodeCount << " tries!" << endl;
+                m_bDecodeFailed = true;
+            }
+            if (bEof)
+                m_bEof = true;
+            m_cvFrameReady.notify_all();
+            if (i64FrmIdx >= m_i64NextDecodeIdx)
+            {
+                if (m_bEof)
+                    return AnalysisSource::READ_EOF;
+                if (m_bDecodeFailed)
+                    return AnalysisSource::READ_FAILED;
+                m_cvFrameReady.wait_for(_lk, chrono::milliseconds(THREAD_IDLE_TIME));
+                return AnalysisSource::READ_AGAIN;
+            }
+            // subscriber map may be changed while the lock is released
+            iter = m_aSubscribers.find(pSubscriber);
+        }
+
+        hAvfrm = CloneSelfFreeAVFramePtr(m_aFrameWindow[i64FrmIdx-m_i64WindowStartIdx].first.get());
+        iter->second++;
+        ReleaseConsumedFrames();
+        return AnalysisSource::READ_OK;
+    }
+
+private:
+    int64_t FrameIndexToPos(int64_t i64FrmIdx) const
+    {
+        return (int64_t)round((double)i64FrmIdx*1000*m_tFrameRate.den/m_tFrameRate.num);
+    }
+
+    SelfFreeAVFramePtr DecodeFrame(int64_t i64FrmIdx, bool& bEof)
+    {
+        SelfFreeAVFramePtr hAvfrm;
+        auto hVfrm = m_hVclip->ReadSourceFrame(FrameIndexToPos(i64FrmIdx), bEof, true);
+        if (!hVfrm)
+            return nullptr;
+        auto tNativeData = hVfrm->GetNativeData();
+        if (tNativeData.eType == MediaCore::VideoFrame::NativeData::AVFRAME)
+            hAvfrm = CloneSelfFreeAVFramePtr((AVFrame*)tNativeData.pData);
+        else if (tNativeData.eType == MediaCore::VideoFrame::NativeData::AVFRAME_HOLDER)
+            hAvfrm = CloneSelfFreeAVFramePtr(((SelfFreeAVFramePtr*)tNativeData.pData)->get());
+        else if (tNativeData.eType == MediaCore::VideoFrame::NativeData::MAT)
+        {
+            const auto& vmat = *((ImGui::ImMat*)tNativeData.pData);
+            if (vmat.device != IM_DD_CPU)
+            {
+                hAvfrm = AllocSelfFreeAVFramePtr();
+                if (!m_tMat2AvfrmCvter.ConvertImage(vmat, hAvfrm.get(), i64FrmIdx))
+                {
+                    m_pLogger->Log(Error) << "[" << m_strKey << "] FAILED to convert ImMat to AVFrame! Error is '" << m_tMat2AvfrmCvter.GetError() << "'." << endl;
+                    hAvfrm = nullptr;
+                }
+            }
+            else
+            {
+                ImMatWrapper_AVFrame tAvfrmWrapper(vmat, true);
+                hAvfrm = CloneSelfFreeAVFramePtr(tAvfrmWrapper.GetWrapper(i64FrmIdx).get());
+            }
+        }
+        return hAvfrm;
+    }
+
+    static size_t CalcFrameBytes(const AVFrame* pAvfrm)
+    {
+        size_t szBytes = 0;
+        for (int i = 0; i < AV_NUM_DATA_POINTERS; i++)
+        {
+            if (pAvfrm->buf[i])
+                szBytes += pAvfrm->buf[i]->size;
+        }
+        return szBytes;
+    }
+
+    void PopFrontFrame()
+    {
+        _ANALYSIS_SOURCE_MEMORY_USAGE -= m_aFrameWindow.front().second;
+        m_aFrameWindow.pop_front();
+        m_i64WindowStartIdx++;
+    }
+
+    void ReleaseConsumedFrames()
+    {
+        int64_t i64MinIdx = m_i64NextDecodeIdx;
+        for (const auto& elem : m_aSubscribers)
+        {
+            if (elem.second < i64MinIdx)
+                i64MinIdx = elem.second;
+        }
+        bool bReleased = false;
+        while (!m_aFrameWindow.empty() && m_i64WindowStartIdx < i64MinIdx)
+        {
+            PopFrontFrame();
+            bReleased = true;
+        }
+        // the subscribers waiting on the memory budget can go on decoding
+        if (bReleased)
+            m_cvFrameReady.notify_all();
+    }
+
+private:
+    string m_strKey;
+    ALogger* m_pLogger;
+    MediaCore::VideoClip::Holder m_hVclip;
+    MediaCore::Ratio m_tFrameRate;
+    ImMatToAVFrameConverter m_tMat2AvfrmCvter;
+    mutable mutex m_mtxLock;
+    condition_variable m_cvFrameReady;
+    unordered_map<const void*, int64_t> m_aSubscribers;
+    deque<pair<SelfFreeAVFramePtr, size_t>> m_aFrameWindow;
+    int64_t m_i64WindowStartIdx{0};
+    int64_t m_i64NextDecodeIdx{0};
+    size_t m_szLastFrameBytes{0};
+    bool m_bDecoding{false};
+    bool m_bEof{false};
+    bool m_bDecodeFailed{false};
+    uint32_t m_u32NullDecodeCount{0};
+    static const uint32_t MAX_NULL_DECODE_COUNT;
+};
+
+const uint32_t AnalysisSource_Impl::MAX_NULL_DECODE_COUNT = 8;
+
+class AnalysisSourceSubscription_Impl : public AnalysisSource::Subscription
+{
+public:
+    AnalysisSourceSubscription_Impl(shared_ptr<AnalysisSource_Impl> hSource) : m_hSource(hSource) {}
+
+    ~AnalysisSourceSubscription_Impl()
+    {
+        m_hSource->RemoveSubscriber(this);
+    }
+
+    AnalysisSource::ReadResult ReadFrame(SelfFreeAVFramePtr& hAvfrm) override
+    {
+        return m_hSource->ReadFrame(this, hAvfrm);
+    }
+
+    int64_t GetNextFrameIndex() const override
+    {
+        return m_hSource->GetNextFrameIndex(this);
+    }
+
+    uint32_t GetSubscriberCount() const override
+    {
+        return m_hSource->GetSubscriberCount();
+    }
+
+private:
+    shared_ptr<AnalysisSource_Impl> m_hSource;
+};
+
+static mutex _ANALYSIS_SOURCE_REGISTRY_LOCK;
+static unordered_map<string, weak_ptr<AnalysisSource_Impl>> _ANALYSIS_SOURCE_REGISTRY;
+
+AnalysisSource::Subscription::Holder AnalysisSource::Subscribe(MediaCore::VideoClip::Holder hVclip, int64_t i64StartFrameIdx)
+{
+    if (!hVclip)
+        return nullptr;
+    auto hSettings = hVclip->GetSharedSettings();
+    const auto tFrameRate = hSettings->VideoOutFrameRate();
+    ostringstream oss; oss << hVclip->GetMediaParser()->GetUrl() << "|" << hVclip->StartOffset() << "|" << hVclip->Duration()
+            << "|" << tFrameRate.num << "/" << tFrameRate.den << "|" << hVclip->OutWidth() << "x" << hVclip->OutHeight();
+    const auto strKey = oss.str();
+
+    shared_ptr<AnalysisSource_Impl> hSource;
+    {
+        lock_guard<mutex> _lk(_ANALYSIS_SOURCE_REGISTRY_LOCK);
+        auto iter = _ANALYSIS_SOURCE_REGISTRY.find(strKey);
+        if (iter != _ANALYSIS_SOURCE_REGISTRY.end())
+            hSource = iter->second.lock();
+        if (!hSource)
+        {
+            // the shared source uses its own clip instance, so the subscriber's clip is still usable as a fallback
+            auto hSrcVclip = hVclip->Clone(hSettings);
+            if (!hSrcVclip)
+                return nullptr;
+            hSource = make_shared<AnalysisSource_Impl>(strKey, hSrcVclip);
+            _ANALYSIS_SOURCE_REGISTRY[strKey] = hSource;
+        }
+        for (auto it = _ANALYSIS_SOURCE_REGISTRY.begin(); it != _ANALYSIS_SOURCE_REGISTRY.end();)
+        {
+            if (it->second.expired())
+                it = _ANALYSIS_SOURCE_REGISTRY.erase(it);
+            else
+                it++;
+        }
+    }
+    auto pSubscription = new AnalysisSourceSubscription_Impl(hSource);
+    if (!hSource->AddSubscriber(pSubscription, i64StartFrameIdx))
+    {
+        delete pSubscription;
+        return nullptr;
+    }
+    return AnalysisSource::Subscription::Holder(pSubscription);
+}
+
+void AnalysisSource::SetMemoryBudget(size_t szBytes)
+{
+    _ANALYSIS_SOURCE_MEMORY_BUDGET = szBytes;
+}
+
+size_t AnalysisSource::GetMemoryBudget()
+{
+    return _ANALYSIS_SOURCE_MEMORY_BUDGET;
+}
+
+size_t AnalysisSource::GetMemoryUsage()
+{
+    return _ANALYSIS_SOURCE_MEMORY_USAGE;
+}
+
+uint32_t BackgroundTaskScheduler::GetCostUnits(BackgroundTask::CostClass eCostClass)
+{
+    switch (eCostClass)
+    {
+    case BackgroundTask::COST_LIGHT: return 1;
+    case BackgroundTask::COST_MEDIUM: return 2;
+    default: return 4;
+    }
+}
+
+class BackgroundTaskScheduler_Impl : public BackgroundTaskScheduler
+{
+public:
+    BackgroundTaskScheduler_Impl(SysUtils::ThreadPoolExecutor::Holder hExctor) : m_hExctor(hExctor)
+    {
+        m_pLogger = GetLogger("BgtaskScheduler");
+        m_u32CpuBudget = max(thread::hardware_concurrency(), 2u);
+        m_u32ThreadCapacity = m_u32CpuBudget;
+        m_hExctor->SetMaxThreadCount(m_u32ThreadCapacity);
+        m_thDispatch = thread(&BackgroundTaskScheduler_Impl::DispatchProc, this);
+    }
+
+    ~BackgroundTaskScheduler_Impl()
+    {
+        Terminate();
+    }
+
+    bool EnqueueTask(BackgroundTask::Holder hTask) override
+    {
+        if (!hTask)
+            return false;
+        lock_guard<mutex> _lk(m_mtxLock);
+        if (m_bQuit)
+            return false;
+        auto itPending = find_if(m_aPendingTasks.begin(), m_aPendingTasks.end(), [hTask] (const _PendingTask& t) { return t.hTask == hTask; });
+        auto itRunning = find_if(m_aRunningTasks.begin(), m_aRunningTasks.end(), [hTask] (const _RunningTask& t) { return t.hTask == hTask; });
+        if (itPending != m_aPendingTasks.end() || itRunning != m_aRunningTasks.end())
+            return true;
+        m_aPendingTasks.push_back({hTask, m_u64EnqueueSeq++});
+        m_cvDispatch.notify_all();
+        return true;
+    }
+
+    void RemoveTask(BackgroundTask::Holder hTask) override
+    {
+        lock_guard<mutex> _lk(m_mtxLock);
+        auto itPending = find_if(m_aPendingTasks.begin(), m_aPendingTasks.end(), [hTask] (const _PendingTask& t) { return t.hTask == hTask; });
+        if (itPending != m_aPendingTasks.end())
+            m_aPendingTasks.erase(itPending);
+        // a running task stays accounted until it stops, its resources are still in use
+        m_cvDispatch.notify_all();
+    }
+
+    void SetCpuBudget(uint32_t u32Units) override
+    {
+        lock_guard<mutex> _lk(m_mtxLock);
+        m_u32CpuBudget = max(u32Units, 1u);
+        UpdateThreadCapacity();
+        m_cvDispatch.notify_all();
+    }
+
+    void SetMemoryBudget(size_t szBytes) override
+    {
+        lock_guard<mutex> _lk(m_mtxLock);
+        m_szMemoryBudget = szBytes;
+        m_cvDispatch.notify_all();
+    }
+
+    void SetThrottled(bool bThrottled) override
+    {
+        if (m_bThrottled == bThrottled)
+            return;
+        lock_guard<mutex> _lk(m_mtxLock);
+        m_bThrottled = bThrottled;
+        m_cvDispatch.notify_all();
+    }
+
+    bool IsThrottled() const override
+    {
+        return m_bThrottled;
+    }
+
+    Stats GetStats() const override
+    {
+        lock_guard<mutex> _lk(m_mtxLock);
+        Stats tStats;
+        tStats.u32QueuedCount = m_aPendingTasks.size();
+        for (const auto& t : m_aRunningTasks)
+        {
+            if (t.hTask->IsProcessing())
+                tStats.u32RunningCount++;
+            if (t.bPausedByThrottle)
+                tStats.u32ThrottledCount++;
+        }
+        tStats.u32FinishedCount = m_u32FinishedCount;
+        tStats.u32CpuUnitsInUse = m_u32CpuUnitsInUse;
+        tStats.u32CpuBudget = m_u32CpuBudget;
+        tStats.szMemoryInUse = m_szMemoryInUse;
+        tStats.szMemoryBudget = m_szMemoryBudget;
+        const auto tpNow = chrono::steady_clock::now();
+        const auto szRecentCount = count_if(m_aFinishTimePoints.begin(), m_aFinishTimePoints.end(), [tpNow] (const chrono::steady_clock::time_point& tp) {
+            return tpNow-tp < chrono::hours(1); });
+        tStats.fThroughput = (float)szRecentCount;
+        tStats.fAvgRunTime = m_u32FinishedCount > 0 ? (float)(m_dTotalRunTime/m_u32FinishedCount) : 0.f;
+        return tStats;
+    }
+
+    void Terminate() override
+    {
+        {
+            lock_guard<mutex> _lk(m_mtxLock);
+            if (m_bQuit)
+                return;
+            m_bQuit = true;
+        }
+        m_cvDispatch.notify_all();
+        if (m_thDispatch.joinable())
+            m_thDispatch.join();
+        // the throttling is lifted from the tasks, otherwise they can never be stopped by their owners
+        lock_guard<mutex> _lk(m_mtxLock);
+        for (auto& t : m_aRunningTasks)
+        {
+            if (t.bPausedByThrottle || t.bHeldForBudget)
+                t.hTask->SetThrottled(false);
+        }
+        m_aRunningTasks.clear();
+        m_aPendingTasks.clear();
+    }
+
+private:
+    struct _PendingTask
+    {
+        BackgroundTask::Holder hTask;
+        uint64_t u64Seq;
+    };
+
+    struct _RunningTask
+    {
+        BackgroundTask::Holder hTask;
+        uint32_t u32CostUnits;
+        size_t szMemory;
+        chrono::steady_clock::time_point tpStart;
+        bool bPausedByThrottle;
+        bool bHeldForBudget;    // resumed by the user or after the throttling, kept paused until its units fit in the budget
+        bool bUserPaused;
+        bool bUsingCpu;
+    };
+
+    void DispatchProc()
+    {
+        unique_lock<mutex> _lk(m_mtxLock);
+        while (!m_bQuit)
+        {
+            UpdateRunningTasks();
+            ApplyThrottle();
+            const bool bAllResumed = ResumeHeldTasks();
+            UpdateThreadCapacity();
+            if (bAllResumed)
+                AdmitPendingTasks();
+            m_cvDispatch.wait_for(_lk, chrono::milliseconds(100));
+        }
+    }
+
+    void UpdateRunningTasks()
+    {
+        const auto tpNow = chrono::steady_clock::now();
+        m_u32CpuUnitsInUse = 0;
+        m_szMemoryInUse = 0;
+        auto it = m_aRunningTasks.begin();
+        while (it != m_aRunningTasks.end())
+        {
+            auto& hTask = it->hTask;
+            if (hTask->IsStopped())
+            {
+                if (hTask->IsDone())
+                {
+                    m_u32FinishedCount++;
+                    m_dTotalRunTime += chrono::duration<double>(tpNow-it->tpStart).count();
+                    m_aFinishTimePoints.push_back(tpNow);
+                }
+                it = m_aRunningTasks.erase(it);
+                continue;
+            }
+            // a task resumed by the user goes through the admission again before it takes its units
+            const bool bUserPaused = hTask->IsUserPaused();
+            if (it->bUserPaused && !bUserPaused && !it->bHeldForBudget)
+            {
+                it->bHeldForBudget = true;
+                UpdateSchedulerPause(*it);
+            }
+            it->bUserPaused = bUserPaused;
+            // a paused task doesn't use CPU, but still holds its memory and its executor thread
+            it->bUsingCpu = !it->bHeldForBudget && !hTask->IsPaused();
+            if (it->bUsingCpu)
+                m_u32CpuUnitsInUse += it->u32CostUnits;
+            m_szMemoryInUse += it->szMemory;
+            it++;
+        }
+        while (!m_aFinishTimePoints.empty() && tpNow-m_aFinishTimePoints.front() >= chrono::hours(1))
+            m_aFinishTimePoints.pop_front();
+    }
+
+    void ApplyThrottle()
+    {
+        for (auto& t : m_aRunningTasks)
+        {
+            // the throttling pause is tracked by the task apart from the user pause, lifting it won't resume a task paused by the user
+            if (m_bThrottled)
+            {
+                if (!t.bPausedByThrottle && t.hTask->GetCostClass() != BackgroundTask::COST_LIGHT)
+                {
+                    t.bPausedByThrottle = true;
+                    UpdateSchedulerPause(t);
+                    m_pLogger->Log(DEBUG) << "Pause task " << t.hTask.get() << " for throttling." << endl;
+                }
+            }
+            else if (t.bPausedByThrottle)
+            {
+                // the light tasks started during the throttling may use the units, the task is resumed by 'ResumeHeldTasks()'
+                t.bPausedByThrottle = false;
+                t.bHeldForBudget = true;
+                m_pLogger->Log(DEBUG) << "Release task " << t.hTask.get() << " from throttling." << endl;
+            }
+        }
+    }
+
+    void UpdateSchedulerPause(_RunningTask& t)
+    {
+        t.hTask->SetThrottled(t.bPausedByThrottle || t.bHeldForBudget);
+    }
+
+    // Resume the held tasks in the order of starting, returns false if any of them doesn't fit in the budget,
+    // the pending tasks are not admitted before it.
+    bool ResumeHeldTasks()
+    {
+        for (auto& t : m_aRunningTasks)
+        {
+            if (!t.bHeldForBudget || t.bUserPaused || (m_bThrottled && t.hTask->GetCostClass() != BackgroundTask::COST_LIGHT))
+                continue;
+            if (m_u32CpuUnitsInUse > 0 && m_u32CpuUnitsInUse+t.u32CostUnits > m_u32CpuBudget)
+                return false;
+            t.bHeldForBudget = false;
+            t.bUsingCpu = true;
+            UpdateSchedulerPause(t);
+            m_u32CpuUnitsInUse += t.u32CostUnits;
+            m_pLogger->Log(DEBUG) << "Resume task " << t.hTask.get() << "." << endl;
+        }
+        return true;
+    }
+
+    // A paused task keeps its executor thread, the executor gets one more thread for each of them, so the running tasks
+    // still have the threads of the whole budget.
+    void UpdateThreadCapacity()
+    {
+        const auto u32ParkedCount = (uint32_t)count_if(m_aRunningTasks.begin(), m_aRunningTasks.end(), [] (const _RunningTask& t) {
+            return !t.bUsingCpu; });
+        const auto u32Capacity = m_u32CpuBudget+u32ParkedCount;
+        if (u32Capacity == m_u32ThreadCapacity)
+            return;
+        m_u32ThreadCapacity = u32Capacity;
+        m_hExctor->SetMaxThreadCount(m_u32ThreadCapacity);
+    }
+
+    void AdmitPendingTasks()
+    {
+        m_aPendingTasks.remove_if([] (const _PendingTask& t) { return t.hTask->IsCancelled(); });
+        if (m_aPendingTasks.empty())
+            return;
+        m_aPendingTasks.sort([] (const _PendingTask& a, const _PendingTask& b) {
+            const auto iPriA = a.hTask->GetPriority(), iPriB = b.hTask->GetPriority();
+            return iPriA != iPriB ? iPriA > iPriB : a.u64Seq < b.u64Seq; });
+        auto it = m_aPendingTasks.begin();
+        while (it != m_aPendingTasks.end())
+        {
+            auto hTask = it->hTask;
+            const auto eCostClass = hTask->GetCostClass();
+            // a task paused before it's started is kept off the executor, it would block a thread until it's resumed
+            if ((m_bThrottled && eCostClass != BackgroundTask::COST_LIGHT) || hTask->IsUserPaused())
+            {
+                it++;
+                continue;
+            }
+            const auto u32RequestedUnits = hTask->GetRequestedCpuUnits();
+            const auto u32CostUnits = u32RequestedUnits > 0 ? min(u32RequestedUnits, m_u32CpuBudget) : GetCostUnits(eCostClass);
+            const auto szMemory = hTask->GetEstimatedMemoryUsage();
+            const bool bIdle = m_aRunningTasks.empty();
+            // stop at the first task that doesn't fit, so a large task won't be starved by the smaller ones behind it
+            if (!bIdle && (m_u32CpuUnitsInUse+u32CostUnits > m_u32CpuBudget || m_szMemoryInUse+szMemory > m_szMemoryBudget
+                    || m_aRunningTasks.size() >= m_u32ThreadCapacity))
+                break;
+            hTask->SetGrantedCpuUnits(u32CostUnits);
+            if (!m_hExctor->EnqueueTask(hTask))
+            {
+                m_pLogger->Log(Error) << "FAILED to enqueue background task " << hTask.get() << " into the executor!" << endl;
+                break;
+            }
+            m_aRunningTasks.push_back({hTask, u32CostUnits, szMemory, chrono::steady_clock::now(), false, false, false, true});
+            m_u32CpuUnitsInUse += u32CostUnits;
+            m_szMemoryInUse += szMemory;
+            it = m_aPendingTasks.erase(it);
+        }
+    }
+
+private:
+    ALogger* m_pLogger;
+    SysUtils::ThreadPoolExecutor::Holder m_hExctor;
+    mutable mutex m_mtxLock;
+    condition_variable m_cvDispatch;
+    thread m_thDispatch;
+    bool m_bQuit{false};
+    atomic_bool m_bThrottled{false};
+    list<_PendingTask> m_aPendingTasks;
+    list<_RunningTask> m_aRunningTasks;
+    uint64_t m_u64EnqueueSeq{0};
+    uint32_t m_u32CpuBudget;
+    uint32_t m_u32ThreadCapacity;
+    size_t m_szMemoryBudget{2048ULL*1024*1024};
+    uint32_t m_u32CpuUnitsInUse{0};
+    size_t m_szMemoryInUse{0};
+    uint32_t m_u32FinishedCount{0};
+    double m_dTotalRunTime{0};
+    deque<chrono::steady_clock::time_point> m_aFinishTimePoints;
+};
+
+BackgroundTaskScheduler::Holder BackgroundTaskScheduler::CreateInstance(SysUtils::ThreadPoolExecutor::Holder hExctor)
+{
+    if (!hExctor)
+        return nullptr;
+    return BackgroundTaskScheduler::Holder(new BackgroundTaskScheduler_Impl(hExctor));
+}
+
+static const char _ANALYSIS_DATA_FILE_MAGIC[4] = { 'M', 'E', 'C', 'S' };
+static const uint16_t _ANALYSIS_DATA_FILE_VERSION = 1;
+static const uint16_t _ANALYSIS_DATA_ELEMTYPE_FLOAT32 = 1;
+
+struct _AnalysisDataFileHeader
+{
+    char acMagic[4];
+    uint16_t u16Version;
+    uint16_t u16ElemType;
+    uint64_t u64Count;
+    uint64_t u64Checksum;
+};
+static_assert(sizeof(_AnalysisDataFileHeader) == 24, "Unexpected size of '_AnalysisDataFileHeader'!");
+
+// 64-bit FNV-1a
+static const uint64_t _CHECKSUM_INIT_VALUE = 0xcbf29ce484222325ULL;
+static uint64_t _UpdateChecksum(uint64_t u64Hash, const uint8_t* pData, size_t szBytes)
+{
+    for (size_t i = 0; i < szBytes; i++)
+    {
+        u64Hash ^= pData[i];
+        u64Hash *= 0x100000001b3ULL;
+    }
+    return u64Hash;
+}
+
+static string _ChecksumToString(uint64_t u64Checksum)
+{
+    ostringstream oss; oss << setw(16) << setfill('0') << hex << u64Checksum;
+    return oss.str();
+}
+
+bool AnalysisDataFile::SaveFloatSeries(const string& strDir, const string& strFileName, const float* pValues, size_t szCount,
+        json::value& jnRef, string& strErrMsg)
+{
+    const auto strPath = strDir.empty() ? strFileName : SysUtils::JoinPath(strDir, strFileName);
+    const auto strTmpPath = strPath+".tmp";
+    _AnalysisDataFileHeader tHeader;
+    memcpy(tHeader.acMagic, _ANALYSIS_DATA_FILE_MAGIC, sizeof(tHeader.acMagic));
+    tHeader.u16Version = _ANALYSIS_DATA_FILE_VERSION;
+    tHeader.u16ElemType = _ANALYSIS_DATA_ELEMTYPE_FLOAT32;
+    tHeader.u64Count = szCount;
+    tHeader.u64Checksum = _UpdateChecksum(_CHECKSUM_INIT_VALUE, (const uint8_t*)pValues, szCount*sizeof(float));
+    // a partial temp file is never left behind
+    auto RemoveTmpFile = [&strTmpPath] {
+        if (SysUtils::Exists(strTmpPath))
+            SysUtils::DeleteFileAt(strTmpPath);
+    };
+    {
+        ofstream ofs(strTmpPath, ios::out|ios::binary|ios::trunc);
+        if (!ofs.is_open())
+        {
+            ostringstream oss; oss << "FAILED to open file '" << strTmpPath << "' for writing!";
+            strErrMsg = oss.str();
+            RemoveTmpFile();
+            return false;
+        }
+        ofs.write((const char*)&tHeader, sizeof(tHeader));
+        if (szCount > 0)
+            ofs.write((const char*)pValues, szCount*sizeof(float));
+        ofs.close();
+        if (ofs.fail())
+        {
+            ostringstream oss; oss << "FAILED to write " << szCount << " values into file '" << strTmpPath << "'!";
+            strErrMsg = oss.str();
+            RemoveTmpFile();
+            return false;
+        }
+    }
+    // replace the old file only after the new one is completely written
+    if (SysUtils::Exists(strPath))
+        SysUtils::DeleteFileAt(strPath);
+    if (!SysUtils::RenameFile(strTmpPath, strPath))
+    {
+        ostringstream oss; oss << "FAILED to rename file '" << strTmpPath << "' to '" << strPath << "'!";
+        strErrMsg = oss.str();
+        RemoveTmpFile();
+        return false;
+    }
+    jnRef = json::value();
+    jnRef["file"] = strFileName;
+    jnRef["count"] = json::number(szCount);
+    jnRef["checksum"] = _ChecksumToString(tHeader.u64Checksum);
+    return true;
+}
+
+bool AnalysisDataFile::LoadFloatSeries(const string& strDir, const json::value& jnRef, vector<float>& aValues, string& strErrMsg)
+{
+    if (!IsReference(jnRef))
+    {
+        strErrMsg = "INVALID analysis data file reference!";
+        return false;
+    }
+    const string strFileName = jnRef["file"].get<json::string>();
+    const string strChecksum = jnRef["checksum"].get<json::string>();
+    const auto strPath = strDir.empty() ? strFileName : SysUtils::JoinPath(strDir, strFileName);
+    ifstream ifs(strPath, ios::in|ios::binary);
+    if (!ifs.is_open())
+    {
+        ostringstream oss; oss << "FAILED to open analysis data file '" << strPath << "'!";
+        strErrMsg = oss.str();
+        return false;
+    }
+    _AnalysisDataFileHeader tHeader;
+    ifs.read((char*)&tHeader, sizeof(tHeader));
+    if (!ifs.good() || memcmp(tHeader.acMagic, _ANALYSIS_DATA_FILE_MAGIC, sizeof(tHeader.acMagic)) != 0
+        || tHeader.u16Version != _ANALYSIS_DATA_FILE_VERSION || tHeader.u16ElemType != _ANALYSIS_DATA_ELEMTYPE_FLOAT32)
+    {
+        ostringstream oss; oss << "'" << strPath << "' is NOT a valid analysis data file of float values!";
+        strErrMsg = oss.str();
+        return false;
+    }
+    if (_ChecksumToString(tHeader.u64Checksum) != strChecksum)
+    {
+        ostringstream oss; oss << "Checksum of analysis data file '" << strPath << "' is " << _ChecksumToString(tHeader.u64Checksum)
+                << ", which does NOT match the expected value " << strChecksum << "!";
+        strErrMsg = oss.str();
+        return false;
+    }
+    vector<float> aReadValues(tHeader.u64Count);
+    if (tHeader.u64Count > 0)
+        ifs.read((char*)aReadValues.data(), tHeader.u64Count*sizeof(float));
+    if (!ifs.good() || _UpdateChecksum(_CHECKSUM_INIT_VALUE, (const uint8_t*)aReadValues.data(), aReadValues.size()*sizeof(float)) != tHeader.u64Checksum)
+    {
+        ostringstream oss; oss << "Content of analysis data file '" << strPath << "' is corrupted!";
+        strErrMsg = oss.str();
+        return false;
+    }
+    aValues = std::move(aReadValues);
+    return true;
+}
+
+bool AnalysisDataFile::CalcFileChecksum(const string& strPath, string& strChecksum)
+{
+    ifstream ifs(strPath, ios::in|ios::binary);
+    if (!ifs.is_open())
+        return false;
+    uint64_t u64Hash = _CHECKSUM_INIT_VALUE;
+    vector<char> aBuffer(1024*1024);
+    while (ifs)
+    {
+        ifs.read(aBuffer.data(), aBuffer.size());
+        const auto szRead = ifs.gcount();
+        if (szRead <= 0)
+            break;
+        u64Hash = _UpdateChecksum(u64Hash, (const uint8_t*)aBuffer.data(), (size_t)szRead);
+    }
+    strChecksum = _ChecksumToString(u64Hash);
+    return true;
+}
+
+bool AnalysisDataFile::IsReference(const json::value& jnRef)
+{
+    return jnRef.is_object() && jnRef.contains("file") && jnRef["file"].is_string()
+            && jnRef.contains("checksum") && jnRef["checksum"].is_string();
+}
+}
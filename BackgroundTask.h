@@ -1,12 +1,15 @@
 #pragma once
 #include <string>
 #include <memory>
+#include <vector>
 #include <imgui_json.h>
 #include <BaseUtils/ThreadUtils.h>
 #include <BaseUtils/Logger.h>
 #include <MediaCore/SharedSettings.h>
 #include <MediaCore/MediaParser.h>
+#include <MediaCore/VideoClip.h>
 #include <MediaCore/TextureManager.h>
+#include <MediaCore/FFUtils.h>
 
 namespace MEC
 {
@@ -24,9 +27,31 @@ namespace MEC
         };
         virtual void SetCallbacks(Callbacks* pCb) = 0;
 
+        // Estimated CPU cost of a task, used by 'BackgroundTaskScheduler' to decide how many tasks can run together
+        enum CostClass
+        {
+            COST_LIGHT = 0,     // decoding plus light-weight analysis on one thread
+            COST_MEDIUM,        // decoding plus full-size filtering
+            COST_HEAVY,         // decoding, filtering and encoding, or analysis on multiple threads
+        };
+        virtual CostClass GetCostClass() const = 0;
+        // CPU cost units the task can make use of, e.g. the count of its worker threads, 0 means the units of its cost class.
+        // The scheduler grants at most its whole CPU budget, and reports the granted units before the task is started.
+        virtual uint32_t GetRequestedCpuUnits() const { return 0; }
+        virtual void SetGrantedCpuUnits(uint32_t u32Units) {}
+        virtual size_t GetEstimatedMemoryUsage() const = 0;
+        // Tasks with higher priority are started earlier, tasks with the same priority are started in the order of enqueueing.
+        virtual int GetPriority() const = 0;
+        virtual void SetPriority(int iPriority) = 0;
+
         virtual bool Pause() = 0;
         virtual bool IsPaused() const = 0;
+        // Whether the task is held paused by 'Pause()', regardless of whether its threads have reached a pause point yet
+        virtual bool IsUserPaused() const = 0;
         virtual bool Resume() = 0;
+        // Pause or resume the task for the scheduler throttling. It is tracked apart from 'Pause()' and 'Resume()' by the user,
+        // the task runs only when neither of them holds it paused.
+        virtual void SetThrottled(bool bThrottled) = 0;
         virtual bool DrawContent(const ImVec2& v2ViewSize) = 0;
         virtual void DrawContentCompact() = 0;
         virtual std::string GetTaskDir() const = 0;
@@ -36,4 +61,92 @@ namespace MEC
         virtual std::string GetError() const = 0;
         virtual void SetLogLevel(Logger::Level l) = 0;
     };
+
+    // Shared decoding stage for analysis tasks. Tasks working on the same source range subscribe to one
+    // 'AnalysisSource' instance, which decodes each frame only once and hands a reference of it to every
+    // subscriber. Frames that are decoded but not yet consumed by all the subscribers are held in a window,
+    // the total size of all the windows is limited by a global memory budget.
+    struct AnalysisSource
+    {
+        enum ReadResult
+        {
+            READ_OK = 0,
+            READ_EOF,
+            READ_AGAIN,     // the frame is being decoded by another subscriber, or the memory budget is used up, the call has already waited a while so it can be retried at once
+            READ_FAILED,
+        };
+
+        struct Subscription
+        {
+            using Holder = std::shared_ptr<Subscription>;
+
+            virtual ReadResult ReadFrame(SelfFreeAVFramePtr& hAvfrm) = 0;
+            virtual int64_t GetNextFrameIndex() const = 0;
+            virtual uint32_t GetSubscriberCount() const = 0;
+        };
+
+        // Subscribe to the shared source of the range defined by 'hVclip', reading starts from 'i64StartFrameIdx'.
+        // Returns null if the start frame is no longer available in the shared window, the caller should decode by itself.
+        // Releasing the returned holder ends the subscription.
+        static Subscription::Holder Subscribe(MediaCore::VideoClip::Holder hVclip, int64_t i64StartFrameIdx);
+        static void SetMemoryBudget(size_t szBytes);
+        static size_t GetMemoryBudget();
+        static size_t GetMemoryUsage();
+    };
+
+    // Admits background tasks into a 'ThreadPoolExecutor' by priority, under a CPU and a memory budget. The CPU budget
+    // is counted in cost units, 1, 2 and 4 units for a light, medium and heavy task, unless the task requests its own
+    // count of units, which is limited to the whole budget. The budgets are only checked when
+    // a task is started, a task larger than the whole budget still runs when nothing else is running.
+    // While the scheduler is throttled, e.g. the timeline is playing, only light tasks are started and the running tasks
+    // of the other classes are paused. Those are resumed once the throttling ends.
+    // A paused task doesn't count in the CPU budget but keeps its executor thread, the executor is given an extra thread
+    // for it. A task resumed by the user or after the throttling is admitted again before the pending tasks, and stays
+    // paused until its units fit in the budget. A task paused before it's started is not admitted until it's resumed.
+    struct BackgroundTaskScheduler
+    {
+        using Holder = std::shared_ptr<BackgroundTaskScheduler>;
+        static Holder CreateInstance(SysUtils::ThreadPoolExecutor::Holder hExctor);
+        static uint32_t GetCostUnits(BackgroundTask::CostClass eCostClass);
+
+        struct Stats
+        {
+            uint32_t u32QueuedCount{0};
+            uint32_t u32RunningCount{0};
+            uint32_t u32ThrottledCount{0};      // running tasks paused by the throttling
+            uint32_t u32FinishedCount{0};
+            uint32_t u32CpuUnitsInUse{0};
+            uint32_t u32CpuBudget{0};
+            size_t szMemoryInUse{0};
+            size_t szMemoryBudget{0};
+            float fThroughput{0.f};             // finished tasks per hour, counted in the last hour
+            float fAvgRunTime{0.f};             // average run time of the finished tasks in seconds
+        };
+
+        virtual bool EnqueueTask(BackgroundTask::Holder hTask) = 0;
+        virtual void RemoveTask(BackgroundTask::Holder hTask) = 0;
+        virtual void SetCpuBudget(uint32_t u32Units) = 0;
+        virtual void SetMemoryBudget(size_t szBytes) = 0;
+        virtual void SetThrottled(bool bThrottled) = 0;
+        virtual bool IsThrottled() const = 0;
+        virtual Stats GetStats() const = 0;
+        virtual void Terminate() = 0;
+    };
+
+    // Binary sidecar files for large numeric series produced by analysis tasks, e.g. per-frame diff scores. A file has
+    // a 24-byte header ('MECS' magic, version, element type, element count and payload checksum) followed by the raw
+    // little-endian values, so it can be memory mapped as is. The task json or the media item meta data only keeps a
+    // reference to the file, which is a json object with 'file', 'count' and 'checksum' attributes.
+    struct AnalysisDataFile
+    {
+        // Write 'szCount' values into 'strFileName' under 'strDir', and fill 'jnRef' with the reference to it.
+        // If 'strDir' is empty, 'strFileName' is used as the full path.
+        static bool SaveFloatSeries(const std::string& strDir, const std::string& strFileName, const float* pValues, size_t szCount,
+                imgui_json::value& jnRef, std::string& strErrMsg);
+        // Read the values referenced by 'jnRef'. Fails if the file is missing or its content does not match the checksum in 'jnRef'.
+        static bool LoadFloatSeries(const std::string& strDir, const imgui_json::value& jnRef, std::vector<float>& aValues, std::string& strErrMsg);
+        // Checksum of an arbitrary file, used to reference sidecar files with other formats, e.g. the vid.stab '.trf' file.
+        static bool CalcFileChecksum(const std::string& strPath, std::string& strChecksum);
+        static bool IsReference(const imgui_json::value& jnRef);
+    };
 }
@@ -0,0 +1,923 @@
+#include <cstdint>
+#include <sstream>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <ios>
+#include <iomanip>
+#include <vector>
+#include <cmath>
+#include <filesystem>
+#include <BaseUtils/TimeUtils.h>
+#include <BaseUtils/FileSystemUtils.h>
+#include <MediaCore/MediaParser.h>
+#include <MediaCore/VideoClip.h>
+#include <MediaCore/MediaEncoder.h>
+#include <MediaCore/FFUtils.h>
+#include <imgui.h>
+#include "BackgroundTask.h"
+#include "MediaTimeline.h"
+extern "C"
+{
+#include "libavutil/avutil.h"
+#include "libavutil/pixdesc.h"
+#include "libavfilter/avfilter.h"
+#include "libavfilter/buffersrc.h"
+#include "libavfilter/buffersink.h"
+#include "libavformat/avformat.h"
+}
+
+
+namespace json = imgui_json;
+namespace fs = std::filesystem;
+using namespace std;
+using namespace Logger;
+
+namespace MEC
+{
+// Transcode a media file into a low resolution, intra-frame only proxy. Every frame of the proxy is a key frame, so seeking
+// and scrubbing on it only decodes one small frame, the preview of the timeline switches to the proxy once it's ready.
+// The proxy is written beside the final location and renamed into place after encoding succeeded, so a proxy file
+// found in the cache is always complete.
+class BgtaskProxy : public BackgroundTask
+{
+public:
+    BgtaskProxy(const string& name) : m_name(name)
+    {
+        m_pLogger = GetLogger(name);
+    }
+
+    ~BgtaskProxy()
+    {
+        ReleaseFilterGraph();
+        ReleaseEncoder();
+    }
+
+    bool Initialize(const json::value& jnTask, MediaCore::SharedSettings::Holder hSettings)
+    {
+        string strAttrName;
+        // read 'task_dir'
+        strAttrName = "task_dir";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_string())
+        {
+            m_strTaskDir = jnTask[strAttrName].get<json::string>();
+            if (!SysUtils::IsDirectory(m_strTaskDir))
+            {
+                ostringstream oss; oss << "INVALID task json attribute '" << strAttrName << "'! '" << m_strTaskDir << "' is NOT a DIRECTORY.";
+                m_errMsg = oss.str();
+                return false;
+            }
+            strAttrName = "task_hash";
+            if (!jnTask.contains(strAttrName) || !jnTask[strAttrName].is_number())
+            {
+                ostringstream oss; oss << "Task json must has a '" << strAttrName << "' attribute of 'number' type!";
+                m_errMsg = oss.str();
+                return false;
+            }
+            m_szHash = (size_t)jnTask[strAttrName].get<json::number>();
+        }
+        else
+        {
+            strAttrName = "project_dir";
+            if (!jnTask.contains(strAttrName) || !jnTask[strAttrName].is_string())
+            {
+                ostringstream oss; oss << "Task json must has a '" << strAttrName << "' attribute of 'string' type!";
+                m_errMsg = oss.str();
+                return false;
+            }
+            string strAttrValue = jnTask[strAttrName].get<json::string>();
+            if (!SysUtils::IsDirectory(strAttrValue))
+            {
+                ostringstream oss; oss << "INVALID task json attribute '" << strAttrName << "'! '" << strAttrValue << "' is NOT a DIRECTORY.";
+                m_errMsg = oss.str();
+                return false;
+            }
+            m_szHash = SysUtils::GetTickHash();
+            ostringstream oss; oss << m_name << "-" << setw(16) << setfill('0') << hex << m_szHash;
+            const auto strWorkDirName = oss.str();
+            m_strTaskDir = SysUtils::JoinPath(strAttrValue, strWorkDirName);
+            if (!SysUtils::IsDirectory(m_strTaskDir))
+                SysUtils::CreateDirectoryAt(m_strTaskDir, true);
+        }
+        // read 'source_url'
+        strAttrName = "source_url";
+        if (!jnTask.contains(strAttrName) || !jnTask[strAttrName].is_string())
+        {
+            ostringstream oss; oss << "Task json must has a '" << strAttrName << "' attribute of 'string' type!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        m_strSrcUrl = jnTask[strAttrName].get<json::string>();
+        if (!SysUtils::IsFile(m_strSrcUrl))
+        {
+            ostringstream oss; oss << "INVALID task json attribute '" << strAttrName << "'! '" << m_strSrcUrl << "' is NOT a FILE.";
+            m_errMsg = oss.str();
+            return false;
+        }
+        // read 'proxy_path'
+        strAttrName = "proxy_path";
+        if (!jnTask.contains(strAttrName) || !jnTask[strAttrName].is_string())
+        {
+            ostringstream oss; oss << "Task json must has a '" << strAttrName << "' attribute of 'string' type!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        m_strProxyPath = jnTask[strAttrName].get<json::string>();
+        if (m_strProxyPath.empty())
+        {
+            ostringstream oss; oss << "INVALID task json attribute '" << strAttrName << "'! This argument CANNOT be EMPTY.";
+            m_errMsg = oss.str();
+            return false;
+        }
+        // read 'media_item_id'
+        strAttrName = "media_item_id";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_number())
+            m_i64MediaItemId = jnTask[strAttrName].get<json::number>();
+        else
+            m_i64MediaItemId = -1;
+        // create MediaParser instance
+        auto hParser = MediaCore::MediaParser::CreateInstance();
+        if (!hParser)
+        {
+            m_errMsg = "FAILED to create MediaParser instance!";
+            return false;
+        }
+        if (!hParser->Open(m_strSrcUrl))
+        {
+            ostringstream oss; oss << "FAILED to open media parser for '" << m_strSrcUrl << "'! Error is '" << hParser->GetError() << "'.";
+            m_errMsg = oss.str();
+            return false;
+        }
+        m_pVidstm = hParser->GetBestVideoStream();
+        if (!m_pVidstm || m_pVidstm->isImage)
+        {
+            ostringstream oss; oss << "FAILED to find video stream in '" << m_strSrcUrl << "'!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        // read 'proxy_height', the proxy keeps the aspect ratio of the source and is never larger than it
+        strAttrName = "proxy_height";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_number())
+        {
+            auto numValue = jnTask[strAttrName].get<json::number>();
+            if (numValue >= 64)
+                m_u32ProxyHeight = (uint32_t)numValue;
+            else
+            {
+                ostringstream oss; oss << "INVALID argument '" << strAttrName << "'! The valid value should be an integer in the range of [64, +inf), while the provided value is "
+                        << numValue << ".";
+                m_errMsg = oss.str();
+                return false;
+            }
+        }
+        const uint32_t u32OutH = min(m_u32ProxyHeight, m_pVidstm->height)&~1u;
+        const uint32_t u32OutW = ((uint32_t)round((double)m_pVidstm->width*u32OutH/m_pVidstm->height)+1)&~1u;
+        // the proxy is decoded with the source attributes, only the size of the output differs
+        m_hSettings = MediaCore::SharedSettings::CreateInstance();
+        m_hSettings->SetVideoOutWidth(u32OutW);
+        m_hSettings->SetVideoOutHeight(u32OutH);
+        m_hSettings->SetVideoOutFrameRate(m_pVidstm->realFrameRate);
+        MediaCore::HwaccelManager::Holder hHwMgr;
+        if (hSettings)
+            hHwMgr = hSettings->GetHwaccelManager();
+        m_hSettings->SetHwaccelManager(hHwMgr ? hHwMgr : MediaCore::HwaccelManager::GetDefaultInstance());
+        // create VideoClip instance on the whole source
+        const int64_t i64SrcDuration = static_cast<int64_t>(m_pVidstm->duration*1000);
+        m_hVclip = MediaCore::VideoClip::CreateVideoInstance(m_i64MediaItemId, hParser, m_hSettings, 0, i64SrcDuration, 0, 0, 0, true);
+        if (!m_hVclip)
+        {
+            ostringstream oss; oss << "FAILED to create VideoClip instance for '" << m_strSrcUrl << "' with duration " << i64SrcDuration << ".";
+            m_errMsg = oss.str();
+            return false;
+        }
+        // read encoder parameters
+        strAttrName = "videnc_codec";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_string())
+        {
+            m_strVidencCodecName = jnTask[strAttrName].get<json::string>();
+            if (m_strVidencCodecName.empty())
+            {
+                ostringstream oss; oss << "INVALID argument '" << strAttrName << "'! This argument CANNOT be EMPTY.";
+                m_errMsg = oss.str();
+                return false;
+            }
+        }
+        else
+        {
+            m_strVidencCodecName = "h264";
+        }
+        strAttrName = "videnc_bitrate";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_number())
+            m_u64VidencBitrate = (uint64_t)jnTask[strAttrName].get<json::number>();
+        else
+        {
+            // intra-only frames need about twice the bits of the inter-coded ones at the same quality
+            const auto& tFrameRate = m_pVidstm->realFrameRate;
+            m_u64VidencBitrate = (uint64_t)((double)u32OutW*u32OutH*0.4*tFrameRate.num/(double)tFrameRate.den);
+        }
+        strAttrName = "priority";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_number())
+            m_iPriority = (int)jnTask[strAttrName].get<json::number>();
+        bool bFailed = false;
+        strAttrName = "is_task_failed";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_boolean())
+            bFailed = jnTask[strAttrName].get<json::boolean>();
+        if (bFailed)
+        {
+            strAttrName = "error_message";
+            if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_string())
+                m_errMsg = jnTask[strAttrName].get<json::string>();
+            SetState(DONE);
+        }
+
+        // the tasks of different projects can transcode the same media at the same time, each one writes its own partial file
+        ostringstream oss; oss << SysUtils::ExtractFileBaseName(m_strProxyPath) << "." << setw(16) << setfill('0') << hex << m_szHash
+                << ".partial" << SysUtils::ExtractFileExtName(m_strProxyPath);
+        m_strPartialPath = SysUtils::JoinPath(SysUtils::ExtractDirectoryPath(m_strProxyPath), oss.str());
+        m_bInited = true;
+        return true;
+    }
+
+    void SetCallbacks(Callbacks* pCb) override
+    {
+        m_pCb = pCb;
+    }
+
+    CostClass GetCostClass() const override
+    {
+        return COST_HEAVY;
+    }
+
+    size_t GetEstimatedMemoryUsage() const override
+    {
+        // the decoder holds about 16 frames of the source size, the scaler and the encoder only hold a few small ones
+        const size_t szFrameBytes = m_pVidstm ? (size_t)m_pVidstm->width*m_pVidstm->height*4 : 0;
+        return szFrameBytes*16;
+    }
+
+    int GetPriority() const override
+    {
+        return m_iPriority;
+    }
+
+    void SetPriority(int iPriority) override
+    {
+        m_iPriority = iPriority;
+    }
+
+    bool CanPause()
+    {
+        return m_eState == PROCESSING;
+    }
+
+    bool Pause() override
+    {
+        lock_guard<mutex> _lk(m_mtxPauseLock);
+        m_bUserPause = true;
+        UpdatePauseState();
+        return true;
+    }
+
+    bool IsPaused() const override
+    {
+        return m_bPause && m_bPauseCheckPointHit;
+    }
+
+    bool IsUserPaused() const override
+    {
+        return m_bUserPause;
+    }
+
+    bool Resume() override
+    {
+        {
+            lock_guard<mutex> _lk(m_mtxPauseLock);
+            m_bUserPause = false;
+            UpdatePauseState();
+        }
+        m_cvPause.notify_all();
+        return true;
+    }
+
+    void SetThrottled(bool bThrottled) override
+    {
+        {
+            lock_guard<mutex> _lk(m_mtxPauseLock);
+            m_bThrottlePause = bThrottled;
+            UpdatePauseState();
+        }
+        m_cvPause.notify_all();
+    }
+
+    bool Cancel() override
+    {
+        const bool bRet = BackgroundTask::Cancel();
+        // acquire the lock before notifying, so a thread just going to wait won't miss the wakeup
+        {
+            lock_guard<mutex> _lk(m_mtxPauseLock);
+        }
+        m_cvPause.notify_all();
+        return bRet;
+    }
+
+    bool DrawContent(const ImVec2& v2ViewSize) override
+    {
+        bool bRemoveThisTask = false;
+        ostringstream oss; oss << "##" << m_name << "-" << setw(16) << setfill('0') << hex << m_szHash;
+        const auto strTaskNameWithHash = oss.str();
+        auto strLabel = strTaskNameWithHash;
+        ImGui::BeginChild(strLabel.c_str(), v2ViewSize, ImGuiChildFlags_Border|ImGuiChildFlags_AutoResizeY);
+        const ImColor tTaskTitleClr(KNOWNIMGUICOLOR_WHITESMOKE);
+        const auto v2TextPadding = ImGui::GetStyle().FramePadding;
+        const auto orgFontScale = ImGui::GetFont()->Scale;
+        ImGui::GetFont()->Scale = 1.2f;
+        ImGui::PushFont(ImGui::GetFont());
+        ImGui::TextColoredWithPadding(tTaskTitleClr, v2TextPadding, "%s", TASK_TYPE_NAME.c_str()); ImGui::SameLine();
+        ImGui::GetFont()->Scale = orgFontScale;
+        ImGui::PopFont();
+        auto v2AvailSize = ImGui::GetContentRegionAvail();
+        auto v2CurrPos = ImGui::GetCursorPos();
+        ImGui::SetCursorPos(v2CurrPos+ImVec2(v2AvailSize.x-30*2, 0));
+        oss.str(""); oss << (IsPaused() ? ICON_PLAY_FORWARD : ICON_PAUSE) << strTaskNameWithHash;
+        strLabel = oss.str();
+        bool bDisableThisWidget = !CanPause();
+        ImGui::BeginDisabled(bDisableThisWidget);
+        if (ImGui::Button(strLabel.c_str()))
+        {
+            if (m_bUserPause)
+                Resume();
+            else
+                Pause();
+        } ImGui::SameLine();
+        ImGui::ShowTooltipOnHover(bDisableThisWidget
+                ? (m_eState == WAITING ? "Task hasn't started yet." : "Task is already stopped.")
+                : (m_bUserPause ? "Resume task" : "Pause task"));
+        ImGui::EndDisabled();
+        oss.str(""); oss << ICON_DELETE << strTaskNameWithHash;
+        strLabel = oss.str();
+        oss.str(""); oss << ICON_TRASH << " Task Deletion" << strTaskNameWithHash;
+        const auto strDelLabel = oss.str();
+        if (ImGui::Button(strLabel.c_str()))
+        {
+            ImGui::OpenPopup(strDelLabel.c_str());
+        }
+        ImGui::ShowTooltipOnHover("Delete this task. A finished proxy is kept in the cache.");
+        const ImColor tTagClr(KNOWNIMGUICOLOR_LIGHTGRAY);
+        ImGui::TextColoredWithPadding(tTagClr, v2TextPadding, "Source: "); ImGui::SameLine(0, 10);
+        ImGui::TextColoredWithPadding(ImColor(KNOWNIMGUICOLOR_LIGHTGREEN), v2TextPadding, "%s", SysUtils::ExtractFileName(m_strSrcUrl).c_str());
+        ImGui::ShowTooltipOnHover("Path: '%s'", m_strSrcUrl.c_str());
+        ImGui::TextColoredWithPadding(tTagClr, v2TextPadding, "Proxy: "); ImGui::SameLine(0, 10);
+        ImGui::TextColoredWithPadding(ImColor(KNOWNIMGUICOLOR_LIGHTGREEN), v2TextPadding, "%u x %u, %s intra", m_hSettings->VideoOutWidth(), m_hSettings->VideoOutHeight(), m_strVidencCodecName.c_str());
+        ImGui::TextColoredWithPadding(tTagClr, v2TextPadding, "State: "); ImGui::SameLine(0, 10);
+        switch (m_eState)
+        {
+        case WAITING:
+            ImGui::TextColoredWithPadding(ImColor(0.8f, 0.8f, 0.1f), v2TextPadding, "Waiting");
+            break;
+        case PROCESSING:
+            ImGui::TextColoredWithPadding(ImColor(0.3f, 0.3f, 0.85f), v2TextPadding, "Processing");
+            break;
+        case DONE:
+            ImGui::TextColoredWithPadding(ImColor(0.3f, 0.85f, 0.3f), v2TextPadding, "Done");
+            break;
+        case FAILED:
+            ImGui::TextColoredWithPadding(ImColor(0.85f, 0.3f, 0.3f), v2TextPadding, "FAILED");
+            ImGui::ShowTooltipOnHover("%s", m_errMsg.c_str());
+            break;
+        case CANCELLED:
+            ImGui::TextColoredWithPadding(ImColor(0.8f, 0.8f, 0.8f), v2TextPadding, "Cancelled");
+            break;
+        default:
+            ImGui::TextColoredWithPadding(ImColor(0.7f, 0.3f, 0.3f), v2TextPadding, "Unknown");
+        }
+        ImGui::TextColoredWithPadding(tTagClr, v2TextPadding, "Progress: "); ImGui::SameLine(0, 10);
+        ImGui::TextColoredWithPadding(ImColor(0.3f, 0.85f, 0.3f), v2TextPadding, "%.02f%%", m_fProgress*100);
+
+        if (ImGui::BeginPopupModal(strDelLabel.c_str(), nullptr, ImGuiWindowFlags_NoMove|ImGuiWindowFlags_NoResize|ImGuiWindowFlags_NoSavedSettings))
+        {
+            bool bClosePopup = false;
+            const ImColor tWarnMsgClr(KNOWNIMGUICOLOR_PALEVIOLETRED);
+            ImGui::TextColoredWithPadding(tWarnMsgClr, {10, 6}, "This task will be removed, an unfinished proxy is discarded!");
+            if (ImGui::Button("  OK  "))
+            {
+                Cancel(); WaitDone();
+                bRemoveThisTask = true;
+                bClosePopup = true;
+            } ImGui::SameLine();
+            if (ImGui::Button("Cancel"))
+                bClosePopup = true;
+            if (bClosePopup)
+                ImGui::CloseCurrentPopup();
+            ImGui::EndPopup();
+        }
+        ImGui::EndChild();
+        return bRemoveThisTask;
+    }
+
+    void DrawContentCompact() override
+    {
+
+    }
+
+    bool SaveAsJson(json::value& jnTask) override
+    {
+        jnTask = json::value();
+        // save basic info
+        jnTask["type"] = "Proxy";
+        jnTask["name"] = m_name;
+        jnTask["task_hash"] = json::number(m_szHash);
+        jnTask["task_dir"] = m_strTaskDir;
+        jnTask["source_url"] = m_strSrcUrl;
+        jnTask["media_item_id"] = json::number(m_i64MediaItemId);
+        jnTask["proxy_path"] = m_strProxyPath;
+        jnTask["proxy_height"] = json::number(m_u32ProxyHeight);
+        // save encoder parameters
+        jnTask["videnc_codec"] = m_strVidencCodecName;
+        jnTask["videnc_bitrate"] = json::number(m_u64VidencBitrate);
+        jnTask["priority"] = json::number(m_iPriority);
+        // save task status
+        jnTask["is_task_failed"] = IsFailed();
+        jnTask["error_message"] = m_errMsg;
+        return true;
+    }
+
+    string Save(const string& _strSavePath) override
+    {
+        json::value jnTask;
+        if (!SaveAsJson(jnTask))
+        {
+            m_pLogger->Log(Error) << "FAILED to save '" << m_name << "' as json!" << endl;
+            return "";
+        }
+        const auto strSavePath = _strSavePath.empty() ? SysUtils::JoinPath(m_strTaskDir, "task.json") : _strSavePath;
+        if (!jnTask.save(strSavePath))
+        {
+            m_pLogger->Log(Error) << "FAILED to save task json of '" << m_name << "' at location '" << strSavePath << "'!" << endl;
+            return "";
+        }
+        return strSavePath;
+    }
+
+    string GetTaskDir() const override
+    {
+        return m_strTaskDir;
+    }
+
+    string GetError() const override
+    {
+        return m_errMsg;
+    }
+
+    void SetLogLevel(Logger::Level l) override
+    {
+        m_pLogger->SetShowLevels(l);
+    }
+
+public:
+    static const string TASK_TYPE_NAME;
+
+protected:
+    bool _TaskProc () override
+    {
+        const bool bSucc = TranscodeProxy();
+        // the partial file is left only if the transcoding is cancelled or failed before it's moved to the proxy path
+        ReleaseEncoder();
+        if (SysUtils::IsFile(m_strPartialPath))
+            SysUtils::DeleteFileAt(m_strPartialPath);
+        return bSucc;
+    }
+
+    bool TranscodeProxy()
+    {
+        m_pLogger->Log(INFO) << "Start background task 'Proxy' for '" << m_strSrcUrl << "'." << endl;
+        if (!m_bInited)
+        {
+            ostringstream oss; oss << "Background task 'Proxy' with name '" << m_name << "' is NOT initialized!";
+            m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+            return false;
+        }
+        // the proxies are shared by the projects, it may be produced already by another task on the same media
+        if (SysUtils::IsFile(m_strProxyPath))
+        {
+            m_pLogger->Log(INFO) << "Proxy '" << m_strProxyPath << "' already exists, skip transcoding." << endl;
+            m_fProgress = 1.f;
+            return true;
+        }
+        const auto strProxyDir = SysUtils::ExtractDirectoryPath(m_strProxyPath);
+        if (!SysUtils::IsDirectory(strProxyDir) && !SysUtils::CreateDirectoryAt(strProxyDir, true))
+        {
+            ostringstream oss; oss << "FAILED to create proxy directory '" << strProxyDir << "'!";
+            m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+            return false;
+        }
+
+        m_fProgress = 0.f;
+        bool bFilterGraphInited = false;
+        bool bEncoderInited = false;
+        int64_t i64FrmIdx = 0;
+        const int64_t i64ClipDur = m_hVclip->Duration();
+        ImMatToAVFrameConverter tMat2AvfrmCvter;
+        const auto tFrameRate = m_hSettings->VideoOutFrameRate();
+        SelfFreeAVFramePtr hFgOutfrmPtr = AllocSelfFreeAVFramePtr();
+        while (!IsCancelled())
+        {
+            if (m_bPause)
+            {
+                if (!WaitWhilePaused())
+                    break;
+                continue;
+            }
+
+            int fferr;
+            SelfFreeAVFramePtr hFgInfrmPtr;
+            const int64_t i64ReadPos = round((double)i64FrmIdx*1000*tFrameRate.den/tFrameRate.num);
+            bool bEof = false;
+            auto hVfrm = m_hVclip->ReadSourceFrame(i64ReadPos, bEof, true);
+            ImMatWrapper_AVFrame tAvfrmWrapper;
+            if (hVfrm)
+            {
+                auto tNativeData = hVfrm->GetNativeData();
+                if (tNativeData.eType == MediaCore::VideoFrame::NativeData::AVFRAME)
+                    hFgInfrmPtr = CloneSelfFreeAVFramePtr((AVFrame*)tNativeData.pData);
+                else if (tNativeData.eType == MediaCore::VideoFrame::NativeData::AVFRAME_HOLDER)
+                    hFgInfrmPtr = *((SelfFreeAVFramePtr*)tNativeData.pData);
+                else if (tNativeData.eType == MediaCore::VideoFrame::NativeData::MAT)
+                {
+                    const auto& vmat = *((ImGui::ImMat*)tNativeData.pData);
+                    if (vmat.device != IM_DD_CPU)
+                    {
+                        hFgInfrmPtr = AllocSelfFreeAVFramePtr();
+                        tMat2AvfrmCvter.ConvertImage(vmat, hFgInfrmPtr.get(), i64FrmIdx);
+                    }
+                    else
+                    {
+                        tAvfrmWrapper.SetMat(vmat);
+                        hFgInfrmPtr = tAvfrmWrapper.GetWrapper(i64FrmIdx);
+                    }
+                }
+            }
+            if (hFgInfrmPtr)
+            {
+                hFgInfrmPtr->pts = i64FrmIdx;
+                if (!bFilterGraphInited)
+                {
+                    if (!SetupScaleFilterGraph(hFgInfrmPtr.get()))
+                    {
+                        m_pLogger->Log(Error) << "'SetupScaleFilterGraph()' FAILED! Error is '" << m_errMsg << "'." << endl;
+                        return false;
+                    }
+                    bFilterGraphInited = true;
+                }
+
+                fferr = av_buffersrc_add_frame(m_pBufsrcCtx, hFgInfrmPtr.get());
+                if (fferr < 0)
+                {
+                    ostringstream oss; oss << "Background task 'Proxy' FAILED when invoking 'av_buffersrc_add_frame()' at frame #" << i64FrmIdx
+                            << ". fferr=" << fferr << ".";
+                    m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+                    return false;
+                }
+
+                av_frame_unref(hFgOutfrmPtr.get());
+                fferr = av_buffersink_get_frame(m_pBufsinkCtx, hFgOutfrmPtr.get());
+                if (fferr != AVERROR(EAGAIN))
+                {
+                    if (fferr < 0)
+                    {
+                        ostringstream oss; oss << "Background task 'Proxy' FAILED when invoking 'av_buffersink_get_frame()' at frame #" << i64FrmIdx
+                                << ". fferr=" << fferr << ".";
+                        m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+                        return false;
+                    }
+                    if (!bEncoderInited)
+                    {
+                        if (!SetupEncoder(hFgOutfrmPtr.get(), m_strPartialPath))
+                        {
+                            m_pLogger->Log(Error) << "'SetupEncoder()' FAILED!" << endl;
+                            return false;
+                        }
+                        bEncoderInited = true;
+                    }
+                    auto hOutVfrm = FFUtils::CreateVideoFrameFromAVFrame(CloneSelfFreeAVFramePtr(hFgOutfrmPtr.get()), i64ReadPos);
+                    bool consumed = false;
+                    if (!m_hEncoder->EncodeVideoFrame(hOutVfrm, consumed))
+                    {
+                        ostringstream oss; oss << "Background task 'Proxy' FAILED to encode video frame! pos=" << i64ReadPos;
+                        m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+                        return false;
+                    }
+                }
+                i64FrmIdx++;
+            }
+            m_fProgress = i64ClipDur > 0 ? min((float)((double)i64ReadPos/i64ClipDur), 1.f) : 0.f;
+            if (bEof)
+                break;
+        }
+        m_hVclip->SeekTo(0);
+        if (IsCancelled())
+        {
+            m_pLogger->Log(INFO) << "Background task 'Proxy' is cancelled at frame #" << i64FrmIdx << "." << endl;
+            return true;
+        }
+        if (!bEncoderInited)
+        {
+            ostringstream oss; oss << "Background task 'Proxy' FAILED! No frame is decoded from '" << m_strSrcUrl << "'.";
+            m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+            return false;
+        }
+        if (!m_hEncoder->FinishEncoding())
+        {
+            ostringstream oss; oss << "FAILED to 'Finish' MediaEncoder! Error is '" << m_hEncoder->GetError() << "'.";
+            m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+            return false;
+        }
+        ReleaseEncoder();
+        error_code ec;
+        fs::rename(fs::u8path(m_strPartialPath), fs::u8path(m_strProxyPath), ec);
+        if (ec)
+        {
+            ostringstream oss; oss << "FAILED to move the proxy into '" << m_strProxyPath << "'! " << ec.message();
+            m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+            return false;
+        }
+        m_fProgress = 1.f;
+
+        m_pLogger->Log(INFO) << "Quit background task 'Proxy' for '" << m_strSrcUrl << "', " << i64FrmIdx << " frames are transcoded." << endl;
+        return true;
+    }
+
+    bool _AfterTaskProc() override
+    {
+        ReleaseFilterGraph();
+        ReleaseEncoder();
+        return true;
+    }
+
+private:
+    bool SetupScaleFilterGraph(const AVFrame* pInAvfrm)
+    {
+        const AVFilter *buffersink = avfilter_get_by_name("buffersink");
+        const AVFilter *buffersrc  = avfilter_get_by_name("buffer");
+
+        m_pFilterGraph = avfilter_graph_alloc();
+        if (!m_pFilterGraph)
+        {
+            m_errMsg = "FAILED to allocate new 'AVFilterGraph'!";
+            return false;
+        }
+
+        int fferr;
+        ostringstream oss;
+        const auto tFrameRate = m_hSettings->VideoOutFrameRate();
+        oss << pInAvfrm->width << ":" << pInAvfrm->height << ":pix_fmt=" << pInAvfrm->format << ":sar=1"
+                << ":time_base=" << tFrameRate.den << "/" << tFrameRate.num << ":frame_rate=" << tFrameRate.num << "/" << tFrameRate.den;
+        string bufsrcArg = oss.str();
+        m_pBufsrcCtx = nullptr;
+        fferr = avfilter_graph_create_filter(&m_pBufsrcCtx, buffersrc, "buffer_source", bufsrcArg.c_str(), nullptr, m_pFilterGraph);
+        if (fferr < 0)
+        {
+            oss.str(""); oss << "FAILED when invoking 'avfilter_graph_create_filter' for INPUT 'buffer_source'! fferr=" << fferr << ".";
+            m_errMsg = oss.str();
+            return false;
+        }
+        AVFilterInOut* filtInOutPtr = avfilter_inout_alloc();
+        if (!filtInOutPtr)
+        {
+            m_errMsg = "FAILED to allocate 'AVFilterInOut' instance!";
+            return false;
+        }
+        filtInOutPtr->name       = av_strdup("in");
+        filtInOutPtr->filter_ctx = m_pBufsrcCtx;
+        filtInOutPtr->pad_idx    = 0;
+        filtInOutPtr->next       = nullptr;
+        m_pFilterOutputs = filtInOutPtr;
+
+        m_pBufsinkCtx = nullptr;
+        fferr = avfilter_graph_create_filter(&m_pBufsinkCtx, buffersink, "buffer_sink", nullptr, nullptr, m_pFilterGraph);
+        if (fferr < 0)
+        {
+            oss.str(""); oss << "FAILED when invoking 'avfilter_graph_create_filter' for OUTPUT 'out'! fferr=" << fferr << ".";
+            m_errMsg = oss.str();
+            return false;
+        }
+        filtInOutPtr = avfilter_inout_alloc();
+        if (!filtInOutPtr)
+        {
+            m_errMsg = "FAILED to allocate 'AVFilterInOut' instance!";
+            return false;
+        }
+        filtInOutPtr->name        = av_strdup("out");
+        filtInOutPtr->filter_ctx  = m_pBufsinkCtx;
+        filtInOutPtr->pad_idx     = 0;
+        filtInOutPtr->next        = nullptr;
+        m_pFilterInputs = filtInOutPtr;
+
+        // the proxy keeps the bit depth, the color range and the color tags of the source, only the resolution is reduced
+        const auto pPixDesc = av_pix_fmt_desc_get((AVPixelFormat)pInAvfrm->format);
+        const bool bSrcIsRgb = pPixDesc && (pPixDesc->flags&AV_PIX_FMT_FLAG_RGB) != 0;
+        const bool bHighDepth = pPixDesc && pPixDesc->comp[0].depth > 8 && (m_strVidencCodecName == "h264" || m_strVidencCodecName == "hevc");
+        m_strOutPixfmt = bHighDepth ? "yuv420p10le" : "yuv420p";
+        m_eColorRange = pInAvfrm->color_range;
+        m_eColorSpace = bSrcIsRgb ? AVCOL_SPC_BT709 : pInAvfrm->colorspace;
+        m_eColorTrc = pInAvfrm->color_trc;
+        m_eColorPrimaries = pInAvfrm->color_primaries;
+        const int iOutW = (int)m_hSettings->VideoOutWidth();
+        const int iOutH = (int)m_hSettings->VideoOutHeight();
+        oss.str("");
+        oss << "scale=w=" << iOutW << ":h=" << iOutH << ":flags=area";
+        if (m_eColorRange != AVCOL_RANGE_UNSPECIFIED)
+        {
+            const char* pcRange = m_eColorRange == AVCOL_RANGE_JPEG ? "full" : "limited";
+            oss << ":in_range=" << pcRange << ":out_range=" << pcRange;
+        }
+        if (bSrcIsRgb)
+            oss << ":out_color_matrix=bt709";
+        oss << ",format=" << m_strOutPixfmt;
+        string filterArgs = oss.str();
+        fferr = avfilter_graph_parse_ptr(m_pFilterGraph, filterArgs.c_str(), &m_pFilterInputs, &m_pFilterOutputs, nullptr);
+        if (fferr < 0)
+        {
+            oss.str(""); oss << "FAILED to invoke 'avfilter_graph_parse_ptr'! fferr=" << fferr << ". Arguments are \"" << filterArgs << "\".";
+            m_errMsg = oss.str();
+            return false;
+        }
+        m_pLogger->Log(INFO) << "Setup filter-graph with arguments: '" << filterArgs << "'." << endl;
+
+        fferr = avfilter_graph_config(m_pFilterGraph, nullptr);
+        if (fferr < 0)
+        {
+            oss.str(""); oss << "FAILED to invoke 'avfilter_graph_config'! fferr=" << fferr << ".";
+            m_errMsg = oss.str();
+            return false;
+        }
+
+        if (m_pFilterOutputs)
+            avfilter_inout_free(&m_pFilterOutputs);
+        if (m_pFilterInputs)
+            avfilter_inout_free(&m_pFilterInputs);
+        return true;
+    }
+
+    void ReleaseFilterGraph()
+    {
+        if (m_pFilterOutputs)
+        {
+            avfilter_inout_free(&m_pFilterOutputs);
+            m_pFilterOutputs = nullptr;
+        }
+        if (m_pFilterInputs)
+        {
+            avfilter_inout_free(&m_pFilterInputs);
+            m_pFilterInputs = nullptr;
+        }
+        m_pBufsrcCtx = nullptr;
+        m_pBufsinkCtx = nullptr;
+        if (m_pFilterGraph)
+        {
+            avfilter_graph_free(&m_pFilterGraph);
+            m_pFilterGraph = nullptr;
+        }
+    }
+
+    bool SetupEncoder(const AVFrame* pInAvfrm, const string& strOutputPath)
+    {
+        auto hEncoder = MediaCore::MediaEncoder::CreateInstance();
+        if (!hEncoder->Open(strOutputPath))
+        {
+            ostringstream oss; oss << "FAILED to open MediaEncoder at location '" << strOutputPath << "'! Error is '" << hEncoder->GetError() << "'.";
+            m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+            return false;
+        }
+        auto strInputPixfmt = string(av_get_pix_fmt_name((AVPixelFormat)pInAvfrm->format));
+        // a gop size of 1 makes every frame a key frame
+        vector<MediaCore::MediaEncoder::Option> aExtraOpts = {
+            { "g",                      MediaCore::Value(1) },
+            { "aspect",                 MediaCore::Value(MediaCore::Ratio(1,1)) },
+        };
+        // only tag the color properties which are known from the source
+        if (m_eColorSpace != AVCOL_SPC_UNSPECIFIED)
+            aExtraOpts.push_back({ "colorspace",        MediaCore::Value((int)m_eColorSpace) });
+        if (m_eColorTrc != AVCOL_TRC_UNSPECIFIED)
+            aExtraOpts.push_back({ "color_trc",         MediaCore::Value((int)m_eColorTrc) });
+        if (m_eColorPrimaries != AVCOL_PRI_UNSPECIFIED)
+            aExtraOpts.push_back({ "color_primaries",   MediaCore::Value((int)m_eColorPrimaries) });
+        if (m_eColorRange != AVCOL_RANGE_UNSPECIFIED)
+            aExtraOpts.push_back({ "color_range",       MediaCore::Value((int)m_eColorRange) });
+        if (m_strVidencCodecName == "h264")
+        {
+            aExtraOpts.push_back({ "profile",   MediaCore::Value(m_strOutPixfmt == "yuv420p10le" ? "high10" : "high") });
+            aExtraOpts.push_back({ "preset",    MediaCore::Value("veryfast") });
+            aExtraOpts.push_back({ "tune",      MediaCore::Value("fastdecode") });
+        }
+        if (!hEncoder->ConfigureVideoStream(m_strVidencCodecName, strInputPixfmt, pInAvfrm->width, pInAvfrm->height, m_hSettings->VideoOutFrameRate(), m_u64VidencBitrate, &aExtraOpts))
+        {
+            ostringstream oss; oss << "FAILED to configure MediaEncoder VIDEO stream! Error is '" << hEncoder->GetError() << "'.";
+            m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+            return false;
+        }
+        if (!hEncoder->Start())
+        {
+            ostringstream oss; oss << "FAILED to 'Start' MediaEncoder! Error is '" << hEncoder->GetError() << "'.";
+            m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+            return false;
+        }
+        m_hEncoder = hEncoder;
+        return true;
+    }
+
+    void ReleaseEncoder()
+    {
+        if (m_hEncoder)
+        {
+            if (!m_hEncoder->Close())
+                m_pLogger->Log(Error) << "In bg-task '" << m_name << "', FAILED to close the encoder! Error is '" << m_hEncoder->GetError() << "'." << endl;
+            m_hEncoder = nullptr;
+        }
+    }
+
+    // The task is paused by the user or by the scheduler throttling, called with 'm_mtxPauseLock' held
+    void UpdatePauseState()
+    {
+        const bool bPause = m_bUserPause || m_bThrottlePause;
+        if (bPause && !m_bPause)
+            m_bPauseCheckPointHit = false;
+        m_bPause = bPause;
+    }
+
+    // Block the calling thread until the task is resumed or cancelled. Returns 'false' if the task is cancelled.
+    bool WaitWhilePaused()
+    {
+        unique_lock<mutex> _lk(m_mtxPauseLock);
+        if (m_bPause)
+            m_bPauseCheckPointHit = true;
+        m_cvPause.wait(_lk, [this] { return !m_bPause || IsCancelled(); });
+        return !IsCancelled();
+    }
+
+private:
+    string m_name;
+    size_t m_szHash;
+    string m_errMsg;
+    ALogger* m_pLogger;
+    Callbacks* m_pCb{nullptr};
+    bool m_bInited{false};
+    string m_strTaskDir;
+    AVFilterGraph* m_pFilterGraph{nullptr};
+    AVFilterContext* m_pBufsrcCtx{nullptr};
+    AVFilterContext* m_pBufsinkCtx{nullptr};
+    AVFilterInOut* m_pFilterOutputs{nullptr};
+    AVFilterInOut* m_pFilterInputs{nullptr};
+    string m_strSrcUrl;
+    int64_t m_i64MediaItemId;
+    MediaCore::VideoClip::Holder m_hVclip;
+    const MediaCore::VideoStream* m_pVidstm{nullptr};
+    MediaCore::SharedSettings::Holder m_hSettings;
+    // output settings
+    string m_strProxyPath;
+    string m_strPartialPath;
+    uint32_t m_u32ProxyHeight{540};
+    MediaCore::MediaEncoder::Holder m_hEncoder;
+    string m_strVidencCodecName;
+    uint64_t m_u64VidencBitrate;
+    string m_strOutPixfmt{"yuv420p"};
+    AVColorRange m_eColorRange{AVCOL_RANGE_UNSPECIFIED};
+    AVColorSpace m_eColorSpace{AVCOL_SPC_UNSPECIFIED};
+    AVColorTransferCharacteristic m_eColorTrc{AVCOL_TRC_UNSPECIFIED};
+    AVColorPrimaries m_eColorPrimaries{AVCOL_PRI_UNSPECIFIED};
+    float m_fProgress{0.f};
+    // task control
+    atomic_bool m_bPause{false};
+    atomic_bool m_bUserPause{false};
+    bool m_bThrottlePause{false};
+    atomic_bool m_bPauseCheckPointHit{false};
+    atomic_int m_iPriority{0};
+    mutex m_mtxPauseLock;
+    condition_variable m_cvPause;
+};
+
+const string BgtaskProxy::TASK_TYPE_NAME = "Proxy Media";
+
+static const auto _BGTASK_PROXY_DELETER = [] (BackgroundTask* p) {
+    BgtaskProxy* ptr = dynamic_cast<BgtaskProxy*>(p);
+    delete ptr;
+};
+
+BackgroundTask::Holder CreateBgtask_Proxy(const json::value& jnTask, MediaCore::SharedSettings::Holder hSettings, RenderUtils::TextureManager::Holder hTxMgr)
+{
+    string strTaskName;
+    string strAttrName = "name";
+    if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_string())
+        strTaskName = jnTask["name"].get<json::string>();
+    else
+        strTaskName = "BgtskProxy";
+    auto p = new BgtaskProxy(strTaskName);
+    if (!p->Initialize(jnTask, hSettings))
+    {
+        Log(Error) << "FAILED to create new 'Proxy' background task! Error is '" << p->GetError() << "'." << endl;
+        delete p;
+        return nullptr;
+    }
+    p->Save("");
+    return BackgroundTask::Holder(p, _BGTASK_PROXY_DELETER);
+}
+}
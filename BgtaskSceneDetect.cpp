@@ -1,6 +1,11 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
 #include <iomanip>
 #include <limits>
-#include <list>
+#include <mutex>
+#include <vector>
 #include <BaseUtils/TimeUtils.h>
 #include <MediaCore/MediaParser.h>
 #include <MediaCore/VideoClip.h>
@@ -10,10 +15,14 @@
 extern "C"
 {
 #include "libavutil/avutil.h"
+#include "libavutil/pixdesc.h"
 #include "libavfilter/avfilter.h"
 #include "libavfilter/buffersrc.h"
 #include "libavfilter/buffersink.h"
 }
+#if defined(_M_X64) || (defined(__SSE2__) && defined(__x86_64__))
+#include <emmintrin.h>
+#endif
 
 
 namespace json = imgui_json;
@@ -286,17 +295,9 @@ public:
             return false;
         }
         m_i64ParseLength = jnTask[strAttrName].get<json::number>();
-        const int64_t i64SrcDuration = static_cast<int64_t>(m_pVidstm->duration*1000);
-        const int64_t i64ClipEndOffset = i64SrcDuration-m_i64ParseStartOffset-m_i64ParseLength;
-        MediaCore::VideoClip::Holder hVclip = MediaCore::VideoClip::CreateVideoInstance(m_i64MediaItemId, hParser, m_hSettings,
-                0, m_i64ParseLength, m_i64ParseStartOffset, i64ClipEndOffset, 0, true);
+        auto hVclip = CreateParseVideoClip();
         if (!hVclip)
-        {
-            ostringstream oss; oss << "FAILED to create VideoClip instance for '" << m_strSrcUrl << "' with (start, end, startOffset, endOffset) = ("
-                    << 0 << ", " << m_i64ParseLength << ", " << m_i64ParseStartOffset << ", " << i64ClipEndOffset << ").";
-            m_errMsg = oss.str();
             return false;
-        }
         m_hParseVclip = hVclip;
         auto hPreviewSettings = m_hSettings->Clone();
         hPreviewSettings->SetVideoOutWidth(m_u32PreviewWidth); hPreviewSettings->SetVideoOutHeight(m_u32PreviewHeight);
@@ -319,6 +320,46 @@ public:
                 return false;
             }
         }
+        strAttrName = "use_shared_decoding";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_boolean())
+            m_bUseSharedDecoding = jnTask[strAttrName].get<json::boolean>();
+        strAttrName = "analysis_width";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_number())
+        {
+            const auto numValue = jnTask[strAttrName].get<json::number>();
+            m_u32AnalysisWidth = numValue > 0 ? (uint32_t)numValue : 0;
+        }
+        strAttrName = "analysis_luma_only";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_boolean())
+            m_bAnalysisLumaOnly = jnTask[strAttrName].get<json::boolean>();
+        strAttrName = "scene_scorer";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_string())
+        {
+            const auto strScorer = jnTask[strAttrName].get<json::string>();
+            if (strScorer == "native")
+                m_bUseNativeScorer = true;
+            else if (strScorer == "lavfi")
+                m_bUseNativeScorer = false;
+            else
+            {
+                ostringstream oss; oss << "INVALID argument '" << strAttrName << "'! The valid value should be 'lavfi' or 'native', while the provided value is '"
+                        << strScorer << "'.";
+                m_errMsg = oss.str();
+                return false;
+            }
+        }
+        strAttrName = "parallel_chunk_count";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_number())
+        {
+            const auto numValue = jnTask[strAttrName].get<json::number>();
+            m_u32ParallelChunkCount = numValue > 1 ? (uint32_t)numValue : 1;
+        }
+        strAttrName = "park_when_paused";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_boolean())
+            m_bParkWhenPaused = jnTask[strAttrName].get<json::boolean>();
+        strAttrName = "priority";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_number())
+            m_iPriority = (int)jnTask[strAttrName].get<json::number>();
         // read task status
         strAttrName = "parsed_frame_idx";
         if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_number())
@@ -330,6 +371,27 @@ public:
             for (const auto& jnElem : jnSceneCutPoints)
                 m_aSceneCutPoints.push_back(_SceneCutPoint::FromJson(jnElem));
         }
+        bool bResultLost = false;
+        strAttrName = "diff_scores_file";
+        if (jnTask.contains(strAttrName) && AnalysisDataFile::IsReference(jnTask[strAttrName]))
+        {
+            string strErrMsg;
+            if (AnalysisDataFile::LoadFloatSeries(m_strTaskDir, jnTask[strAttrName], m_aDiffScores, strErrMsg))
+            {
+                m_jnDiffScoresFileRef = jnTask[strAttrName];
+                m_szSavedDiffScoreCount = m_aDiffScores.size();
+            }
+            else
+            {
+                m_pLogger->Log(WARN) << "FAILED to load diff scores of task '" << m_name << "', the scene detection will restart. Error is '"
+                        << strErrMsg << "'." << endl;
+                bResultLost = true;
+                m_aDiffScores.clear();
+                m_aSceneCutPoints.clear();
+                m_i64ParsedFrameIdx = 0;
+            }
+        }
+        // task json of older version stores the diff scores as a json array
         strAttrName = "diff_scores";
         if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_array())
         {
@@ -361,7 +423,7 @@ public:
         {
             strAttrName = "is_task_done";
             if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_boolean())
-                bDone = jnTask[strAttrName].get<json::boolean>();
+                bDone = jnTask[strAttrName].get<json::boolean>() && !bResultLost;
             if (bDone)
                 SetState(DONE, true);
         }
@@ -392,6 +454,41 @@ public:
         m_pCb = pCb;
     }
 
+    CostClass GetCostClass() const override
+    {
+        // the serial detection decodes on one thread and scores small frames, the chunks run on as many threads as
+        // the cost units of a heavy task
+        return m_u32ParallelChunkCount > 1 ? COST_HEAVY : COST_LIGHT;
+    }
+
+    uint32_t GetRequestedCpuUnits() const override
+    {
+        // one unit for each chunk thread, the merging thread mostly waits
+        return m_u32ParallelChunkCount > 1 ? m_u32ParallelChunkCount : 0;
+    }
+
+    void SetGrantedCpuUnits(uint32_t u32Units) override
+    {
+        m_u32GrantedCpuUnits = u32Units;
+    }
+
+    size_t GetEstimatedMemoryUsage() const override
+    {
+        // about 8 decoded yuv420 frames are held by each decoder and its filter graph
+        const size_t szFrameBytes = (size_t)m_hSettings->VideoOutWidth()*m_hSettings->VideoOutHeight()*3/2;
+        return szFrameBytes*8*m_u32ParallelChunkCount;
+    }
+
+    int GetPriority() const override
+    {
+        return m_iPriority;
+    }
+
+    void SetPriority(int iPriority) override
+    {
+        m_iPriority = iPriority;
+    }
+
     bool CanPause()
     {
         return m_eState == PROCESSING;
@@ -399,10 +496,9 @@ public:
 
     bool Pause() override
     {
-        if (m_bPause)
-            return true;
-        m_bPauseCheckPointHit = false;
-        m_bPause = true;
+        lock_guard<mutex> _lk(m_mtxPauseLock);
+        m_bUserPause = true;
+        UpdatePauseState();
         return true;
     }
 
@@ -411,12 +507,43 @@ public:
         return m_bPause && m_bPauseCheckPointHit;
     }
 
+    bool IsUserPaused() const override
+    {
+        return m_bUserPause;
+    }
+
     bool Resume() override
     {
-        m_bPause = false;
+        {
+            lock_guard<mutex> _lk(m_mtxPauseLock);
+            m_bUserPause = false;
+            UpdatePauseState();
+        }
+        m_cvPause.notify_all();
         return true;
     }
 
+    void SetThrottled(bool bThrottled) override
+    {
+        {
+            lock_guard<mutex> _lk(m_mtxPauseLock);
+            m_bThrottlePause = bThrottled;
+            UpdatePauseState();
+        }
+        m_cvPause.notify_all();
+    }
+
+    bool Cancel() override
+    {
+        const bool bRet = BackgroundTask::Cancel();
+        // acquire the lock before notifying, so a thread just going to wait won't miss the wakeup
+        {
+            lock_guard<mutex> _lk(m_mtxPauseLock);
+        }
+        m_cvPause.notify_all();
+        return bRet;
+    }
+
     bool DrawContent(const ImVec2& v2ViewSize) override
     {
         bool bRemoveThisTask = false;
@@ -457,10 +584,20 @@ public:
             for (const auto& elem : m_aSceneCutPoints)
                 jnSceneCutPoints.push_back(elem.SaveAsJson());
             jnMetaValue["scene_cut_points"] = jnSceneCutPoints;
-            json::array jnDiffScores;
-            for (const auto& elem : m_aDiffScores)
-                jnDiffScores.push_back(json::number(elem));
-            jnMetaValue["diff_scores"] = jnDiffScores;
+            // the meta data outlives this task, so its diff scores file is placed in the project directory instead of the task directory,
+            // and the reference keeps the path relative to the project directory
+            const auto strProjDir = SysUtils::PopLastComponent(m_strTaskDir);
+            const string strDataSubDir = "AnalysisData";
+            const auto strDataDir = SysUtils::JoinPath(strProjDir, strDataSubDir);
+            if (!SysUtils::IsDirectory(strDataDir))
+                SysUtils::CreateDirectoryAt(strDataDir, true);
+            const auto strDataFileName = SysUtils::JoinPath(strDataSubDir, m_resultId+".diff_scores.bin");
+            json::value jnDiffScoresRef;
+            string strErrMsg;
+            if (AnalysisDataFile::SaveFloatSeries(strProjDir, strDataFileName, m_aDiffScores.data(), m_aDiffScores.size(), jnDiffScoresRef, strErrMsg))
+                jnMetaValue["diff_scores_file"] = jnDiffScoresRef;
+            else
+                m_pLogger->Log(Error) << "FAILED to save diff scores for the meta data of '" << m_strSrcUrl << "'! Error is '" << strErrMsg << "'." << endl;
             jnMetaValue["result_id"] = m_resultId;
             m_pCb->OnOutputMediaItemMetaData(m_strSrcUrl, TASK_RESULT_META_NAME, jnMetaValue);
         } ImGui::SameLine();
@@ -473,14 +610,14 @@ public:
         ImGui::BeginDisabled(bDisableThisWidget);
         if (ImGui::Button(strLabel.c_str()))
         {
-            if (m_bPause)
+            if (m_bUserPause)
                 Resume();
             else
                 Pause();
         } ImGui::SameLine();
         ImGui::ShowTooltipOnHover(bDisableThisWidget
                 ? (IsWaiting() ? "Task hasn't started yet." : "Task is already stopped.")
-                : (m_bPause ? "Resume task" : "Pause task"));
+                : (m_bUserPause ? "Resume task" : "Pause task"));
         ImGui::EndDisabled();
         oss.str(""); oss << ICON_DELETE << m_strTaskNameWithHash;
         strLabel = oss.str();
@@ -702,16 +839,34 @@ public:
         jnTask["parse_length"] = json::number(m_i64ParseLength);
         // save scene detect parameters
         jnTask["scene_detect_thresh"] = json::number(m_fSceneDetectThresh);
+        jnTask["use_shared_decoding"] = m_bUseSharedDecoding;
+        jnTask["analysis_width"] = json::number(m_u32AnalysisWidth);
+        jnTask["analysis_luma_only"] = m_bAnalysisLumaOnly;
+        jnTask["scene_scorer"] = m_bUseNativeScorer ? "native" : "lavfi";
+        jnTask["parallel_chunk_count"] = json::number(m_u32ParallelChunkCount);
+        jnTask["park_when_paused"] = m_bParkWhenPaused;
+        jnTask["priority"] = json::number(m_iPriority);
         // save task status
         jnTask["parsed_frame_idx"] = json::number(m_i64ParsedFrameIdx);
-        json::array jnSceneCutPoints;
-        for (const auto& elem : m_aSceneCutPoints)
-            jnSceneCutPoints.push_back(elem.SaveAsJson());
-        jnTask["scene_cut_points"] = jnSceneCutPoints;
-        json::array jnDiffScores;
-        for (const auto& elem : m_aDiffScores)
-            jnDiffScores.push_back(json::number(elem));
-        jnTask["diff_scores"] = jnDiffScores;
+        {
+            lock_guard<mutex> _lk(m_mtxResultLock);
+            json::array jnSceneCutPoints;
+            for (const auto& elem : m_aSceneCutPoints)
+                jnSceneCutPoints.push_back(elem.SaveAsJson());
+            jnTask["scene_cut_points"] = jnSceneCutPoints;
+            // the diff scores are stored in a binary sidecar file, only rewrite it when there are new scores
+            if (m_szSavedDiffScoreCount != m_aDiffScores.size() || !AnalysisDataFile::IsReference(m_jnDiffScoresFileRef))
+            {
+                string strErrMsg;
+                if (!AnalysisDataFile::SaveFloatSeries(m_strTaskDir, "diff_scores.bin", m_aDiffScores.data(), m_aDiffScores.size(), m_jnDiffScoresFileRef, strErrMsg))
+                {
+                    m_errMsg = strErrMsg;
+                    return false;
+                }
+                m_szSavedDiffScoreCount = m_aDiffScores.size();
+            }
+            jnTask["diff_scores_file"] = m_jnDiffScoresFileRef;
+        }
         jnTask["result_hash"] = json::number(m_resultHash);
         jnTask["is_task_done"] = IsDone();
         jnTask["is_task_failed"] = IsFailed();
@@ -798,6 +953,14 @@ protected:
             return false;
         }
 
+        if (m_u32ParallelChunkCount > 1)
+        {
+            if (!SceneDetectInChunks())
+                return false;
+            FinishSceneDetect();
+            return true;
+        }
+
         float fStageProgress = 0.f, fStageShare = 0.5f, fAccumShares = 0.f;
         bool bFilterGraphInited = false;
         const int64_t i64ClipDur = m_hParseVclip->Duration();
@@ -812,43 +975,80 @@ protected:
             m_hParseVclip->SeekTo(i64ReadPos);
         }
 
+        // try to share the decoded frames with other analysis tasks working on the same source range
+        AnalysisSource::Subscription::Holder hSharedSrc;
+        bool bOwnDecoderSynced = true;
+        if (m_bUseSharedDecoding)
+            hSharedSrc = AnalysisSource::Subscribe(m_hParseVclip, i64FrmIdx);
+        // scores of the frames before this index are not reported, they are the priming frames fed after the task is unparked
+        int64_t i64ReportFrmIdx = i64FrmIdx;
         SelfFreeAVFramePtr hFgOutfrmPtr = AllocSelfFreeAVFramePtr();
         while (!IsCancelled())
         {
             if (m_bPause)
             {
-                m_bPauseCheckPointHit = true;
-                this_thread::sleep_for(chrono::milliseconds(THREAD_IDLE_TIME));
+                // leave the shared source while paused, so other subscribers won't be blocked by this task
+                hSharedSrc = nullptr;
+                const bool bPark = m_bParkWhenPaused;
+                if (bPark)
+                {
+                    // release the decoder and the filter graph, they are rebuilt on resume
+                    ReleaseFilterGraph();
+                    bFilterGraphInited = false;
+                    m_hParseVclip = nullptr;
+                    m_pLogger->Log(DEBUG) << "Task '" << m_name << "' is parked at frame #" << i64FrmIdx << "." << endl;
+                }
+                if (!WaitWhilePaused())
+                    break;
+                if (bPark)
+                {
+                    m_hParseVclip = CreateParseVideoClip();
+                    if (!m_hParseVclip)
+                    {
+                        m_pLogger->Log(Error) << "FAILED to rebuild the parse VideoClip on resume! Error is '" << m_errMsg << "'." << endl;
+                        return false;
+                    }
+                    // re-feed the previous two frames, so the restored filter state produces the same scores
+                    i64ReportFrmIdx = i64FrmIdx;
+                    i64FrmIdx = i64FrmIdx > 2 ? i64FrmIdx-2 : 0;
+                    m_hParseVclip->SeekTo(round((double)i64FrmIdx*1000*tFrameRate.den/tFrameRate.num));
+                    bOwnDecoderSynced = true;
+                }
+                if (m_bUseSharedDecoding)
+                    hSharedSrc = AnalysisSource::Subscribe(m_hParseVclip, i64FrmIdx);
                 continue;
             }
 
             int fferr;
             SelfFreeAVFramePtr hFgInfrmPtr;
+            ImMatWrapper_AVFrame tAvfrmWrapper;
             const int64_t i64ReadPos = round((double)i64FrmIdx*1000*tFrameRate.den/tFrameRate.num);
             bool bEof = false;
-            auto hVfrm = m_hParseVclip->ReadSourceFrame(i64ReadPos, bEof, true);
-            ImMatWrapper_AVFrame tAvfrmWrapper;
-            if (hVfrm)
+            if (hSharedSrc)
             {
-                auto tNativeData = hVfrm->GetNativeData();
-                if (tNativeData.eType == MediaCore::VideoFrame::NativeData::AVFRAME)
-                    hFgInfrmPtr = CloneSelfFreeAVFramePtr((AVFrame*)tNativeData.pData);
-                else if (tNativeData.eType == MediaCore::VideoFrame::NativeData::AVFRAME_HOLDER)
-                    hFgInfrmPtr = *((SelfFreeAVFramePtr*)tNativeData.pData);
-                else if (tNativeData.eType == MediaCore::VideoFrame::NativeData::MAT)
+                const auto eReadRes = hSharedSrc->ReadFrame(hFgInfrmPtr);
+                if (eReadRes == AnalysisSource::READ_AGAIN)
+                    continue;
+                else if (eReadRes == AnalysisSource::READ_EOF)
+                    bEof = true;
+                else if (eReadRes == AnalysisSource::READ_FAILED)
                 {
-                    const auto& vmat = *((ImGui::ImMat*)tNativeData.pData);
-                    if (vmat.device != IM_DD_CPU)
-                    {
-                        hFgInfrmPtr = AllocSelfFreeAVFramePtr();
-                        tMat2AvfrmCvter.ConvertImage(vmat, hFgInfrmPtr.get(), i64FrmIdx);
-                    }
-                    else
-                    {
-                        tAvfrmWrapper.SetMat(vmat);
-                        hFgInfrmPtr = tAvfrmWrapper.GetWrapper(i64FrmIdx);
-                    }
+                    m_pLogger->Log(WARN) << "Read from shared analysis source FAILED at frame #" << i64FrmIdx << ", switch to private decoding." << endl;
+                    hSharedSrc = nullptr;
+                    continue;
                 }
+                bOwnDecoderSynced = false;
+            }
+            else
+            {
+                if (!bOwnDecoderSynced)
+                {
+                    m_hParseVclip->SeekTo(i64ReadPos);
+                    bOwnDecoderSynced = true;
+                }
+                auto hVfrm = m_hParseVclip->ReadSourceFrame(i64ReadPos, bEof, true);
+                if (hVfrm)
+                    hFgInfrmPtr = GetAvframeFromVideoFrame(hVfrm, tMat2AvfrmCvter, tAvfrmWrapper, i64FrmIdx);
             }
             if (hFgInfrmPtr)
             {
@@ -863,7 +1063,7 @@ protected:
                     bFilterGraphInited = true;
                 }
 
-                fferr = av_buffersrc_add_frame(m_pBufsrcCtx, hFgInfrmPtr.get());
+                fferr = m_tSceneFilter.SendFrame(hFgInfrmPtr.get());
                 if (fferr < 0)
                 {
                     ostringstream oss; oss << "Background task 'SceneDetect' FAILED when invoking 'av_buffersrc_add_frame()' at frame #" << (i64FrmIdx-1)
@@ -871,19 +1071,21 @@ protected:
                     m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
                     return false;
                 }
-                m_i64ParsedFrameIdx = i64FrmIdx;
+                if (i64FrmIdx >= i64ReportFrmIdx)
+                    m_i64ParsedFrameIdx = i64FrmIdx;
                 i64FrmIdx++;
 
                 av_frame_unref(hFgOutfrmPtr.get());
-                fferr = av_buffersink_get_frame(m_pBufsinkCtx, hFgOutfrmPtr.get());
+                fferr = m_tSceneFilter.ReceiveFrame(hFgOutfrmPtr.get());
                 if (fferr != AVERROR(EAGAIN))
                 {
                     if (fferr == 0)
                     {
-                        float fScore = 0;
-                        auto dictEntry = av_dict_get(hFgOutfrmPtr->metadata, "lavfi.scene_score", nullptr, 0);
-                        if (dictEntry)
-                            fScore = stof(dictEntry->value);
+                        // the scores of the priming frames are already reported before the task was parked
+                        if (hFgOutfrmPtr->pts < i64ReportFrmIdx)
+                            continue;
+                        const float fScore = _SceneScoreFilter::GetSceneScore(hFgOutfrmPtr.get());
+                        lock_guard<mutex> _lk(m_mtxResultLock);
                         m_aDiffScores.push_back(fScore);
                         if (fScore >= m_fSceneDetectThresh)
                         {
@@ -906,7 +1108,65 @@ protected:
             if (bEof)
                 break;
         }
+        hSharedSrc = nullptr;
         ReleaseFilterGraph();
+        FinishSceneDetect();
+        return true;
+    }
+
+    bool _AfterTaskProc() override
+    {
+        ReleaseFilterGraph();
+        return true;
+    }
+
+    // The task is paused by the user or by the scheduler throttling, called with 'm_mtxPauseLock' held
+    void UpdatePauseState()
+    {
+        const bool bPause = m_bUserPause || m_bThrottlePause;
+        if (bPause && !m_bPause)
+            m_bPauseCheckPointHit = false;
+        m_bPause = bPause;
+    }
+
+private:
+    // Block the calling thread until the task is resumed or cancelled. Returns 'false' if the task is cancelled.
+    bool WaitWhilePaused()
+    {
+        unique_lock<mutex> _lk(m_mtxPauseLock);
+        if (m_bPause)
+            m_bPauseCheckPointHit = true;
+        m_cvPause.wait(_lk, [this] { return !m_bPause || IsCancelled(); });
+        return !IsCancelled();
+    }
+
+    // Called by a chunk which stops before all of its scores are out, wakes up the merging thread even if the task is paused
+    void OnChunkStopped()
+    {
+        {
+            lock_guard<mutex> _lk(m_mtxPauseLock);
+            m_bChunkStopped = true;
+        }
+        m_cvPause.notify_all();
+    }
+
+    MediaCore::VideoClip::Holder CreateParseVideoClip()
+    {
+        const int64_t i64SrcDuration = static_cast<int64_t>(m_pVidstm->duration*1000);
+        const int64_t i64ClipEndOffset = i64SrcDuration-m_i64ParseStartOffset-m_i64ParseLength;
+        MediaCore::VideoClip::Holder hVclip = MediaCore::VideoClip::CreateVideoInstance(m_i64MediaItemId, m_hParser, m_hSettings,
+                0, m_i64ParseLength, m_i64ParseStartOffset, i64ClipEndOffset, 0, true);
+        if (!hVclip)
+        {
+            ostringstream oss; oss << "FAILED to create VideoClip instance for '" << m_strSrcUrl << "' with (start, end, startOffset, endOffset) = ("
+                    << 0 << ", " << m_i64ParseLength << ", " << m_i64ParseStartOffset << ", " << i64ClipEndOffset << ").";
+            m_errMsg = oss.str();
+        }
+        return hVclip;
+    }
+
+    void FinishSceneDetect()
+    {
         m_hParseVclip = nullptr;
 
         m_resultHash = SysUtils::GetTickHash();
@@ -915,132 +1175,693 @@ protected:
         m_resultId = oss.str();
         m_fProgress = 1.f;
         m_pLogger->Log(INFO) << "Quit background task 'SceneDetect' for '" << m_strSrcUrl << "'." << endl;
-        return true;
     }
 
-    bool _AfterTaskProc() override
+    // 'tAvfrmWrapper' must outlive the returned AVFrame, since the wrapped frame references the ImMat data held by it
+    static SelfFreeAVFramePtr GetAvframeFromVideoFrame(MediaCore::VideoFrame::Holder hVfrm, ImMatToAVFrameConverter& tMat2AvfrmCvter,
+            ImMatWrapper_AVFrame& tAvfrmWrapper, int64_t i64FrmIdx)
     {
-        ReleaseFilterGraph();
-        return true;
+        SelfFreeAVFramePtr hAvfrmPtr;
+        auto tNativeData = hVfrm->GetNativeData();
+        if (tNativeData.eType == MediaCore::VideoFrame::NativeData::AVFRAME)
+            hAvfrmPtr = CloneSelfFreeAVFramePtr((AVFrame*)tNativeData.pData);
+        else if (tNativeData.eType == MediaCore::VideoFrame::NativeData::AVFRAME_HOLDER)
+            hAvfrmPtr = *((SelfFreeAVFramePtr*)tNativeData.pData);
+        else if (tNativeData.eType == MediaCore::VideoFrame::NativeData::MAT)
+        {
+            const auto& vmat = *((ImGui::ImMat*)tNativeData.pData);
+            if (vmat.device != IM_DD_CPU)
+            {
+                hAvfrmPtr = AllocSelfFreeAVFramePtr();
+                tMat2AvfrmCvter.ConvertImage(vmat, hAvfrmPtr.get(), i64FrmIdx);
+            }
+            else
+            {
+                tAvfrmWrapper.SetMat(vmat);
+                hAvfrmPtr = tAvfrmWrapper.GetWrapper(i64FrmIdx);
+            }
+        }
+        return hAvfrmPtr;
     }
 
-private:
-    bool SetupSceneDetectFilterGraph(const AVFrame* pInAvfrm)
+    // Native scene scorer working on a downscaled 8-bit luma plane. It mirrors the 'select' filter's scene score formula,
+    // but skips the scaling and pixel format conversion when the decoded frame already has a planar 8-bit luma plane.
+    class _LumaSadScorer
     {
-        const AVFilter *buffersink = avfilter_get_by_name("buffersink");
-        const AVFilter *buffersrc  = avfilter_get_by_name("buffer");
+    public:
+        void Reset(int iDstW, int iDstH)
+        {
+            m_iDstW = iDstW; m_iDstH = iDstH;
+            m_aCurrPlane.resize((size_t)iDstW*iDstH);
+            m_aPrevPlane.resize((size_t)iDstW*iDstH);
+            m_bHasPrev = false;
+            m_dPrevMafd = 0;
+            m_iSrcW = m_iSrcH = 0;
+        }
 
-        m_pFilterGraph = avfilter_graph_alloc();
-        if (!m_pFilterGraph)
+        float Score(const uint8_t* pSrc, int iLinesize, int iSrcW, int iSrcH)
         {
-            m_errMsg = "FAILED to allocate new 'AVFilterGraph'!";
-            return false;
+            Downsample(pSrc, iLinesize, iSrcW, iSrcH);
+            float fScore = 0;
+            if (m_bHasPrev)
+            {
+                const size_t szCount = m_aCurrPlane.size();
+                const uint64_t u64Sad = CalcSad(m_aPrevPlane.data(), m_aCurrPlane.data(), szCount);
+                const double dMafd = (double)u64Sad*100./szCount/256.;
+                const double dDiff = fabs(dMafd-m_dPrevMafd);
+                fScore = (float)std::min(std::max(std::min(dMafd, dDiff)/100., 0.), 1.);
+                m_dPrevMafd = dMafd;
+            }
+            m_aPrevPlane.swap(m_aCurrPlane);
+            m_bHasPrev = true;
+            return fScore;
         }
 
-        int fferr;
-        ostringstream oss;
-        m_eFgInputPixfmt = (AVPixelFormat)pInAvfrm->format;
-        const auto tFrameRate = m_hSettings->VideoOutFrameRate();
-        oss << pInAvfrm->width << ":" << pInAvfrm->height << ":pix_fmt=" << (int)m_eFgInputPixfmt << ":sar=1"
-                << ":time_base=" << tFrameRate.den << "/" << tFrameRate.num << ":frame_rate=" << tFrameRate.num << "/" << tFrameRate.den;
-        string bufsrcArg = oss.str();
-        m_pBufsrcCtx = nullptr;
-        fferr = avfilter_graph_create_filter(&m_pBufsrcCtx, buffersrc, "buffer_source", bufsrcArg.c_str(), nullptr, m_pFilterGraph);
-        if (fferr < 0)
-        {
-            oss << "FAILED when invoking 'avfilter_graph_create_filter' for INPUT 'buffer_source'! fferr=" << fferr << ".";
-            m_errMsg = oss.str();
-            return false;
+        static bool IsDirectInputFormat(AVPixelFormat ePixfmt)
+        {
+            const auto pDesc = av_pix_fmt_desc_get(ePixfmt);
+            if (!pDesc || (pDesc->flags&(AV_PIX_FMT_FLAG_RGB|AV_PIX_FMT_FLAG_HWACCEL|AV_PIX_FMT_FLAG_PAL|AV_PIX_FMT_FLAG_BITSTREAM)) != 0)
+                return false;
+            const auto& tLumaComp = pDesc->comp[0];
+            return tLumaComp.plane == 0 && tLumaComp.depth == 8 && tLumaComp.step == 1 && tLumaComp.offset == 0;
         }
-        AVFilterInOut* filtInOutPtr = avfilter_inout_alloc();
-        if (!filtInOutPtr)
+
+    private:
+        // box filter the source luma plane into 'm_aCurrPlane', each source row is accumulated column-wise so the inner loop vectorizes
+        void Downsample(const uint8_t* pSrc, int iLinesize, int iSrcW, int iSrcH)
         {
-            m_errMsg = "FAILED to allocate 'AVFilterInOut' instance!";
-            return false;
+            if (iSrcW != m_iSrcW || iSrcH != m_iSrcH)
+            {
+                m_iSrcW = iSrcW; m_iSrcH = iSrcH;
+                m_aColBounds.resize(m_iDstW+1);
+                for (int i = 0; i <= m_iDstW; i++)
+                    m_aColBounds[i] = (int)((int64_t)i*iSrcW/m_iDstW);
+                m_aRowAcc.resize(iSrcW);
+            }
+            uint8_t* pDst = m_aCurrPlane.data();
+            for (int y = 0; y < m_iDstH; y++)
+            {
+                const int iSrcY0 = (int)((int64_t)y*iSrcH/m_iDstH);
+                const int iSrcY1 = std::max((int)((int64_t)(y+1)*iSrcH/m_iDstH), iSrcY0+1);
+                uint32_t* pAcc = m_aRowAcc.data();
+                std::fill(m_aRowAcc.begin(), m_aRowAcc.end(), 0);
+                for (int sy = iSrcY0; sy < iSrcY1; sy++)
+                {
+                    const uint8_t* pSrcRow = pSrc+(ptrdiff_t)sy*iLinesize;
+                    for (int x = 0; x < iSrcW; x++)
+                        pAcc[x] += pSrcRow[x];
+                }
+                for (int x = 0; x < m_iDstW; x++)
+                {
+                    const int iSrcX0 = m_aColBounds[x];
+                    const int iSrcX1 = std::max(m_aColBounds[x+1], iSrcX0+1);
+                    uint32_t u32Sum = 0;
+                    for (int sx = iSrcX0; sx < iSrcX1; sx++)
+                        u32Sum += pAcc[sx];
+                    const uint32_t u32Cnt = (uint32_t)(iSrcX1-iSrcX0)*(iSrcY1-iSrcY0);
+                    *pDst++ = (uint8_t)((u32Sum+u32Cnt/2)/u32Cnt);
+                }
+            }
         }
-        filtInOutPtr->name       = av_strdup("in");
-        filtInOutPtr->filter_ctx = m_pBufsrcCtx;
-        filtInOutPtr->pad_idx    = 0;
-        filtInOutPtr->next       = nullptr;
-        m_pFilterOutputs = filtInOutPtr;
 
-        m_pBufsinkCtx = nullptr;
-        fferr = avfilter_graph_create_filter(&m_pBufsinkCtx, buffersink, "buffer_sink", nullptr, nullptr, m_pFilterGraph);
-        if (fferr < 0)
+        static uint64_t CalcSad(const uint8_t* pA, const uint8_t* pB, size_t szCount)
         {
-            oss << "FAILED when invoking 'avfilter_graph_create_filter' for OUTPUT 'out'! fferr=" << fferr << ".";
-            m_errMsg = oss.str();
-            return false;
+            uint64_t u64Sad = 0;
+            size_t i = 0;
+#if defined(_M_X64) || (defined(__SSE2__) && defined(__x86_64__))
+            __m128i tAcc = _mm_setzero_si128();
+            for (; i+16 <= szCount; i += 16)
+            {
+                const __m128i tA = _mm_loadu_si128((const __m128i*)(pA+i));
+                const __m128i tB = _mm_loadu_si128((const __m128i*)(pB+i));
+                tAcc = _mm_add_epi64(tAcc, _mm_sad_epu8(tA, tB));
+            }
+            u64Sad = (uint64_t)_mm_cvtsi128_si64(tAcc)+(uint64_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(tAcc, tAcc));
+#endif
+            for (; i < szCount; i++)
+                u64Sad += pA[i] > pB[i] ? pA[i]-pB[i] : pB[i]-pA[i];
+            return u64Sad;
+        }
+
+    private:
+        int m_iDstW{0}, m_iDstH{0};
+        int m_iSrcW{0}, m_iSrcH{0};
+        vector<uint8_t> m_aCurrPlane, m_aPrevPlane;
+        vector<int> m_aColBounds;
+        vector<uint32_t> m_aRowAcc;
+        bool m_bHasPrev{false};
+        double m_dPrevMafd{0};
+    };
+
+    // Filter graph producing the 'lavfi.scene_score' metadata for each input frame. Each chunk worker owns its own instance.
+    // With the native scorer, the filter graph is only used for scaling and pixel format conversion when the decoded frame
+    // can not be scored directly, and the score is attached to the output frame as the same metadata entry.
+    class _SceneScoreFilter
+    {
+    public:
+        ~_SceneScoreFilter()
+        {
+            Release();
         }
-        filtInOutPtr = avfilter_inout_alloc();
-        if (!filtInOutPtr)
+
+        bool Setup(const AVFrame* pInAvfrm, int iOutW, int iOutH, bool bLumaOnly, bool bNativeScorer, const MediaCore::Ratio& tFrameRate, ALogger* pLogger)
         {
-            m_errMsg = "FAILED to allocate 'AVFilterInOut' instance!";
-            return false;
+            m_eInputPixfmt = (AVPixelFormat)pInAvfrm->format;
+            m_bNativeScorer = bNativeScorer;
+            if (bNativeScorer)
+            {
+                m_tNativeScorer.Reset(std::min(iOutW, pInAvfrm->width), std::min(iOutH, pInAvfrm->height));
+                m_bHasPendingScore = false;
+                m_bInited = true;
+                if (_LumaSadScorer::IsDirectInputFormat(m_eInputPixfmt))
+                {
+                    pLogger->Log(INFO) << "Use native scene scorer on the luma plane of '" << av_get_pix_fmt_name(m_eInputPixfmt) << "' frames." << endl;
+                    return true;
+                }
+            }
+
+            const AVFilter *buffersink = avfilter_get_by_name("buffersink");
+            const AVFilter *buffersrc  = avfilter_get_by_name("buffer");
+
+            m_pFilterGraph = avfilter_graph_alloc();
+            if (!m_pFilterGraph)
+            {
+                m_errMsg = "FAILED to allocate new 'AVFilterGraph'!";
+                return false;
+            }
+
+            int fferr;
+            ostringstream oss;
+            oss << pInAvfrm->width << ":" << pInAvfrm->height << ":pix_fmt=" << (int)m_eInputPixfmt << ":sar=1"
+                    << ":time_base=" << tFrameRate.den << "/" << tFrameRate.num << ":frame_rate=" << tFrameRate.num << "/" << tFrameRate.den;
+            string bufsrcArg = oss.str();
+            m_pBufsrcCtx = nullptr;
+            fferr = avfilter_graph_create_filter(&m_pBufsrcCtx, buffersrc, "buffer_source", bufsrcArg.c_str(), nullptr, m_pFilterGraph);
+            if (fferr < 0)
+            {
+                oss << "FAILED when invoking 'avfilter_graph_create_filter' for INPUT 'buffer_source'! fferr=" << fferr << ".";
+                m_errMsg = oss.str();
+                return false;
+            }
+            AVFilterInOut* filtInOutPtr = avfilter_inout_alloc();
+            if (!filtInOutPtr)
+            {
+                m_errMsg = "FAILED to allocate 'AVFilterInOut' instance!";
+                return false;
+            }
+            filtInOutPtr->name       = av_strdup("in");
+            filtInOutPtr->filter_ctx = m_pBufsrcCtx;
+            filtInOutPtr->pad_idx    = 0;
+            filtInOutPtr->next       = nullptr;
+            m_pFilterOutputs = filtInOutPtr;
+
+            m_pBufsinkCtx = nullptr;
+            fferr = avfilter_graph_create_filter(&m_pBufsinkCtx, buffersink, "buffer_sink", nullptr, nullptr, m_pFilterGraph);
+            if (fferr < 0)
+            {
+                oss << "FAILED when invoking 'avfilter_graph_create_filter' for OUTPUT 'out'! fferr=" << fferr << ".";
+                m_errMsg = oss.str();
+                return false;
+            }
+            filtInOutPtr = avfilter_inout_alloc();
+            if (!filtInOutPtr)
+            {
+                m_errMsg = "FAILED to allocate 'AVFilterInOut' instance!";
+                return false;
+            }
+            filtInOutPtr->name        = av_strdup("out");
+            filtInOutPtr->filter_ctx  = m_pBufsinkCtx;
+            filtInOutPtr->pad_idx     = 0;
+            filtInOutPtr->next        = nullptr;
+            m_pFilterInputs = filtInOutPtr;
+
+            oss.str("");
+            if (pInAvfrm->width != iOutW || pInAvfrm->height != iOutH)
+            {
+                string strInterpAlgo = iOutW*iOutH >= pInAvfrm->width*pInAvfrm->height ? "bicubic" : "area";
+                oss << "scale=w=" << iOutW << ":h=" << iOutH << ":flags=" << strInterpAlgo << ",";
+            }
+            const AVPixelFormat eAnalysisPixfmt = bLumaOnly || bNativeScorer ? AV_PIX_FMT_GRAY8 : AV_PIX_FMT_RGB24;
+            if ((AVPixelFormat)pInAvfrm->format != eAnalysisPixfmt)
+            {
+                oss << "format=" << av_get_pix_fmt_name(eAnalysisPixfmt) << ",";
+            }
+            if (!bNativeScorer)
+                oss << "select='gte(scene\\,0)'";
+            else
+                oss << "null";
+            string filterArgs = oss.str();
+            fferr = avfilter_graph_parse_ptr(m_pFilterGraph, filterArgs.c_str(), &m_pFilterInputs, &m_pFilterOutputs, nullptr);
+            if (fferr < 0)
+            {
+                oss.str(""); oss << "FAILED to invoke 'avfilter_graph_parse_ptr'! fferr=" << fferr << ". Arguments are \"" << filterArgs << "\".";
+                m_errMsg = oss.str();
+                return false;
+            }
+            pLogger->Log(INFO) << "Setup filter-graph with arguments: '" << filterArgs << "'." << endl;
+
+            fferr = avfilter_graph_config(m_pFilterGraph, nullptr);
+            if (fferr < 0)
+            {
+                oss << "FAILED to invoke 'avfilter_graph_config'! fferr=" << fferr << ".";
+                m_errMsg = oss.str();
+                return false;
+            }
+
+            if (m_pFilterOutputs)
+                avfilter_inout_free(&m_pFilterOutputs);
+            if (m_pFilterInputs)
+                avfilter_inout_free(&m_pFilterInputs);
+            m_bInited = true;
+            return true;
         }
-        filtInOutPtr->name        = av_strdup("out");
-        filtInOutPtr->filter_ctx  = m_pBufsinkCtx;
-        filtInOutPtr->pad_idx     = 0;
-        filtInOutPtr->next        = nullptr;
-        m_pFilterInputs = filtInOutPtr;
 
-        const int iOutW = (int)m_hSettings->VideoOutWidth();
-        const int iOutH = (int)m_hSettings->VideoOutHeight();
-        oss.str("");
-        if (pInAvfrm->width != iOutW || pInAvfrm->height != iOutH)
+        void Release()
         {
-            string strInterpAlgo = iOutW*iOutH >= pInAvfrm->width*pInAvfrm->height ? "bicubic" : "area";
-            oss << "scale=w=" << iOutW << ":h=" << iOutH << ":flags=" << strInterpAlgo << ",";
+            if (m_pFilterOutputs)
+            {
+                avfilter_inout_free(&m_pFilterOutputs);
+                m_pFilterOutputs = nullptr;
+            }
+            if (m_pFilterInputs)
+            {
+                avfilter_inout_free(&m_pFilterInputs);
+                m_pFilterInputs = nullptr;
+            }
+            m_pBufsrcCtx = nullptr;
+            m_pBufsinkCtx = nullptr;
+            if (m_pFilterGraph)
+            {
+                avfilter_graph_free(&m_pFilterGraph);
+                m_pFilterGraph = nullptr;
+            }
+            m_bInited = false;
         }
-        if ((AVPixelFormat)pInAvfrm->format != AV_PIX_FMT_RGB24)
+
+        bool IsInited() const { return m_bInited; }
+        AVPixelFormat GetInputPixelFormat() const { return m_eInputPixfmt; }
+        string GetError() const { return m_errMsg; }
+
+        int SendFrame(AVFrame* pAvfrm)
         {
-            oss << "format=rgb24,";
+            if (m_pFilterGraph)
+                return av_buffersrc_add_frame(m_pBufsrcCtx, pAvfrm);
+            if (m_bHasPendingScore)
+                return AVERROR(EAGAIN);
+            m_fPendingScore = m_tNativeScorer.Score(pAvfrm->data[0], pAvfrm->linesize[0], pAvfrm->width, pAvfrm->height);
+            m_i64PendingPts = pAvfrm->pts;
+            m_bHasPendingScore = true;
+            return 0;
         }
-        oss << "select='gte(scene\\,0)'";
-        string filterArgs = oss.str();
-        fferr = avfilter_graph_parse_ptr(m_pFilterGraph, filterArgs.c_str(), &m_pFilterInputs, &m_pFilterOutputs, nullptr);
-        if (fferr < 0)
+
+        int ReceiveFrame(AVFrame* pAvfrm)
         {
-            oss.str(""); oss << "FAILED to invoke 'avfilter_graph_parse_ptr'! fferr=" << fferr << ". Arguments are \"" << filterArgs << "\".";
-            m_errMsg = oss.str();
-            return false;
+            if (m_pFilterGraph)
+            {
+                int fferr = av_buffersink_get_frame(m_pBufsinkCtx, pAvfrm);
+                if (fferr < 0 || !m_bNativeScorer)
+                    return fferr;
+                const float fScore = m_tNativeScorer.Score(pAvfrm->data[0], pAvfrm->linesize[0], pAvfrm->width, pAvfrm->height);
+                return SetSceneScore(pAvfrm, fScore);
+            }
+            if (!m_bHasPendingScore)
+                return AVERROR(EAGAIN);
+            m_bHasPendingScore = false;
+            pAvfrm->pts = m_i64PendingPts;
+            return SetSceneScore(pAvfrm, m_fPendingScore);
         }
-        m_pLogger->Log(INFO) << "Setup filter-graph with arguments: '" << filterArgs << "'." << endl;
 
-        fferr = avfilter_graph_config(m_pFilterGraph, nullptr);
-        if (fferr < 0)
+        static float GetSceneScore(const AVFrame* pAvfrm)
         {
-            oss << "FAILED to invoke 'avfilter_graph_config'! fferr=" << fferr << ".";
-            m_errMsg = oss.str();
-            return false;
+            float fScore = 0;
+            auto dictEntry = av_dict_get(pAvfrm->metadata, "lavfi.scene_score", nullptr, 0);
+            if (dictEntry)
+                fScore = stof(dictEntry->value);
+            return fScore;
         }
 
-        if (m_pFilterOutputs)
-            avfilter_inout_free(&m_pFilterOutputs);
-        if (m_pFilterInputs)
-            avfilter_inout_free(&m_pFilterInputs);
-        return true;
+    private:
+        static int SetSceneScore(AVFrame* pAvfrm, float fScore)
+        {
+            char acScore[32];
+            snprintf(acScore, sizeof(acScore), "%f", fScore);
+            return av_dict_set(&pAvfrm->metadata, "lavfi.scene_score", acScore, 0);
+        }
+
+    private:
+        AVFilterGraph* m_pFilterGraph{nullptr};
+        AVFilterContext* m_pBufsrcCtx{nullptr};
+        AVFilterContext* m_pBufsinkCtx{nullptr};
+        AVFilterInOut* m_pFilterOutputs{nullptr};
+        AVFilterInOut* m_pFilterInputs{nullptr};
+        AVPixelFormat m_eInputPixfmt{AV_PIX_FMT_NONE};
+        bool m_bInited{false};
+        bool m_bNativeScorer{false};
+        _LumaSadScorer m_tNativeScorer;
+        bool m_bHasPendingScore{false};
+        float m_fPendingScore{0};
+        int64_t m_i64PendingPts{0};
+        string m_errMsg;
+    };
+
+    // Worker computing the scene scores of frames in [m_i64StartFrmIdx, m_i64EndFrmIdx) with its own decoder and filter graph.
+    // Up to two frames ahead of the chunk are fed into the filter graph but not reported, because the scene score of a frame
+    // depends on the previous frame and on the difference between the previous two frames. So the scores produced by the chunks
+    // are identical to the ones produced by a serial run.
+    class _SceneDetectChunk : public SysUtils::BaseAsyncTask
+    {
+    public:
+        using Holder = shared_ptr<_SceneDetectChunk>;
+
+        _SceneDetectChunk(BgtaskSceneDetect* pOwner, int64_t i64StartFrmIdx, int64_t i64EndFrmIdx)
+            : m_pOwner(pOwner), m_i64StartFrmIdx(i64StartFrmIdx), m_i64EndFrmIdx(i64EndFrmIdx)
+        {}
+
+        int64_t GetStartFrameIndex() const { return m_i64StartFrmIdx; }
+        int64_t GetEndFrameIndex() const { return m_i64EndFrmIdx; }
+        string GetError() const { return m_errMsg; }
+
+        // move the scores that are not fetched yet into 'aScores', returns 'true' if all the scores of this chunk have been fetched
+        bool FetchScores(vector<float>& aScores)
+        {
+            lock_guard<mutex> _lk(m_mtxScoresLock);
+            aScores.insert(aScores.end(), m_aScores.begin(), m_aScores.end());
+            m_aScores.clear();
+            return m_bAllScoresOut;
+        }
+
+        int64_t GetScoredFrameCount() const
+        {
+            return m_i64ScoredFrameCnt;
+        }
+
+        bool HasFailed() const
+        {
+            return m_bFailed;
+        }
+
+    protected:
+        bool _TaskProc() override
+        {
+            const bool bRet = ScoreFrames();
+            if (!bRet)
+                m_bFailed = true;
+            bool bAllScoresOut;
+            {
+                lock_guard<mutex> _lk(m_mtxScoresLock);
+                bAllScoresOut = m_bAllScoresOut;
+            }
+            if (!bAllScoresOut)
+                m_pOwner->OnChunkStopped();
+            return bRet;
+        }
+
+    private:
+        bool ScoreFrames()
+        {
+            auto hVclip = m_pOwner->m_hParseVclip->Clone(m_pOwner->m_hSettings);
+            if (!hVclip)
+            {
+                ostringstream oss; oss << "FAILED to clone VideoClip for chunk [" << m_i64StartFrmIdx << ", " << m_i64EndFrmIdx << ").";
+                m_errMsg = oss.str();
+                return false;
+            }
+            const auto tFrameRate = m_pOwner->m_hSettings->VideoOutFrameRate();
+            int iOutW, iOutH;
+            m_pOwner->GetAnalysisSize(iOutW, iOutH);
+            ImMatToAVFrameConverter tMat2AvfrmCvter;
+            int64_t i64FrmIdx = m_i64StartFrmIdx > 2 ? m_i64StartFrmIdx-2 : 0;
+            if (i64FrmIdx > 0)
+            {
+                const int64_t i64ReadPos = round((double)i64FrmIdx*1000*tFrameRate.den/tFrameRate.num);
+                hVclip->SeekTo(i64ReadPos);
+            }
+
+            _SceneScoreFilter tSceneFilter;
+            SelfFreeAVFramePtr hFgOutfrmPtr = AllocSelfFreeAVFramePtr();
+            int64_t i64ReportFrmIdx = m_i64StartFrmIdx;
+            bool bEof = false;
+            while (!IsCancelled() && !m_pOwner->IsCancelled() && !bEof && i64FrmIdx < m_i64EndFrmIdx)
+            {
+                if (m_pOwner->m_bPause)
+                {
+                    const bool bPark = m_pOwner->m_bParkWhenPaused;
+                    if (bPark)
+                    {
+                        tSceneFilter.Release();
+                        hVclip = nullptr;
+                    }
+                    if (!m_pOwner->WaitWhilePaused())
+                        break;
+                    if (bPark)
+                    {
+                        hVclip = m_pOwner->m_hParseVclip->Clone(m_pOwner->m_hSettings);
+                        if (!hVclip)
+                        {
+                            ostringstream oss; oss << "FAILED to clone VideoClip for chunk [" << m_i64StartFrmIdx << ", " << m_i64EndFrmIdx << ") on resume.";
+                            m_errMsg = oss.str();
+                            return false;
+                        }
+                        // prime the new filter graph in the same way as the chunk start
+                        i64ReportFrmIdx = max(i64FrmIdx, m_i64StartFrmIdx);
+                        i64FrmIdx = i64ReportFrmIdx > 2 ? i64ReportFrmIdx-2 : 0;
+                        hVclip->SeekTo(round((double)i64FrmIdx*1000*tFrameRate.den/tFrameRate.num));
+                    }
+                    continue;
+                }
+
+                const int64_t i64ReadPos = round((double)i64FrmIdx*1000*tFrameRate.den/tFrameRate.num);
+                auto hVfrm = hVclip->ReadSourceFrame(i64ReadPos, bEof, true);
+                if (!hVfrm)
+                    continue;
+                ImMatWrapper_AVFrame tAvfrmWrapper;
+                auto hFgInfrmPtr = GetAvframeFromVideoFrame(hVfrm, tMat2AvfrmCvter, tAvfrmWrapper, i64FrmIdx);
+                if (!hFgInfrmPtr)
+                    continue;
+                hFgInfrmPtr->pts = i64FrmIdx;
+                if (!tSceneFilter.IsInited() && !tSceneFilter.Setup(hFgInfrmPtr.get(), iOutW, iOutH,
+                        m_pOwner->m_bAnalysisLumaOnly, m_pOwner->m_bUseNativeScorer, tFrameRate, m_pOwner->m_pLogger))
+                {
+                    m_errMsg = tSceneFilter.GetError();
+                    return false;
+                }
+                int fferr = tSceneFilter.SendFrame(hFgInfrmPtr.get());
+                if (fferr < 0)
+                {
+                    ostringstream oss; oss << "FAILED when invoking 'av_buffersrc_add_frame()' at frame #" << i64FrmIdx << ". fferr=" << fferr << ".";
+                    m_errMsg = oss.str();
+                    return false;
+                }
+                i64FrmIdx++;
+
+                av_frame_unref(hFgOutfrmPtr.get());
+                fferr = tSceneFilter.ReceiveFrame(hFgOutfrmPtr.get());
+                if (fferr == AVERROR(EAGAIN))
+                    continue;
+                if (fferr < 0)
+                {
+                    ostringstream oss; oss << "FAILED when invoking 'av_buffersink_get_frame()' at frame #" << (i64FrmIdx-1) << ". fferr=" << fferr << ".";
+                    m_errMsg = oss.str();
+                    return false;
+                }
+                // drop the scores of the priming frames
+                if (hFgOutfrmPtr->pts < i64ReportFrmIdx)
+                    continue;
+                const float fScore = _SceneScoreFilter::GetSceneScore(hFgOutfrmPtr.get());
+                lock_guard<mutex> _lk(m_mtxScoresLock);
+                m_aScores.push_back(fScore);
+                m_i64ScoredFrameCnt++;
+            }
+            if (IsCancelled() || m_pOwner->IsCancelled())
+                return true;
+            lock_guard<mutex> _lk(m_mtxScoresLock);
+            m_bAllScoresOut = true;
+            return true;
+        }
+
+    private:
+        BgtaskSceneDetect* m_pOwner;
+        int64_t m_i64StartFrmIdx, m_i64EndFrmIdx;
+        mutex m_mtxScoresLock;
+        vector<float> m_aScores;
+        atomic_int64_t m_i64ScoredFrameCnt{0};
+        bool m_bAllScoresOut{false};
+        atomic_bool m_bFailed{false};
+        string m_errMsg;
+    };
+
+    // Split [i64StartFrmIdx, i64EndFrmIdx) into 'u32ChunkCnt' chunks. The boundaries are moved to the nearest key frames if the
+    // seek points of the source are available, so each chunk decoder starts with a cheap seek.
+    vector<int64_t> GetChunkBoundaries(int64_t i64StartFrmIdx, int64_t i64EndFrmIdx, uint32_t u32ChunkCnt)
+    {
+        const auto tFrameRate = m_hSettings->VideoOutFrameRate();
+        const AVRational tb = { tFrameRate.den, tFrameRate.num };
+        vector<int64_t> aKeyFrameIdxs;
+        if (!m_bIsImageSeq)
+        {
+            m_hParser->EnableParseInfo(MediaCore::MediaParser::VIDEO_SEEK_POINTS);
+            auto hSeekPoints = m_hParser->GetVideoSeekPoints(true);
+            if (hSeekPoints)
+            {
+                const AVRational tStmTb = { m_pVidstm->timebase.num, m_pVidstm->timebase.den };
+                for (const auto pts : *hSeekPoints)
+                {
+                    const auto mts = av_rescale_q(pts-m_pVidstm->startPts, tStmTb, MILLISEC_TIMEBASE)-m_i64ParseStartOffset;
+                    const auto i64KeyFrmIdx = av_rescale_q_rnd(mts, MILLISEC_TIMEBASE, tb, AV_ROUND_UP);
+                    if (i64KeyFrmIdx > i64StartFrmIdx && i64KeyFrmIdx < i64EndFrmIdx)
+                        aKeyFrameIdxs.push_back(i64KeyFrmIdx);
+                }
+                sort(aKeyFrameIdxs.begin(), aKeyFrameIdxs.end());
+            }
+        }
+
+        vector<int64_t> aBoundaries;
+        aBoundaries.push_back(i64StartFrmIdx);
+        const int64_t i64TotalFrmCnt = i64EndFrmIdx-i64StartFrmIdx;
+        for (uint32_t i = 1; i < u32ChunkCnt; i++)
+        {
+            int64_t i64Boundary = i64StartFrmIdx+i64TotalFrmCnt*i/u32ChunkCnt;
+            auto itKf = lower_bound(aKeyFrameIdxs.begin(), aKeyFrameIdxs.end(), i64Boundary);
+            int64_t i64NearestKf = -1;
+            if (itKf != aKeyFrameIdxs.end())
+                i64NearestKf = *itKf;
+            if (itKf != aKeyFrameIdxs.begin() && (i64NearestKf < 0 || i64Boundary-*(itKf-1) < i64NearestKf-i64Boundary))
+                i64NearestKf = *(itKf-1);
+            if (i64NearestKf > aBoundaries.back())
+                i64Boundary = i64NearestKf;
+            if (i64Boundary > aBoundaries.back())
+                aBoundaries.push_back(i64Boundary);
+        }
+        aBoundaries.push_back(i64EndFrmIdx);
+        return aBoundaries;
     }
 
-    void ReleaseFilterGraph()
+    bool SceneDetectInChunks()
     {
-        if (m_pFilterOutputs)
+        const auto tFrameRate = m_hSettings->VideoOutFrameRate();
+        const AVRational tb = { tFrameRate.den, tFrameRate.num };
+        // the last chunk reads until eof, this end index is only used to split the range
+        const int64_t i64EndFrmIdx = av_rescale_q(m_hParseVclip->Duration(), MILLISEC_TIMEBASE, tb);
+        // resume from the first frame without a score
+        const int64_t i64StartFrmIdx = (int64_t)m_aDiffScores.size();
+        uint32_t u32ChunkCnt = m_u32ParallelChunkCount;
+        const int64_t i64MinChunkFrames = 250;
+        if (i64EndFrmIdx-i64StartFrmIdx < (int64_t)u32ChunkCnt*i64MinChunkFrames)
+            u32ChunkCnt = (uint32_t)max((int64_t)1, (i64EndFrmIdx-i64StartFrmIdx)/i64MinChunkFrames);
+        const auto aBoundaries = GetChunkBoundaries(i64StartFrmIdx, i64EndFrmIdx, u32ChunkCnt);
+        const int64_t i64TotalFrmCnt = i64EndFrmIdx > i64StartFrmIdx ? i64EndFrmIdx-i64StartFrmIdx : 1;
+
+        vector<_SceneDetectChunk::Holder> aChunks;
+        for (size_t i = 0; i+1 < aBoundaries.size(); i++)
         {
-            avfilter_inout_free(&m_pFilterOutputs);
-            m_pFilterOutputs = nullptr;
+            const int64_t i64ChunkEnd = i+2 < aBoundaries.size() ? aBoundaries[i+1] : INT64_MAX;
+            aChunks.push_back(_SceneDetectChunk::Holder(new _SceneDetectChunk(this, aBoundaries[i], i64ChunkEnd)));
         }
-        if (m_pFilterInputs)
+        m_pLogger->Log(INFO) << "Run scene detect for frames [" << i64StartFrmIdx << ", " << i64EndFrmIdx << ") in " << aChunks.size() << " chunks." << endl;
+        // the scheduler admits this task by the units requested for the chunk threads, limited to its budget, so the chunk
+        // threads are limited to the units it is granted. the merging on this thread mostly waits
+        auto hExctor = SysUtils::ThreadPoolExecutor::CreateInstance("SceneDetectChunkExctor");
+        const uint32_t u32GrantedUnits = m_u32GrantedCpuUnits > 0 ? (uint32_t)m_u32GrantedCpuUnits : m_u32ParallelChunkCount;
+        const uint32_t u32ThreadCnt = max(min((uint32_t)aChunks.size(), u32GrantedUnits), 1u);
         {
-            avfilter_inout_free(&m_pFilterInputs);
-            m_pFilterInputs = nullptr;
+            lock_guard<mutex> _lk(m_mtxPauseLock);
+            m_bChunkStopped = false;
         }
-        m_pBufsrcCtx = nullptr;
-        m_pBufsinkCtx = nullptr;
-        if (m_pFilterGraph)
+        hExctor->SetMaxThreadCount(u32ThreadCnt);
+        hExctor->SetMinThreadCount(u32ThreadCnt);
+        for (auto& hChunk : aChunks)
+            hExctor->EnqueueTask(hChunk);
+
+        // merge the chunk results in order, so the output is the same as a serial run
+        bool bSucceeded = true;
+        vector<float> aScores;
+        size_t szMergeIdx = 0;
+        while (!IsCancelled() && szMergeIdx < aChunks.size())
         {
-            avfilter_graph_free(&m_pFilterGraph);
-            m_pFilterGraph = nullptr;
+            if (m_bPause)
+            {
+                // a stopped chunk wakes up the merging, so its failure is reported without waiting for the resume
+                unique_lock<mutex> _lk(m_mtxPauseLock);
+                m_bPauseCheckPointHit = true;
+                m_cvPause.wait(_lk, [this] { return !m_bPause || IsCancelled() || m_bChunkStopped; });
+                if (!m_bChunkStopped)
+                    continue;
+            }
+
+            auto& hChunk = aChunks[szMergeIdx];
+            aScores.clear();
+            const bool bChunkMerged = hChunk->FetchScores(aScores);
+            {
+                lock_guard<mutex> _lk(m_mtxResultLock);
+                int64_t i64FrmIdx = (int64_t)m_aDiffScores.size();
+                for (const auto fScore : aScores)
+                {
+                    m_aDiffScores.push_back(fScore);
+                    if (fScore >= m_fSceneDetectThresh)
+                    {
+                        int64_t mts = av_rescale_q(i64FrmIdx, tb, MILLISEC_TIMEBASE);
+                        m_aSceneCutPoints.push_back({i64FrmIdx, mts, fScore});
+                        m_pLogger->Log(INFO) << "Scene detect output: frame#" << i64FrmIdx << ", time=" << MillisecToString(mts) << ", score=" << fScore << endl;
+                    }
+                    m_i64ParsedFrameIdx = i64FrmIdx++;
+                }
+            }
+            if (bChunkMerged)
+            {
+                szMergeIdx++;
+                continue;
+            }
+            auto itFailed = find_if(aChunks.begin(), aChunks.end(), [] (const _SceneDetectChunk::Holder& h) { return h->HasFailed(); });
+            if (itFailed != aChunks.end())
+            {
+                const auto& hFailedChunk = *itFailed;
+                ostringstream oss; oss << "Background task 'SceneDetect' FAILED on chunk [" << hFailedChunk->GetStartFrameIndex() << ", " << hFailedChunk->GetEndFrameIndex()
+                        << ")! Error is '" << hFailedChunk->GetError() << "'.";
+                m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+                bSucceeded = false;
+                break;
+            }
+
+            int64_t i64ScoredFrmCnt = 0;
+            for (const auto& hWorker : aChunks)
+                i64ScoredFrmCnt += hWorker->GetScoredFrameCount();
+            m_fProgress = (float)min((double)i64ScoredFrmCnt/i64TotalFrmCnt, 1.);
+            this_thread::sleep_for(chrono::milliseconds(THREAD_IDLE_TIME));
+        }
+        for (auto& hChunk : aChunks)
+            hChunk->Cancel();
+        hExctor->Terminate(true);
+        return bSucceeded;
+    }
+
+    void GetAnalysisSize(int& iW, int& iH) const
+    {
+        iW = (int)m_hSettings->VideoOutWidth();
+        iH = (int)m_hSettings->VideoOutHeight();
+        if (m_u32AnalysisWidth > 0 && (int)m_u32AnalysisWidth < iW)
+        {
+            iH = std::max((int)round((double)iH*m_u32AnalysisWidth/iW), 2);
+            iH += iH&1;
+            iW = (int)(m_u32AnalysisWidth+(m_u32AnalysisWidth&1));
+        }
+    }
+
+    bool SetupSceneDetectFilterGraph(const AVFrame* pInAvfrm)
+    {
+        int iOutW, iOutH;
+        GetAnalysisSize(iOutW, iOutH);
+        if (!m_tSceneFilter.Setup(pInAvfrm, iOutW, iOutH, m_bAnalysisLumaOnly, m_bUseNativeScorer, m_hSettings->VideoOutFrameRate(), m_pLogger))
+        {
+            m_errMsg = m_tSceneFilter.GetError();
+            return false;
         }
+        m_eFgInputPixfmt = m_tSceneFilter.GetInputPixelFormat();
+        return true;
+    }
+
+    void ReleaseFilterGraph()
+    {
+        m_tSceneFilter.Release();
     }
 
 private:
@@ -1051,12 +1872,8 @@ private:
     Callbacks* m_pCb{nullptr};
     bool m_bInited{false};
     string m_strTaskDir;
-    AVFilterGraph* m_pFilterGraph{nullptr};
-    AVFilterContext* m_pBufsrcCtx;
-    AVFilterContext* m_pBufsinkCtx;
-    AVFilterInOut* m_pFilterOutputs{nullptr};
-    AVFilterInOut* m_pFilterInputs{nullptr};
-    AVPixelFormat m_eFgInputPixfmt;
+    _SceneScoreFilter m_tSceneFilter;
+    AVPixelFormat m_eFgInputPixfmt{AV_PIX_FMT_NONE};
     string m_strTrfPath;
     string m_strSrcUrl;
     int64_t m_i64MediaItemId;
@@ -1073,17 +1890,33 @@ private:
     bool m_bUseSrcAttr;
     // scene detect parameters
     float m_fSceneDetectThresh{0.4f};
+    bool m_bUseSharedDecoding{true};
+    uint32_t m_u32AnalysisWidth{0};  // 0 means analyzing with the full output size
+    bool m_bAnalysisLumaOnly{false};
+    bool m_bUseNativeScorer{false};
+    uint32_t m_u32ParallelChunkCount{1};
+    atomic_uint32_t m_u32GrantedCpuUnits{0};
     // output
     size_t m_resultHash;
     string m_resultId;
     string m_strOutputPath;
     vector<_SceneCutPoint> m_aSceneCutPoints;
-    list<float> m_aDiffScores;
+    vector<float> m_aDiffScores;
+    mutex m_mtxResultLock;
+    json::value m_jnDiffScoresFileRef;
+    size_t m_szSavedDiffScoreCount{0};
     // task control
     int64_t m_i64ParsedFrameIdx{0};
     float m_fProgress{0.f};
-    bool m_bPause{false};
-    bool m_bPauseCheckPointHit{false};
+    atomic_bool m_bPause{false};
+    atomic_bool m_bUserPause{false};
+    bool m_bThrottlePause{false};
+    atomic_bool m_bPauseCheckPointHit{false};
+    bool m_bParkWhenPaused{false};    // release the decoder and the filter graph while the task is paused
+    atomic_int m_iPriority{0};
+    mutex m_mtxPauseLock;
+    condition_variable m_cvPause;
+    bool m_bChunkStopped{false};      // set by a chunk which stops early, guarded by 'm_mtxPauseLock'
     // ui vars
     string m_strTaskNameWithHash;
     uint32_t m_u32PreviewWidth{480}, m_u32PreviewHeight{270};
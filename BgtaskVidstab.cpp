@@ -1,10 +1,17 @@
 #include <cstdint>
 #include <sstream>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 #include <ios>
 #include <iomanip>
+#include <fstream>
 #include <vector>
 #include <cmath>
 #include <cassert>
+#include <cstring>
+#include <chrono>
+#include <filesystem>
 #include <BaseUtils/TimeUtils.h>
 #include <BaseUtils/FileSystemUtils.h>
 #include <MediaCore/MediaParser.h>
@@ -17,9 +24,11 @@
 extern "C"
 {
 #include "libavutil/avutil.h"
+#include "libavutil/imgutils.h"
 #include "libavfilter/avfilter.h"
 #include "libavfilter/buffersrc.h"
 #include "libavfilter/buffersink.h"
+#include "libavformat/avformat.h"
 }
 
 
@@ -29,6 +38,11 @@ using namespace Logger;
 
 namespace MEC
 {
+// the spool is only started if the raw size of the detect frames plus this reserve is free, and it's dropped once the free
+// space falls under the reserve
+static const uint64_t SPOOL_FREE_SPACE_RESERVE = 1024ULL*1024*1024;
+static const int64_t SPOOL_SPACE_CHECK_INTERVAL = 250;
+
 class BgtaskVidstab : public BackgroundTask
 {
 public:
@@ -553,6 +567,18 @@ public:
                     m_aVidencExtraOpts.push_back(std::move(tOpt));
             }
         }
+        strAttrName = "use_shared_decoding";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_boolean())
+            m_bUseSharedDecoding = jnTask[strAttrName].get<json::boolean>();
+        strAttrName = "spool_detect_frames";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_boolean())
+            m_bSpoolDetectFrames = jnTask[strAttrName].get<json::boolean>();
+        strAttrName = "park_when_paused";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_boolean())
+            m_bParkWhenPaused = jnTask[strAttrName].get<json::boolean>();
+        strAttrName = "priority";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_number())
+            m_iPriority = (int)jnTask[strAttrName].get<json::number>();
         // read task status
         strAttrName = "is_vidstab_detect_done";
         if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_boolean())
@@ -564,6 +590,54 @@ public:
             m_bVidstabTransformFinished = jnTask[strAttrName].get<json::boolean>();
         else
             m_bVidstabTransformFinished = false;
+        // the transforms are kept in the '.trf' sidecar file, check it still matches the one produced by the detect pass
+        if (m_bVidstabDetectFinished)
+        {
+            strAttrName = "transforms_file";
+            string strChecksum;
+            bool bTrfValid = AnalysisDataFile::CalcFileChecksum(m_strTrfPath, strChecksum);
+            if (bTrfValid && jnTask.contains(strAttrName) && AnalysisDataFile::IsReference(jnTask[strAttrName]))
+                bTrfValid = jnTask[strAttrName]["checksum"].get<json::string>() == strChecksum;
+            if (bTrfValid)
+            {
+                m_strTrfChecksum = strChecksum;
+            }
+            else
+            {
+                m_pLogger->Log(WARN) << "Transforms file '" << m_strTrfPath << "' is missing or modified, the vidstab detection will restart." << endl;
+                m_bVidstabDetectFinished = false;
+                m_bVidstabTransformFinished = false;
+            }
+        }
+        strAttrName = "transform_segment_length";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_number())
+        {
+            const auto numValue = jnTask[strAttrName].get<json::number>();
+            m_i64SegmentLength = numValue > 0 ? (int64_t)numValue : 0;
+        }
+        // the finished output segments of an interrupted transform pass
+        strAttrName = "transform_segments";
+        if (m_bVidstabDetectFinished && !m_bVidstabTransformFinished && jnTask.contains(strAttrName) && jnTask[strAttrName].is_array())
+        {
+            const auto& jnSegments = jnTask[strAttrName].get<json::array>();
+            for (const auto& jnElem : jnSegments)
+            {
+                if (!jnElem.contains("file") || !jnElem["file"].is_string() || !jnElem.contains("frame_count") || !jnElem["frame_count"].is_number())
+                    break;
+                _OutputSegment tSeg;
+                tSeg.strFileName = jnElem["file"].get<json::string>();
+                tSeg.i64FrameCount = (int64_t)jnElem["frame_count"].get<json::number>();
+                // only the continuous segments from the beginning can be used
+                if (!SysUtils::IsFile(SysUtils::JoinPath(m_strTaskDir, tSeg.strFileName)))
+                    break;
+                m_i64TransformedFrameCount += tSeg.i64FrameCount;
+                m_aOutputSegments.push_back(std::move(tSeg));
+            }
+        }
+        m_strSpoolPath = SysUtils::JoinPath(m_strTaskDir, "detect_spool.mkv");
+        strAttrName = "is_detect_spool_ready";
+        if (m_bVidstabDetectFinished && !m_bVidstabTransformFinished && jnTask.contains(strAttrName) && jnTask[strAttrName].is_boolean())
+            m_bSpoolReady = jnTask[strAttrName].get<json::boolean>() && SysUtils::IsFile(m_strSpoolPath);
         bool bFailed = false;
         strAttrName = "is_task_failed";
         if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_boolean())
@@ -586,6 +660,28 @@ public:
         m_pCb = pCb;
     }
 
+    CostClass GetCostClass() const override
+    {
+        return COST_HEAVY;
+    }
+
+    size_t GetEstimatedMemoryUsage() const override
+    {
+        // decoder, filter graph and encoder together hold about 24 frames, 4 bytes per pixel at most
+        const size_t szFrameBytes = (size_t)m_hSettings->VideoOutWidth()*m_hSettings->VideoOutHeight()*4;
+        return szFrameBytes*24;
+    }
+
+    int GetPriority() const override
+    {
+        return m_iPriority;
+    }
+
+    void SetPriority(int iPriority) override
+    {
+        m_iPriority = iPriority;
+    }
+
     bool CanPause()
     {
         return m_eState == PROCESSING;
@@ -593,10 +689,9 @@ public:
 
     bool Pause() override
     {
-        if (m_bPause)
-            return true;
-        m_bPauseCheckPointHit = false;
-        m_bPause = true;
+        lock_guard<mutex> _lk(m_mtxPauseLock);
+        m_bUserPause = true;
+        UpdatePauseState();
         return true;
     }
 
@@ -605,12 +700,43 @@ public:
         return m_bPause && m_bPauseCheckPointHit;
     }
 
+    bool IsUserPaused() const override
+    {
+        return m_bUserPause;
+    }
+
     bool Resume() override
     {
-        m_bPause = false;
+        {
+            lock_guard<mutex> _lk(m_mtxPauseLock);
+            m_bUserPause = false;
+            UpdatePauseState();
+        }
+        m_cvPause.notify_all();
         return true;
     }
 
+    void SetThrottled(bool bThrottled) override
+    {
+        {
+            lock_guard<mutex> _lk(m_mtxPauseLock);
+            m_bThrottlePause = bThrottled;
+            UpdatePauseState();
+        }
+        m_cvPause.notify_all();
+    }
+
+    bool Cancel() override
+    {
+        const bool bRet = BackgroundTask::Cancel();
+        // acquire the lock before notifying, so a thread just going to wait won't miss the wakeup
+        {
+            lock_guard<mutex> _lk(m_mtxPauseLock);
+        }
+        m_cvPause.notify_all();
+        return bRet;
+    }
+
     bool DrawContent(const ImVec2& v2ViewSize) override
     {
         bool bRemoveThisTask = false;
@@ -655,14 +781,14 @@ public:
         ImGui::BeginDisabled(bDisableThisWidget);
         if (ImGui::Button(strLabel.c_str()))
         {
-            if (m_bPause)
+            if (m_bUserPause)
                 Resume();
             else
                 Pause();
         } ImGui::SameLine();
         ImGui::ShowTooltipOnHover(bDisableThisWidget
                 ? (m_eState == WAITING ? "Task hasn't started yet." : "Task is already stopped.")
-                : (m_bPause ? "Resume task" : "Pause task"));
+                : (m_bUserPause ? "Resume task" : "Pause task"));
         ImGui::EndDisabled();
         oss.str(""); oss << ICON_DELETE << strTaskNameWithHash;
         strLabel = oss.str();
@@ -806,9 +932,34 @@ public:
                 jnExtraOpts[item.name] = jval;
         }
         jnTask["videnc_extra_opts"] = jnExtraOpts;
+        jnTask["use_shared_decoding"] = m_bUseSharedDecoding;
+        jnTask["spool_detect_frames"] = m_bSpoolDetectFrames;
+        jnTask["park_when_paused"] = m_bParkWhenPaused;
+        jnTask["priority"] = json::number(m_iPriority);
+        jnTask["is_detect_spool_ready"] = m_bSpoolReady;
         // save task status
         jnTask["is_vidstab_detect_done"] = m_bVidstabDetectFinished;
+        if (m_bVidstabDetectFinished && !m_strTrfChecksum.empty())
+        {
+            json::value jnTrfRef;
+            jnTrfRef["file"] = SysUtils::ExtractFileName(m_strTrfPath);
+            jnTrfRef["checksum"] = m_strTrfChecksum;
+            jnTask["transforms_file"] = jnTrfRef;
+        }
         jnTask["is_vidstab_transform_done"] = m_bVidstabTransformFinished;
+        jnTask["transform_segment_length"] = json::number(m_i64SegmentLength);
+        json::array jnSegments;
+        {
+            lock_guard<mutex> _lk(m_mtxSegmentsLock);
+            for (const auto& tSeg : m_aOutputSegments)
+            {
+                json::value jnSeg;
+                jnSeg["file"] = tSeg.strFileName;
+                jnSeg["frame_count"] = json::number(tSeg.i64FrameCount);
+                jnSegments.push_back(jnSeg);
+            }
+        }
+        jnTask["transform_segments"] = jnSegments;
         jnTask["is_task_failed"] = IsFailed();
         jnTask["error_message"] = m_errMsg;
         return true;
@@ -823,6 +974,8 @@ public:
             return "";
         }
         const auto strSavePath = _strSavePath.empty() ? SysUtils::JoinPath(m_strTaskDir, "task.json") : _strSavePath;
+        // the task json is saved by the UI thread and by the checkpoints of the worker thread
+        lock_guard<mutex> _lk(m_mtxSaveLock);
         if (!jnTask.save(strSavePath))
         {
             m_pLogger->Log(Error) << "FAILED to save task json of '" << m_name << "' at location '" << strSavePath << "'!" << endl;
@@ -870,13 +1023,34 @@ protected:
         const auto tFrameRate = m_hSettings->VideoOutFrameRate();
         if (!m_bVidstabDetectFinished)
         {
+            // the detect pass can share the decoded frames with other analysis tasks working on the same source range
+            AnalysisSource::Subscription::Holder hSharedSrc;
+            bool bOwnDecoderSynced = true;
+            if (m_bUseSharedDecoding)
+                hSharedSrc = AnalysisSource::Subscribe(m_hVclip, i64FrmIdx);
+            bool bSpoolFrames = m_bSpoolDetectFrames;
+            m_bSpoolReady = false;
+            m_strTrfChecksum.clear();
+            // output segments of an earlier transform pass are stale once the transforms are detected again
+            {
+                lock_guard<mutex> _lk(m_mtxSegmentsLock);
+                m_aOutputSegments.clear();
+            }
+            m_i64TransformedFrameCount = 0;
+            bool bDetectReachedEof = false;
+            const auto tpDetectStart = chrono::steady_clock::now();
             SelfFreeAVFramePtr hFgOutfrmPtr = AllocSelfFreeAVFramePtr();
             while (!IsCancelled())
             {
                 if (m_bPause)
                 {
-                    m_bPauseCheckPointHit = true;
-                    this_thread::sleep_for(chrono::milliseconds(THREAD_IDLE_TIME));
+                    // leave the shared source while paused, so other subscribers won't be blocked by this task.
+                    // the detect pass is never parked, the motion state of 'vidstabdetect' can not be rebuilt.
+                    hSharedSrc = nullptr;
+                    if (!WaitWhilePaused())
+                        break;
+                    if (m_bUseSharedDecoding)
+                        hSharedSrc = AnalysisSource::Subscribe(m_hVclip, i64FrmIdx);
                     continue;
                 }
 
@@ -884,27 +1058,50 @@ protected:
                 SelfFreeAVFramePtr hFgInfrmPtr;
                 const int64_t i64ReadPos = round((double)i64FrmIdx*1000*tFrameRate.den/tFrameRate.num);
                 bool bEof = false;
-                auto hVfrm = m_hVclip->ReadSourceFrame(i64ReadPos, bEof, true);
-                ImMatWrapper_AVFrame tAvfrmWrapper;
-                if (hVfrm)
+                if (hSharedSrc)
                 {
-                    auto tNativeData = hVfrm->GetNativeData();
-                    if (tNativeData.eType == MediaCore::VideoFrame::NativeData::AVFRAME)
-                        hFgInfrmPtr = CloneSelfFreeAVFramePtr((AVFrame*)tNativeData.pData);
-                    else if (tNativeData.eType == MediaCore::VideoFrame::NativeData::AVFRAME_HOLDER)
-                        hFgInfrmPtr = *((SelfFreeAVFramePtr*)tNativeData.pData);
-                    else if (tNativeData.eType == MediaCore::VideoFrame::NativeData::MAT)
+                    const auto eReadRes = hSharedSrc->ReadFrame(hFgInfrmPtr);
+                    if (eReadRes == AnalysisSource::READ_AGAIN)
+                        continue;
+                    else if (eReadRes == AnalysisSource::READ_EOF)
+                        bEof = true;
+                    else if (eReadRes == AnalysisSource::READ_FAILED)
                     {
-                        const auto& vmat = *((ImGui::ImMat*)tNativeData.pData);
-                        if (vmat.device != IM_DD_CPU)
-                        {
-                            hFgInfrmPtr = AllocSelfFreeAVFramePtr();
-                            tMat2AvfrmCvter.ConvertImage(vmat, hFgInfrmPtr.get(), i64FrmIdx);
-                        }
-                        else
+                        m_pLogger->Log(WARN) << "Read from shared analysis source FAILED at frame #" << i64FrmIdx << ", switch to private decoding." << endl;
+                        hSharedSrc = nullptr;
+                        continue;
+                    }
+                    bOwnDecoderSynced = false;
+                }
+                else
+                {
+                    if (!bOwnDecoderSynced)
+                    {
+                        m_hVclip->SeekTo(i64ReadPos);
+                        bOwnDecoderSynced = true;
+                    }
+                    auto hVfrm = m_hVclip->ReadSourceFrame(i64ReadPos, bEof, true);
+                    ImMatWrapper_AVFrame tAvfrmWrapper;
+                    if (hVfrm)
+                    {
+                        auto tNativeData = hVfrm->GetNativeData();
+                        if (tNativeData.eType == MediaCore::VideoFrame::NativeData::AVFRAME)
+                            hFgInfrmPtr = CloneSelfFreeAVFramePtr((AVFrame*)tNativeData.pData);
+                        else if (tNativeData.eType == MediaCore::VideoFrame::NativeData::AVFRAME_HOLDER)
+                            hFgInfrmPtr = *((SelfFreeAVFramePtr*)tNativeData.pData);
+                        else if (tNativeData.eType == MediaCore::VideoFrame::NativeData::MAT)
                         {
-                            tAvfrmWrapper.SetMat(vmat);
-                            hFgInfrmPtr = tAvfrmWrapper.GetWrapper(i64FrmIdx);
+                            const auto& vmat = *((ImGui::ImMat*)tNativeData.pData);
+                            if (vmat.device != IM_DD_CPU)
+                            {
+                                hFgInfrmPtr = AllocSelfFreeAVFramePtr();
+                                tMat2AvfrmCvter.ConvertImage(vmat, hFgInfrmPtr.get(), i64FrmIdx);
+                            }
+                            else
+                            {
+                                tAvfrmWrapper.SetMat(vmat);
+                                hFgInfrmPtr = tAvfrmWrapper.GetWrapper(i64FrmIdx);
+                            }
                         }
                     }
                 }
@@ -942,33 +1139,97 @@ protected:
                             m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
                             return false;
                         }
+                        // 'vidstabdetect' passes the scaled frames through, spool them so the transform pass doesn't need to decode the source again
+                        if (bSpoolFrames)
+                            bSpoolFrames = SpoolDetectFrame(hFgOutfrmPtr.get());
                     }
                 }
                 float fStageProgress = (float)((double)i64ReadPos/i64ClipDur);
                 m_fProgress = fAccumShares+(fStageProgress*fStageShare);
                 if (bEof)
+                {
+                    bDetectReachedEof = true;
                     break;
+                }
             }
-            m_bVidstabDetectFinished = true;
+            hSharedSrc = nullptr;
+            // the 'vidstabdetect' filter flushes and closes the transforms file when the filter graph is released
             ReleaseFilterGraph();
+            if (!bDetectReachedEof || IsCancelled())
+            {
+                // the partial transforms file is not reused, the detect pass starts over when the task is run again
+                DiscardSpool();
+                m_pLogger->Log(INFO) << "Vidstab detect pass is cancelled at frame #" << i64FrmIdx << "." << endl;
+                return true;
+            }
+            if (!AnalysisDataFile::CalcFileChecksum(m_strTrfPath, m_strTrfChecksum))
+                m_pLogger->Log(WARN) << "FAILED to calculate the checksum of transforms file '" << m_strTrfPath << "'." << endl;
+            if (bSpoolFrames && m_hSpoolEncoder)
+                m_bSpoolReady = FinishSpool();
+            else
+                DiscardSpool();
+            m_pLogger->Log(INFO) << "Vidstab detect pass took " << chrono::duration<double>(chrono::steady_clock::now()-tpDetectStart).count() << "s"
+                    << (m_bSpoolReady ? " with spooling." : " without spooling.") << endl;
+            m_bVidstabDetectFinished = true;
         }
         fAccumShares += fStageShare;
         m_fProgress = fAccumShares;
 
         fStageProgress = 0.f; fStageShare = 0.5f;
-        i64FrmIdx = 0;
-        m_hVclip->SeekTo(0);
         bFilterGraphInited = false;
         bool bEncoderInited = false;
         if (!m_bVidstabTransformFinished)
         {
+            // resume from the first frame that is not in a finished output segment, the frames in the warm-up window
+            // before it are transformed again but not encoded
+            int64_t i64ResumeFrmIdx = m_i64TransformedFrameCount;
+            i64FrmIdx = GetWarmupStartFrameIndex(i64ResumeFrmIdx);
+            int64_t i64SegStartFrmIdx = i64ResumeFrmIdx;
+            const int64_t i64SegFrameCount = m_i64SegmentLength > 0 ? max((int64_t)1, av_rescale_q(m_i64SegmentLength, MILLISEC_TIMEBASE, { tFrameRate.den, tFrameRate.num })) : INT64_MAX;
+            // read the spooled detect frames if available, otherwise decode the source again
+            MediaCore::VideoClip::Holder hSrcVclip;
+            if (m_bSpoolReady)
+                hSrcVclip = OpenSpool(i64ClipDur);
+            if (!hSrcVclip)
+                hSrcVclip = m_hVclip;
+            const bool bReadSpool = hSrcVclip != m_hVclip;
+            const auto tpTransformStart = chrono::steady_clock::now();
+            hSrcVclip->SeekTo(round((double)i64FrmIdx*1000*tFrameRate.den/tFrameRate.num));
+            if (i64ResumeFrmIdx > 0)
+                m_pLogger->Log(INFO) << "Resume vidstab transform pass from frame #" << i64ResumeFrmIdx << " with " << m_aOutputSegments.size() << " finished segments." << endl;
             SelfFreeAVFramePtr hFgOutfrmPtr = AllocSelfFreeAVFramePtr();
             while (!IsCancelled())
             {
                 if (m_bPause)
                 {
-                    m_bPauseCheckPointHit = true;
-                    this_thread::sleep_for(chrono::milliseconds(THREAD_IDLE_TIME));
+                    const bool bPark = m_bParkWhenPaused;
+                    if (bPark)
+                    {
+                        // close the current output segment as a checkpoint, then release the decoder, the filter graph and
+                        // the encoder. they are rebuilt on resume in the same way as resuming an interrupted task.
+                        if (bEncoderInited)
+                        {
+                            if (!FinishSegment(i64FrmIdx-i64SegStartFrmIdx))
+                                return false;
+                            bEncoderInited = false;
+                        }
+                        ReleaseFilterGraph();
+                        bFilterGraphInited = false;
+                        hSrcVclip = nullptr;
+                        m_pLogger->Log(DEBUG) << "Task '" << m_name << "' is parked at frame #" << i64FrmIdx << "." << endl;
+                    }
+                    if (!WaitWhilePaused())
+                        break;
+                    if (bPark)
+                    {
+                        i64ResumeFrmIdx = i64FrmIdx;
+                        i64FrmIdx = GetWarmupStartFrameIndex(i64ResumeFrmIdx);
+                        if (m_bSpoolReady)
+                            hSrcVclip = OpenSpool(i64ClipDur);
+                        if (!hSrcVclip)
+                            hSrcVclip = m_hVclip;
+                        hSrcVclip->SeekTo(round((double)i64FrmIdx*1000*tFrameRate.den/tFrameRate.num));
+                    }
                     continue;
                 }
 
@@ -976,7 +1237,7 @@ protected:
                 SelfFreeAVFramePtr hFgInfrmPtr;
                 const int64_t i64ReadPos = round((double)i64FrmIdx*1000*tFrameRate.den/tFrameRate.num);
                 bool bEof = false;
-                auto hVfrm = m_hVclip->ReadSourceFrame(i64ReadPos, bEof, true);
+                auto hVfrm = hSrcVclip->ReadSourceFrame(i64ReadPos, bEof, true);
                 ImMatWrapper_AVFrame tAvfrmWrapper;
                 if (hVfrm)
                 {
@@ -1006,9 +1267,9 @@ protected:
                     hFgInfrmPtr->pict_type = AV_PICTURE_TYPE_NONE;
                     if (!bFilterGraphInited)
                     {
-                        if (!SetupVidstabTransformFilterGraph(hFgInfrmPtr.get()))
+                        if (!SetupResumedTransformFilterGraph(hFgInfrmPtr.get(), i64FrmIdx))
                         {
-                            m_pLogger->Log(Error) << "'SetupVidstabTransformFilterGraph()' FAILED! Error is '" << m_errMsg << "'." << endl;
+                            m_pLogger->Log(Error) << "'SetupResumedTransformFilterGraph()' FAILED! Error is '" << m_errMsg << "'." << endl;
                             return false;
                         }
                         bFilterGraphInited = true;
@@ -1033,17 +1294,24 @@ protected:
                             m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
                             return false;
                         }
+                    }
+                    // the frames in the warm-up window are already in a finished segment, they are not encoded again
+                    if (fferr >= 0 && i64FrmIdx >= i64ResumeFrmIdx)
+                    {
                         if (!bEncoderInited)
                         {
-                            // setup MediaEncoder
-                            if (!SetupEncoder(hFgOutfrmPtr.get()))
+                            // setup MediaEncoder for a new output segment
+                            if (!SetupEncoder(hFgOutfrmPtr.get(), GetSegmentPath(m_aOutputSegments.size())))
                             {
                                 m_pLogger->Log(Error) << "'SetupEncoder()' FAILED!" << endl;
                                 return false;
                             }
                             bEncoderInited = true;
+                            i64SegStartFrmIdx = i64FrmIdx;
                         }
-                        auto hVfrm = FFUtils::CreateVideoFrameFromAVFrame(CloneSelfFreeAVFramePtr(hFgOutfrmPtr.get()), i64ReadPos);
+                        // each segment starts at time 0, the segments are rebased when they are concatenated
+                        const int64_t i64SegPos = i64ReadPos-round((double)i64SegStartFrmIdx*1000*tFrameRate.den/tFrameRate.num);
+                        auto hVfrm = FFUtils::CreateVideoFrameFromAVFrame(CloneSelfFreeAVFramePtr(hFgOutfrmPtr.get()), i64SegPos);
                         bool consumed = false;
                         if (!m_hEncoder->EncodeVideoFrame(hVfrm, consumed))
                         {
@@ -1053,22 +1321,42 @@ protected:
                         }
                     }
                     i64FrmIdx++;
+                    // close the current segment and save a checkpoint
+                    if (bEncoderInited && i64FrmIdx-i64SegStartFrmIdx >= i64SegFrameCount)
+                    {
+                        if (!FinishSegment(i64FrmIdx-i64SegStartFrmIdx))
+                            return false;
+                        bEncoderInited = false;
+                    }
                 }
                 float fStageProgress = (float)((double)i64ReadPos/i64ClipDur);
                 m_fProgress = fAccumShares+(fStageProgress*fStageShare);
                 if (bEof)
                     break;
             }
+            hSrcVclip = nullptr;
+            if (IsCancelled())
+            {
+                // drop the unfinished segment, finished segments are kept for resuming
+                ReleaseEncoder();
+                if (bEncoderInited)
+                    SysUtils::DeleteFileAt(GetSegmentPath(m_aOutputSegments.size()));
+                m_pLogger->Log(INFO) << "Vidstab transform pass is cancelled with " << m_i64TransformedFrameCount << " frames in finished segments." << endl;
+                return true;
+            }
             if (bEncoderInited)
             {
-                if (!m_hEncoder->FinishEncoding())
-                {
-                    ostringstream oss; oss << "FAILED to 'Finish' MediaEncoder! Error is '" << m_hEncoder->GetError() << "'.";
-                    m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+                if (!FinishSegment(i64FrmIdx-i64SegStartFrmIdx))
                     return false;
-                }
-                m_hEncoder->Close();
             }
+            if (!ConcatOutputSegments())
+            {
+                m_pLogger->Log(Error) << "'ConcatOutputSegments()' FAILED! Error is '" << m_errMsg << "'." << endl;
+                return false;
+            }
+            DiscardSpool();
+            m_pLogger->Log(INFO) << "Vidstab transform pass took " << chrono::duration<double>(chrono::steady_clock::now()-tpTransformStart).count() << "s"
+                    << (bReadSpool ? " reading the spool." : " decoding the source.") << endl;
             m_bVidstabTransformFinished = true;
         }
         fAccumShares += fStageShare;
@@ -1082,6 +1370,8 @@ protected:
     {
         ReleaseFilterGraph();
         ReleaseEncoder();
+        if (m_hSpoolEncoder)
+            DiscardSpool();
         return true;
     }
 
@@ -1184,7 +1474,7 @@ private:
         return true;
     }
 
-    bool SetupVidstabTransformFilterGraph(const AVFrame* pInAvfrm)
+    bool SetupVidstabTransformFilterGraph(const AVFrame* pInAvfrm, const string& strTrfPath)
     {
         const AVFilter *buffersink = avfilter_get_by_name("buffersink");
         const AVFilter *buffersrc  = avfilter_get_by_name("buffer");
@@ -1264,7 +1554,7 @@ private:
         if (m_u8InterpMode == 0) strInterpMode = "no";
         else if (m_u8InterpMode == 1) strInterpMode = "linear";
         else if (m_u8InterpMode == 3) strInterpMode = "bicubic";
-        oss << "vidstabtransform=input=" << m_strTrfPath << ":smoothing=" << m_u32Smoothing << ":optalgo=" << strOptAlgo << ":maxshift=" << m_i32MaxShift
+        oss << "vidstabtransform=input=" << strTrfPath << ":smoothing=" << m_u32Smoothing << ":optalgo=" << strOptAlgo << ":maxshift=" << m_i32MaxShift
                 << ":maxangle=" << m_fMaxAngle << ":crop=" << strCropMode << ":invert=" << (m_bInvertTrans?1:0) << ":relative=" << (m_bRelative?1:0)
                 << ":zoom=" << m_fPresetZoom << ":optzoom=" << (int)m_u8OptZoom << ":zoomspeed=" << m_fZoomSpeed << ":interpol=" << strInterpMode;
         string filterArgs = oss.str();
@@ -1313,12 +1603,12 @@ private:
         }
     }
 
-    bool SetupEncoder(const AVFrame* pInAvfrm)
+    bool SetupEncoder(const AVFrame* pInAvfrm, const string& strOutputPath)
     {
         auto hEncoder = MediaCore::MediaEncoder::CreateInstance();
-        if (!hEncoder->Open(m_strOutputPath))
+        if (!hEncoder->Open(strOutputPath))
         {
-            ostringstream oss; oss << "FAILED to open MediaEncoder at location '" << m_strOutputPath << "'! Error is '" << hEncoder->GetError() << "'.";
+            ostringstream oss; oss << "FAILED to open MediaEncoder at location '" << strOutputPath << "'! Error is '" << hEncoder->GetError() << "'.";
             m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
             return false;
         }
@@ -1356,6 +1646,405 @@ private:
         }
     }
 
+    // The task is paused by the user or by the scheduler throttling, called with 'm_mtxPauseLock' held
+    void UpdatePauseState()
+    {
+        const bool bPause = m_bUserPause || m_bThrottlePause;
+        if (bPause && !m_bPause)
+            m_bPauseCheckPointHit = false;
+        m_bPause = bPause;
+    }
+
+    // Block the calling thread until the task is resumed or cancelled. Returns 'false' if the task is cancelled.
+    bool WaitWhilePaused()
+    {
+        unique_lock<mutex> _lk(m_mtxPauseLock);
+        if (m_bPause)
+            m_bPauseCheckPointHit = true;
+        m_cvPause.wait(_lk, [this] { return !m_bPause || IsCancelled(); });
+        return !IsCancelled();
+    }
+
+    string GetSegmentPath(size_t szSegIdx) const
+    {
+        ostringstream oss; oss << "TaskOutput.seg" << setw(4) << setfill('0') << szSegIdx << ".mp4";
+        return SysUtils::JoinPath(m_strTaskDir, oss.str());
+    }
+
+    // Finish the output segment being encoded and save the task json as a checkpoint, so the transform pass can resume after it.
+    bool FinishSegment(int64_t i64SegFrameCount)
+    {
+        if (!m_hEncoder->FinishEncoding())
+        {
+            ostringstream oss; oss << "FAILED to 'Finish' MediaEncoder! Error is '" << m_hEncoder->GetError() << "'.";
+            m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+            return false;
+        }
+        ReleaseEncoder();
+        {
+            // the segment list is read by 'SaveAsJson()' from the UI thread
+            lock_guard<mutex> _lk(m_mtxSegmentsLock);
+            m_aOutputSegments.push_back({SysUtils::ExtractFileName(GetSegmentPath(m_aOutputSegments.size())), i64SegFrameCount});
+        }
+        m_i64TransformedFrameCount += i64SegFrameCount;
+        if (Save("").empty())
+            m_pLogger->Log(WARN) << "FAILED to save checkpoint after output segment #" << (m_aOutputSegments.size()-1) << "." << endl;
+        return true;
+    }
+
+    // 'vidstabtransform' smooths the camera path over (smoothing*2+1) frames, and with 'crop=keep' the borders are filled with
+    // the previous output frame. So a resumed transform pass starts a smoothing window earlier than the resumed frame, and
+    // transforms these warm-up frames again without encoding them.
+    int64_t GetWarmupStartFrameIndex(int64_t i64ResumeFrmIdx) const
+    {
+        if (i64ResumeFrmIdx <= 0)
+            return 0;
+        return max((int64_t)0, i64ResumeFrmIdx-(int64_t)m_u32Smoothing-1);
+    }
+
+    // 'vidstabtransform' picks the transforms in the order of its input frames. To start at frame 'i64StartFrmIdx', the filter
+    // is built on a copy of the transforms file that begins at this frame. The optimal static zoom (optzoom=1) is calculated
+    // over all the transforms, in that case the full file is used and the filter is moved forward with blank frames.
+    bool SetupResumedTransformFilterGraph(const AVFrame* pInAvfrm, int64_t i64StartFrmIdx)
+    {
+        if (i64StartFrmIdx <= 0 || m_u8OptZoom == 1)
+        {
+            if (!SetupVidstabTransformFilterGraph(pInAvfrm, m_strTrfPath))
+                return false;
+            return i64StartFrmIdx <= 0 || SkipTransformedFrames(pInAvfrm, i64StartFrmIdx);
+        }
+        const auto strResumeTrfPath = SysUtils::JoinPath(m_strTaskDir, "transforms.resume.trf");
+        if (!WriteResumeTransformsFile(strResumeTrfPath, i64StartFrmIdx))
+            return false;
+        // the transforms file is read when the filter graph is configured
+        const bool bSucc = SetupVidstabTransformFilterGraph(pInAvfrm, strResumeTrfPath);
+        SysUtils::DeleteFileAt(strResumeTrfPath);
+        return bSucc;
+    }
+
+    // Copy the transforms of the frames from 'i64StartFrmIdx' to 'strResumeTrfPath'. The frame numbers in the vid.stab
+    // transforms file start from 1, they are renumbered so that frame 'i64StartFrmIdx' becomes the first one.
+    bool WriteResumeTransformsFile(const string& strResumeTrfPath, int64_t i64StartFrmIdx)
+    {
+        ifstream ifs(m_strTrfPath);
+        if (!ifs.is_open())
+        {
+            ostringstream oss; oss << "FAILED to open transforms file '" << m_strTrfPath << "'!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        ofstream ofs(strResumeTrfPath, ios::out|ios::trunc);
+        if (!ofs.is_open())
+        {
+            ostringstream oss; oss << "FAILED to create transforms file '" << strResumeTrfPath << "'!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        const string strFramePrefix = "Frame ";
+        string strLine;
+        while (getline(ifs, strLine))
+        {
+            if (strLine.compare(0, strFramePrefix.size(), strFramePrefix) != 0)
+            {
+                // version header and comments
+                ofs << strLine << "\n";
+                continue;
+            }
+            const char* pNum = strLine.c_str()+strFramePrefix.size();
+            char* pNumEnd = nullptr;
+            const int64_t i64FrameNum = strtoll(pNum, &pNumEnd, 10);
+            if (pNumEnd == pNum || i64FrameNum-1 < i64StartFrmIdx)
+                continue;
+            ofs << strFramePrefix << (i64FrameNum-i64StartFrmIdx) << pNumEnd << "\n";
+        }
+        if (!ofs.good())
+        {
+            ostringstream oss; oss << "FAILED to write transforms file '" << strResumeTrfPath << "'!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        return true;
+    }
+
+    // Move the filter built on the full transforms file to frame 'i64FrameCount' by feeding a blank frame that many times.
+    bool SkipTransformedFrames(const AVFrame* pRefAvfrm, int64_t i64FrameCount)
+    {
+        SelfFreeAVFramePtr hBlankfrmPtr = AllocSelfFreeAVFramePtr();
+        hBlankfrmPtr->format = pRefAvfrm->format;
+        hBlankfrmPtr->width = pRefAvfrm->width;
+        hBlankfrmPtr->height = pRefAvfrm->height;
+        int fferr = av_frame_get_buffer(hBlankfrmPtr.get(), 0);
+        if (fferr < 0)
+        {
+            ostringstream oss; oss << "FAILED to allocate blank frame for skipping! fferr=" << fferr << ".";
+            m_errMsg = oss.str();
+            return false;
+        }
+        for (int i = 0; i < AV_NUM_DATA_POINTERS && hBlankfrmPtr->buf[i]; i++)
+            memset(hBlankfrmPtr->buf[i]->data, 0, hBlankfrmPtr->buf[i]->size);
+        SelfFreeAVFramePtr hOutfrmPtr = AllocSelfFreeAVFramePtr();
+        for (int64_t i = 0; i < i64FrameCount && !IsCancelled(); i++)
+        {
+            hBlankfrmPtr->pts = i;
+            fferr = av_buffersrc_add_frame_flags(m_pBufsrcCtx, hBlankfrmPtr.get(), AV_BUFFERSRC_FLAG_KEEP_REF);
+            if (fferr < 0)
+            {
+                ostringstream oss; oss << "FAILED when invoking 'av_buffersrc_add_frame_flags()' at skipped frame #" << i << ". fferr=" << fferr << ".";
+                m_errMsg = oss.str();
+                return false;
+            }
+            while ((fferr = av_buffersink_get_frame(m_pBufsinkCtx, hOutfrmPtr.get())) >= 0)
+                av_frame_unref(hOutfrmPtr.get());
+            if (fferr != AVERROR(EAGAIN))
+            {
+                ostringstream oss; oss << "FAILED when invoking 'av_buffersink_get_frame()' at skipped frame #" << i << ". fferr=" << fferr << ".";
+                m_errMsg = oss.str();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Remux the finished output segments into 'm_strOutputPath' without re-encoding. Each segment starts at time 0,
+    // so its timestamps are shifted by the total frame count of the segments before it.
+    bool ConcatOutputSegments()
+    {
+        if (m_aOutputSegments.empty())
+            return true;
+        if (SysUtils::IsFile(m_strOutputPath))
+            SysUtils::DeleteFileAt(m_strOutputPath);
+        if (m_aOutputSegments.size() == 1)
+        {
+            if (!SysUtils::RenameFile(SysUtils::JoinPath(m_strTaskDir, m_aOutputSegments[0].strFileName), m_strOutputPath))
+            {
+                ostringstream oss; oss << "FAILED to rename output segment '" << m_aOutputSegments[0].strFileName << "' to '" << m_strOutputPath << "'!";
+                m_errMsg = oss.str();
+                return false;
+            }
+            lock_guard<mutex> _lk(m_mtxSegmentsLock);
+            m_aOutputSegments.clear();
+            return true;
+        }
+
+        AVFormatContext* pOutFmtCtx = nullptr;
+        int fferr = avformat_alloc_output_context2(&pOutFmtCtx, nullptr, nullptr, m_strOutputPath.c_str());
+        if (fferr < 0 || !pOutFmtCtx)
+        {
+            ostringstream oss; oss << "FAILED to allocate output format context for '" << m_strOutputPath << "'! fferr=" << fferr << ".";
+            m_errMsg = oss.str();
+            return false;
+        }
+        const auto tFrameRate = m_hSettings->VideoOutFrameRate();
+        const AVRational tFrameTb = { tFrameRate.den, tFrameRate.num };
+        AVStream* pOutStm = nullptr;
+        AVPacket* pAvpkt = av_packet_alloc();
+        bool bHeaderWritten = false;
+        int64_t i64OffsetFrameCount = 0;
+        ostringstream oss;
+        for (const auto& tSeg : m_aOutputSegments)
+        {
+            const auto strSegPath = SysUtils::JoinPath(m_strTaskDir, tSeg.strFileName);
+            AVFormatContext* pInFmtCtx = nullptr;
+            fferr = avformat_open_input(&pInFmtCtx, strSegPath.c_str(), nullptr, nullptr);
+            if (fferr < 0)
+            {
+                oss << "FAILED to open output segment '" << strSegPath << "'! fferr=" << fferr << ".";
+                break;
+            }
+            fferr = avformat_find_stream_info(pInFmtCtx, nullptr);
+            const int iVidStmIdx = fferr < 0 ? fferr : av_find_best_stream(pInFmtCtx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+            if (iVidStmIdx < 0)
+            {
+                oss << "FAILED to find video stream in output segment '" << strSegPath << "'! fferr=" << iVidStmIdx << ".";
+                avformat_close_input(&pInFmtCtx);
+                break;
+            }
+            AVStream* pInStm = pInFmtCtx->streams[iVidStmIdx];
+            if (!pOutStm)
+            {
+                pOutStm = avformat_new_stream(pOutFmtCtx, nullptr);
+                if (!pOutStm || avcodec_parameters_copy(pOutStm->codecpar, pInStm->codecpar) < 0)
+                {
+                    oss << "FAILED to create the output video stream!";
+                    avformat_close_input(&pInFmtCtx);
+                    break;
+                }
+                pOutStm->codecpar->codec_tag = 0;
+                pOutStm->time_base = pInStm->time_base;
+                pOutStm->avg_frame_rate = pInStm->avg_frame_rate;
+                if (!(pOutFmtCtx->oformat->flags&AVFMT_NOFILE))
+                    fferr = avio_open(&pOutFmtCtx->pb, m_strOutputPath.c_str(), AVIO_FLAG_WRITE);
+                if (fferr >= 0)
+                    fferr = avformat_write_header(pOutFmtCtx, nullptr);
+                if (fferr < 0)
+                {
+                    oss << "FAILED to write the header of '" << m_strOutputPath << "'! fferr=" << fferr << ".";
+                    avformat_close_input(&pInFmtCtx);
+                    break;
+                }
+                bHeaderWritten = true;
+            }
+            const int64_t i64Offset = av_rescale_q(i64OffsetFrameCount, tFrameTb, pOutStm->time_base);
+            while ((fferr = av_read_frame(pInFmtCtx, pAvpkt)) >= 0)
+            {
+                if (pAvpkt->stream_index == iVidStmIdx)
+                {
+                    av_packet_rescale_ts(pAvpkt, pInStm->time_base, pOutStm->time_base);
+                    if (pAvpkt->pts != AV_NOPTS_VALUE)
+                        pAvpkt->pts += i64Offset;
+                    if (pAvpkt->dts != AV_NOPTS_VALUE)
+                        pAvpkt->dts += i64Offset;
+                    pAvpkt->stream_index = pOutStm->index;
+                    pAvpkt->pos = -1;
+                    fferr = av_interleaved_write_frame(pOutFmtCtx, pAvpkt);
+                    if (fferr < 0)
+                    {
+                        oss << "FAILED to write packet of segment '" << strSegPath << "' into '" << m_strOutputPath << "'! fferr=" << fferr << ".";
+                        break;
+                    }
+                }
+                av_packet_unref(pAvpkt);
+            }
+            av_packet_unref(pAvpkt);
+            avformat_close_input(&pInFmtCtx);
+            if (fferr != AVERROR_EOF)
+            {
+                if (oss.str().empty())
+                    oss << "FAILED to read packet from segment '" << strSegPath << "'! fferr=" << fferr << ".";
+                break;
+            }
+            i64OffsetFrameCount += tSeg.i64FrameCount;
+        }
+        av_packet_free(&pAvpkt);
+        if (bHeaderWritten)
+        {
+            fferr = av_write_trailer(pOutFmtCtx);
+            if (fferr < 0 && oss.str().empty())
+                oss << "FAILED to write the trailer of '" << m_strOutputPath << "'! fferr=" << fferr << ".";
+        }
+        if (pOutFmtCtx->pb)
+            avio_closep(&pOutFmtCtx->pb);
+        avformat_free_context(pOutFmtCtx);
+        if (!oss.str().empty())
+        {
+            m_errMsg = oss.str();
+            return false;
+        }
+
+        lock_guard<mutex> _lk(m_mtxSegmentsLock);
+        for (const auto& tSeg : m_aOutputSegments)
+            SysUtils::DeleteFileAt(SysUtils::JoinPath(m_strTaskDir, tSeg.strFileName));
+        m_aOutputSegments.clear();
+        return true;
+    }
+
+    // Encode a detect pass output frame into the spool file with the lossless 'ffv1' codec, the encoding is done on the worker
+    // thread of the encoder. Returns 'false' if spooling failed or the disk is short of space, in which case the spool is
+    // discarded and the transform pass falls back to decoding the source.
+    bool SpoolDetectFrame(const AVFrame* pAvfrm)
+    {
+        std::error_code ec;
+        if (!m_hSpoolEncoder)
+        {
+            // the raw size is the worst case of a lossless codec
+            const auto tFrameRate = m_hSettings->VideoOutFrameRate();
+            const int64_t i64FrameCount = av_rescale_q(m_hVclip->Duration(), MILLISEC_TIMEBASE, { tFrameRate.den, tFrameRate.num });
+            const int iFrameBytes = av_image_get_buffer_size((AVPixelFormat)pAvfrm->format, pAvfrm->width, pAvfrm->height, 1);
+            const uint64_t u64RawBytes = iFrameBytes > 0 && i64FrameCount > 0 ? (uint64_t)iFrameBytes*i64FrameCount : 0;
+            const auto tSpace = std::filesystem::space(m_strTaskDir, ec);
+            if (ec || tSpace.available < u64RawBytes+SPOOL_FREE_SPACE_RESERVE)
+            {
+                m_pLogger->Log(INFO) << "Skip spooling the detect frames, " << (u64RawBytes>>20) << "MB may be needed but "
+                        << (ec ? 0 : tSpace.available>>20) << "MB is free in '" << m_strTaskDir << "'." << endl;
+                return false;
+            }
+            auto hEncoder = MediaCore::MediaEncoder::CreateInstance();
+            auto strInputPixfmt = string(av_get_pix_fmt_name((AVPixelFormat)pAvfrm->format));
+            if (!hEncoder->Open(m_strSpoolPath)
+                || !hEncoder->ConfigureVideoStream("ffv1", strInputPixfmt, pAvfrm->width, pAvfrm->height, m_hSettings->VideoOutFrameRate(), 0)
+                || !hEncoder->Start())
+            {
+                m_pLogger->Log(WARN) << "FAILED to setup the spool encoder at '" << m_strSpoolPath << "', the transform pass will decode the source. Error is '"
+                        << hEncoder->GetError() << "'." << endl;
+                hEncoder->Close();
+                DiscardSpool();
+                return false;
+            }
+            m_hSpoolEncoder = hEncoder;
+        }
+        else if (pAvfrm->pts%SPOOL_SPACE_CHECK_INTERVAL == 0)
+        {
+            const auto tSpace = std::filesystem::space(m_strTaskDir, ec);
+            if (!ec && tSpace.available < SPOOL_FREE_SPACE_RESERVE)
+            {
+                m_pLogger->Log(WARN) << "Drop the detect spool at frame #" << pAvfrm->pts << ", only " << (tSpace.available>>20)
+                        << "MB is free in '" << m_strTaskDir << "'." << endl;
+                DiscardSpool();
+                return false;
+            }
+        }
+        const auto tFrameRate = m_hSettings->VideoOutFrameRate();
+        const int64_t i64Pos = round((double)pAvfrm->pts*1000*tFrameRate.den/tFrameRate.num);
+        auto hVfrm = FFUtils::CreateVideoFrameFromAVFrame(CloneSelfFreeAVFramePtr(pAvfrm), i64Pos);
+        bool consumed = false;
+        if (!m_hSpoolEncoder->EncodeVideoFrame(hVfrm, consumed))
+        {
+            m_pLogger->Log(WARN) << "FAILED to spool detect frame at pos " << i64Pos << ", the transform pass will decode the source. Error is '"
+                    << m_hSpoolEncoder->GetError() << "'." << endl;
+            DiscardSpool();
+            return false;
+        }
+        return true;
+    }
+
+    bool FinishSpool()
+    {
+        const bool bSucceeded = m_hSpoolEncoder->FinishEncoding();
+        if (!bSucceeded)
+            m_pLogger->Log(WARN) << "FAILED to finish the spool encoder! Error is '" << m_hSpoolEncoder->GetError() << "'." << endl;
+        m_hSpoolEncoder->Close();
+        m_hSpoolEncoder = nullptr;
+        if (!bSucceeded)
+            DiscardSpool();
+        return bSucceeded;
+    }
+
+    void DiscardSpool()
+    {
+        if (m_hSpoolEncoder)
+        {
+            m_hSpoolEncoder->Close();
+            m_hSpoolEncoder = nullptr;
+        }
+        if (SysUtils::IsFile(m_strSpoolPath))
+            SysUtils::DeleteFileAt(m_strSpoolPath);
+        m_bSpoolReady = false;
+    }
+
+    MediaCore::VideoClip::Holder OpenSpool(int64_t i64ClipDur)
+    {
+        auto hParser = MediaCore::MediaParser::CreateInstance();
+        if (!hParser->Open(m_strSpoolPath))
+        {
+            m_pLogger->Log(WARN) << "FAILED to open the spool file '" << m_strSpoolPath << "'! Error is '" << hParser->GetError() << "'." << endl;
+            return nullptr;
+        }
+        auto pVidstm = hParser->GetBestVideoStream();
+        if (!pVidstm)
+        {
+            m_pLogger->Log(WARN) << "Spool file '" << m_strSpoolPath << "' has NO video stream!" << endl;
+            return nullptr;
+        }
+        const int64_t i64SpoolDuration = static_cast<int64_t>(pVidstm->duration*1000);
+        const int64_t i64EndOffset = i64SpoolDuration > i64ClipDur ? i64SpoolDuration-i64ClipDur : 0;
+        auto hVclip = MediaCore::VideoClip::CreateVideoInstance(m_i64ClipId, hParser, m_hSettings, 0, i64ClipDur, 0, i64EndOffset, 0, true);
+        if (!hVclip)
+            m_pLogger->Log(WARN) << "FAILED to create VideoClip on the spool file '" << m_strSpoolPath << "'!" << endl;
+        else
+            m_pLogger->Log(INFO) << "Read the transform pass input from spool file '" << m_strSpoolPath << "'." << endl;
+        return hVclip;
+    }
+
 private:
     string m_name;
     size_t m_szHash;
@@ -1371,6 +2060,7 @@ private:
     AVFilterInOut* m_pFilterInputs{nullptr};
     AVPixelFormat m_eFgInputPixfmt;
     string m_strTrfPath;
+    string m_strTrfChecksum;
     string m_strSrcUrl;
     int64_t m_i64ClipId;
     MediaCore::VideoClip::Holder m_hVclip;
@@ -1384,6 +2074,11 @@ private:
     uint16_t m_u16StepSize{12};      // The region around minimum is scanned with 1 pixel resolution.
     float m_fMinContrast{0.1f};     // 0-1, below this value a local measurement field is discarded.
     bool m_bVidstabDetectFinished{false};
+    bool m_bUseSharedDecoding{true};
+    bool m_bSpoolDetectFrames{false};
+    MediaCore::MediaEncoder::Holder m_hSpoolEncoder;
+    string m_strSpoolPath;
+    bool m_bSpoolReady{false};
     // vidstab transform parameters
     uint32_t m_u32Smoothing{20};    // (value*2+1) frames are used for lowpass filtering the camera movements.
     uint8_t m_u8OptAlgo{0};         // 0: gauss, 1: avg. This is the camera path optimization algorithm.
@@ -1397,6 +2092,17 @@ private:
     float m_fZoomSpeed{0.25f};      // Set percent to zoom maximally each frame (enabled when optzoom is set to 2). Range is from 0 to 5.
     uint8_t m_u8InterpMode{2};      // 0: nearest, 1: linear, 2: bilinear, 3: bicubic.
     bool m_bVidstabTransformFinished{false};
+    // resumable transform pass
+    struct _OutputSegment
+    {
+        string strFileName;
+        int64_t i64FrameCount;
+    };
+    int64_t m_i64SegmentLength{60000};      // Length of each output segment in millisecond, 0 means no segmentation.
+    vector<_OutputSegment> m_aOutputSegments;
+    mutable mutex m_mtxSegmentsLock;
+    mutex m_mtxSaveLock;
+    int64_t m_i64TransformedFrameCount{0};
     // output settings
     MediaCore::MediaEncoder::Holder m_hEncoder;
     string m_strVidencCodecName;
@@ -1406,8 +2112,14 @@ private:
     string m_strOutputPath;
     float m_fProgress{0.f};
     // task control
-    bool m_bPause{false};
-    bool m_bPauseCheckPointHit{false};
+    atomic_bool m_bPause{false};
+    atomic_bool m_bUserPause{false};
+    bool m_bThrottlePause{false};
+    atomic_bool m_bPauseCheckPointHit{false};
+    bool m_bParkWhenPaused{false};    // release the decoder, the filter graph and the encoder while the transform pass is paused
+    atomic_int m_iPriority{0};
+    mutex m_mtxPauseLock;
+    condition_variable m_cvPause;
 };
 
 const string BgtaskVidstab::TASK_TYPE_NAME = "Video Stabilization";
@@ -0,0 +1,905 @@
+#include <sstream>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <cstring>
+#include <cmath>
+#include <BaseUtils/ThreadUtils.h>
+#include "CpuVideoScope.h"
+
+using namespace std;
+using namespace Logger;
+
+namespace MEC
+{
+static const uint32_t CPU_SCOPE_MAX_THREADS = 16;
+static const int VECTOR_SCOPE_SIZE = 512;
+static const int WAVEFORM_TILE_COLUMNS = 16;
+
+struct _ChromaticityPoints
+{
+    float xRed, yRed;
+    float xGreen, yGreen;
+    float xBlue, yBlue;
+    float xWhite, yWhite;
+};
+
+// Primaries and white points of 'CpuVideoScope::ColorsSystems', in the same order
+static const _ChromaticityPoints COLOR_SYSTEMS[CpuVideoScope::NB_CS] = {
+    { 0.67f,   0.33f,   0.21f,   0.71f,   0.14f,   0.08f,   0.310063f, 0.316158f },  // NTSC, illuminant C
+    { 0.64f,   0.33f,   0.29f,   0.60f,   0.15f,   0.06f,   0.312713f, 0.329016f },  // EBU, D65
+    { 0.630f,  0.340f,  0.310f,  0.595f,  0.155f,  0.070f,  0.312713f, 0.329016f },  // SMPTE, D65
+    { 0.670f,  0.330f,  0.210f,  0.710f,  0.150f,  0.060f,  0.312713f, 0.329016f },  // SMPTE 240M, D65
+    { 0.625f,  0.340f,  0.280f,  0.595f,  0.115f,  0.070f,  0.312713f, 0.329016f },  // APPLE, D65
+    { 0.7347f, 0.2653f, 0.1152f, 0.8264f, 0.1566f, 0.0177f, 0.3457f,   0.3585f   },  // wRGB, D50
+    { 0.7347f, 0.2653f, 0.2738f, 0.7174f, 0.1666f, 0.0089f, 1.f/3.f,   1.f/3.f   },  // CIE1931, illuminant E
+    { 0.64f,   0.33f,   0.30f,   0.60f,   0.15f,   0.06f,   0.312713f, 0.329016f },  // Rec709, D65
+    { 0.708f,  0.292f,  0.170f,  0.797f,  0.131f,  0.046f,  0.312713f, 0.329016f },  // Rec2020, D65
+    { 0.680f,  0.320f,  0.265f,  0.690f,  0.150f,  0.060f,  0.314f,    0.351f    },  // DCI-P3, DCI white
+};
+
+static bool Invert3x3(const float m[9], float inv[9])
+{
+    const float det = m[0]*(m[4]*m[8]-m[5]*m[7]) - m[1]*(m[3]*m[8]-m[5]*m[6]) + m[2]*(m[3]*m[7]-m[4]*m[6]);
+    if (fabs(det) < 1e-12f)
+        return false;
+    const float invDet = 1.f/det;
+    inv[0] = (m[4]*m[8]-m[5]*m[7])*invDet;
+    inv[1] = (m[2]*m[7]-m[1]*m[8])*invDet;
+    inv[2] = (m[1]*m[5]-m[2]*m[4])*invDet;
+    inv[3] = (m[5]*m[6]-m[3]*m[8])*invDet;
+    inv[4] = (m[0]*m[8]-m[2]*m[6])*invDet;
+    inv[5] = (m[2]*m[3]-m[0]*m[5])*invDet;
+    inv[6] = (m[3]*m[7]-m[4]*m[6])*invDet;
+    inv[7] = (m[1]*m[6]-m[0]*m[7])*invDet;
+    inv[8] = (m[0]*m[4]-m[1]*m[3])*invDet;
+    return true;
+}
+
+// Build the linear rgb to XYZ matrix from the primaries and the white point
+static void GetRgbToXyzMatrix(const _ChromaticityPoints& cs, float m[9])
+{
+    const float p[9] = {
+        cs.xRed/cs.yRed,             cs.xGreen/cs.yGreen,               cs.xBlue/cs.yBlue,
+        1.f,                         1.f,                               1.f,
+        (1.f-cs.xRed-cs.yRed)/cs.yRed, (1.f-cs.xGreen-cs.yGreen)/cs.yGreen, (1.f-cs.xBlue-cs.yBlue)/cs.yBlue,
+    };
+    const float w[3] = { cs.xWhite/cs.yWhite, 1.f, (1.f-cs.xWhite-cs.yWhite)/cs.yWhite };
+    float pinv[9];
+    if (!Invert3x3(p, pinv))
+    {
+        memset(m, 0, sizeof(float)*9);
+        return;
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        const float s = pinv[i*3]*w[0]+pinv[i*3+1]*w[1]+pinv[i*3+2]*w[2];
+        m[i] = p[i]*s; m[3+i] = p[3+i]*s; m[6+i] = p[6+i]*s;
+    }
+}
+
+// Convert chromaticity 'x', 'y' to the coordinates of cie system 'cie', all the systems use the range [0, 1]
+static inline void XyToCie(int cie, float x, float y, float& u, float& v)
+{
+    if (cie == CpuVideoScope::UCS || cie == CpuVideoScope::LUV)
+    {
+        const float d = -2.f*x+12.f*y+3.f;
+        u = 4.f*x/d;
+        v = (cie == CpuVideoScope::UCS ? 6.f : 9.f)*y/d;
+    }
+    else
+    {
+        u = x; v = y;
+    }
+}
+
+static inline void CieToXy(int cie, float u, float v, float& x, float& y)
+{
+    if (cie == CpuVideoScope::UCS)
+    {
+        const float d = 2.f*u-8.f*v+4.f;
+        x = 3.f*u/d; y = 2.f*v/d;
+    }
+    else if (cie == CpuVideoScope::LUV)
+    {
+        const float d = 6.f*u-16.f*v+12.f;
+        x = 9.f*u/d; y = 4.f*v/d;
+    }
+    else
+    {
+        x = u; y = v;
+    }
+}
+
+template<typename T>
+static void LoadRow(const T* pR, const T* pG, const T* pB, size_t szStride, int iCount, float fNorm, float* pfR, float* pfG, float* pfB)
+{
+    for (int i = 0; i < iCount; i++)
+    {
+        pfR[i] = (float)pR[i*szStride]*fNorm;
+        pfG[i] = (float)pG[i*szStride]*fNorm;
+        pfB[i] = (float)pB[i*szStride]*fNorm;
+    }
+}
+
+class CpuVideoScope_Impl : public CpuVideoScope
+{
+private:
+    class _BandTask : public SysUtils::BaseAsyncTask
+    {
+    public:
+        _BandTask(const function<void(uint32_t)>& fnBandProc, uint32_t u32BandIdx) : m_fnBandProc(fnBandProc), m_u32BandIdx(u32BandIdx) {}
+
+    protected:
+        bool _TaskProc() override
+        {
+            m_fnBandProc(m_u32BandIdx);
+            return true;
+        }
+
+    private:
+        const function<void(uint32_t)>& m_fnBandProc;
+        uint32_t m_u32BandIdx;
+    };
+
+    // Sampled view of the source image. Pixel 'i' of a sampled row is the source pixel 'i*step' of that row.
+    struct _SrcView
+    {
+        const uint8_t* apChBase[3];
+        size_t szRowBytes;
+        size_t szPixStride;
+        ImDataType eDataType;
+        int iSampledW, iSampledH;
+        int iStep;
+
+        void LoadSampledRow(int iSampledY, int iSampledX0, int iCount, float* pfR, float* pfG, float* pfB) const
+        {
+            const size_t szOffset = (size_t)iSampledY*iStep*szRowBytes;
+            const size_t szStride = szPixStride*iStep;
+            const size_t szStartElem = (size_t)iSampledX0*szStride;
+            if (eDataType == IM_DT_INT8)
+                LoadRow((const uint8_t*)(apChBase[0]+szOffset)+szStartElem, (const uint8_t*)(apChBase[1]+szOffset)+szStartElem,
+                        (const uint8_t*)(apChBase[2]+szOffset)+szStartElem, szStride, iCount, 1.f/255.f, pfR, pfG, pfB);
+            else if (eDataType == IM_DT_INT16)
+                LoadRow((const uint16_t*)(apChBase[0]+szOffset)+szStartElem, (const uint16_t*)(apChBase[1]+szOffset)+szStartElem,
+                        (const uint16_t*)(apChBase[2]+szOffset)+szStartElem, szStride, iCount, 1.f/65535.f, pfR, pfG, pfB);
+            else
+                LoadRow((const float*)(apChBase[0]+szOffset)+szStartElem, (const float*)(apChBase[1]+szOffset)+szStartElem,
+                        (const float*)(apChBase[2]+szOffset)+szStartElem, szStride, iCount, 1.f, pfR, pfG, pfB);
+        }
+
+        // 8-bit sources are read in place, without the conversion to float
+        bool IsU8() const { return eDataType == IM_DT_INT8; }
+
+        void GetU8Row(int iSampledY, int iSampledX0, const uint8_t* apRow[3], size_t& szStride) const
+        {
+            const size_t szOffset = (size_t)iSampledY*iStep*szRowBytes;
+            szStride = szPixStride*iStep;
+            for (int i = 0; i < 3; i++)
+                apRow[i] = apChBase[i]+szOffset+(size_t)iSampledX0*szStride;
+        }
+    };
+
+    struct _RowBuffer
+    {
+        vector<float> aR, aG, aB;
+
+        void Resize(int iSize)
+        {
+            if ((int)aR.size() < iSize)
+            {
+                aR.resize(iSize); aG.resize(iSize); aB.resize(iSize);
+            }
+        }
+    };
+
+public:
+    CpuVideoScope_Impl(uint32_t u32ThreadCount)
+    {
+        m_pLogger = GetLogger("CpuVideoScope");
+        if (u32ThreadCount == 0)
+            u32ThreadCount = min(max(thread::hardware_concurrency(), 1u), CPU_SCOPE_MAX_THREADS);
+        m_u32ThreadCount = u32ThreadCount;
+        if (m_u32ThreadCount > 1)
+        {
+            // the calling thread always processes the first band
+            m_hExctor = SysUtils::ThreadPoolExecutor::CreateInstance("CpuVideoScopeExctor");
+            m_hExctor->SetMaxThreadCount(m_u32ThreadCount-1);
+            m_hExctor->SetMinThreadCount(m_u32ThreadCount-1);
+        }
+        m_aBandBuffers.resize(m_u32ThreadCount);
+        m_aRowBuffers.resize(m_u32ThreadCount);
+        BuildVectorColorTable();
+        SetCieParam(Rec709system, XYY, 512, Rec2020system, 0.75f, false);
+    }
+
+    ~CpuVideoScope_Impl()
+    {
+        if (m_hExctor)
+        {
+            m_hExctor->Terminate(true);
+            m_hExctor = nullptr;
+        }
+    }
+
+    void SetFrameDecimation(uint32_t u32Interval) override
+    {
+        m_u32FrameDecimation = max(u32Interval, 1u);
+        m_u32FrameCounter = 0;
+    }
+
+    uint32_t GetFrameDecimation() const override
+    {
+        return m_u32FrameDecimation;
+    }
+
+    bool CheckFrame(bool bForce) override
+    {
+        const bool bTake = bForce || m_u32FrameCounter == 0;
+        m_u32FrameCounter = bForce ? 1%m_u32FrameDecimation : (m_u32FrameCounter+1)%m_u32FrameDecimation;
+        return bTake;
+    }
+
+    void SetPixelStep(uint32_t u32Step) override
+    {
+        m_iPixelStep = (int)max(u32Step, 1u);
+    }
+
+    double HistogramScope(const ImGui::ImMat& src, ImGui::ImMat& dst, int level, float scale, bool log_view) override
+    {
+        const auto tStart = chrono::steady_clock::now();
+        _SrcView tSrcView;
+        if (!PrepareSource(src, tSrcView) || !CheckLevel(level))
+            return -1;
+
+        // each band counts its rows into its private bins, then the bins of all the bands are summed up
+        const uint32_t u32BandCnt = min(m_u32ThreadCount, (uint32_t)tSrcView.iSampledH);
+        const size_t szBinCnt = (size_t)level*4;
+        const float fLvlScale = (float)(level-1);
+        uint16_t au16U8Bins[256];
+        BuildU8BinTable(level, au16U8Bins);
+        function<void(uint32_t)> fnBandProc = [&] (uint32_t u32BandIdx) {
+            auto& aBins = m_aBandBuffers[u32BandIdx];
+            aBins.assign(szBinCnt, 0);
+            uint32_t* pBinR = aBins.data(); uint32_t* pBinG = pBinR+level; uint32_t* pBinB = pBinG+level; uint32_t* pBinY = pBinB+level;
+            int y0, y1;
+            GetBandRange(tSrcView.iSampledH, u32BandCnt, u32BandIdx, y0, y1);
+            if (tSrcView.IsU8())
+            {
+                const uint8_t* apRow[3]; size_t szStride;
+                for (int y = y0; y < y1; y++)
+                {
+                    tSrcView.GetU8Row(y, 0, apRow, szStride);
+                    const uint8_t* pR = apRow[0]; const uint8_t* pG = apRow[1]; const uint8_t* pB = apRow[2];
+                    for (int x = 0; x < tSrcView.iSampledW; x++, pR += szStride, pG += szStride, pB += szStride)
+                    {
+                        pBinR[au16U8Bins[*pR]]++;
+                        pBinG[au16U8Bins[*pG]]++;
+                        pBinB[au16U8Bins[*pB]]++;
+                        pBinY[au16U8Bins[U8Luma(*pR, *pG, *pB)]]++;
+                    }
+                }
+                return;
+            }
+            auto& tRowBuf = m_aRowBuffers[u32BandIdx];
+            tRowBuf.Resize(tSrcView.iSampledW);
+            float* pfR = tRowBuf.aR.data(); float* pfG = tRowBuf.aG.data(); float* pfB = tRowBuf.aB.data();
+            for (int y = y0; y < y1; y++)
+            {
+                tSrcView.LoadSampledRow(y, 0, tSrcView.iSampledW, pfR, pfG, pfB);
+                for (int x = 0; x < tSrcView.iSampledW; x++)
+                {
+                    const float fY = 0.2126f*pfR[x]+0.7152f*pfG[x]+0.0722f*pfB[x];
+                    pBinR[ToBin(pfR[x], fLvlScale, level)]++;
+                    pBinG[ToBin(pfG[x], fLvlScale, level)]++;
+                    pBinB[ToBin(pfB[x], fLvlScale, level)]++;
+                    pBinY[ToBin(fY, fLvlScale, level)]++;
+                }
+            }
+        };
+        ParallelFor(u32BandCnt, fnBandProc);
+
+        dst.create_type(level, 1, 4, IM_DT_FLOAT32);
+        const float fCountScale = (float)(tSrcView.iStep*tSrcView.iStep)*scale;
+        for (int c = 0; c < 4; c++)
+        {
+            float* pDst = (float*)dst.data+dst.cstep*c;
+            for (int i = 0; i < level; i++)
+            {
+                uint64_t u64Count = 0;
+                for (uint32_t b = 0; b < u32BandCnt; b++)
+                    u64Count += m_aBandBuffers[b][c*level+i];
+                const float fValue = (float)u64Count*fCountScale;
+                pDst[i] = log_view ? log2f(fValue+1.f) : fValue;
+            }
+        }
+        dst.time_stamp = src.time_stamp;
+        dst.flags |= IM_MAT_FLAGS_CUSTOM_UPDATED;
+        return chrono::duration<double, milli>(chrono::steady_clock::now()-tStart).count();
+    }
+
+    double WaveformScope(const ImGui::ImMat& src, ImGui::ImMat& dst, int level, float fintensity, bool separate, bool show_y) override
+    {
+        const auto tStart = chrono::steady_clock::now();
+        _SrcView tSrcView;
+        if (!PrepareSource(src, tSrcView) || !CheckLevel(level))
+            return -1;
+        if (tSrcView.iSampledH > 0xffff)
+        {
+            ostringstream oss; oss << "Image height " << src.h << " is too large for the waveform scope!";
+            m_errMsg = oss.str();
+            return -1;
+        }
+
+        // counts are laid out as [column][R,G,B,Y][level], the bands own disjoint columns so they can share the counts.
+        // The columns are processed in tiles, so the counts being updated stay in cache while walking down the rows.
+        const int iW = tSrcView.iSampledW;
+        const size_t szColBins = (size_t)level*4;
+        m_aWaveCounts.resize((size_t)iW*szColBins);
+        const uint32_t u32BandCnt = min(m_u32ThreadCount, (uint32_t)iW);
+        const float fLvlScale = (float)(level-1);
+        uint16_t au16U8Bins[256];
+        BuildU8BinTable(level, au16U8Bins);
+        function<void(uint32_t)> fnBandProc = [&] (uint32_t u32BandIdx) {
+            int x0, x1;
+            GetBandRange(iW, u32BandCnt, u32BandIdx, x0, x1);
+            auto& tRowBuf = m_aRowBuffers[u32BandIdx];
+            tRowBuf.Resize(WAVEFORM_TILE_COLUMNS);
+            float* pfR = tRowBuf.aR.data(); float* pfG = tRowBuf.aG.data(); float* pfB = tRowBuf.aB.data();
+            for (int tx0 = x0; tx0 < x1; tx0 += WAVEFORM_TILE_COLUMNS)
+            {
+                const int iTileW = min(tx0+WAVEFORM_TILE_COLUMNS, x1)-tx0;
+                uint16_t* pTileBins = m_aWaveCounts.data()+(size_t)tx0*szColBins;
+                memset(pTileBins, 0, iTileW*szColBins*sizeof(uint16_t));
+                for (int y = 0; y < tSrcView.iSampledH; y++)
+                {
+                    uint16_t* pColBins = pTileBins;
+                    if (tSrcView.IsU8())
+                    {
+                        const uint8_t* apRow[3]; size_t szStride;
+                        tSrcView.GetU8Row(y, tx0, apRow, szStride);
+                        const uint8_t* pR = apRow[0]; const uint8_t* pG = apRow[1]; const uint8_t* pB = apRow[2];
+                        for (int x = 0; x < iTileW; x++, pColBins += szColBins, pR += szStride, pG += szStride, pB += szStride)
+                        {
+                            pColBins[au16U8Bins[*pR]]++;
+                            pColBins[level+au16U8Bins[*pG]]++;
+                            pColBins[level*2+au16U8Bins[*pB]]++;
+                            pColBins[level*3+au16U8Bins[U8Luma(*pR, *pG, *pB)]]++;
+                        }
+                        continue;
+                    }
+                    tSrcView.LoadSampledRow(y, tx0, iTileW, pfR, pfG, pfB);
+                    for (int x = 0; x < iTileW; x++, pColBins += szColBins)
+                    {
+                        const float fY = 0.2126f*pfR[x]+0.7152f*pfG[x]+0.0722f*pfB[x];
+                        pColBins[ToBin(pfR[x], fLvlScale, level)]++;
+                        pColBins[level+ToBin(pfG[x], fLvlScale, level)]++;
+                        pColBins[level*2+ToBin(pfB[x], fLvlScale, level)]++;
+                        pColBins[level*3+ToBin(fY, fLvlScale, level)]++;
+                    }
+                }
+            }
+        };
+        ParallelFor(u32BandCnt, fnBandProc);
+
+        // in separate mode each component gets its own panel, the source columns are folded into the panel width
+        const int iPanelCnt = separate ? (show_y ? 4 : 3) : 1;
+        const int iFold = iPanelCnt;
+        const int iPanelW = max(iW/iPanelCnt, 1);
+        const int iOutW = iPanelW*iPanelCnt;
+        const float fNorm = fintensity*level/(float)tSrcView.iSampledH*0.05f*255.f/iFold;
+        dst.create(iOutW, level, 4, (size_t)1, 4);
+        const uint32_t u32OutBandCnt = min(m_u32ThreadCount, (uint32_t)iOutW);
+        function<void(uint32_t)> fnOutProc = [&] (uint32_t u32BandIdx) {
+            int ox0, ox1;
+            GetBandRange(iOutW, u32OutBandCnt, u32BandIdx, ox0, ox1);
+            for (int tx0 = ox0; tx0 < ox1; tx0 += WAVEFORM_TILE_COLUMNS)
+            {
+                const int tx1 = min(tx0+WAVEFORM_TILE_COLUMNS, ox1);
+                for (int v = 0; v < level; v++)
+                {
+                    uint8_t* pDst = (uint8_t*)dst.data+((size_t)v*iOutW+tx0)*4;
+                    for (int ox = tx0; ox < tx1; ox++, pDst += 4)
+                    {
+                        float afVal[3] = {0.f, 0.f, 0.f};
+                        if (iPanelCnt == 1)
+                        {
+                            const uint16_t* pColBins = m_aWaveCounts.data()+(size_t)ox*szColBins;
+                            afVal[0] = pColBins[v]; afVal[1] = pColBins[level+v]; afVal[2] = pColBins[level*2+v];
+                            if (show_y)
+                            {
+                                const float fY = pColBins[level*3+v];
+                                afVal[0] += fY; afVal[1] += fY; afVal[2] += fY;
+                            }
+                        }
+                        else
+                        {
+                            const int iPanel = ox/iPanelW;
+                            const int iSrcX0 = (ox-iPanel*iPanelW)*iFold;
+                            const int iSrcX1 = min(iSrcX0+iFold, iW);
+                            float fSum = 0.f;
+                            for (int sx = iSrcX0; sx < iSrcX1; sx++)
+                                fSum += m_aWaveCounts[(size_t)sx*szColBins+iPanel*level+v];
+                            if (iPanel < 3)
+                                afVal[iPanel] = fSum;
+                            else
+                                afVal[0] = afVal[1] = afVal[2] = fSum;
+                        }
+                        const uint8_t u8R = (uint8_t)min(afVal[0]*fNorm, 255.f);
+                        const uint8_t u8G = (uint8_t)min(afVal[1]*fNorm, 255.f);
+                        const uint8_t u8B = (uint8_t)min(afVal[2]*fNorm, 255.f);
+                        pDst[0] = u8R; pDst[1] = u8G; pDst[2] = u8B;
+                        pDst[3] = max(u8R, max(u8G, u8B));
+                    }
+                }
+            }
+        };
+        ParallelFor(u32OutBandCnt, fnOutProc);
+        dst.time_stamp = src.time_stamp;
+        dst.flags |= IM_MAT_FLAGS_CUSTOM_UPDATED;
+        return chrono::duration<double, milli>(chrono::steady_clock::now()-tStart).count();
+    }
+
+    void SetCieParam(int color_system, int cie, int size, int gamuts, float contrast, bool correct_gamma) override
+    {
+        m_iCieColorSystem = color_system >= 0 && color_system < NB_CS ? color_system : Rec709system;
+        m_iCieMode = cie >= 0 && cie < NB_CIE ? cie : XYY;
+        m_iCieSize = max(size, 64);
+        m_iCieGamuts = gamuts >= 0 && gamuts < NB_CS ? gamuts : Rec2020system;
+        m_fCieContrast = min(max(contrast, 0.f), 1.f);
+        m_bCieCorrectGamma = correct_gamma;
+
+        const auto& tCs = COLOR_SYSTEMS[m_iCieColorSystem];
+        GetRgbToXyzMatrix(tCs, m_afRgbToXyz);
+        float afXyzToRgb[9];
+        if (!Invert3x3(m_afRgbToXyz, afXyzToRgb))
+            memset(afXyzToRgb, 0, sizeof(afXyzToRgb));
+        for (int i = 0; i < 256; i++)
+            m_afGammaTable[i] = m_bCieCorrectGamma ? powf(i/255.f, 2.2f) : i/255.f;
+
+        // the color of each plot position, and the background which fills the triangle of the color system
+        const int iSize = m_iCieSize;
+        m_aCieColors.resize((size_t)iSize*iSize*3);
+        m_aCieBackground.resize((size_t)iSize*iSize*4);
+        float afTriX[3], afTriY[3];
+        GetRedPoint((ColorsSystems)m_iCieColorSystem, iSize, iSize, &afTriX[0], &afTriY[0]);
+        GetGreenPoint((ColorsSystems)m_iCieColorSystem, iSize, iSize, &afTriX[1], &afTriY[1]);
+        GetBluePoint((ColorsSystems)m_iCieColorSystem, iSize, iSize, &afTriX[2], &afTriY[2]);
+        for (int py = 0; py < iSize; py++)
+        {
+            for (int px = 0; px < iSize; px++)
+            {
+                const float u = (px+0.5f)/iSize;
+                const float v = 1.f-(py+0.5f)/iSize;
+                float x, y;
+                CieToXy(m_iCieMode, u, v, x, y);
+                float afRgb[3] = {1.f, 1.f, 1.f};
+                if (y > 1e-4f)
+                {
+                    const float afXyz[3] = { x/y, 1.f, (1.f-x-y)/y };
+                    for (int c = 0; c < 3; c++)
+                        afRgb[c] = afXyzToRgb[c*3]*afXyz[0]+afXyzToRgb[c*3+1]*afXyz[1]+afXyzToRgb[c*3+2]*afXyz[2];
+                    // out of gamut colors are desaturated by adding white, then normalized to the brightest component
+                    const float fMin = min(afRgb[0], min(afRgb[1], afRgb[2]));
+                    if (fMin < 0.f)
+                        for (auto& f : afRgb) f -= fMin;
+                    const float fMax = max(afRgb[0], max(afRgb[1], afRgb[2]));
+                    for (auto& f : afRgb) f = fMax > 0.f ? powf(f/fMax, 1.f/2.2f) : 1.f;
+                }
+                uint8_t* pColor = m_aCieColors.data()+((size_t)py*iSize+px)*3;
+                for (int c = 0; c < 3; c++)
+                    pColor[c] = (uint8_t)(afRgb[c]*255.f+0.5f);
+                uint8_t* pBg = m_aCieBackground.data()+((size_t)py*iSize+px)*4;
+                if (IsInTriangle((float)px, (float)py, afTriX, afTriY))
+                {
+                    for (int c = 0; c < 3; c++)
+                        pBg[c] = (uint8_t)(pColor[c]*m_fCieContrast*0.5f);
+                    pBg[3] = 255;
+                }
+                else
+                    memset(pBg, 0, 4);
+            }
+        }
+    }
+
+    double CieScope(const ImGui::ImMat& src, ImGui::ImMat& dst, float intensity, bool show_color) override
+    {
+        const auto tStart = chrono::steady_clock::now();
+        _SrcView tSrcView;
+        if (!PrepareSource(src, tSrcView))
+            return -1;
+
+        const int iSize = m_iCieSize;
+        const uint32_t u32BandCnt = min(m_u32ThreadCount, (uint32_t)tSrcView.iSampledH);
+        const float fPlotScale = (float)iSize;
+        function<void(uint32_t)> fnBandProc = [&] (uint32_t u32BandIdx) {
+            auto& aBins = m_aBandBuffers[u32BandIdx];
+            aBins.assign((size_t)iSize*iSize, 0);
+            auto& tRowBuf = m_aRowBuffers[u32BandIdx];
+            tRowBuf.Resize(tSrcView.iSampledW);
+            float* pfR = tRowBuf.aR.data(); float* pfG = tRowBuf.aG.data(); float* pfB = tRowBuf.aB.data();
+            const float* m = m_afRgbToXyz;
+            const bool bU8 = tSrcView.IsU8();
+            const uint8_t* apRow[3] = {nullptr, nullptr, nullptr}; size_t szStride = 0;
+            int y0, y1;
+            GetBandRange(tSrcView.iSampledH, u32BandCnt, u32BandIdx, y0, y1);
+            for (int y = y0; y < y1; y++)
+            {
+                if (bU8)
+                    tSrcView.GetU8Row(y, 0, apRow, szStride);
+                else
+                    tSrcView.LoadSampledRow(y, 0, tSrcView.iSampledW, pfR, pfG, pfB);
+                for (int x = 0; x < tSrcView.iSampledW; x++)
+                {
+                    const int ir = bU8 ? apRow[0][x*szStride] : ToBin(pfR[x], 255.f, 256);
+                    const int ig = bU8 ? apRow[1][x*szStride] : ToBin(pfG[x], 255.f, 256);
+                    const int ib = bU8 ? apRow[2][x*szStride] : ToBin(pfB[x], 255.f, 256);
+                    const float r = m_afGammaTable[ir];
+                    const float g = m_afGammaTable[ig];
+                    const float b = m_afGammaTable[ib];
+                    const float fX = m[0]*r+m[1]*g+m[2]*b;
+                    const float fY = m[3]*r+m[4]*g+m[5]*b;
+                    const float fZ = m[6]*r+m[7]*g+m[8]*b;
+                    const float fSum = fX+fY+fZ;
+                    if (fSum < 1e-6f)
+                        continue;
+                    float u, v;
+                    XyToCie(m_iCieMode, fX/fSum, fY/fSum, u, v);
+                    const int px = (int)(u*fPlotScale);
+                    const int py = (int)((1.f-v)*fPlotScale);
+                    if (px >= 0 && px < iSize && py >= 0 && py < iSize)
+                        aBins[(size_t)py*iSize+px]++;
+                }
+            }
+        };
+        ParallelFor(u32BandCnt, fnBandProc);
+
+        const float fGain = intensity*(float)iSize*iSize/((float)tSrcView.iSampledW*tSrcView.iSampledH)*0.1f;
+        dst.create(iSize, iSize, 4, (size_t)1, 4);
+        MergePlotBins(u32BandCnt, iSize, fGain, (uint8_t*)dst.data, [&] (size_t szIdx, float fAlpha, uint8_t* pDst) {
+            const uint8_t* pBg = m_aCieBackground.data()+szIdx*4;
+            const uint8_t* pColor = m_aCieColors.data()+szIdx*3;
+            for (int c = 0; c < 3; c++)
+                pDst[c] = (uint8_t)(pBg[c]*(1.f-fAlpha)+(show_color ? pColor[c] : 255)*fAlpha);
+            pDst[3] = max(pBg[3], (uint8_t)(fAlpha*255.f));
+        });
+
+        // outline the triangle of the gamut to compare with
+        float afTriX[3], afTriY[3];
+        GetRedPoint((ColorsSystems)m_iCieGamuts, iSize, iSize, &afTriX[0], &afTriY[0]);
+        GetGreenPoint((ColorsSystems)m_iCieGamuts, iSize, iSize, &afTriX[1], &afTriY[1]);
+        GetBluePoint((ColorsSystems)m_iCieGamuts, iSize, iSize, &afTriX[2], &afTriY[2]);
+        for (int i = 0; i < 3; i++)
+            DrawLine(dst, afTriX[i], afTriY[i], afTriX[(i+1)%3], afTriY[(i+1)%3]);
+        dst.time_stamp = src.time_stamp;
+        dst.flags |= IM_MAT_FLAGS_CUSTOM_UPDATED;
+        return chrono::duration<double, milli>(chrono::steady_clock::now()-tStart).count();
+    }
+
+    double VectorScope(const ImGui::ImMat& src, ImGui::ImMat& dst, float intensity) override
+    {
+        const auto tStart = chrono::steady_clock::now();
+        _SrcView tSrcView;
+        if (!PrepareSource(src, tSrcView))
+            return -1;
+
+        // the hexagonal chroma plane, primary and secondary colors at full saturation are on the unit circle,
+        // the angle follows the hue, which matches the targets drawn by the scope view
+        const int iSize = VECTOR_SCOPE_SIZE;
+        const uint32_t u32BandCnt = min(m_u32ThreadCount, (uint32_t)tSrcView.iSampledH);
+        const float fHalf = (float)(iSize-1)*0.5f;
+        function<void(uint32_t)> fnBandProc = [&] (uint32_t u32BandIdx) {
+            auto& aBins = m_aBandBuffers[u32BandIdx];
+            aBins.assign((size_t)iSize*iSize, 0);
+            auto& tRowBuf = m_aRowBuffers[u32BandIdx];
+            tRowBuf.Resize(tSrcView.iSampledW);
+            float* pfR = tRowBuf.aR.data(); float* pfG = tRowBuf.aG.data(); float* pfB = tRowBuf.aB.data();
+            int y0, y1;
+            GetBandRange(tSrcView.iSampledH, u32BandCnt, u32BandIdx, y0, y1);
+            if (tSrcView.IsU8())
+            {
+                // 'm_aVectorXTable' is indexed by 2r-g-b+510, 'm_aVectorYTable' by g-b+255
+                const uint8_t* apRow[3]; size_t szStride;
+                uint32_t* pBins = aBins.data();
+                for (int y = y0; y < y1; y++)
+                {
+                    tSrcView.GetU8Row(y, 0, apRow, szStride);
+                    const uint8_t* pR = apRow[0]; const uint8_t* pG = apRow[1]; const uint8_t* pB = apRow[2];
+                    for (int x = 0; x < tSrcView.iSampledW; x++, pR += szStride, pG += szStride, pB += szStride)
+                    {
+                        const int px = m_aVectorXTable[2*(int)*pR-(int)*pG-(int)*pB+510];
+                        const int py = m_aVectorYTable[(int)*pG-(int)*pB+255];
+                        pBins[py*iSize+px]++;
+                    }
+                }
+                return;
+            }
+            for (int y = y0; y < y1; y++)
+            {
+                tSrcView.LoadSampledRow(y, 0, tSrcView.iSampledW, pfR, pfG, pfB);
+                for (int x = 0; x < tSrcView.iSampledW; x++)
+                {
+                    const float fCx = pfR[x]-0.5f*(pfG[x]+pfB[x]);
+                    const float fCy = 0.8660254f*(pfG[x]-pfB[x]);
+                    const int px = (int)((1.f+fCx)*fHalf+0.5f);
+                    const int py = (int)((1.f-fCy)*fHalf+0.5f);
+                    if (px >= 0 && px < iSize && py >= 0 && py < iSize)
+                        aBins[(size_t)py*iSize+px]++;
+                }
+            }
+        };
+        ParallelFor(u32BandCnt, fnBandProc);
+
+        const float fGain = intensity*(float)iSize*iSize/((float)tSrcView.iSampledW*tSrcView.iSampledH)*0.1f;
+        dst.create(iSize, iSize, 4, (size_t)1, 4);
+        MergePlotBins(u32BandCnt, iSize, fGain, (uint8_t*)dst.data, [&] (size_t szIdx, float fAlpha, uint8_t* pDst) {
+            const uint8_t* pColor = m_aVectorColors.data()+szIdx*3;
+            for (int c = 0; c < 3; c++)
+                pDst[c] = (uint8_t)(pColor[c]*fAlpha);
+            pDst[3] = (uint8_t)(fAlpha*255.f);
+        });
+        dst.time_stamp = src.time_stamp;
+        dst.flags |= IM_MAT_FLAGS_CUSTOM_UPDATED;
+        return chrono::duration<double, milli>(chrono::steady_clock::now()-tStart).count();
+    }
+
+    void GetWhitePoint(ColorsSystems cs, float w, float h, float* x, float* y) override
+    {
+        if (cs < 0 || cs >= NB_CS) cs = Rec709system;
+        ChromaticityToView(COLOR_SYSTEMS[cs].xWhite, COLOR_SYSTEMS[cs].yWhite, w, h, x, y);
+    }
+
+    void GetRedPoint(ColorsSystems cs, float w, float h, float* x, float* y) override
+    {
+        if (cs < 0 || cs >= NB_CS) cs = Rec709system;
+        ChromaticityToView(COLOR_SYSTEMS[cs].xRed, COLOR_SYSTEMS[cs].yRed, w, h, x, y);
+    }
+
+    void GetGreenPoint(ColorsSystems cs, float w, float h, float* x, float* y) override
+    {
+        if (cs < 0 || cs >= NB_CS) cs = Rec709system;
+        ChromaticityToView(COLOR_SYSTEMS[cs].xGreen, COLOR_SYSTEMS[cs].yGreen, w, h, x, y);
+    }
+
+    void GetBluePoint(ColorsSystems cs, float w, float h, float* x, float* y) override
+    {
+        if (cs < 0 || cs >= NB_CS) cs = Rec709system;
+        ChromaticityToView(COLOR_SYSTEMS[cs].xBlue, COLOR_SYSTEMS[cs].yBlue, w, h, x, y);
+    }
+
+    string GetError() const override
+    {
+        return m_errMsg;
+    }
+
+    void SetLogLevel(Level l) override
+    {
+        m_pLogger->SetShowLevels(l);
+    }
+
+private:
+    bool PrepareSource(const ImGui::ImMat& src, _SrcView& tSrcView)
+    {
+        if (src.empty() || src.w <= 0 || src.h <= 0)
+        {
+            m_errMsg = "Source image is empty!";
+            return false;
+        }
+        if (src.device != IM_DD_CPU)
+        {
+            m_errMsg = "Source image is NOT in CPU memory!";
+            return false;
+        }
+        if (src.type != IM_DT_INT8 && src.type != IM_DT_INT16 && src.type != IM_DT_FLOAT32)
+        {
+            ostringstream oss; oss << "Unsupported source data type " << (int)src.type << "!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        const int iChCnt = src.c > 0 ? src.c : 1;
+        const uint8_t* pData = (const uint8_t*)src.data;
+        const bool bPlanar = iChCnt > 1 && src.elempack == 1;
+        for (int i = 0; i < 3; i++)
+        {
+            const int iCh = iChCnt >= 3 ? i : 0;
+            tSrcView.apChBase[i] = bPlanar ? pData+src.cstep*iCh*src.elemsize : pData+iCh*IM_ESIZE(src.type);
+        }
+        tSrcView.szPixStride = bPlanar ? 1 : (size_t)iChCnt;
+        tSrcView.szRowBytes = (size_t)src.w*tSrcView.szPixStride*IM_ESIZE(src.type);
+        tSrcView.eDataType = src.type;
+        tSrcView.iStep = m_iPixelStep;
+        tSrcView.iSampledW = (src.w+m_iPixelStep-1)/m_iPixelStep;
+        tSrcView.iSampledH = (src.h+m_iPixelStep-1)/m_iPixelStep;
+        return true;
+    }
+
+    bool CheckLevel(int level)
+    {
+        if (level < 2 || level > 4096)
+        {
+            ostringstream oss; oss << "Invalid scope level " << level << "!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        return true;
+    }
+
+    static inline int ToBin(float fValue, float fLvlScale, int iLevel)
+    {
+        const int i = (int)(fValue*fLvlScale+0.5f);
+        return i < 0 ? 0 : (i >= iLevel ? iLevel-1 : i);
+    }
+
+    static inline uint8_t U8Luma(uint8_t r, uint8_t g, uint8_t b)
+    {
+        // bt.709 weights in 8-bit fixed point, they sum up to 256
+        return (uint8_t)((54*r+183*g+19*b+128)>>8);
+    }
+
+    static void BuildU8BinTable(int iLevel, uint16_t au16Table[256])
+    {
+        for (int i = 0; i < 256; i++)
+            au16Table[i] = (uint16_t)((i*(iLevel-1)+127)/255);
+    }
+
+    static void GetBandRange(int iTotal, uint32_t u32BandCnt, uint32_t u32BandIdx, int& iBegin, int& iEnd)
+    {
+        iBegin = (int)((int64_t)iTotal*u32BandIdx/u32BandCnt);
+        iEnd = (int)((int64_t)iTotal*(u32BandIdx+1)/u32BandCnt);
+    }
+
+    void ParallelFor(uint32_t u32BandCnt, const function<void(uint32_t)>& fnBandProc)
+    {
+        if (u32BandCnt <= 1 || !m_hExctor)
+        {
+            for (uint32_t i = 0; i < u32BandCnt; i++)
+                fnBandProc(i);
+            return;
+        }
+        vector<SysUtils::AsyncTask::Holder> aTasks;
+        aTasks.reserve(u32BandCnt-1);
+        for (uint32_t i = 1; i < u32BandCnt; i++)
+        {
+            SysUtils::AsyncTask::Holder hTask(new _BandTask(fnBandProc, i));
+            if (m_hExctor->EnqueueTask(hTask))
+                aTasks.push_back(hTask);
+            else
+                fnBandProc(i);
+        }
+        fnBandProc(0);
+        for (auto& hTask : aTasks)
+            hTask->WaitDone();
+    }
+
+    // Sum the per-band bins of a 'iSize' x 'iSize' plot and compose the output pixels in parallel
+    template<typename ComposeFunc>
+    void MergePlotBins(uint32_t u32BandCnt, int iSize, float fGain, uint8_t* pOut, ComposeFunc&& fnCompose)
+    {
+        const uint32_t u32OutBandCnt = min(m_u32ThreadCount, (uint32_t)iSize);
+        function<void(uint32_t)> fnOutProc = [&] (uint32_t u32OutBandIdx) {
+            int y0, y1;
+            GetBandRange(iSize, u32OutBandCnt, u32OutBandIdx, y0, y1);
+            for (size_t i = (size_t)y0*iSize; i < (size_t)y1*iSize; i++)
+            {
+                uint32_t u32Count = 0;
+                for (uint32_t b = 0; b < u32BandCnt; b++)
+                    u32Count += m_aBandBuffers[b][i];
+                const float fAlpha = min((float)u32Count*fGain, 1.f);
+                fnCompose(i, fAlpha, pOut+i*4);
+            }
+        };
+        ParallelFor(u32OutBandCnt, fnOutProc);
+    }
+
+    void ChromaticityToView(float x, float y, float w, float h, float* px, float* py) const
+    {
+        float u, v;
+        XyToCie(m_iCieMode, x, y, u, v);
+        *px = u*w;
+        *py = (1.f-v)*h;
+    }
+
+    static bool IsInTriangle(float x, float y, const float afTriX[3], const float afTriY[3])
+    {
+        bool bHasNeg = false, bHasPos = false;
+        for (int i = 0; i < 3; i++)
+        {
+            const int j = (i+1)%3;
+            const float d = (x-afTriX[j])*(afTriY[i]-afTriY[j])-(afTriX[i]-afTriX[j])*(y-afTriY[j]);
+            bHasNeg |= d < 0.f;
+            bHasPos |= d > 0.f;
+        }
+        return !(bHasNeg && bHasPos);
+    }
+
+    static void DrawLine(ImGui::ImMat& dst, float x0, float y0, float x1, float y1)
+    {
+        const int iSteps = (int)max(fabs(x1-x0), fabs(y1-y0))+1;
+        for (int i = 0; i <= iSteps; i++)
+        {
+            const int x = (int)(x0+(x1-x0)*i/iSteps+0.5f);
+            const int y = (int)(y0+(y1-y0)*i/iSteps+0.5f);
+            if (x < 0 || x >= dst.w || y < 0 || y >= dst.h)
+                continue;
+            uint8_t* pDst = (uint8_t*)dst.data+((size_t)y*dst.w+x)*4;
+            pDst[0] = pDst[1] = pDst[2] = 192; pDst[3] = 255;
+        }
+    }
+
+    void BuildVectorColorTable()
+    {
+        const int iSize = VECTOR_SCOPE_SIZE;
+        const float fHalf = (float)(iSize-1)*0.5f;
+        m_aVectorColors.resize((size_t)iSize*iSize*3);
+        m_aVectorXTable.resize(1021);
+        for (int i = 0; i < 1021; i++)
+            m_aVectorXTable[i] = (uint16_t)min((int)((1.f+(i-510)/510.f)*fHalf+0.5f), iSize-1);
+        m_aVectorYTable.resize(511);
+        for (int i = 0; i < 511; i++)
+            m_aVectorYTable[i] = (uint16_t)min((int)((1.f-0.8660254f*(i-255)/255.f)*fHalf+0.5f), iSize-1);
+        for (int py = 0; py < iSize; py++)
+        {
+            for (int px = 0; px < iSize; px++)
+            {
+                const float fCx = (float)px/fHalf-1.f;
+                const float fCy = 1.f-(float)py/fHalf;
+                float fHue = atan2f(fCy, fCx)/(float)(2*M_PI);
+                if (fHue < 0.f) fHue += 1.f;
+                const float fSat = min(sqrtf(fCx*fCx+fCy*fCy), 1.f);
+                // hsv to rgb, with value 1
+                const float h6 = fHue*6.f;
+                const int iSector = (int)h6%6;
+                const float f = h6-floorf(h6);
+                const float p = 1.f-fSat, q = 1.f-fSat*f, t = 1.f-fSat*(1.f-f);
+                float r, g, b;
+                switch (iSector)
+                {
+                    case 0: r = 1.f; g = t; b = p; break;
+                    case 1: r = q; g = 1.f; b = p; break;
+                    case 2: r = p; g = 1.f; b = t; break;
+                    case 3: r = p; g = q; b = 1.f; break;
+                    case 4: r = t; g = p; b = 1.f; break;
+                    default: r = 1.f; g = p; b = q; break;
+                }
+                uint8_t* pColor = m_aVectorColors.data()+((size_t)py*iSize+px)*3;
+                pColor[0] = (uint8_t)(r*255.f+0.5f);
+                pColor[1] = (uint8_t)(g*255.f+0.5f);
+                pColor[2] = (uint8_t)(b*255.f+0.5f);
+            }
+        }
+    }
+
+private:
+    ALogger* m_pLogger;
+    string m_errMsg;
+    uint32_t m_u32ThreadCount;
+    SysUtils::ThreadPoolExecutor::Holder m_hExctor;
+    vector<vector<uint32_t>> m_aBandBuffers;
+    vector<_RowBuffer> m_aRowBuffers;
+    vector<uint16_t> m_aWaveCounts;
+    uint32_t m_u32FrameDecimation{1};
+    uint32_t m_u32FrameCounter{0};
+    int m_iPixelStep{1};
+    // cie scope parameters
+    int m_iCieColorSystem{Rec709system};
+    int m_iCieMode{XYY};
+    int m_iCieSize{512};
+    int m_iCieGamuts{Rec2020system};
+    float m_fCieContrast{0.75f};
+    bool m_bCieCorrectGamma{false};
+    float m_afRgbToXyz[9];
+    float m_afGammaTable[256];
+    vector<uint8_t> m_aCieColors;
+    vector<uint8_t> m_aCieBackground;
+    vector<uint8_t> m_aVectorColors;
+    vector<uint16_t> m_aVectorXTable;
+    vector<uint16_t> m_aVectorYTable;
+};
+
+CpuVideoScope::Holder CpuVideoScope::CreateInstance(uint32_t u32ThreadCount)
+{
+    return CpuVideoScope::Holder(new CpuVideoScope_Impl(u32ThreadCount));
+}
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <memory>
+#include <immat.h>
+#include <BaseUtils/Logger.h>
+
+namespace MEC
+{
+    // Multi-threaded CPU implementation of the video scopes, used when the vulkan scopes are not built or no gpu is available.
+    // The outputs have the same layout as the ones of 'Histogram_vulkan', 'Waveform_vulkan', 'CIE_vulkan' and 'Vector_vulkan',
+    // so they can be drawn by the same ui code. Each 'XxxScope()' call returns the time used in milliseconds, or a negative
+    // value on failure.
+    struct CpuVideoScope
+    {
+        // Same values as 'ImGui::CieSystem' and 'ImGui::ColorsSystems'
+        enum CieSystem : int32_t
+        {
+            XYY = 0,
+            UCS,
+            LUV,
+            NB_CIE
+        };
+
+        enum ColorsSystems : int32_t
+        {
+            NTSCsystem = 0,
+            EBUsystem,
+            SMPTEsystem,
+            SMPTE240Msystem,
+            APPLEsystem,
+            wRGBsystem,
+            CIE1931system,
+            Rec709system,
+            Rec2020system,
+            DCIP3,
+            NB_CS
+        };
+
+        using Holder = std::shared_ptr<CpuVideoScope>;
+        // 'u32ThreadCount' is the number of worker threads, 0 means using the number of cpu cores
+        static Holder CreateInstance(uint32_t u32ThreadCount = 0);
+
+        // Only 1 of every 'u32Interval' frames is taken by 'CheckFrame()', 1 means processing every frame
+        virtual void SetFrameDecimation(uint32_t u32Interval) = 0;
+        virtual uint32_t GetFrameDecimation() const = 0;
+        // Returns true if the scopes should be calculated for the current frame, 'bForce' bypasses the frame decimation
+        virtual bool CheckFrame(bool bForce = false) = 0;
+        // Only 1 of every 'u32Step' pixels in both directions is sampled, the results are scaled to the full frame size
+        virtual void SetPixelStep(uint32_t u32Step) = 0;
+
+        virtual double HistogramScope(const ImGui::ImMat& src, ImGui::ImMat& dst, int level = 256, float scale = 1.0, bool log_view = false) = 0;
+        virtual double WaveformScope(const ImGui::ImMat& src, ImGui::ImMat& dst, int level = 256, float fintensity = 0.1, bool separate = false, bool show_y = false) = 0;
+        virtual void SetCieParam(int color_system, int cie, int size, int gamuts, float contrast, bool correct_gamma) = 0;
+        virtual double CieScope(const ImGui::ImMat& src, ImGui::ImMat& dst, float intensity = 0.01, bool show_color = true) = 0;
+        virtual double VectorScope(const ImGui::ImMat& src, ImGui::ImMat& dst, float intensity = 0.01) = 0;
+
+        // Positions of the white point and the primaries of color system 'cs' in a 'w' x 'h' cie view, using the cie system set by 'SetCieParam()'
+        virtual void GetWhitePoint(ColorsSystems cs, float w, float h, float* x, float* y) = 0;
+        virtual void GetRedPoint(ColorsSystems cs, float w, float h, float* x, float* y) = 0;
+        virtual void GetGreenPoint(ColorsSystems cs, float w, float h, float* x, float* y) = 0;
+        virtual void GetBluePoint(ColorsSystems cs, float w, float h, float* x, float* y) = 0;
+
+        virtual std::string GetError() const = 0;
+        virtual void SetLogLevel(Logger::Level l) = 0;
+    };
+}
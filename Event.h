@@ -51,6 +51,8 @@ namespace MEC
         virtual const ImGui::MaskCreator::Holder GetMaskCreator(int64_t nodeId, size_t index) const = 0;
         virtual bool RemoveMask(size_t index) = 0;
         virtual bool RemoveMask(int64_t nodeId, size_t index) = 0;
+        // The masks are edited through their 'MaskCreator' instances, call this after an edit to update the rasterized masks.
+        virtual void NotifyMaskChanged() = 0;
     };
 
     struct AudioEvent : virtual Event
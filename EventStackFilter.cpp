@@ -1,6 +1,9 @@
 #include <algorithm>
+#include <atomic>
 #include <functional>
+#include <memory>
 #include <sstream>
+#include <vector>
 #include <MediaCore/VideoBlender.h>
 #include <ImMaskCreator/MatMath.h>
 #include "EventStackFilter.h"
@@ -89,6 +92,60 @@ protected:
     uint32_t m_status{0};
 };
 
+// Interval index of the events in a stack. The sorted starts and ends of all the events split the timeline into elementary
+// intervals, and the active events of each interval are listed in the order of the event list. So looking up the events
+// at a position is a binary search over the boundaries, returning a list that is built along with the index.
+// An index is immutable once built, a stack replaces it with a new one whenever the events are added, removed, moved or resized.
+class EventIntervalIndex
+{
+public:
+    using Holder = shared_ptr<const EventIntervalIndex>;
+
+    static Holder Build(const list<Event::Holder>& eventList)
+    {
+        auto pIndex = new EventIntervalIndex();
+        pIndex->m_aHolders.reserve(eventList.size());
+        pIndex->m_aBoundaries.reserve(eventList.size()*2);
+        for (const auto& e : eventList)
+        {
+            pIndex->m_aHolders.push_back(e);
+            pIndex->m_aBoundaries.push_back(e->Start());
+            pIndex->m_aBoundaries.push_back(e->End());
+        }
+        auto& aBoundaries = pIndex->m_aBoundaries;
+        sort(aBoundaries.begin(), aBoundaries.end());
+        aBoundaries.erase(unique(aBoundaries.begin(), aBoundaries.end()), aBoundaries.end());
+        if (!aBoundaries.empty())
+            pIndex->m_aActiveEvents.resize(aBoundaries.size()-1);
+        for (const auto& e : eventList)
+        {
+            Event_Base* pEvtBase = dynamic_cast<Event_Base*>(e.get());
+            const auto idxBegin = lower_bound(aBoundaries.begin(), aBoundaries.end(), e->Start())-aBoundaries.begin();
+            const auto idxEnd = lower_bound(aBoundaries.begin(), aBoundaries.end(), e->End())-aBoundaries.begin();
+            for (auto i = idxBegin; i < idxEnd; i++)
+                pIndex->m_aActiveEvents[i].push_back(pEvtBase);
+        }
+        return Holder(pIndex);
+    }
+
+    const vector<Event_Base*>& GetActiveEvents(int64_t pos) const
+    {
+        static const vector<Event_Base*> s_aEmpty;
+        auto itUpper = upper_bound(m_aBoundaries.begin(), m_aBoundaries.end(), pos);
+        if (itUpper == m_aBoundaries.begin() || itUpper == m_aBoundaries.end())
+            return s_aEmpty;
+        return m_aActiveEvents[itUpper-m_aBoundaries.begin()-1];
+    }
+
+private:
+    EventIntervalIndex() = default;
+
+private:
+    vector<Event::Holder> m_aHolders;       // keep the events alive while this index is in use
+    vector<int64_t> m_aBoundaries;
+    vector<vector<Event_Base*>> m_aActiveEvents;
+};
+
 class EventStack_Base : public virtual EventStack
 {
 public:
@@ -101,6 +158,11 @@ public:
         m_eventList.clear();
     }
 
+    EventIntervalIndex::Holder GetEventIndex() const
+    {
+        return atomic_load(&m_hEventIndex);
+    }
+
     Event::Holder GetEvent(int64_t id) override
     {
         auto iter = find_if(m_eventList.begin(), m_eventList.end(), [id] (auto e) {
@@ -151,6 +213,7 @@ public:
         Event::Holder hEvt = CreateNewEvent(id, start, end, z);
         m_eventList.push_back(hEvt);
         m_eventList.sort(EVENTLIST_COMPARATOR);
+        UpdateEventIndex();
         return hEvt;
     }
 
@@ -162,6 +225,7 @@ public:
         if (iter != m_eventList.end())
         {
             m_eventList.erase(iter);
+            UpdateEventIndex();
         }
     }
 
@@ -201,6 +265,7 @@ public:
         pEvtBase->SetEnd(end);
         pEvtBase->UpdateKeyPointRange();
         m_eventList.sort(EVENTLIST_COMPARATOR);
+        UpdateEventIndex();
         return true;
     }
 
@@ -231,6 +296,7 @@ public:
         pEvtBase->SetEnd(end);
         pEvtBase->SetZ(z);
         m_eventList.sort(EVENTLIST_COMPARATOR);
+        UpdateEventIndex();
         return true;
     }
 
@@ -244,6 +310,7 @@ public:
             pEvtBase->SetStart(newStart);
             pEvtBase->SetEnd(newEnd);
         }
+        UpdateEventIndex();
         return true;
     }
 
@@ -281,6 +348,7 @@ public:
             pEvtBase->SetZ(newZ);
         }
         m_eventList.sort(EVENTLIST_COMPARATOR);
+        UpdateEventIndex();
         return true;
     }
 
@@ -354,10 +422,16 @@ public:
         }
         m_eventList.push_back(hEvt);
         m_eventList.sort(EVENTLIST_COMPARATOR);
+        UpdateEventIndex();
         return true;
     }
 
 protected:
+    void UpdateEventIndex()
+    {
+        atomic_store(&m_hEventIndex, EventIntervalIndex::Build(m_eventList));
+    }
+
     static function<bool(const Event::Holder&,const Event::Holder&)> EVENTLIST_COMPARATOR;
 
     virtual Event::Holder CreateNewEvent(int64_t id, int64_t start, int64_t end, int32_t z) = 0;
@@ -365,6 +439,7 @@ protected:
 public:
     ALogger* m_logger;
     list<Event::Holder> m_eventList;
+    EventIntervalIndex::Holder m_hEventIndex{EventIntervalIndex::Build({})};
     int64_t m_editingEventId{-1};
     BluePrint::BluePrintCallbackFunctions m_bpCallbacks;
     void* m_tlHandle{nullptr};
@@ -475,16 +550,11 @@ public:
 
     ImGui::ImMat FilterImage(const ImGui::ImMat& vmat, int64_t pos, const std::unordered_map<std::string, std::string>* pExtraArgs) override
     {
-        list<Event::Holder> effectiveEvents;
-        for (auto e : m_eventList)
-        {
-            if (e->IsInRange(pos))
-                effectiveEvents.push_back(e);
-        }
+        const auto hEventIndex = GetEventIndex();
         ImGui::ImMat outM = vmat;
-        for (auto& e : effectiveEvents)
+        for (auto pEvtBase : hEventIndex->GetActiveEvents(pos))
         {
-            VideoEvent_Impl* pEvtImpl = dynamic_cast<VideoEvent_Impl*>(e.get());
+            VideoEvent_Impl* pEvtImpl = static_cast<VideoEvent_Impl*>(pEvtBase);
             outM = pEvtImpl->FilterImage(outM, pos-pEvtImpl->Start(), pExtraArgs);
         }
         return outM;
@@ -573,22 +643,7 @@ public:
                 if (!m_ahMaskCreators.empty())
                 {
                     const int64_t i64Tick = pos;
-                    ImGui::ImMat mCombinedMask;
-                    const MatUtils::Size2i szImageSize(outMat.w, outMat.h);
-                    const auto szMaskCnt = m_ahMaskCreators.size();
-                    for (auto i = 0; i < szMaskCnt; i++)
-                    {
-                        auto& hMaskCreator = m_ahMaskCreators[i];
-                        if (szImageSize != hMaskCreator->GetMaskSize())
-                            hMaskCreator->ChangeMaskSize(szImageSize, true);
-                        if (!hMaskCreator->IsMaskReady())
-                            continue;
-                        auto mMask = m_ahMaskCreators[i]->GetMask(ImGui::MaskCreator::AA, true, IM_DT_FLOAT32, 1, 0, i64Tick);
-                        if (mCombinedMask.empty())
-                            mCombinedMask = mMask.clone();
-                        else
-                            MatUtils::Max(mCombinedMask, mMask);
-                    }
+                    const auto& mCombinedMask = GetCombinedMask(MatUtils::Size2i(outMat.w, outMat.h), i64Tick);
                     if (!mCombinedMask.empty())
                     {
                         if (!m_hBlender) m_hBlender = MediaCore::VideoBlender::CreateInstance();
@@ -614,9 +669,15 @@ public:
             auto hMaskCreator = ImGui::MaskCreator::CreateInstance(szMaskSize, name);
             hMaskCreator->SetTickRange(0, Length());
             m_ahMaskCreators.push_back(hMaskCreator);
+            m_u32MaskVersion++;
             return hMaskCreator;
         }
 
+        void NotifyMaskChanged() override
+        {
+            m_u32MaskVersion++;
+        }
+
         int GetMaskCount() const override
         {
             return m_ahMaskCreators.size();
@@ -672,6 +733,7 @@ public:
             }
             auto itDel = m_ahMaskCreators.begin()+index;
             m_ahMaskCreators.erase(itDel);
+            m_u32MaskVersion++;
             return true;
         }
 
@@ -734,14 +796,75 @@ public:
             return j;
         }
 
+    private:
+        // Rasterize and merge all the masks of this event. A mask is rasterized again only if the masks are edited (the mask
+        // version is bumped by 'NotifyMaskChanged()'), the image size changes, or it has key frames and the tick changes,
+        // otherwise its cached rasterization is reused. If none of the masks changes, the combined mask from the last call
+        // is returned as it is.
+        const ImGui::ImMat& GetCombinedMask(const MatUtils::Size2i& szImageSize, int64_t i64Tick)
+        {
+            const auto szMaskCnt = m_ahMaskCreators.size();
+            bool bCombinedMaskValid = m_szCombinedMaskSize == szImageSize && m_aMaskRasterCaches.size() == szMaskCnt;
+            if (m_aMaskRasterCaches.size() != szMaskCnt)
+                m_aMaskRasterCaches.resize(szMaskCnt);
+            for (auto i = 0; i < szMaskCnt; i++)
+            {
+                auto& hMaskCreator = m_ahMaskCreators[i];
+                auto& tCache = m_aMaskRasterCaches[i];
+                if (szImageSize != hMaskCreator->GetMaskSize())
+                    hMaskCreator->ChangeMaskSize(szImageSize, true);
+                const bool bReady = hMaskCreator->IsMaskReady();
+                const uint32_t u32MaskVersion = m_u32MaskVersion;
+                const bool bKeyFramed = hMaskCreator->IsKeyFrameEnabled();
+                if (tCache.pMaskCreator == hMaskCreator.get() && tCache.bReady == bReady && tCache.u32MaskVersion == u32MaskVersion
+                        && tCache.szMaskSize == szImageSize && (!bKeyFramed || tCache.i64Tick == i64Tick))
+                    continue;
+                tCache.pMaskCreator = hMaskCreator.get();
+                tCache.bReady = bReady;
+                tCache.u32MaskVersion = u32MaskVersion;
+                tCache.szMaskSize = szImageSize;
+                tCache.i64Tick = i64Tick;
+                tCache.mMask = bReady ? hMaskCreator->GetMask(ImGui::MaskCreator::AA, true, IM_DT_FLOAT32, 1, 0, i64Tick) : ImGui::ImMat();
+                bCombinedMaskValid = false;
+            }
+            if (bCombinedMaskValid)
+                return m_mCombinedMask;
+
+            m_mCombinedMask.release();
+            for (const auto& tCache : m_aMaskRasterCaches)
+            {
+                if (tCache.mMask.empty())
+                    continue;
+                if (m_mCombinedMask.empty())
+                    m_mCombinedMask = tCache.mMask.clone();
+                else
+                    MatUtils::Max(m_mCombinedMask, tCache.mMask);
+            }
+            m_szCombinedMaskSize = szImageSize;
+            return m_mCombinedMask;
+        }
+
     private:
         MediaCore::VideoBlender::Holder m_hBlender;
+        struct _MaskRasterCache
+        {
+            const ImGui::MaskCreator* pMaskCreator{nullptr};
+            bool bReady{false};
+            uint32_t u32MaskVersion{0};
+            MatUtils::Size2i szMaskSize;
+            int64_t i64Tick{0};
+            ImGui::ImMat mMask;
+        };
+        vector<_MaskRasterCache> m_aMaskRasterCaches;
+        ImGui::ImMat m_mCombinedMask;
+        MatUtils::Size2i m_szCombinedMaskSize;
 
     private:
         VideoEvent_Impl(VideoEventStackFilter_Impl* owner) : Event_Base(owner) {}
 
         vector<ImGui::MaskCreator::Holder> m_ahMaskCreators;
         unordered_map<int64_t, vector<ImGui::MaskCreator::Holder>> m_mapEffectMaskTable;
+        atomic<uint32_t> m_u32MaskVersion{1};
     };
 
     static const function<void(Event*)> VIDEO_EVENT_DELETER;
@@ -961,16 +1084,11 @@ public:
 
     ImGui::ImMat FilterPcm(const ImGui::ImMat& amat, int64_t pos, int64_t dur) override
     {
-        list<Event::Holder> effectiveEvents;
-        for (auto e : m_eventList)
-        {
-            if (e->IsInRange(pos))
-                effectiveEvents.push_back(e);
-        }
+        const auto hEventIndex = GetEventIndex();
         ImGui::ImMat outM = amat;
-        for (auto& e : effectiveEvents)
+        for (auto pEvtBase : hEventIndex->GetActiveEvents(pos))
         {
-            AudioEvent_Impl* pEvtImpl = dynamic_cast<AudioEvent_Impl*>(e.get());
+            AudioEvent_Impl* pEvtImpl = static_cast<AudioEvent_Impl*>(pEvtBase);
             outM = pEvtImpl->FilterPcm(outM, pos-pEvtImpl->Start(), dur);
         }
         return outM;
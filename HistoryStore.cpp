@@ -0,0 +1,694 @@
+#include <sstream>
+#include <fstream>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include "BaseUtils/FileSystemUtils.h"
+#include "HistoryStore.h"
+
+using namespace std;
+using namespace Logger;
+namespace fs = std::filesystem;
+
+namespace MEC
+{
+class HistoryStore_Impl : public HistoryStore
+{
+public:
+    HistoryStore_Impl(const string& strSpillDir, uint64_t u64MemoryBudget) : m_strSpillDir(strSpillDir), m_u64MemoryBudget(u64MemoryBudget)
+    {
+        m_pLogger = GetLogger("HistoryStore");
+    }
+
+    ~HistoryStore_Impl()
+    {
+        Clear();
+    }
+
+    void SetMemoryBudget(uint64_t u64Bytes) override
+    {
+        m_u64MemoryBudget = u64Bytes;
+        SpillRecords();
+    }
+
+    uint64_t GetMemoryBudget() const override
+    {
+        return m_u64MemoryBudget;
+    }
+
+    bool AddRecord(const imgui_json::value& jnRecord) override
+    {
+        TruncateRecords(m_szCurrPos);
+        Record tRecord;
+        unordered_map<string, uint32_t> mapKeys;
+        EncodeValue(jnRecord, tRecord, tRecord.strData, mapKeys, 0);
+        tRecord.u32DataSize = tRecord.strData.size();
+        m_u64MemoryUsage += tRecord.strData.size();
+        m_aRecords.push_back(std::move(tRecord));
+        m_szCurrPos = m_aRecords.size();
+        SpillRecords();
+        m_pLogger->Log(DEBUG) << "Added history record #" << m_aRecords.size()-1 << " (" << m_aRecords.back().u32DataSize << " bytes), memory usage "
+                << m_u64MemoryUsage << " bytes, spilled " << m_u64SpilledSize << " bytes." << endl;
+        return true;
+    }
+
+    bool Undo(imgui_json::value& jnRecord) override
+    {
+        if (m_szCurrPos == 0)
+            return false;
+        if (!DecodeRecord(m_szCurrPos-1, jnRecord))
+            return false;
+        m_szCurrPos--;
+        return true;
+    }
+
+    bool Redo(imgui_json::value& jnRecord) override
+    {
+        if (m_szCurrPos >= m_aRecords.size())
+            return false;
+        if (!DecodeRecord(m_szCurrPos, jnRecord))
+            return false;
+        m_szCurrPos++;
+        return true;
+    }
+
+    bool CanUndo() const override
+    {
+        return m_szCurrPos > 0;
+    }
+
+    bool CanRedo() const override
+    {
+        return m_szCurrPos < m_aRecords.size();
+    }
+
+    void Clear() override
+    {
+        m_aRecords.clear();
+        m_aBaseBlobs.clear();
+        m_szCurrPos = 0;
+        m_szFirstInMemory = 0;
+        m_u64MemoryUsage = 0;
+        m_u64SpilledSize = 0;
+        m_u64SpillEnd = 0;
+        if (m_fsSpill.is_open())
+            m_fsSpill.close();
+        if (!m_strSpillPath.empty())
+        {
+            if (SysUtils::IsFile(m_strSpillPath))
+                SysUtils::DeleteFileAt(m_strSpillPath);
+            m_strSpillPath.clear();
+        }
+    }
+
+    size_t GetRecordCount() const override
+    {
+        return m_aRecords.size();
+    }
+
+    uint64_t GetMemoryUsage() const override
+    {
+        return m_u64MemoryUsage;
+    }
+
+    uint64_t GetSpilledSize() const override
+    {
+        return m_u64SpilledSize;
+    }
+
+    string GetError() const override
+    {
+        return m_errMsg;
+    }
+
+    void SetLogLevel(Level l) override
+    {
+        m_pLogger->SetShowLevels(l);
+    }
+
+private:
+    // Record encoding: each value starts with one of the tags below. Integral numbers are zigzag varints, object keys are
+    // interned per record (varint 0 followed by the key for a new key, or index+1 of a known key). The values of the action
+    // fields (record -> actions -> action -> field) are encoded with their own key table, the large ones become blobs which
+    // can be the delta bases of the later ones.
+    enum : uint8_t
+    {
+        TAG_NULL = 0,
+        TAG_FALSE,
+        TAG_TRUE,
+        TAG_INT,
+        TAG_NUMBER,
+        TAG_STRING,
+        TAG_ARRAY,
+        TAG_OBJECT,
+        TAG_POINT,
+        TAG_VEC2,
+        TAG_VEC4,
+        TAG_DISCARDED,
+        TAG_EMBED,      // varint size + self-contained value
+        TAG_BLOB,       // varint size + self-contained value, registered as a delta base
+        TAG_DELTA,      // varint base record, varint base blob, varint prefix size, varint suffix size, varint size + middle bytes
+    };
+
+    static constexpr int FIELD_DEPTH = 3;
+    static constexpr size_t BLOB_MIN_SIZE = 4096;
+    static constexpr size_t MAX_BASE_BLOBS = 4;
+
+    struct Record
+    {
+        string strData;                             // empty if the record is spilled
+        uint32_t u32DataSize{0};
+        bool bSpilled{false};
+        uint64_t u64SpillOffset{0};
+        vector<pair<uint32_t, uint32_t>> aBlobs;    // offset and size of the blobs in 'strData'
+    };
+
+    struct BaseBlob
+    {
+        size_t szRecordIdx;
+        uint32_t u32BlobIdx;
+        string strBytes;
+    };
+
+    static void PutVarint(string& strOut, uint64_t u64Val)
+    {
+        while (u64Val >= 0x80)
+        {
+            strOut.push_back((char)(u64Val&0x7f|0x80));
+            u64Val >>= 7;
+        }
+        strOut.push_back((char)u64Val);
+    }
+
+    template <typename T>
+    static void PutRaw(string& strOut, const T& val)
+    {
+        strOut.append((const char*)&val, sizeof(T));
+    }
+
+    struct Reader
+    {
+        const uint8_t* pData;
+        size_t szSize;
+        size_t szPos{0};
+        bool bError{false};
+
+        uint8_t GetByte()
+        {
+            if (szPos >= szSize) { bError = true; return 0; }
+            return pData[szPos++];
+        }
+
+        uint64_t GetVarint()
+        {
+            uint64_t u64Val = 0;
+            for (int iShift = 0; iShift < 64; iShift += 7)
+            {
+                const uint8_t u8Byte = GetByte();
+                u64Val |= (uint64_t)(u8Byte&0x7f) << iShift;
+                if (!(u8Byte&0x80))
+                    return u64Val;
+            }
+            bError = true;
+            return 0;
+        }
+
+        const char* GetBytes(size_t szLen)
+        {
+            if (szLen > szSize-szPos) { bError = true; return nullptr; }
+            auto p = (const char*)pData+szPos;
+            szPos += szLen;
+            return p;
+        }
+
+        template <typename T>
+        T GetRaw()
+        {
+            T val{};
+            auto p = GetBytes(sizeof(T));
+            if (p) memcpy(&val, p, sizeof(T));
+            return val;
+        }
+    };
+
+    void EncodeValue(const imgui_json::value& jnVal, Record& tRecord, string& strOut, unordered_map<string, uint32_t>& mapKeys, int iDepth)
+    {
+        switch (jnVal.type())
+        {
+        case imgui_json::type_t::null:
+            strOut.push_back(TAG_NULL);
+            break;
+        case imgui_json::type_t::boolean:
+            strOut.push_back(jnVal.get<imgui_json::boolean>() ? TAG_TRUE : TAG_FALSE);
+            break;
+        case imgui_json::type_t::number:
+        {
+            // the ids and the time stamps are integers, store them as varints
+            const double dVal = jnVal.get<imgui_json::number>();
+            if (dVal >= -9007199254740992.0 && dVal <= 9007199254740992.0 && dVal == (double)(int64_t)dVal)
+            {
+                const int64_t i64Val = (int64_t)dVal;
+                strOut.push_back(TAG_INT);
+                PutVarint(strOut, ((uint64_t)i64Val<<1)^(uint64_t)(i64Val>>63));
+            }
+            else
+            {
+                strOut.push_back(TAG_NUMBER);
+                PutRaw(strOut, dVal);
+            }
+            break;
+        }
+        case imgui_json::type_t::string:
+        {
+            auto& strVal = jnVal.get<imgui_json::string>();
+            strOut.push_back(TAG_STRING);
+            PutVarint(strOut, strVal.size());
+            strOut.append(strVal);
+            break;
+        }
+        case imgui_json::type_t::array:
+        {
+            auto& aElems = jnVal.get<imgui_json::array>();
+            strOut.push_back(TAG_ARRAY);
+            PutVarint(strOut, aElems.size());
+            for (auto& jnElem : aElems)
+                EncodeValue(jnElem, tRecord, strOut, mapKeys, iDepth+1);
+            break;
+        }
+        case imgui_json::type_t::object:
+        {
+            auto& mapMembers = jnVal.get<imgui_json::object>();
+            strOut.push_back(TAG_OBJECT);
+            PutVarint(strOut, mapMembers.size());
+            for (auto& elem : mapMembers)
+            {
+                auto iter = mapKeys.find(elem.first);
+                if (iter == mapKeys.end())
+                {
+                    const uint32_t u32Idx = mapKeys.size();
+                    mapKeys.emplace(elem.first, u32Idx);
+                    PutVarint(strOut, 0);
+                    PutVarint(strOut, elem.first.size());
+                    strOut.append(elem.first);
+                }
+                else
+                {
+                    PutVarint(strOut, iter->second+1);
+                }
+                if (iDepth+1 == FIELD_DEPTH && (elem.second.is_structured() || elem.second.is_string()))
+                    EncodeField(elem.second, tRecord, strOut);
+                else
+                    EncodeValue(elem.second, tRecord, strOut, mapKeys, iDepth+1);
+            }
+            break;
+        }
+        case imgui_json::type_t::point:
+            strOut.push_back(TAG_POINT);
+            PutRaw(strOut, (int64_t)jnVal.get<imgui_json::point>());
+            break;
+        case imgui_json::type_t::vec2:
+        {
+            auto& v2Val = jnVal.get<imgui_json::vec2>();
+            strOut.push_back(TAG_VEC2);
+            PutRaw(strOut, v2Val.x); PutRaw(strOut, v2Val.y);
+            break;
+        }
+        case imgui_json::type_t::vec4:
+        {
+            auto& v4Val = jnVal.get<imgui_json::vec4>();
+            strOut.push_back(TAG_VEC4);
+            PutRaw(strOut, v4Val.x); PutRaw(strOut, v4Val.y); PutRaw(strOut, v4Val.z); PutRaw(strOut, v4Val.w);
+            break;
+        }
+        default:
+            strOut.push_back(TAG_DISCARDED);
+            break;
+        }
+    }
+
+    void EncodeField(const imgui_json::value& jnVal, Record& tRecord, string& strOut)
+    {
+        string strBytes;
+        unordered_map<string, uint32_t> mapKeys;
+        EncodeValue(jnVal, tRecord, strBytes, mapKeys, FIELD_DEPTH);
+        if (strBytes.size() < BLOB_MIN_SIZE)
+        {
+            strOut.push_back(TAG_EMBED);
+            PutVarint(strOut, strBytes.size());
+            strOut.append(strBytes);
+            return;
+        }
+
+        // find the base which shares the longest common prefix and suffix with this blob
+        const BaseBlob* pBestBase = nullptr;
+        size_t szBestPrefix = 0, szBestSuffix = 0;
+        for (auto& tBase : m_aBaseBlobs)
+        {
+            const auto& strBase = tBase.strBytes;
+            const size_t szMaxCommon = min(strBase.size(), strBytes.size());
+            size_t szPrefix = 0;
+            while (szPrefix < szMaxCommon && strBase[szPrefix] == strBytes[szPrefix])
+                szPrefix++;
+            size_t szSuffix = 0;
+            while (szSuffix < szMaxCommon-szPrefix && strBase[strBase.size()-1-szSuffix] == strBytes[strBytes.size()-1-szSuffix])
+                szSuffix++;
+            if (szPrefix+szSuffix > szBestPrefix+szBestSuffix)
+            {
+                pBestBase = &tBase;
+                szBestPrefix = szPrefix;
+                szBestSuffix = szSuffix;
+            }
+        }
+        if (pBestBase && szBestPrefix+szBestSuffix >= strBytes.size()/2)
+        {
+            const size_t szMidSize = strBytes.size()-szBestPrefix-szBestSuffix;
+            strOut.push_back(TAG_DELTA);
+            PutVarint(strOut, pBestBase->szRecordIdx);
+            PutVarint(strOut, pBestBase->u32BlobIdx);
+            PutVarint(strOut, szBestPrefix);
+            PutVarint(strOut, szBestSuffix);
+            PutVarint(strOut, szMidSize);
+            strOut.append(strBytes, szBestPrefix, szMidSize);
+            return;
+        }
+
+        // store the full blob, it becomes a delta base of the following blobs
+        strOut.push_back(TAG_BLOB);
+        PutVarint(strOut, strBytes.size());
+        tRecord.aBlobs.push_back({(uint32_t)strOut.size(), (uint32_t)strBytes.size()});
+        strOut.append(strBytes);
+        m_u64MemoryUsage += strBytes.size();
+        m_aBaseBlobs.push_back({m_aRecords.size(), (uint32_t)tRecord.aBlobs.size()-1, std::move(strBytes)});
+        if (m_aBaseBlobs.size() > MAX_BASE_BLOBS)
+        {
+            m_u64MemoryUsage -= m_aBaseBlobs.front().strBytes.size();
+            m_aBaseBlobs.pop_front();
+        }
+    }
+
+    bool DecodeValue(Reader& tReader, vector<string>& aKeys, imgui_json::value& jnVal)
+    {
+        const uint8_t u8Tag = tReader.GetByte();
+        switch (u8Tag)
+        {
+        case TAG_NULL:
+            jnVal = imgui_json::value();
+            break;
+        case TAG_FALSE:
+        case TAG_TRUE:
+            jnVal = imgui_json::boolean(u8Tag == TAG_TRUE);
+            break;
+        case TAG_INT:
+        {
+            const uint64_t u64Val = tReader.GetVarint();
+            jnVal = imgui_json::number((double)(int64_t)((u64Val>>1)^(~(u64Val&1)+1)));
+            break;
+        }
+        case TAG_NUMBER:
+            jnVal = imgui_json::number(tReader.GetRaw<double>());
+            break;
+        case TAG_STRING:
+        {
+            const size_t szLen = tReader.GetVarint();
+            auto p = tReader.GetBytes(szLen);
+            if (!p) return false;
+            jnVal = imgui_json::string(p, szLen);
+            break;
+        }
+        case TAG_ARRAY:
+        {
+            const size_t szCount = tReader.GetVarint();
+            if (tReader.bError || szCount > tReader.szSize) return false;
+            imgui_json::array aElems(szCount);
+            for (auto& jnElem : aElems)
+            {
+                if (!DecodeValue(tReader, aKeys, jnElem))
+                    return false;
+            }
+            jnVal = std::move(aElems);
+            break;
+        }
+        case TAG_OBJECT:
+        {
+            const size_t szCount = tReader.GetVarint();
+            imgui_json::object mapMembers;
+            for (size_t i = 0; i < szCount && !tReader.bError; i++)
+            {
+                const size_t szKeyRef = tReader.GetVarint();
+                if (szKeyRef == 0)
+                {
+                    const size_t szLen = tReader.GetVarint();
+                    auto p = tReader.GetBytes(szLen);
+                    if (!p) return false;
+                    aKeys.push_back(string(p, szLen));
+                }
+                else if (szKeyRef > aKeys.size())
+                {
+                    return false;
+                }
+                const string strKey = szKeyRef == 0 ? aKeys.back() : aKeys[szKeyRef-1];
+                if (!DecodeValue(tReader, aKeys, mapMembers[strKey]))
+                    return false;
+            }
+            jnVal = std::move(mapMembers);
+            break;
+        }
+        case TAG_POINT:
+            jnVal = imgui_json::point(tReader.GetRaw<int64_t>());
+            break;
+        case TAG_VEC2:
+        {
+            const float x = tReader.GetRaw<float>(), y = tReader.GetRaw<float>();
+            jnVal = imgui_json::vec2(x, y);
+            break;
+        }
+        case TAG_VEC4:
+        {
+            const float x = tReader.GetRaw<float>(), y = tReader.GetRaw<float>(), z = tReader.GetRaw<float>(), w = tReader.GetRaw<float>();
+            jnVal = imgui_json::vec4(x, y, z, w);
+            break;
+        }
+        case TAG_DISCARDED:
+            jnVal = imgui_json::value(imgui_json::type_t::discarded);
+            break;
+        case TAG_EMBED:
+        case TAG_BLOB:
+        {
+            const size_t szLen = tReader.GetVarint();
+            auto p = tReader.GetBytes(szLen);
+            if (!p) return false;
+            return DecodeBytes(p, szLen, jnVal);
+        }
+        case TAG_DELTA:
+        {
+            const size_t szRecordIdx = tReader.GetVarint();
+            const size_t szBlobIdx = tReader.GetVarint();
+            const size_t szPrefix = tReader.GetVarint();
+            const size_t szSuffix = tReader.GetVarint();
+            const size_t szMidSize = tReader.GetVarint();
+            auto pMid = tReader.GetBytes(szMidSize);
+            if (!pMid) return false;
+            string strBase;
+            if (!GetBlob(szRecordIdx, szBlobIdx, strBase) || szPrefix+szSuffix > strBase.size())
+            {
+                ostringstream oss; oss << "FAILED to get the delta base blob #" << szBlobIdx << " of history record #" << szRecordIdx << "!";
+                m_errMsg = oss.str();
+                return false;
+            }
+            string strBytes;
+            strBytes.reserve(szPrefix+szMidSize+szSuffix);
+            strBytes.append(strBase, 0, szPrefix);
+            strBytes.append(pMid, szMidSize);
+            strBytes.append(strBase, strBase.size()-szSuffix, szSuffix);
+            return DecodeBytes(strBytes.data(), strBytes.size(), jnVal);
+        }
+        default:
+            return false;
+        }
+        return !tReader.bError;
+    }
+
+    bool DecodeBytes(const char* pData, size_t szSize, imgui_json::value& jnVal)
+    {
+        Reader tReader {(const uint8_t*)pData, szSize};
+        vector<string> aKeys;
+        return DecodeValue(tReader, aKeys, jnVal) && tReader.szPos == szSize;
+    }
+
+    bool DecodeRecord(size_t szIdx, imgui_json::value& jnRecord)
+    {
+        string strData;
+        if (!GetRecordData(szIdx, strData))
+            return false;
+        if (!DecodeBytes(strData.data(), strData.size(), jnRecord))
+        {
+            if (m_errMsg.empty())
+            {
+                ostringstream oss; oss << "FAILED to decode history record #" << szIdx << "!";
+                m_errMsg = oss.str();
+            }
+            m_pLogger->Log(Error) << m_errMsg << endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool GetRecordData(size_t szIdx, string& strData)
+    {
+        if (szIdx >= m_aRecords.size())
+            return false;
+        auto& tRecord = m_aRecords[szIdx];
+        if (!tRecord.bSpilled)
+        {
+            strData = tRecord.strData;
+            return true;
+        }
+        strData.resize(tRecord.u32DataSize);
+        m_fsSpill.clear();
+        m_fsSpill.seekg(tRecord.u64SpillOffset);
+        m_fsSpill.read(&strData[0], strData.size());
+        if (!m_fsSpill.good())
+        {
+            ostringstream oss; oss << "FAILED to read history record #" << szIdx << " from spill file '" << m_strSpillPath << "'!";
+            m_errMsg = oss.str();
+            m_pLogger->Log(Error) << m_errMsg << endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool GetBlob(size_t szRecordIdx, size_t szBlobIdx, string& strBlob)
+    {
+        if (szRecordIdx >= m_aRecords.size() || szBlobIdx >= m_aRecords[szRecordIdx].aBlobs.size())
+            return false;
+        for (auto& tBase : m_aBaseBlobs)
+        {
+            if (tBase.szRecordIdx == szRecordIdx && tBase.u32BlobIdx == szBlobIdx)
+            {
+                strBlob = tBase.strBytes;
+                return true;
+            }
+        }
+        string strData;
+        if (!GetRecordData(szRecordIdx, strData))
+            return false;
+        const auto& tBlob = m_aRecords[szRecordIdx].aBlobs[szBlobIdx];
+        strBlob = strData.substr(tBlob.first, tBlob.second);
+        return true;
+    }
+
+    // Remove the records from index 'szIdx', the removed spilled records are always at the end of the spill file
+    void TruncateRecords(size_t szIdx)
+    {
+        if (szIdx >= m_aRecords.size())
+            return;
+        for (size_t i = szIdx; i < m_aRecords.size(); i++)
+        {
+            auto& tRecord = m_aRecords[i];
+            if (tRecord.bSpilled)
+            {
+                m_u64SpilledSize -= tRecord.u32DataSize;
+                m_u64SpillEnd = min(m_u64SpillEnd, tRecord.u64SpillOffset);
+            }
+            else
+            {
+                m_u64MemoryUsage -= tRecord.strData.size();
+            }
+        }
+        m_aRecords.resize(szIdx);
+        m_szFirstInMemory = min(m_szFirstInMemory, szIdx);
+        for (auto iter = m_aBaseBlobs.begin(); iter != m_aBaseBlobs.end();)
+        {
+            if (iter->szRecordIdx >= szIdx)
+            {
+                m_u64MemoryUsage -= iter->strBytes.size();
+                iter = m_aBaseBlobs.erase(iter);
+            }
+            else
+                iter++;
+        }
+    }
+
+    // Move the oldest records into the spill file until the memory usage is under the budget, the latest record always stays in memory
+    void SpillRecords()
+    {
+        while (m_u64MemoryUsage > m_u64MemoryBudget && m_szFirstInMemory+1 < m_aRecords.size())
+        {
+            if (!OpenSpillFile())
+                return;
+            auto& tRecord = m_aRecords[m_szFirstInMemory];
+            m_fsSpill.clear();
+            m_fsSpill.seekp(m_u64SpillEnd);
+            m_fsSpill.write(tRecord.strData.data(), tRecord.strData.size());
+            if (!m_fsSpill.good())
+            {
+                ostringstream oss; oss << "FAILED to write history record #" << m_szFirstInMemory << " into spill file '" << m_strSpillPath << "'!";
+                m_errMsg = oss.str();
+                m_pLogger->Log(Error) << m_errMsg << endl;
+                m_bSpillFailed = true;
+                return;
+            }
+            tRecord.bSpilled = true;
+            tRecord.u64SpillOffset = m_u64SpillEnd;
+            m_u64SpillEnd += tRecord.strData.size();
+            m_u64MemoryUsage -= tRecord.strData.size();
+            m_u64SpilledSize += tRecord.strData.size();
+            string().swap(tRecord.strData);
+            m_szFirstInMemory++;
+        }
+    }
+
+    bool OpenSpillFile()
+    {
+        if (m_fsSpill.is_open())
+            return true;
+        if (m_bSpillFailed)
+            return false;
+        if (m_strSpillDir.empty() || (!SysUtils::IsDirectory(m_strSpillDir) && !SysUtils::CreateDirectoryAt(m_strSpillDir, true)))
+        {
+            m_pLogger->Log(WARN) << "History spill directory '" << m_strSpillDir << "' is NOT available, the undo history is kept in memory." << endl;
+            m_bSpillFailed = true;
+            return false;
+        }
+        ostringstream oss;
+        oss << "history_" << (void*)this << "_" << chrono::steady_clock::now().time_since_epoch().count() << ".tmp";
+        m_strSpillPath = SysUtils::JoinPath(m_strSpillDir, oss.str());
+        m_fsSpill.open(fs::u8path(m_strSpillPath), ios::in|ios::out|ios::binary|ios::trunc);
+        if (!m_fsSpill.is_open())
+        {
+            ostringstream oss; oss << "FAILED to open history spill file '" << m_strSpillPath << "'!";
+            m_errMsg = oss.str();
+            m_pLogger->Log(Error) << m_errMsg << endl;
+            m_strSpillPath.clear();
+            m_bSpillFailed = true;
+            return false;
+        }
+        m_u64SpillEnd = 0;
+        return true;
+    }
+
+private:
+    ALogger* m_pLogger;
+    string m_errMsg;
+    string m_strSpillDir;
+    string m_strSpillPath;
+    fstream m_fsSpill;
+    bool m_bSpillFailed{false};
+    uint64_t m_u64SpillEnd{0};
+    uint64_t m_u64MemoryBudget;
+    uint64_t m_u64MemoryUsage{0};
+    uint64_t m_u64SpilledSize{0};
+    vector<Record> m_aRecords;
+    size_t m_szCurrPos{0};
+    size_t m_szFirstInMemory{0};
+    list<BaseBlob> m_aBaseBlobs;
+};
+
+HistoryStore::Holder HistoryStore::CreateInstance(const string& strSpillDir, uint64_t u64MemoryBudget)
+{
+    return HistoryStore::Holder(new HistoryStore_Impl(strSpillDir, u64MemoryBudget));
+}
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <memory>
+#include <imgui_json.h>
+#include <BaseUtils/Logger.h>
+
+namespace MEC
+{
+    // Undo history of the timeline. Records are kept in a compact binary encoding instead of json trees, the large values
+    // carried by the actions ('clip_json', 'track_json', blueprint documents, ...) are stored as deltas against the similar
+    // ones stored before, and the oldest records are spilled into a file under 'strSpillDir' once the memory used by the
+    // history exceeds the budget. The records after the current position are the redo ones.
+    struct HistoryStore
+    {
+        using Holder = std::shared_ptr<HistoryStore>;
+        // 'strSpillDir' is usually 'Project::GetCacheDir()', an empty one disables spilling
+        static Holder CreateInstance(const std::string& strSpillDir, uint64_t u64MemoryBudget = 64*1024*1024);
+
+        virtual void SetMemoryBudget(uint64_t u64Bytes) = 0;
+        virtual uint64_t GetMemoryBudget() const = 0;
+        // Append a record at the current position, the redo records are discarded
+        virtual bool AddRecord(const imgui_json::value& jnRecord) = 0;
+        // Step the current position backward and output the record to be undone
+        virtual bool Undo(imgui_json::value& jnRecord) = 0;
+        // Output the record to be redone and step the current position forward
+        virtual bool Redo(imgui_json::value& jnRecord) = 0;
+        virtual bool CanUndo() const = 0;
+        virtual bool CanRedo() const = 0;
+        virtual void Clear() = 0;
+
+        virtual size_t GetRecordCount() const = 0;
+        virtual uint64_t GetMemoryUsage() const = 0;
+        virtual uint64_t GetSpilledSize() const = 0;
+
+        virtual std::string GetError() const = 0;
+        virtual void SetLogLevel(Logger::Level l) = 0;
+    };
+}
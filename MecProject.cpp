@@ -1,4 +1,15 @@
 #include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <chrono>
+#include <climits>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#endif
 #include "imgui_helper.h"
 #include "BaseUtils/FileSystemUtils.h"
 #include "MecProject.h"
@@ -9,6 +20,183 @@ using namespace Logger;
 
 namespace MEC
 {
+// A snapshot of the project content taken on the UI thread, serialized and written by 'RunSaveJob()'
+struct Project::SaveJob
+{
+    bool bJournal{false};
+    std::string strFilePath;
+    imgui_json::value jnSkeleton;               // the project json with a placeholder string for each section
+    bool bUseSections{false};
+    bool abDirty[SECTION_COUNT]{false};
+    imgui_json::value ajnSections[SECTION_COUNT];
+    uint64_t au64Signatures[SECTION_COUNT]{0};
+    bool bRestartJournal{false};
+    void* pTlHandle{nullptr};                   // set if the timeline section is not serialized yet
+};
+
+const char* const Project::SECTION_NAMES[Project::SECTION_COUNT] = { "MediaBank", "TimeLine" };
+
+static const uint32_t JOURNAL_MAGIC = 0x4A43454D;              // 'MECJ'
+// only the last entry of each section is replayed, the journal is restarted when it holds several copies of the content
+static const uint64_t JOURNAL_RESTART_MIN_SIZE = 4*1024*1024;
+static const uint64_t JOURNAL_RESTART_ENTRY_RATIO = 4;
+static const int64_t TIMELINE_SAVE_SLICE_US = 4000;
+static const int TIMELINE_SAVE_MAX_RESTARTS = 3;
+
+static inline uint64_t FnvHash(uint64_t u64Hash, const void* pData, size_t szLen)
+{
+    auto pBytes = (const uint8_t*)pData;
+    for (size_t i = 0; i < szLen; i++)
+    {
+        u64Hash ^= pBytes[i];
+        u64Hash *= 0x100000001b3ULL;
+    }
+    return u64Hash;
+}
+
+template<typename T>
+static inline uint64_t FnvHash(uint64_t u64Hash, const T& val)
+{
+    return FnvHash(u64Hash, &val, sizeof(val));
+}
+
+static inline uint64_t FnvHash(uint64_t u64Hash, const string& str)
+{
+    u64Hash = FnvHash(u64Hash, str.size());
+    return FnvHash(u64Hash, str.data(), str.size());
+}
+
+static const uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ULL;
+
+// The signatures only cover the fields which are cheap to visit, they catch the structural changes made without 'MarkDirty()'.
+// The other edits (attributes, filters, blueprints, ...) are reported by the editor through 'MarkDirty()'.
+static uint64_t CalcMediaBankSignature(const MediaTimeline::TimeLine* pTl)
+{
+    auto u64Hash = FnvHash(FNV_OFFSET_BASIS, pTl->media_items.size());
+    for (const auto pItem : pTl->media_items)
+    {
+        u64Hash = FnvHash(u64Hash, pItem->mID);
+        u64Hash = FnvHash(u64Hash, pItem->mName);
+        u64Hash = FnvHash(u64Hash, pItem->mPath);
+        u64Hash = FnvHash(u64Hash, pItem->mMediaType);
+    }
+    return u64Hash;
+}
+
+static uint64_t CalcTimelineSignature(const MediaTimeline::TimeLine* pTl)
+{
+    auto u64Hash = FnvHash(FNV_OFFSET_BASIS, pTl->mStart);
+    u64Hash = FnvHash(u64Hash, pTl->mEnd);
+    u64Hash = FnvHash(u64Hash, pTl->m_Tracks.size());
+    for (const auto pTrack : pTl->m_Tracks)
+    {
+        u64Hash = FnvHash(u64Hash, pTrack->mID);
+        u64Hash = FnvHash(u64Hash, pTrack->mName);
+        u64Hash = FnvHash(u64Hash, pTrack->mTrackHeight);
+        u64Hash = FnvHash(u64Hash, pTrack->mLinkedTrack);
+        const uint8_t u8Flags = (pTrack->mExpanded ? 1 : 0) | (pTrack->mView ? 2 : 0) | (pTrack->mLocked ? 4 : 0);
+        u64Hash = FnvHash(u64Hash, u8Flags);
+        u64Hash = FnvHash(u64Hash, pTrack->m_Clips.size());
+        for (const auto pClip : pTrack->m_Clips)
+            u64Hash = FnvHash(u64Hash, pClip->mID);
+    }
+    u64Hash = FnvHash(u64Hash, pTl->m_Clips.size());
+    for (const auto pClip : pTl->m_Clips)
+    {
+        u64Hash = FnvHash(u64Hash, pClip->mID);
+        u64Hash = FnvHash(u64Hash, pClip->Start());
+        u64Hash = FnvHash(u64Hash, pClip->End());
+        u64Hash = FnvHash(u64Hash, pClip->StartOffset());
+        u64Hash = FnvHash(u64Hash, pClip->EndOffset());
+        u64Hash = FnvHash(u64Hash, pClip->mGroupID);
+    }
+    u64Hash = FnvHash(u64Hash, pTl->m_Overlaps.size());
+    for (const auto pOverlap : pTl->m_Overlaps)
+    {
+        u64Hash = FnvHash(u64Hash, pOverlap->mID);
+        u64Hash = FnvHash(u64Hash, pOverlap->mStart);
+        u64Hash = FnvHash(u64Hash, pOverlap->mEnd);
+    }
+    u64Hash = FnvHash(u64Hash, pTl->m_Groups.size());
+    for (const auto& group : pTl->m_Groups)
+    {
+        u64Hash = FnvHash(u64Hash, group.mID);
+        u64Hash = FnvHash(u64Hash, group.m_Grouped_Clips.size());
+    }
+    return u64Hash;
+}
+
+// Dump 'jnValue' as it would be dumped by 'imgui_json::value::dump(4)' as a member at nesting level 'iLevel'
+static string DumpAtLevel(const imgui_json::value& jnValue, int iLevel)
+{
+    const auto strDump = jnValue.dump(4);
+    const string strIndent(iLevel*4, ' ');
+    string strOut;
+    strOut.reserve(strDump.size()+strDump.size()/16);
+    size_t szLineStart = 0;
+    while (szLineStart < strDump.size())
+    {
+        auto szLineEnd = strDump.find('\n', szLineStart);
+        szLineEnd = szLineEnd == string::npos ? strDump.size() : szLineEnd+1;
+        strOut.append(strIndent);
+        strOut.append(strDump, szLineStart, szLineEnd-szLineStart);
+        szLineStart = szLineEnd;
+    }
+    return strOut;
+}
+
+static bool FlushFileToDisk(FILE* fp)
+{
+    if (fflush(fp) != 0)
+        return false;
+#if defined(_WIN32)
+    return _commit(_fileno(fp)) == 0;
+#else
+    return fsync(fileno(fp)) == 0;
+#endif
+}
+
+// Write the data into a temp file beside 'strFilePath', flush it to the disk and then rename it to replace the target file.
+// The target file is either the old one or the new one, it's never a partially written one.
+static bool WriteFileAtomically(const string& strFilePath, const string& strData, string& strErrMsg)
+{
+    const auto strTmpPath = strFilePath+".tmp";
+    auto fp = fopen(strTmpPath.c_str(), "wb");
+    if (!fp)
+    {
+        strErrMsg = "CANNOT open temp file '"+strTmpPath+"' for writing!";
+        return false;
+    }
+    bool bSucc = fwrite(strData.data(), 1, strData.size(), fp) == strData.size();
+    bSucc = FlushFileToDisk(fp) && bSucc;
+    bSucc = fclose(fp) == 0 && bSucc;
+    if (!bSucc)
+    {
+        strErrMsg = "FAILED to write temp file '"+strTmpPath+"'!";
+        SysUtils::DeleteFileAt(strTmpPath);
+        return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(strTmpPath, strFilePath, ec);
+    if (ec)
+    {
+        strErrMsg = "FAILED to rename '"+strTmpPath+"' to '"+strFilePath+"'! "+ec.message();
+        SysUtils::DeleteFileAt(strTmpPath);
+        return false;
+    }
+#if !defined(_WIN32)
+    // make the rename durable
+    const auto strDirPath = SysUtils::ExtractDirectoryPath(strFilePath);
+    const int fdDir = open(strDirPath.empty() ? "." : strDirPath.c_str(), O_RDONLY);
+    if (fdDir >= 0)
+    {
+        fsync(fdDir);
+        close(fdDir);
+    }
+#endif
+    return true;
+}
+
 ALogger* Project::GetDefaultLogger()
 {
     return GetLogger("MecProject");
@@ -188,6 +376,17 @@ Project::Project(const string& projName, const string& projDir, const string& me
         throw runtime_error("FAILED to save mec project");
 }
 
+Project::~Project()
+{
+    {
+        lock_guard<mutex> _lk(m_mtxSaveLock);
+        m_bQuitSaveWorker = true;
+    }
+    m_cvSave.notify_all();
+    if (m_thSaveWorker.joinable())
+        m_thSaveWorker.join();
+}
+
 string Project::GetCacheDir()
 {
     if (!s_CACHEDIR.empty())
@@ -244,6 +443,7 @@ Project::ErrorCode Project::Move(const string& newProjDir, bool overwrite)
         return NOT_OPENED;
     if (m_projDir == newProjDir)
         return Save();
+    WaitSaveDone();
     if (overwrite && SysUtils::IsDirectory(newProjDir))
     {
         if (!SysUtils::DeleteDirectoryAt(newProjDir))
@@ -280,6 +480,7 @@ Project::ErrorCode Project::Load(const string& projFilePath)
             return errcode;
         }
     }
+    WaitSaveDone();
     if (!SysUtils::IsFile(projFilePath))
     {
         m_pLogger->Log(Error) << "FAILED to load project from '" << projFilePath << "'! Target is NOT a file." << endl;
@@ -328,8 +529,8 @@ Project::ErrorCode Project::Load(const string& projFilePath)
                         {
                             hTask->SetCallbacks(this);
                             hTask->Pause();
-                            if (m_hBgtaskExctor)
-                                if (!m_hBgtaskExctor->EnqueueTask(hTask))
+                            if (m_hBgtaskScheduler)
+                                if (!m_hBgtaskScheduler->EnqueueTask(hTask))
                                     m_pLogger->Log(Error) << "FAILED to enqueue background task from json '" << strTaskJsonPath << "'!" << endl;
                             m_aBgtasks.push_back(hTask);
                         }
@@ -354,13 +555,24 @@ Project::ErrorCode Project::Load(const string& projFilePath)
         m_projName = SysUtils::ExtractFileBaseName(projFilePath);
     }
     m_projFilePath = projFilePath;
+    const auto strJournalPath = GetJournalPath();
+    if (SysUtils::IsFile(strJournalPath))
+        ReplayJournal(strJournalPath);
+    // the content is reloaded, the next save and autosave serialize all the sections
+    for (auto& tCache : m_aSectionCaches)
+        tCache = SectionCache();
+    for (auto& bValid : m_abJournalValid)
+        bValid = false;
+    m_bRestartJournal = true;
+    m_u32DirtySections = SECTION_ALL;
+    m_u32JournalDirtySections = SECTION_ALL;
     m_bOpened = true;
     return OK;
 }
 
-Project::ErrorCode Project::Save()
+Project::ErrorCode Project::Save(bool bBackground)
 {
-    return SaveTo(m_projFilePath);
+    return SaveTo(m_projFilePath, bBackground);
 }
 
 Project::ErrorCode Project::SaveAs(const string& newProjName, const string& newProjDir, bool overwrite)
@@ -388,6 +600,8 @@ Project::ErrorCode Project::SaveAs(const string& newProjName, const string& newP
         m_pLogger->Log(Error) << "FAILED to create new project at '" << newProjDir << "', CANNOT create the project directory!" << endl;
         return MKDIR_FAILED;
     }
+    // the unsaved changes go to the new project, the journal of the old one is obsolete
+    DiscardJournal();
     m_projName = newProjName;
     m_projDir = newProjDir;
     m_projFilePath = SysUtils::JoinPath(m_projDir, m_projName+s_PROJ_FILE_EXT);
@@ -395,41 +609,155 @@ Project::ErrorCode Project::SaveAs(const string& newProjName, const string& newP
     return Save();
 }
 
-Project::ErrorCode Project::SaveTo(const string& projFilePath)
+Project::ErrorCode Project::SaveTo(const string& projFilePath, bool bBackground)
+{
+    lock_guard<recursive_mutex> _lk(m_mtxApiLock);
+    if (!m_bOpened)
+        return NOT_OPENED;
+    // the section caches are owned by the pending job
+    WaitSaveDone();
+    ApplyJournalFailure();
+
+    auto hJob = CreateSaveJob(projFilePath);
+    if (hJob->bUseSections)
+    {
+        const auto u32Dirty = m_u32DirtySections.exchange(0);
+        m_u32JournalDirtySections = 0;
+        uint64_t au64LastSignatures[SECTION_COUNT];
+        bool abLastValid[SECTION_COUNT];
+        for (int i = 0; i < SECTION_COUNT; i++)
+        {
+            au64LastSignatures[i] = m_aSectionCaches[i].u64Signature;
+            abLastValid[i] = m_aSectionCaches[i].bValid;
+        }
+        SnapshotSections(*hJob, u32Dirty, au64LastSignatures, abLastValid);
+        // the journal restarts from the saved content
+        for (int i = 0; i < SECTION_COUNT; i++)
+        {
+            m_au64JournalSignatures[i] = hJob->au64Signatures[i];
+            m_abJournalValid[i] = true;
+        }
+        m_bRestartJournal = true;
+    }
+    if (bBackground)
+        return QueueSaveJob(hJob);
+    const auto ec = RunSaveJob(*hJob);
+    lock_guard<mutex> _lk2(m_mtxSaveLock);
+    m_eLastSaveResult = ec;
+    return ec;
+}
+
+Project::ErrorCode Project::WaitSaveDone()
+{
+    unique_lock<mutex> _lk(m_mtxSaveLock);
+    WaitSaveWorkerIdle(_lk);
+    return m_eLastSaveResult;
+}
+
+bool Project::TakeSaveResult(ErrorCode& ec)
+{
+    lock_guard<mutex> _lk(m_mtxSaveLock);
+    if (!m_bSaveResultUnread)
+        return false;
+    m_bSaveResultUnread = false;
+    ec = m_eLastSaveResult;
+    return true;
+}
+
+bool Project::IsSaving()
+{
+    lock_guard<mutex> _lk(m_mtxSaveLock);
+    return m_hSaveJob != nullptr && !m_hSaveJob->bJournal;
+}
+
+Project::ErrorCode Project::AutoSave()
 {
     lock_guard<recursive_mutex> _lk(m_mtxApiLock);
     if (!m_bOpened)
         return NOT_OPENED;
+    if (!m_pTlHandle)
+        return OK;
+    {
+        lock_guard<mutex> _lk2(m_mtxSaveLock);
+        if (m_hSaveJob)
+            return NOT_READY;
+    }
+    ApplyJournalFailure();
+
+    auto hJob = make_shared<SaveJob>();
+    hJob->bJournal = true;
+    hJob->strFilePath = GetJournalPath();
+    bool bRestart = m_bRestartJournal;
+    if (!bRestart && SysUtils::IsFile(hJob->strFilePath))
+    {
+        std::error_code ec;
+        const auto u64JournalSize = std::filesystem::file_size(hJob->strFilePath, ec);
+        const uint64_t u64RestartSize = std::max(JOURNAL_RESTART_MIN_SIZE, m_u64LastJournalEntrySize.load()*JOURNAL_RESTART_ENTRY_RATIO);
+        if (!ec && u64JournalSize > u64RestartSize)
+        {
+            // the journal is replayed on the saved project file, a truncated one must hold all the sections
+            for (auto& bValid : m_abJournalValid)
+                bValid = false;
+            bRestart = true;
+        }
+    }
+    const auto u32Dirty = m_u32JournalDirtySections.exchange(0);
+    if (!SnapshotSections(*hJob, u32Dirty, m_au64JournalSignatures, m_abJournalValid))
+        return OK;
+    hJob->bRestartJournal = bRestart;
+    for (int i = 0; i < SECTION_COUNT; i++)
+    {
+        m_au64JournalSignatures[i] = hJob->au64Signatures[i];
+        m_abJournalValid[i] = true;
+    }
+    m_bRestartJournal = false;
+    return QueueSaveJob(hJob);
+}
 
-    imgui_json::value jnProj;
+void Project::ApplyJournalFailure()
+{
+    // the journal state is only touched under the api lock, the save worker reports a failure through 'm_bJournalFailed'
+    if (!m_bJournalFailed.exchange(false))
+        return;
+    for (auto& bValid : m_abJournalValid)
+        bValid = false;
+    m_bRestartJournal = true;
+}
+
+void Project::DiscardJournal()
+{
+    lock_guard<recursive_mutex> _lk(m_mtxApiLock);
+    WaitSaveDone();
+    if (m_projFilePath.empty())
+        return;
+    const auto strJournalPath = GetJournalPath();
+    if (SysUtils::IsFile(strJournalPath) && !SysUtils::DeleteFileAt(strJournalPath))
+        m_pLogger->Log(WARN) << "CANNOT delete the journal file at '" << strJournalPath << "'!" << endl;
+    m_bRestartJournal = true;
+}
+
+shared_ptr<Project::SaveJob> Project::CreateSaveJob(const string& projFilePath)
+{
+    auto hJob = make_shared<SaveJob>();
+    hJob->strFilePath = projFilePath;
+    auto& jnProj = hJob->jnSkeleton;
     jnProj["mec_proj_version"] = imgui_json::number(m_projVer);
     if (!m_bUntitled)
         jnProj["proj_name"] = imgui_json::string(m_projName);
 
     if (m_pTlHandle)
     {
-        MediaTimeline::TimeLine* pTl = (MediaTimeline::TimeLine*)m_pTlHandle;
-        // save media items
-        imgui_json::array aMediaItems;
-        for (auto media : pTl->media_items)
-        {
-            imgui_json::value item;
-            item["id"] = imgui_json::number(media->mID);
-            item["name"] = media->mName;
-            item["path"] = media->mPath;
-            item["type"] = imgui_json::number(media->mMediaType);
-            item["meta_data"] = media->mMetaData;
-            aMediaItems.push_back(item);
-        }
+        // the sections are dumped by the save worker and filled in place of the placeholders
         imgui_json::value jnProjContent;
-        jnProjContent["MediaBank"] = aMediaItems;
-        // save timeline
-        imgui_json::value jnTimeLine;
-        pTl->Save(jnTimeLine);
-        jnProjContent["TimeLine"] = jnTimeLine;
-        m_jnProjContent = std::move(jnProjContent);
+        for (int i = 0; i < SECTION_COUNT; i++)
+            jnProjContent[SECTION_NAMES[i]] = imgui_json::string(string("@@MEC_SECTION_")+SECTION_NAMES[i]+"@@");
+        jnProj["proj_content"] = jnProjContent;
+        hJob->bUseSections = true;
+    }
+    else
+    {
+        jnProj["proj_content"] = m_jnProjContent;
     }
-    jnProj["proj_content"] = m_jnProjContent;
 
     // save background tasks
     imgui_json::array aTaskSavePaths;
@@ -439,19 +767,305 @@ Project::ErrorCode Project::SaveTo(const string& projFilePath)
         aTaskSavePaths.push_back(strTaskSavePath);
     }
     jnProj["bg_tasks"] = aTaskSavePaths;
-    if (!jnProj.save(projFilePath))
+    return hJob;
+}
+
+bool Project::SnapshotSections(SaveJob& tJob, uint32_t u32DirtySections, const uint64_t au64LastSignatures[], const bool abLastValid[])
+{
+    MediaTimeline::TimeLine* pTl = (MediaTimeline::TimeLine*)m_pTlHandle;
+    bool bHasDirty = false;
+    for (int i = 0; i < SECTION_COUNT; i++)
+    {
+        const auto u64Signature = i == 0 ? CalcMediaBankSignature(pTl) : CalcTimelineSignature(pTl);
+        const bool bDirty = (u32DirtySections&(1U<<i)) != 0 || !abLastValid[i] || u64Signature != au64LastSignatures[i];
+        tJob.au64Signatures[i] = u64Signature;
+        tJob.abDirty[i] = bDirty;
+        if (!bDirty)
+            continue;
+        bHasDirty = true;
+        auto& jnSection = tJob.ajnSections[i];
+        if (i == 0)
+        {
+            // save media items
+            imgui_json::array aMediaItems;
+            for (auto media : pTl->media_items)
+            {
+                imgui_json::value item;
+                item["id"] = imgui_json::number(media->mID);
+                item["name"] = media->mName;
+                item["path"] = media->mPath;
+                item["type"] = imgui_json::number(media->mMediaType);
+                item["meta_data"] = media->mMetaData;
+                aMediaItems.push_back(item);
+            }
+            jnSection = std::move(aMediaItems);
+        }
+        else
+        {
+            // the editing items are synced here on the UI thread, the timeline is serialized by 'RunSaveJob()'
+            pTl->SyncEditingItems();
+            tJob.pTlHandle = pTl;
+        }
+    }
+    return bHasDirty;
+}
+
+void Project::LockContent()
+{
+    s_bContentLockWanted = true;
+    s_mtxContentLock.lock();
+    s_bContentLockWanted = false;
+    s_tidContentOwner = this_thread::get_id();
+}
+
+void Project::UnlockContent()
+{
+    s_tidContentOwner = thread::id();
+    s_mtxContentLock.unlock();
+}
+
+void Project::SerializeTimelineSection(SaveJob& tJob)
+{
+    auto pTl = (MediaTimeline::TimeLine*)tJob.pTlHandle;
+    tJob.pTlHandle = nullptr;
+    auto& jnSection = tJob.ajnSections[1];
+    imgui_json::array aClips;
+    if (s_tidContentOwner.load() == this_thread::get_id())
+    {
+        // a blocking save on the UI thread
+        pTl->SaveClips(aClips, 0, INT64_MAX);
+        pTl->SaveExceptClips(jnSection);
+    }
+    else
+    {
+        // serialize the clips in slices and let the editor run between them. If the timeline is edited in between, the
+        // serialization restarts, after too many restarts the rest is done in one slice.
+        int iRestarts = 0, iSlices = 0;
+        size_t szNextClip = 0;
+        uint64_t u64Generation = 0, u64Signature = 0;
+        int64_t i64LockWaitUs = 0;
+        while (true)
+        {
+            const int64_t i64WaitStartUs = (int64_t)ImGui::get_current_time_usec();
+            {
+                lock_guard<mutex> _lk(s_mtxContentLock);
+                i64LockWaitUs += (int64_t)ImGui::get_current_time_usec()-i64WaitStartUs;
+                iSlices++;
+                const uint64_t u64CurrGeneration = m_u64ContentGeneration;
+                const auto u64CurrSignature = CalcTimelineSignature(pTl);
+                if (szNextClip > 0 && (u64CurrGeneration != u64Generation || u64CurrSignature != u64Signature))
+                {
+                    aClips.clear();
+                    szNextClip = 0;
+                    iRestarts++;
+                }
+                if (szNextClip == 0)
+                {
+                    u64Generation = u64CurrGeneration;
+                    u64Signature = u64CurrSignature;
+                }
+                const int64_t i64DeadlineUs = iRestarts >= TIMELINE_SAVE_MAX_RESTARTS ? INT64_MAX : (int64_t)ImGui::get_current_time_usec()+TIMELINE_SAVE_SLICE_US;
+                szNextClip = pTl->SaveClips(aClips, szNextClip, i64DeadlineUs);
+                if (szNextClip >= pTl->m_Clips.size())
+                {
+                    pTl->SaveExceptClips(jnSection);
+                    break;
+                }
+            }
+            // 'std::mutex' is not fair, hand the lock over if the editor is waiting for it
+            while (s_bContentLockWanted)
+                this_thread::sleep_for(chrono::microseconds(100));
+        }
+        // the editor holds the content lock for a whole frame, so the wait is about one frame per slice
+        m_pLogger->Log(DEBUG) << "Serialized " << aClips.size() << " clip(s) in " << iSlices << " slice(s) with " << iRestarts
+                << " restart(s), waited " << i64LockWaitUs/1000 << "ms for the content lock." << endl;
+    }
+    if (!aClips.empty())
+        jnSection["MediaClip"] = std::move(aClips);
+}
+
+void Project::WaitSaveWorkerIdle(unique_lock<mutex>& lk)
+{
+    if (!m_hSaveJob)
+        return;
+    // the pending job may need the content lock to serialize the timeline, release it while waiting
+    const bool bOwnContent = s_tidContentOwner.load() == this_thread::get_id();
+    if (bOwnContent)
+        UnlockContent();
+    m_cvSave.wait(lk, [this] { return m_hSaveJob == nullptr; });
+    if (bOwnContent)
     {
-        m_pLogger->Log(Error) << "FAILED to save project json file at '" << projFilePath << "'!" << endl;
+        lk.unlock();
+        LockContent();
+        lk.lock();
+    }
+}
+
+Project::ErrorCode Project::QueueSaveJob(shared_ptr<SaveJob> hJob)
+{
+    unique_lock<mutex> _lk(m_mtxSaveLock);
+    WaitSaveWorkerIdle(_lk);
+    if (!m_thSaveWorker.joinable())
+    {
+        m_thSaveWorker = thread(&Project::_SaveProc, this);
+        SysUtils::SetThreadName(m_thSaveWorker, "MecProjSave");
+    }
+    m_hSaveJob = hJob;
+    m_cvSave.notify_all();
+    return OK;
+}
+
+Project::ErrorCode Project::RunSaveJob(SaveJob& tJob)
+{
+    if (tJob.pTlHandle)
+        SerializeTimelineSection(tJob);
+    string strErrMsg;
+    if (tJob.bJournal)
+    {
+        // each journal entry is a header of 4 uint32 (magic, section index, data size, data checksum) followed by the compact json
+        string strEntries;
+        for (int i = 0; i < SECTION_COUNT; i++)
+        {
+            if (!tJob.abDirty[i])
+                continue;
+            const auto strData = tJob.ajnSections[i].dump();
+            const uint32_t au32Header[4] = { JOURNAL_MAGIC, (uint32_t)i, (uint32_t)strData.size(), (uint32_t)FnvHash(FNV_OFFSET_BASIS, strData.data(), strData.size()) };
+            strEntries.append((const char*)au32Header, sizeof(au32Header));
+            strEntries.append(strData);
+        }
+        const int64_t i64WriteStartUs = (int64_t)ImGui::get_current_time_usec();
+        auto fp = fopen(tJob.strFilePath.c_str(), tJob.bRestartJournal ? "wb" : "ab");
+        bool bSucc = fp != nullptr;
+        if (fp)
+        {
+            bSucc = fwrite(strEntries.data(), 1, strEntries.size(), fp) == strEntries.size();
+            bSucc = FlushFileToDisk(fp) && bSucc;
+            bSucc = fclose(fp) == 0 && bSucc;
+        }
+        if (!bSucc)
+        {
+            m_pLogger->Log(Error) << "FAILED to write project journal at '" << tJob.strFilePath << "'!" << endl;
+            m_bJournalFailed = true;
+            return IO_ERROR;
+        }
+        m_u64LastJournalEntrySize = strEntries.size();
+        m_pLogger->Log(DEBUG) << (tJob.bRestartJournal ? "Restarted" : "Appended") << " the project journal with " << strEntries.size()
+                << " bytes in " << ((int64_t)ImGui::get_current_time_usec()-i64WriteStartUs)/1000 << "ms." << endl;
+        return OK;
+    }
+
+    string strOut = tJob.jnSkeleton.dump(4);
+    if (tJob.bUseSections)
+    {
+        for (int i = 0; i < SECTION_COUNT; i++)
+        {
+            auto& tCache = m_aSectionCaches[i];
+            if (tJob.abDirty[i])
+            {
+                // 'proj_content' sections are at nesting level 2 of the project json
+                const auto& jnSection = tJob.ajnSections[i];
+                tCache.bStructured = jnSection.is_object() || jnSection.is_array();
+                tCache.strBytes = tCache.bStructured ? DumpAtLevel(jnSection, 2) : jnSection.dump(4);
+                tCache.u64Signature = tJob.au64Signatures[i];
+                tCache.bValid = true;
+                tJob.ajnSections[i] = nullptr;
+            }
+            const auto strPlaceholder = string("\"@@MEC_SECTION_")+SECTION_NAMES[i]+"@@\"";
+            const auto szPos = strOut.find(strPlaceholder);
+            if (szPos == string::npos || szPos == 0)
+            {
+                m_pLogger->Log(Error) << "FAILED to save project, the placeholder of section '" << SECTION_NAMES[i] << "' is missing!" << endl;
+                tCache.bValid = false;
+                return FAILED;
+            }
+            // replace the ' ' between the key and the placeholder too, a structured member starts at a new line
+            strOut.replace(szPos-1, strPlaceholder.size()+1, (tCache.bStructured ? "\n" : " ")+tCache.strBytes);
+        }
+    }
+    if (!WriteFileAtomically(tJob.strFilePath, strOut, strErrMsg))
+    {
+        m_pLogger->Log(Error) << "FAILED to save project json file at '" << tJob.strFilePath << "'! " << strErrMsg << endl;
+        m_bJournalFailed = true;
         return FAILED;
     }
+    {
+        // the saved content includes all the changes kept in the journal
+        const auto strJournalPath = tJob.strFilePath+".journal";
+        if (SysUtils::IsFile(strJournalPath) && !SysUtils::DeleteFileAt(strJournalPath))
+            m_pLogger->Log(WARN) << "CANNOT delete the journal file at '" << strJournalPath << "'!" << endl;
+    }
     return OK;
 }
 
+void Project::ReplayJournal(const string& strJournalPath)
+{
+    auto fp = fopen(strJournalPath.c_str(), "rb");
+    if (!fp)
+    {
+        m_pLogger->Log(WARN) << "CANNOT open the journal file at '" << strJournalPath << "'!" << endl;
+        return;
+    }
+    // the entries are applied in order, the last complete entry of a section wins. A torn entry at the tail is ignored.
+    imgui_json::value ajnSections[SECTION_COUNT];
+    bool abReplayed[SECTION_COUNT]{false};
+    int iEntryCount = 0;
+    uint32_t au32Header[4];
+    string strData;
+    while (fread(au32Header, sizeof(au32Header), 1, fp) == 1)
+    {
+        if (au32Header[0] != JOURNAL_MAGIC || au32Header[1] >= (uint32_t)SECTION_COUNT)
+            break;
+        strData.resize(au32Header[2]);
+        if (au32Header[2] > 0 && fread(&strData[0], 1, au32Header[2], fp) != au32Header[2])
+            break;
+        if ((uint32_t)FnvHash(FNV_OFFSET_BASIS, strData.data(), strData.size()) != au32Header[3])
+            break;
+        auto jnSection = imgui_json::value::parse(strData);
+        if (jnSection.is_discarded())
+            break;
+        ajnSections[au32Header[1]] = std::move(jnSection);
+        abReplayed[au32Header[1]] = true;
+        iEntryCount++;
+    }
+    fclose(fp);
+    if (iEntryCount == 0)
+        return;
+    for (int i = 0; i < SECTION_COUNT; i++)
+    {
+        if (abReplayed[i])
+            m_jnProjContent[SECTION_NAMES[i]] = std::move(ajnSections[i]);
+    }
+    m_pLogger->Log(WARN) << "Project '" << m_projName << "' was not saved normally, recovered " << iEntryCount << " autosaved change(s) from '" << strJournalPath << "'." << endl;
+}
+
+void Project::_SaveProc()
+{
+    unique_lock<mutex> _lk(m_mtxSaveLock);
+    while (true)
+    {
+        m_cvSave.wait(_lk, [this] { return m_bQuitSaveWorker || m_hSaveJob != nullptr; });
+        if (!m_hSaveJob)
+            break;
+        auto hJob = m_hSaveJob;
+        _lk.unlock();
+        const auto ec = RunSaveJob(*hJob);
+        _lk.lock();
+        if (!hJob->bJournal)
+        {
+            m_eLastSaveResult = ec;
+            m_bSaveResultUnread = true;
+        }
+        m_hSaveJob = nullptr;
+        m_cvSave.notify_all();
+    }
+}
+
 Project::ErrorCode Project::Close(bool bSaveBeforeClose)
 {
     lock_guard<recursive_mutex> _lk(m_mtxApiLock);
     if (!m_bOpened)
         return OK;
+    WaitSaveDone();
     list<BackgroundTask::Holder> aBgtaskList;
     {
         lock_guard<mutex> _lk2(m_mtxBgtaskLock);
@@ -469,6 +1083,12 @@ Project::ErrorCode Project::Close(bool bSaveBeforeClose)
             return errcode;
         }
     }
+    else
+    {
+        DiscardJournal();
+    }
+    for (auto& tCache : m_aSectionCaches)
+        tCache = SectionCache();
     m_jnProjContent = nullptr;
     m_projDir.clear();
     m_projName.clear();
@@ -500,15 +1120,20 @@ Project::ErrorCode Project::Delete()
 void Project::SetBgtaskExecutor(SysUtils::ThreadPoolExecutor::Holder hBgtaskExctor)
 {
     lock_guard<recursive_mutex> _lk(m_mtxApiLock);
-    m_hBgtaskExctor = hBgtaskExctor;
+    if (m_hBgtaskScheduler)
+    {
+        m_hBgtaskScheduler->Terminate();
+        m_hBgtaskScheduler = nullptr;
+    }
     if (!hBgtaskExctor)
         return;
+    m_hBgtaskScheduler = BackgroundTaskScheduler::CreateInstance(hBgtaskExctor);
     lock_guard<mutex> _lk2(m_mtxBgtaskLock);
     for (auto& hTask : m_aBgtasks)
     {
         if (hTask->IsWaiting())
         {
-            if (!hBgtaskExctor->EnqueueTask(hTask))
+            if (!m_hBgtaskScheduler->EnqueueTask(hTask))
                 m_pLogger->Log(Error) << "Enqueue background task FAILED!" << endl;
         }
     }
@@ -524,6 +1149,7 @@ Project::ErrorCode Project::ChangeProjectName(const string& newName)
     if (m_projName == newName)
         return OK;
     m_projName = newName;
+    WaitSaveDone();
     auto newProjFilePath = SysUtils::JoinPath(m_projDir, newName+s_PROJ_FILE_EXT);
     auto ec = SaveTo(newProjFilePath);
     if (ec != OK)
@@ -532,6 +1158,9 @@ Project::ErrorCode Project::ChangeProjectName(const string& newName)
     if (SysUtils::IsFile(newProjFilePath))
         if (!SysUtils::DeleteFileAt(newProjFilePath))
             m_pLogger->Log(WARN) << "CANNOT delete the old project file at '" << newProjFilePath << "'!" << endl;
+    const auto strOldJournalPath = newProjFilePath+".journal";
+    if (SysUtils::IsFile(strOldJournalPath))
+        SysUtils::DeleteFileAt(strOldJournalPath);
     m_bUntitled = false;
     return OK;
 }
@@ -541,12 +1170,12 @@ Project::ErrorCode Project::EnqueueBackgroundTask(BackgroundTask::Holder hTask)
     lock_guard<recursive_mutex> _lk(m_mtxApiLock);
     if (!m_bOpened)
         return NOT_OPENED;
-    if (!m_hBgtaskExctor)
+    if (!m_hBgtaskScheduler)
     {
         m_pLogger->Log(Error) << "Current MEC::Project instance has NOT been set with background task executor!" << endl;
         return NOT_READY;
     }
-    if (!m_hBgtaskExctor->EnqueueTask(hTask))
+    if (!m_hBgtaskScheduler->EnqueueTask(hTask))
     {
         m_pLogger->Log(Error) << "Enqueue background task FAILED!" << endl;
         return FAILED;
@@ -573,6 +1202,8 @@ Project::ErrorCode Project::RemoveBackgroundTask(BackgroundTask::Holder hTask, b
     if (itRem == m_aBgtasks.end())
         return INVALID_ARG;
     m_aBgtasks.erase(itRem);
+    if (m_hBgtaskScheduler)
+        m_hBgtaskScheduler->RemoveTask(hTask);
     if (bRemoveTaskDir)
     {
         const auto strTaskDir = hTask->GetTaskDir();
@@ -603,7 +1234,10 @@ bool Project::OnOutputMediaItemMetaData(const std::string& fileUrl, const std::s
     if (!m_pTlHandle)
         return false;
     MediaTimeline::TimeLine* pTl = (MediaTimeline::TimeLine*)m_pTlHandle;
-    return pTl->UpdateMediaItemMetaData(fileUrl, metaName, metaValue);
+    const bool bUpdated = pTl->UpdateMediaItemMetaData(fileUrl, metaName, metaValue);
+    if (bUpdated)
+        MarkDirty(SECTION_MEDIA_BANK);
+    return bUpdated;
 }
 
 const imgui_json::value& Project::OnCheckMediaItemMetaData(const std::string& fileUrl, const std::string& metaName)
@@ -621,6 +1255,9 @@ const string Project::UNTITLED_PROJECT_NAME = "Untitled";
 
 string Project::s_PROJ_FILE_EXT = ".mep";
 string Project::s_CACHEDIR;
+mutex Project::s_mtxContentLock;
+atomic<thread::id> Project::s_tidContentOwner;
+atomic_bool Project::s_bContentLockWanted{false};
 
 string Project::TryCacheDirPath(const string& strParentDir, const string& strCacheDirName)
 {
@@ -3,6 +3,9 @@
 #include <string>
 #include <memory>
 #include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
 #include <list>
 #include <vector>
 #include <imgui_json.h>
@@ -49,14 +52,49 @@ public:
     static std::string GetCacheDir();
     static ErrorCode SetCacheDir(const std::string& path);
 
+    ~Project();
+
+    // The sections of the project content which are serialized separately. A section which is not marked dirty and whose
+    // signature is unchanged reuses the bytes serialized by the previous save.
+    enum SaveSection : uint32_t
+    {
+        SECTION_MEDIA_BANK  = 0x1,
+        SECTION_TIMELINE    = 0x2,
+        SECTION_ALL         = 0x3,
+    };
+    void MarkDirty(uint32_t u32Sections) { m_u32DirtySections.fetch_or(u32Sections); m_u32JournalDirtySections.fetch_or(u32Sections); m_u64ContentGeneration++; }
+
+    // The content is edited by the UI thread while it holds the content lock, i.e. during a frame of the editor. The save worker
+    // serializes the timeline under this lock in short slices, so the editor is blocked by one slice at most.
+    static void LockContent();
+    static void UnlockContent();
+    struct ContentLockGuard
+    {
+        ContentLockGuard() { LockContent(); }
+        ~ContentLockGuard() { UnlockContent(); }
+    };
+
     ErrorCode Move(const std::string& newProjDir, bool overwrite = false);
     ErrorCode Load(const std::string& mepFilePath);
-    ErrorCode Save();
+    // The content is snapshot on the calling thread. With 'bBackground' the serialization and the file writing are done on the
+    // save worker thread, and the returned code only tells whether the save is queued, use 'WaitSaveDone()' to get the result.
+    // The project file is written into a temp file which replaces the old one after it's flushed to the disk.
+    ErrorCode Save(bool bBackground = false);
     ErrorCode SaveAs(const std::string& newProjName, const std::string& newProjDir, bool overwrite = false);
-    ErrorCode SaveTo(const std::string& projFilePath);
+    ErrorCode SaveTo(const std::string& projFilePath, bool bBackground = false);
+    ErrorCode WaitSaveDone();
+    // Returns true once for each finished background save, with its result in 'ec'. To be polled by the UI thread, a failed save
+    // leaves the changes unsaved.
+    bool TakeSaveResult(ErrorCode& ec);
+    bool IsSaving();
+    // Append the sections changed since the last save or autosave to the journal beside the project file. It's replayed by 'Load()'
+    // if the project is not saved or closed normally. Returns NOT_READY without doing anything if a save is in progress.
+    ErrorCode AutoSave();
+    void DiscardJournal();
     ErrorCode Close(bool bSaveBeforeClose = true);
     ErrorCode Delete();
     void SetBgtaskExecutor(SysUtils::ThreadPoolExecutor::Holder hBgtaskExctor);
+    BackgroundTaskScheduler::Holder GetBgtaskScheduler() const { return m_hBgtaskScheduler; }
     std::string GetProjectName() const { return m_projName; }
     ErrorCode ChangeProjectName(const std::string& newName);
     std::string GetProjectDir() const { return m_projDir; }
@@ -88,8 +126,25 @@ protected:
     void SetUntitled() { m_bUntitled = true; }
 
     static std::string s_CACHEDIR;
+    static std::mutex s_mtxContentLock;
+    static std::atomic<std::thread::id> s_tidContentOwner;
+    static std::atomic_bool s_bContentLockWanted;
     static std::string TryCacheDirPath(const std::string& strParentDir, const std::string& strCacheDirName);
 
+    struct SaveJob;
+    static constexpr int SECTION_COUNT = 2;
+    static const char* const SECTION_NAMES[SECTION_COUNT];
+    std::string GetJournalPath() const { return m_projFilePath+".journal"; }
+    std::shared_ptr<SaveJob> CreateSaveJob(const std::string& projFilePath);
+    bool SnapshotSections(SaveJob& tJob, uint32_t u32DirtySections, const uint64_t au64LastSignatures[], const bool abLastValid[]);
+    ErrorCode QueueSaveJob(std::shared_ptr<SaveJob> hJob);
+    ErrorCode RunSaveJob(SaveJob& tJob);
+    void SerializeTimelineSection(SaveJob& tJob);
+    void WaitSaveWorkerIdle(std::unique_lock<std::mutex>& lk);
+    void ReplayJournal(const std::string& strJournalPath);
+    void ApplyJournalFailure();
+    void _SaveProc();
+
 private:
     Logger::ALogger* m_pLogger;
     bool m_bOpened{false};
@@ -102,9 +157,34 @@ private:
     std::recursive_mutex m_mtxApiLock;
     std::list<BackgroundTask::Holder> m_aBgtasks;
     std::mutex m_mtxBgtaskLock;
-    SysUtils::ThreadPoolExecutor::Holder m_hBgtaskExctor;
+    BackgroundTaskScheduler::Holder m_hBgtaskScheduler;
     MediaCore::HwaccelManager::Holder m_hHwMgr;
 
+    // save worker, it runs one job at a time, the section caches are only accessed by the worker while a job is pending
+    struct SectionCache
+    {
+        std::string strBytes;       // the section serialized at the nesting level of the project file
+        bool bStructured{false};
+        uint64_t u64Signature{0};
+        bool bValid{false};
+    };
+    SectionCache m_aSectionCaches[SECTION_COUNT];
+    uint64_t m_au64JournalSignatures[SECTION_COUNT]{0};
+    bool m_abJournalValid[SECTION_COUNT]{false};
+    bool m_bRestartJournal{true};
+    std::atomic_bool m_bJournalFailed{false};  // set by the save worker, applied to the journal state under 'm_mtxApiLock'
+    std::atomic<uint32_t> m_u32DirtySections{SECTION_ALL};
+    std::atomic<uint32_t> m_u32JournalDirtySections{SECTION_ALL};
+    std::atomic<uint64_t> m_u64ContentGeneration{0};
+    std::thread m_thSaveWorker;
+    std::mutex m_mtxSaveLock;
+    std::condition_variable m_cvSave;
+    std::shared_ptr<SaveJob> m_hSaveJob;
+    ErrorCode m_eLastSaveResult{OK};
+    bool m_bSaveResultUnread{false};
+    std::atomic<uint64_t> m_u64LastJournalEntrySize{0};
+    bool m_bQuitSaveWorker{false};
+
     // this ugly reference to the TimeLine instance should be removed after global TimeLine pointer is opted out
     void* m_pTlHandle{nullptr};
 };
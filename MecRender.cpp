@@ -0,0 +1,393 @@
+/*
+    Copyright (c) 2023-2024 CodeWin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Headless render of a MEC project, without window, gpu context or audio device.
+// Progress and result are printed to stdout as one json object per line. The process' stdout is redirected to stderr at start,
+// only the json lines are written to the original stdout, so the logs of 'Logger' and the libraries go to stderr.
+//
+// Usage: mec_render [options] -o <output file> <project.mep>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <getopt.h>
+#include <unistd.h>
+#include <imgui.h>
+#include <imgui_json.h>
+#include <imgui_helper.h>
+#include <BaseUtils/Logger.h>
+#include <BaseUtils/FileSystemUtils.h>
+#include "MecProject.h"
+#include "MediaTimeline.h"
+#include "MediaCore/MediaEncoder.h"
+#include "MediaCore/HwaccelManager.h"
+
+using namespace MediaTimeline;
+
+struct RenderOptions
+{
+    std::string project_path;
+    std::string output_path;
+    std::string plugin_path;
+    std::string video_codec {"h264"};
+    std::string audio_codec {"aac"};
+    bool export_video {true};
+    bool export_audio {true};
+    int64_t start {-1};                     // in millisecond, -1 means the timeline start
+    int64_t end {-1};                       // in millisecond, -1 means the timeline end
+    int width {-1};                         // -1 means using the timeline setting
+    int height {-1};
+    MediaCore::Ratio frame_rate {0, 0};
+    int64_t video_bitrate {-1};
+    int64_t audio_bitrate {128000};
+    int sample_rate {-1};
+    int channels {-1};
+    int segments {1};
+    int progress_interval {500};            // in millisecond
+    bool hwaccel {false};
+};
+
+static void PrintUsage(const char* app)
+{
+    fprintf(stderr, "Usage: %s [options] -o <output file> <project.mep>\n", app);
+    fprintf(stderr, "  -o, --output <path>          output media file, the container is decided by the file extension\n");
+    fprintf(stderr, "  -p, --plugin_dir <path>      blueprint plugin directory, default is '../plugins' of the executable\n");
+    fprintf(stderr, "  -s, --start <ms>             export range start, default is the timeline start\n");
+    fprintf(stderr, "  -e, --end <ms>               export range end, default is the timeline end\n");
+    fprintf(stderr, "      --vcodec <name>          video codec or encoder name, default is 'h264'\n");
+    fprintf(stderr, "      --acodec <name>          audio codec or encoder name, default is 'aac'\n");
+    fprintf(stderr, "      --width <n>, --height <n>, --fps <num/den>\n");
+    fprintf(stderr, "                               output video format, default is the timeline setting\n");
+    fprintf(stderr, "      --vbitrate <bps>, --abitrate <bps>\n");
+    fprintf(stderr, "      --sample_rate <n>, --channels <n>\n");
+    fprintf(stderr, "      --segments <n>           encode the video in n parallel segments, default is 1\n");
+    fprintf(stderr, "      --no_video, --no_audio   skip the video or audio stream\n");
+    fprintf(stderr, "      --hwaccel                allow hardware decoders and encoders\n");
+    fprintf(stderr, "      --interval <ms>          progress report interval, default is 500\n");
+}
+
+static bool ParseOptions(int argc, char** argv, RenderOptions& options)
+{
+    enum { OPT_VCODEC = 256, OPT_ACODEC, OPT_WIDTH, OPT_HEIGHT, OPT_FPS, OPT_VBITRATE, OPT_ABITRATE,
+        OPT_SAMPLE_RATE, OPT_CHANNELS, OPT_SEGMENTS, OPT_NO_VIDEO, OPT_NO_AUDIO, OPT_HWACCEL, OPT_INTERVAL };
+    static struct option long_options[] = {
+        { "output", required_argument, NULL, 'o' },
+        { "plugin_dir", required_argument, NULL, 'p' },
+        { "start", required_argument, NULL, 's' },
+        { "end", required_argument, NULL, 'e' },
+        { "vcodec", required_argument, NULL, OPT_VCODEC },
+        { "acodec", required_argument, NULL, OPT_ACODEC },
+        { "width", required_argument, NULL, OPT_WIDTH },
+        { "height", required_argument, NULL, OPT_HEIGHT },
+        { "fps", required_argument, NULL, OPT_FPS },
+        { "vbitrate", required_argument, NULL, OPT_VBITRATE },
+        { "abitrate", required_argument, NULL, OPT_ABITRATE },
+        { "sample_rate", required_argument, NULL, OPT_SAMPLE_RATE },
+        { "channels", required_argument, NULL, OPT_CHANNELS },
+        { "segments", required_argument, NULL, OPT_SEGMENTS },
+        { "no_video", no_argument, NULL, OPT_NO_VIDEO },
+        { "no_audio", no_argument, NULL, OPT_NO_AUDIO },
+        { "hwaccel", no_argument, NULL, OPT_HWACCEL },
+        { "interval", required_argument, NULL, OPT_INTERVAL },
+        { "help", no_argument, NULL, 'h' },
+        { 0, 0, 0, 0 }
+    };
+    int o = -1;
+    int option_index = 0;
+    while ((o = getopt_long(argc, argv, "o:p:s:e:h", long_options, &option_index)) != -1)
+    {
+        switch (o)
+        {
+            case 'o': options.output_path = optarg; break;
+            case 'p': options.plugin_path = optarg; break;
+            case 's': options.start = atoll(optarg); break;
+            case 'e': options.end = atoll(optarg); break;
+            case OPT_VCODEC: options.video_codec = optarg; break;
+            case OPT_ACODEC: options.audio_codec = optarg; break;
+            case OPT_WIDTH: options.width = atoi(optarg); break;
+            case OPT_HEIGHT: options.height = atoi(optarg); break;
+            case OPT_FPS:
+            {
+                int num = 0, den = 1;
+                if (sscanf(optarg, "%d/%d", &num, &den) < 1 || num <= 0 || den <= 0)
+                    return false;
+                options.frame_rate = {num, den};
+                break;
+            }
+            case OPT_VBITRATE: options.video_bitrate = atoll(optarg); break;
+            case OPT_ABITRATE: options.audio_bitrate = atoll(optarg); break;
+            case OPT_SAMPLE_RATE: options.sample_rate = atoi(optarg); break;
+            case OPT_CHANNELS: options.channels = atoi(optarg); break;
+            case OPT_SEGMENTS: options.segments = atoi(optarg); break;
+            case OPT_NO_VIDEO: options.export_video = false; break;
+            case OPT_NO_AUDIO: options.export_audio = false; break;
+            case OPT_HWACCEL: options.hwaccel = true; break;
+            case OPT_INTERVAL: options.progress_interval = atoi(optarg); break;
+            default: return false;
+        }
+    }
+    if (optind != argc-1 || options.output_path.empty())
+        return false;
+    options.project_path = argv[optind];
+    if (options.progress_interval <= 0)
+        options.progress_interval = 500;
+    if (options.segments < 1)
+        options.segments = 1;
+    return options.export_video || options.export_audio;
+}
+
+static FILE* g_pJsonOut = stdout;
+
+// Keep the original stdout for the json lines, everything else written to stdout, e.g. by the default 'StdoutLogger', goes to stderr
+static void RedirectStdoutToStderr()
+{
+    fflush(stdout);
+    const int iJsonFd = dup(STDOUT_FILENO);
+    if (iJsonFd < 0)
+        return;
+    FILE* pJsonOut = fdopen(iJsonFd, "w");
+    if (!pJsonOut)
+    {
+        close(iJsonFd);
+        return;
+    }
+    if (dup2(STDERR_FILENO, STDOUT_FILENO) < 0)
+    {
+        fclose(pJsonOut);
+        return;
+    }
+    g_pJsonOut = pJsonOut;
+}
+
+static void PrintJsonLine(const imgui_json::value& value)
+{
+    fprintf(g_pJsonOut, "%s\n", value.dump().c_str());
+    fflush(g_pJsonOut);
+}
+
+static void PrintError(const std::string& stage, const std::string& message)
+{
+    imgui_json::value value;
+    value["event"] = imgui_json::string("error");
+    value["stage"] = imgui_json::string(stage);
+    value["message"] = imgui_json::string(message);
+    PrintJsonLine(value);
+}
+
+// Accept both codec names ('h264') and encoder names ('libx264'), prefer the software encoders unless 'hwaccel' is set
+static std::string FindEncoderName(const std::string& codec, bool hwaccel)
+{
+    std::vector<MediaCore::MediaEncoder::Description> enc_desc_list;
+    if (!MediaCore::MediaEncoder::FindEncoder(codec, enc_desc_list) || enc_desc_list.empty())
+        return codec;
+    for (const auto& desc : enc_desc_list)
+    {
+        if (hwaccel || !desc.isHardwareEncoder)
+            return desc.codecName;
+    }
+    return enc_desc_list[0].codecName;
+}
+
+static bool LoadProject(TimeLine* timeline, MEC::Project::Holder hProj)
+{
+    const auto& jnProjContent = hProj->GetProjectContentJson();
+    std::string attrName = "MediaBank";
+    if (jnProjContent.contains(attrName) && jnProjContent[attrName].is_array())
+    {
+        const auto& jnMediaBank = jnProjContent[attrName].get<imgui_json::array>();
+        for (const auto& jnItem : jnMediaBank)
+        {
+            int64_t id = -1;
+            std::string name, path;
+            uint32_t type = MEDIA_UNKNOWN;
+            if (jnItem.contains("id") && jnItem["id"].is_number())
+                id = jnItem["id"].get<imgui_json::number>();
+            if (jnItem.contains("name") && jnItem["name"].is_string())
+                name = jnItem["name"].get<imgui_json::string>();
+            if (jnItem.contains("path") && jnItem["path"].is_string())
+                path = jnItem["path"].get<imgui_json::string>();
+            if (jnItem.contains("type") && jnItem["type"].is_number())
+                type = jnItem["type"].get<imgui_json::number>();
+            MediaItem* item = new MediaItem(name, path, type, timeline);
+            if (id != -1) item->mID = id;
+            if (jnItem.contains("meta_data"))
+                item->mMetaData = jnItem["meta_data"];
+            // the overviews are only needed for drawing, the clips of a headless timeline never open them
+            if (!item->Initialize(true))
+                Logger::Log(Logger::WARN) << "FAILED to initialize media item '" << path << "'." << std::endl;
+            timeline->media_items.push_back(item);
+            timeline->InvalidateIndex(TimeLine::INDEX_MEDIA_ITEM);
+        }
+    }
+    attrName = "TimeLine";
+    if (!jnProjContent.contains(attrName) || !jnProjContent[attrName].is_object())
+        return false;
+    timeline->Load(jnProjContent[attrName]);
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    RedirectStdoutToStderr();
+    RenderOptions options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        PrintUsage(argv[0]);
+        return -1;
+    }
+    auto exec_path = ImGuiHelper::exec_path();
+    if (options.plugin_path.empty())
+        options.plugin_path = ImGuiHelper::path_parent(exec_path) + "plugins";
+
+    // imgui context is still needed by the blueprint, but no backend is initialized
+    ImGui::CreateContext();
+    auto hHwaMgr = MediaCore::HwaccelManager::GetDefaultInstance();
+    if (!hHwaMgr->Init())
+        Logger::Log(Logger::WARN) << "FAILED to init 'HwaccelManager' instance! Error is '" << hHwaMgr->GetError() << "'." << std::endl;
+    MediaCore::VideoClip::USE_HWACCEL = options.hwaccel;
+
+    std::vector<std::string> plugin_paths;
+    plugin_paths.push_back(options.plugin_path);
+    int plugin_index = 0;
+    float plugin_percentage = 0;
+    std::string plugin_message;
+    int plugins = BluePrint::BluePrintUI::CheckPlugins(plugin_paths);
+    BluePrint::BluePrintUI::LoadPlugins(plugin_paths, plugin_index, plugin_message, plugin_percentage, plugins);
+
+    const auto load_start = std::chrono::steady_clock::now();
+    MEC::Project::ErrorCode ec;
+    auto hProj = MEC::Project::OpenProjectFile(ec, options.project_path);
+    if (!hProj)
+    {
+        PrintError("load", "FAILED to open project file '" + options.project_path + "', error code " + std::to_string((int)ec) + ".");
+        ImGui::DestroyContext();
+        return -1;
+    }
+    int ret = 0;
+    TimeLine* timeline = new TimeLine(true);
+    hProj->SetTimelineHandle(timeline);
+    timeline->mhProject = hProj;
+    timeline->mHardwareCodec = options.hwaccel;
+    // the clips of a headless render are only read by the export, which always decodes the original media
+    timeline->mUseProxyMedia = false;
+    if (!LoadProject(timeline, hProj))
+    {
+        PrintError("load", "CANNOT find 'TimeLine' in project '" + options.project_path + "'.");
+        ret = -1;
+    }
+    const double load_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-load_start).count();
+
+    if (ret == 0)
+    {
+        auto& hSettings = timeline->mhMediaSettings;
+        if (options.start >= 0 || options.end >= 0)
+        {
+            timeline->mark_in = options.start >= 0 ? options.start : 0;
+            timeline->mark_out = options.end >= 0 ? options.end : INT64_MAX;
+            timeline->mEncodingInRange = true;
+        }
+        const int64_t duration = timeline->ValidDuration();
+
+        TimeLine::VideoEncoderParams vidEncParams;
+        vidEncParams.encodeVideo = options.export_video;
+        vidEncParams.codecName = FindEncoderName(options.video_codec, options.hwaccel);
+        vidEncParams.width = options.width > 0 ? options.width : hSettings->VideoOutWidth();
+        vidEncParams.height = options.height > 0 ? options.height : hSettings->VideoOutHeight();
+        vidEncParams.frameRate = options.frame_rate.num > 0 ? options.frame_rate : hSettings->VideoOutFrameRate();
+        vidEncParams.bitRate = options.video_bitrate > 0 ? options.video_bitrate :
+                (int64_t)vidEncParams.width * vidEncParams.height * vidEncParams.frameRate.num / vidEncParams.frameRate.den / 10;
+        TimeLine::AudioEncoderParams audEncParams;
+        audEncParams.encodeAudio = options.export_audio;
+        audEncParams.codecName = FindEncoderName(options.audio_codec, options.hwaccel);
+        audEncParams.channels = options.channels > 0 ? options.channels : hSettings->AudioOutChannels();
+        audEncParams.sampleRate = options.sample_rate > 0 ? options.sample_rate : hSettings->AudioOutSampleRate();
+        audEncParams.bitRate = options.audio_bitrate;
+        timeline->mEncodingSegments = options.segments;
+
+        std::string errMsg;
+        if (duration <= 0)
+        {
+            PrintError("config", "Export range is EMPTY.");
+            ret = -1;
+        }
+        else if (!timeline->ConfigEncoder(options.output_path, vidEncParams, audEncParams, errMsg))
+        {
+            PrintError("config", errMsg);
+            ret = -1;
+        }
+        else
+        {
+            imgui_json::value start_info;
+            start_info["event"] = imgui_json::string("start");
+            start_info["project"] = imgui_json::string(options.project_path);
+            start_info["output"] = imgui_json::string(options.output_path);
+            start_info["start_ms"] = imgui_json::number(timeline->mEncodingStart);
+            start_info["end_ms"] = imgui_json::number(timeline->mEncodingEnd);
+            start_info["video_codec"] = imgui_json::string(options.export_video ? vidEncParams.codecName : "");
+            start_info["audio_codec"] = imgui_json::string(options.export_audio ? audEncParams.codecName : "");
+            start_info["segments"] = imgui_json::number(timeline->mEncSegments.empty() ? 1 : timeline->mEncSegments.size());
+            start_info["load_ms"] = imgui_json::number(load_ms);
+            PrintJsonLine(start_info);
+
+            const auto encode_start = std::chrono::steady_clock::now();
+            const char* stage_names[TimeLine::ENCODE_STAGE_COUNT] = { "video", "audio", "encode" };
+            auto MakeProgress = [&] (const char* event) {
+                const double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-encode_start).count();
+                imgui_json::value progress;
+                progress["event"] = imgui_json::string(event);
+                progress["progress"] = imgui_json::number(timeline->mEncodingProgress);
+                progress["elapsed_ms"] = imgui_json::number(elapsed_ms);
+                progress["speed"] = imgui_json::number(elapsed_ms > 0 ? timeline->mEncodingProgress * duration / elapsed_ms : 0);
+                for (int i = 0; i < TimeLine::ENCODE_STAGE_COUNT; i++)
+                {
+                    const auto& stats = timeline->mEncodeStageStats[i];
+                    imgui_json::value stage;
+                    stage["frames"] = imgui_json::number(stats.frames);
+                    stage["fps"] = imgui_json::number(stats.Fps());
+                    stage["busy_ms"] = imgui_json::number(stats.busyUs / 1000);
+                    stage["stall_ms"] = imgui_json::number(stats.stallUs / 1000);
+                    progress[stage_names[i]] = stage;
+                }
+                return progress;
+            };
+            timeline->StartEncoding();
+            while (timeline->mIsEncoding)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(options.progress_interval));
+                if (timeline->mIsEncoding)
+                    PrintJsonLine(MakeProgress("progress"));
+            }
+            timeline->StopEncoding();
+            auto result = MakeProgress("done");
+            result["status"] = imgui_json::string(timeline->mEncodeProcErrMsg.empty() ? "ok" : "failed");
+            if (!timeline->mEncodeProcErrMsg.empty())
+            {
+                result["message"] = imgui_json::string(timeline->mEncodeProcErrMsg);
+                ret = -1;
+            }
+            PrintJsonLine(result);
+        }
+    }
+
+    delete timeline;
+    hProj->Close(false);
+    ImGui::DestroyContext();
+    return ret;
+}
@@ -0,0 +1,678 @@
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <algorithm>
+#include <filesystem>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+#include "BaseUtils/FileSystemUtils.h"
+#include "MediaCache.h"
+#include "MecProject.h"
+
+using namespace std;
+using namespace Logger;
+namespace fs = std::filesystem;
+
+namespace MEC
+{
+static uint64_t HashBytes(uint64_t u64Hash, const void* pData, size_t szLen)
+{
+    // 64-bit FNV-1a
+    auto pBytes = (const uint8_t*)pData;
+    for (size_t i = 0; i < szLen; i++)
+    {
+        u64Hash ^= pBytes[i];
+        u64Hash *= 0x100000001b3ULL;
+    }
+    return u64Hash;
+}
+
+string GetMediaContentId(const string& strMediaPath, string& strErrMsg)
+{
+    if (!SysUtils::IsFile(strMediaPath))
+    {
+        ostringstream oss; oss << "'" << strMediaPath << "' is NOT a regular file!";
+        strErrMsg = oss.str();
+        return "";
+    }
+    // identify the media by its size and samples of its content instead of the path,
+    // so the id still stays the same after the file is moved or copied
+    const size_t CONTENT_SAMPLE_SIZE = 64*1024;
+    error_code ec;
+    const auto u64FileSize = (uint64_t)fs::file_size(fs::u8path(strMediaPath), ec);
+    if (ec)
+    {
+        ostringstream oss; oss << "FAILED to get file size of '" << strMediaPath << "'! " << ec.message();
+        strErrMsg = oss.str();
+        return "";
+    }
+    ifstream ifs(fs::u8path(strMediaPath), ios::binary);
+    if (!ifs.is_open())
+    {
+        ostringstream oss; oss << "FAILED to open media file '" << strMediaPath << "' for reading!";
+        strErrMsg = oss.str();
+        return "";
+    }
+    uint64_t u64Hash = 0xcbf29ce484222325ULL;
+    u64Hash = HashBytes(u64Hash, &u64FileSize, sizeof(u64FileSize));
+    vector<char> aSampleBuf(CONTENT_SAMPLE_SIZE);
+    const auto u64HeadSize = min(u64FileSize, (uint64_t)CONTENT_SAMPLE_SIZE);
+    ifs.read(aSampleBuf.data(), u64HeadSize);
+    u64Hash = HashBytes(u64Hash, aSampleBuf.data(), ifs.gcount());
+    if (u64FileSize > 2*CONTENT_SAMPLE_SIZE)
+    {
+        ifs.clear();
+        ifs.seekg(u64FileSize-CONTENT_SAMPLE_SIZE, ios::beg);
+        ifs.read(aSampleBuf.data(), CONTENT_SAMPLE_SIZE);
+        u64Hash = HashBytes(u64Hash, aSampleBuf.data(), ifs.gcount());
+    }
+    ostringstream oss;
+    oss << hex << setw(16) << setfill('0') << u64Hash;
+    return oss.str();
+}
+
+string GetProxyMediaPath(const string& strContentId)
+{
+    if (strContentId.empty())
+        return "";
+    const auto strProjCacheDir = Project::GetCacheDir();
+    if (strProjCacheDir.empty())
+        return "";
+    return SysUtils::JoinPath(SysUtils::JoinPath(strProjCacheDir, "Proxies"), strContentId+".proxy.mp4");
+}
+
+// Remove the least recently modified files with extension name 'strExtName' under 'strCacheDir',
+// until the total size of these files is not larger than 'u64MaxBytes'.
+static void EvictCacheFiles(const string& strCacheDir, const string& strExtName, uint64_t u64MaxBytes, ALogger* pLogger)
+{
+    if (u64MaxBytes == 0 || !SysUtils::IsDirectory(strCacheDir))
+        return;
+    struct _CacheFile
+    {
+        fs::path tPath;
+        uint64_t u64Size;
+        fs::file_time_type tLastAccess;
+    };
+    vector<_CacheFile> aCacheFiles;
+    uint64_t u64TotalSize = 0;
+    error_code ec;
+    for (const auto& tDirEnt : fs::directory_iterator(fs::u8path(strCacheDir), ec))
+    {
+        if (!tDirEnt.is_regular_file(ec) || tDirEnt.path().extension() != strExtName)
+            continue;
+        _CacheFile tCacheFile{tDirEnt.path(), (uint64_t)tDirEnt.file_size(ec), tDirEnt.last_write_time(ec)};
+        u64TotalSize += tCacheFile.u64Size;
+        aCacheFiles.push_back(std::move(tCacheFile));
+    }
+    if (u64TotalSize <= u64MaxBytes)
+        return;
+    sort(aCacheFiles.begin(), aCacheFiles.end(), [] (const _CacheFile& a, const _CacheFile& b) {
+        return a.tLastAccess < b.tLastAccess;
+    });
+    for (const auto& tCacheFile : aCacheFiles)
+    {
+        if (u64TotalSize <= u64MaxBytes)
+            break;
+        if (fs::remove(tCacheFile.tPath, ec))
+        {
+            u64TotalSize -= tCacheFile.u64Size;
+            pLogger->Log(DEBUG) << "Evicted cache file '" << tCacheFile.tPath.u8string() << "'." << endl;
+        }
+    }
+}
+
+class ThumbnailCache_Impl : public ThumbnailCache
+{
+public:
+    ThumbnailCache_Impl(const string& strCacheDir) : m_strCacheDir(strCacheDir)
+    {
+        m_pLogger = GetLogger("ThumbnailCache");
+    }
+
+    string MakeKey(const string& strContentId, uint32_t u32SnapWidth, uint32_t u32SnapHeight, uint32_t u32SnapCount) override
+    {
+        if (m_strCacheDir.empty() || strContentId.empty())
+            return "";
+        ostringstream oss;
+        oss << strContentId << "_" << u32SnapWidth << "x" << u32SnapHeight << "_" << u32SnapCount;
+        return oss.str();
+    }
+
+    bool Load(const string& strKey, vector<ImGui::ImMat>& aSnapshots) override
+    {
+        if (strKey.empty())
+            return false;
+        const auto strEntryPath = GetEntryPath(strKey);
+        lock_guard<mutex> lk(m_mtxEntries);
+        error_code ec;
+        const uint64_t u64FileSize = fs::file_size(fs::u8path(strEntryPath), ec);
+        if (ec)
+            return false;
+        ifstream ifs(fs::u8path(strEntryPath), ios::binary);
+        if (!ifs.is_open())
+            return false;
+        char acMagic[sizeof(ENTRY_MAGIC)] = {0};
+        uint32_t u32Count = 0;
+        ifs.read(acMagic, sizeof(ENTRY_MAGIC));
+        ifs.read((char*)&u32Count, sizeof(u32Count));
+        // the count and the sizes in the headers are checked against the rest of the file before anything is allocated
+        uint64_t u64Remaining = u64FileSize > sizeof(ENTRY_MAGIC)+sizeof(u32Count) ? u64FileSize-sizeof(ENTRY_MAGIC)-sizeof(u32Count) : 0;
+        if (!ifs || memcmp(acMagic, ENTRY_MAGIC, sizeof(ENTRY_MAGIC)) != 0 || (uint64_t)u32Count*sizeof(_EntryMatHeader) > u64Remaining)
+        {
+            m_pLogger->Log(WARN) << "Invalid thumbnail cache entry '" << strEntryPath << "', remove it." << endl;
+            ifs.close();
+            SysUtils::DeleteFileAt(strEntryPath);
+            return false;
+        }
+        vector<ImGui::ImMat> aLoaded;
+        aLoaded.reserve(u32Count);
+        for (uint32_t i = 0; i < u32Count; i++)
+        {
+            _EntryMatHeader tHdr;
+            ifs.read((char*)&tHdr, sizeof(tHdr));
+            if (!ifs)
+                break;
+            u64Remaining -= sizeof(tHdr);
+            if (tHdr.w <= 0 || tHdr.h <= 0 || tHdr.c <= 0 || tHdr.elemsize == 0 || tHdr.dataSize > u64Remaining
+                || (uint64_t)tHdr.w*tHdr.h*tHdr.c*tHdr.elemsize > u64Remaining)
+                break;
+            ImGui::ImMat m;
+            m.create(tHdr.w, tHdr.h, tHdr.c, (size_t)tHdr.elemsize, tHdr.elempack);
+            if (m.empty() || m.dims != tHdr.dims || m.total()*m.elemsize != tHdr.dataSize)
+                break;
+            m.type = (ImDataType)tHdr.type;
+            m.color_format = (ImColorFormat)tHdr.colorFormat;
+            m.time_stamp = tHdr.timeStamp;
+            ifs.read((char*)m.data, tHdr.dataSize);
+            if (!ifs)
+                break;
+            u64Remaining -= tHdr.dataSize;
+            aLoaded.push_back(m);
+        }
+        ifs.close();
+        if (aLoaded.size() != u32Count)
+        {
+            m_pLogger->Log(WARN) << "Thumbnail cache entry '" << strEntryPath << "' is truncated, remove it." << endl;
+            SysUtils::DeleteFileAt(strEntryPath);
+            return false;
+        }
+        // refresh the modification time, which is used as the last access time for the LRU eviction
+        fs::last_write_time(fs::u8path(strEntryPath), fs::file_time_type::clock::now(), ec);
+        aSnapshots = std::move(aLoaded);
+        m_pLogger->Log(DEBUG) << "Loaded " << u32Count << " snapshots from thumbnail cache entry '" << strKey << "'." << endl;
+        return true;
+    }
+
+    bool Store(const string& strKey, const vector<ImGui::ImMat>& aSnapshots) override
+    {
+        if (strKey.empty() || aSnapshots.empty())
+            return false;
+        for (const auto& m : aSnapshots)
+        {
+            if (m.empty() || m.device != IM_DD_CPU)
+            {
+                m_errMsg = "Only non-empty snapshots in CPU memory can be stored in thumbnail cache!";
+                return false;
+            }
+        }
+        if (!SysUtils::IsDirectory(m_strCacheDir) && !SysUtils::CreateDirectoryAt(m_strCacheDir, true))
+        {
+            ostringstream oss; oss << "FAILED to create thumbnail cache directory '" << m_strCacheDir << "'!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        const auto strEntryPath = GetEntryPath(strKey);
+        // write to a temporary file first, then rename it, so a partially written entry is never visible to 'Load()'
+        const auto strTempPath = strEntryPath+".tmp";
+        lock_guard<mutex> lk(m_mtxEntries);
+        {
+            ofstream ofs(fs::u8path(strTempPath), ios::binary|ios::trunc);
+            if (!ofs.is_open())
+            {
+                ostringstream oss; oss << "FAILED to open file '" << strTempPath << "' for writing!";
+                m_errMsg = oss.str();
+                return false;
+            }
+            const uint32_t u32Count = aSnapshots.size();
+            ofs.write(ENTRY_MAGIC, sizeof(ENTRY_MAGIC));
+            ofs.write((const char*)&u32Count, sizeof(u32Count));
+            for (const auto& m : aSnapshots)
+            {
+                _EntryMatHeader tHdr;
+                tHdr.w = m.w; tHdr.h = m.h; tHdr.c = m.c; tHdr.dims = m.dims;
+                tHdr.elemsize = m.elemsize; tHdr.elempack = m.elempack;
+                tHdr.type = (int32_t)m.type; tHdr.colorFormat = (int32_t)m.color_format;
+                tHdr.timeStamp = m.time_stamp;
+                tHdr.dataSize = m.total()*m.elemsize;
+                ofs.write((const char*)&tHdr, sizeof(tHdr));
+                ofs.write((const char*)m.data, tHdr.dataSize);
+            }
+            if (!ofs)
+            {
+                ostringstream oss; oss << "FAILED to write thumbnail cache entry into file '" << strTempPath << "'!";
+                m_errMsg = oss.str();
+                ofs.close();
+                SysUtils::DeleteFileAt(strTempPath);
+                return false;
+            }
+        }
+        if (SysUtils::Exists(strEntryPath))
+            SysUtils::DeleteFileAt(strEntryPath);
+        if (!SysUtils::RenameFile(strTempPath, strEntryPath))
+        {
+            ostringstream oss; oss << "FAILED to rename '" << strTempPath << "' to '" << strEntryPath << "'!";
+            m_errMsg = oss.str();
+            SysUtils::DeleteFileAt(strTempPath);
+            return false;
+        }
+        m_pLogger->Log(DEBUG) << "Stored " << aSnapshots.size() << " snapshots into thumbnail cache entry '" << strKey << "'." << endl;
+        EvictEntries();
+        return true;
+    }
+
+    void SetMaxCacheSize(uint64_t u64MaxBytes) override
+    {
+        lock_guard<mutex> lk(m_mtxEntries);
+        m_u64MaxCacheSize = u64MaxBytes;
+        EvictEntries();
+    }
+
+    string GetCacheDir() const override
+    {
+        return m_strCacheDir;
+    }
+
+    string GetError() const override
+    {
+        return m_errMsg;
+    }
+
+    void SetLogLevel(Level l) override
+    {
+        m_pLogger->SetShowLevels(l);
+    }
+
+private:
+    string GetEntryPath(const string& strKey) const
+    {
+        return SysUtils::JoinPath(m_strCacheDir, strKey+ENTRY_EXTNAME);
+    }
+
+    // must be called with 'm_mtxEntries' locked
+    void EvictEntries()
+    {
+        EvictCacheFiles(m_strCacheDir, ENTRY_EXTNAME, m_u64MaxCacheSize, m_pLogger);
+    }
+
+private:
+    static constexpr char ENTRY_MAGIC[8] = {'M', 'E', 'C', 'T', 'H', 'M', 'B', '1'};
+    static constexpr const char* ENTRY_EXTNAME = ".thumb";
+
+    struct _EntryMatHeader
+    {
+        int32_t w, h, c, dims;
+        uint32_t elemsize;
+        int32_t elempack;
+        int32_t type;
+        int32_t colorFormat;
+        double timeStamp;
+        uint64_t dataSize;
+    };
+
+    ALogger* m_pLogger;
+    string m_errMsg;
+    string m_strCacheDir;
+    mutex m_mtxEntries;
+    uint64_t m_u64MaxCacheSize{512ULL*1024*1024};
+};
+
+constexpr char ThumbnailCache_Impl::ENTRY_MAGIC[8];
+
+static ThumbnailCache::Holder s_hThumbnailCache;
+static mutex s_mtxThumbnailCache;
+
+ThumbnailCache::Holder ThumbnailCache::GetInstance()
+{
+    lock_guard<mutex> lk(s_mtxThumbnailCache);
+    const auto strProjCacheDir = Project::GetCacheDir();
+    if (strProjCacheDir.empty())
+        return nullptr;
+    const auto strCacheDir = SysUtils::JoinPath(strProjCacheDir, "Thumbnails");
+    if (!s_hThumbnailCache || s_hThumbnailCache->GetCacheDir() != strCacheDir)
+        s_hThumbnailCache = CreateInstance(strCacheDir);
+    return s_hThumbnailCache;
+}
+
+ThumbnailCache::Holder ThumbnailCache::CreateInstance(const string& strCacheDir)
+{
+    return ThumbnailCache::Holder(new ThumbnailCache_Impl(strCacheDir));
+}
+
+class WaveformPyramid_Impl : public WaveformPyramid
+{
+public:
+    WaveformPyramid_Impl() = default;
+
+    bool Build(const MediaCore::Overview::Waveform& tWaveform)
+    {
+        if (tWaveform.pcm.empty())
+        {
+            m_errMsg = "Waveform has NO pcm data!";
+            return false;
+        }
+        size_t szSampleCount = tWaveform.pcm[0].size();
+        for (const auto& aChPcm : tWaveform.pcm)
+            szSampleCount = min(szSampleCount, aChPcm.size());
+        if (szSampleCount == 0)
+        {
+            m_errMsg = "Waveform has NO pcm data!";
+            return false;
+        }
+        m_tHdr.u32ChannelCount = tWaveform.pcm.size();
+        m_tHdr.i64SampleCount = szSampleCount;
+        m_tHdr.dAggregateDuration = tWaveform.aggregateDuration;
+        m_tHdr.dAggregateSamples = tWaveform.aggregateSamples;
+        m_tHdr.fMinSample = tWaveform.minSample;
+        m_tHdr.fMaxSample = tWaveform.maxSample;
+        m_tHdr.u32LevelCount = 1;
+        int64_t i64LevelLen = szSampleCount;
+        while (i64LevelLen > 1 && m_tHdr.u32LevelCount < MAX_LEVEL_COUNT)
+        {
+            i64LevelLen = (i64LevelLen+1)/2;
+            m_tHdr.u32LevelCount++;
+        }
+        SetupLevels();
+        m_aData.resize(m_tHdr.u64DataCount);
+        for (uint32_t ch = 0; ch < m_tHdr.u32ChannelCount; ch++)
+        {
+            // level 0, each entry is a (max, min) pair of one aggregated sample
+            const auto& aChPcm = tWaveform.pcm[ch];
+            float* pDst = GetLevelData(ch, 0);
+            for (int64_t i = 0; i < m_tHdr.i64SampleCount; i++)
+            {
+                pDst[2*i] = pDst[2*i+1] = aChPcm[i];
+            }
+            // following levels
+            for (uint32_t l = 1; l < m_tHdr.u32LevelCount; l++)
+            {
+                const float* pSrc = GetLevelData(ch, l-1);
+                const auto i64SrcLen = m_aLevelLengths[l-1];
+                pDst = GetLevelData(ch, l);
+                for (int64_t i = 0; i < m_aLevelLengths[l]; i++)
+                {
+                    const auto j = 2*i;
+                    float fMax = pSrc[2*j], fMin = pSrc[2*j+1];
+                    if (j+1 < i64SrcLen)
+                    {
+                        fMax = max(fMax, pSrc[2*j+2]);
+                        fMin = min(fMin, pSrc[2*j+3]);
+                    }
+                    pDst[2*i] = fMax;
+                    pDst[2*i+1] = fMin;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool Load(const string& strFilePath)
+    {
+        ifstream ifs(fs::u8path(strFilePath), ios::binary);
+        if (!ifs.is_open())
+        {
+            ostringstream oss; oss << "FAILED to open waveform pyramid file '" << strFilePath << "'!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        ifs.read((char*)&m_tHdr, sizeof(m_tHdr));
+        if (!ifs || memcmp(m_tHdr.acMagic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0
+            || m_tHdr.u32ChannelCount == 0 || m_tHdr.i64SampleCount <= 0
+            || m_tHdr.u32LevelCount == 0 || m_tHdr.u32LevelCount > MAX_LEVEL_COUNT)
+        {
+            ostringstream oss; oss << "Invalid waveform pyramid file '" << strFilePath << "'!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        const auto u64DataCount = m_tHdr.u64DataCount;
+        SetupLevels();
+        if (u64DataCount != m_tHdr.u64DataCount)
+        {
+            ostringstream oss; oss << "Invalid waveform pyramid file '" << strFilePath << "'! Data count does NOT match the layout.";
+            m_errMsg = oss.str();
+            return false;
+        }
+        m_aData.resize(m_tHdr.u64DataCount);
+        ifs.read((char*)m_aData.data(), m_aData.size()*sizeof(float));
+        if (!ifs)
+        {
+            ostringstream oss; oss << "Waveform pyramid file '" << strFilePath << "' is truncated!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        return true;
+    }
+
+    bool SaveToCache(const string& strContentId) override
+    {
+        const auto strFilePath = GetCacheFilePath(strContentId, m_errMsg);
+        if (strFilePath.empty())
+            return false;
+        const auto strCacheDir = SysUtils::ExtractDirectoryPath(strFilePath);
+        if (!SysUtils::IsDirectory(strCacheDir) && !SysUtils::CreateDirectoryAt(strCacheDir, true))
+        {
+            ostringstream oss; oss << "FAILED to create waveform cache directory '" << strCacheDir << "'!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        const auto strTempPath = strFilePath+".tmp";
+        {
+            ofstream ofs(fs::u8path(strTempPath), ios::binary|ios::trunc);
+            if (!ofs.is_open())
+            {
+                ostringstream oss; oss << "FAILED to open file '" << strTempPath << "' for writing!";
+                m_errMsg = oss.str();
+                return false;
+            }
+            ofs.write((const char*)&m_tHdr, sizeof(m_tHdr));
+            ofs.write((const char*)m_aData.data(), m_aData.size()*sizeof(float));
+            if (!ofs)
+            {
+                ostringstream oss; oss << "FAILED to write waveform pyramid into file '" << strTempPath << "'!";
+                m_errMsg = oss.str();
+                ofs.close();
+                SysUtils::DeleteFileAt(strTempPath);
+                return false;
+            }
+        }
+        if (SysUtils::Exists(strFilePath))
+            SysUtils::DeleteFileAt(strFilePath);
+        if (!SysUtils::RenameFile(strTempPath, strFilePath))
+        {
+            ostringstream oss; oss << "FAILED to rename '" << strTempPath << "' to '" << strFilePath << "'!";
+            m_errMsg = oss.str();
+            SysUtils::DeleteFileAt(strTempPath);
+            return false;
+        }
+        EvictCacheFiles(strCacheDir, FILE_EXTNAME, MAX_CACHE_SIZE, GetLogger("WaveformPyramid"));
+        return true;
+    }
+
+    uint32_t GetChannelCount() const override { return m_tHdr.u32ChannelCount; }
+    int64_t GetSampleCount() const override { return m_tHdr.i64SampleCount; }
+    double GetAggregateDuration() const override { return m_tHdr.dAggregateDuration; }
+    float GetMinSample() const override { return m_tHdr.fMinSample; }
+    float GetMaxSample() const override { return m_tHdr.fMaxSample; }
+
+    bool Resample(uint32_t u32ChIdx, int64_t i64StartOffset, double dSamplesPerPixel, int iSize, ImGui::ImMat& tPlotMax, ImGui::ImMat& tPlotMin) const override
+    {
+        if (iSize <= 0 || u32ChIdx >= m_tHdr.u32ChannelCount)
+            return false;
+        if (dSamplesPerPixel < 1)
+            dSamplesPerPixel = 1;
+        tPlotMax.create_type(iSize, 1, 1, IM_DT_FLOAT32);
+        tPlotMin.create_type(iSize, 1, 1, IM_DT_FLOAT32);
+        float* pOutMax = (float*)tPlotMax.data;
+        float* pOutMin = (float*)tPlotMin.data;
+        const bool bMinMax = dSamplesPerPixel > 16;
+        if (!bMinMax)
+        {
+            const float* pLevel0 = GetLevelData(u32ChIdx, 0);
+            for (int i = 0; i < iSize; i++)
+            {
+                const auto i64Idx = i64StartOffset+(int64_t)(i*dSamplesPerPixel);
+                const float fVal = i64Idx >= 0 && i64Idx < m_tHdr.i64SampleCount ? pLevel0[2*i64Idx] : 0.f;
+                pOutMax[i] = pOutMin[i] = max(min(fVal, 1.f), -1.f);
+            }
+            return false;
+        }
+        // pick the level on which each pixel covers 1 to 2 entries
+        uint32_t u32Level = (uint32_t)floor(log2(dSamplesPerPixel));
+        if (u32Level >= m_tHdr.u32LevelCount)
+            u32Level = m_tHdr.u32LevelCount-1;
+        const double dScale = (double)((int64_t)1 << u32Level);
+        const float* pLevel = GetLevelData(u32ChIdx, u32Level);
+        const auto i64LevelLen = m_aLevelLengths[u32Level];
+        for (int i = 0; i < iSize; i++)
+        {
+            const double dBegin = i64StartOffset+i*dSamplesPerPixel;
+            int64_t i64Begin = (int64_t)floor(dBegin/dScale);
+            int64_t i64End = max(i64Begin+1, (int64_t)ceil((dBegin+dSamplesPerPixel)/dScale));
+            i64Begin = max(i64Begin, (int64_t)0);
+            i64End = min(i64End, i64LevelLen);
+            float fMax = -FLT_MAX, fMin = FLT_MAX;
+            for (int64_t j = i64Begin; j < i64End; j++)
+            {
+                if (fMax < pLevel[2*j]) fMax = pLevel[2*j];
+                if (fMin > pLevel[2*j+1]) fMin = pLevel[2*j+1];
+            }
+            if (i64Begin >= i64End)
+            {
+                fMax = fMin = 0.f;
+            }
+            else if (fMax < 0 && fMin < 0)
+            {
+                fMax = fMin;
+            }
+            else if (fMax > 0 && fMin > 0)
+            {
+                fMin = fMax;
+            }
+            pOutMax[i] = min(fMax, 1.f);
+            pOutMin[i] = max(fMin, -1.f);
+        }
+        return true;
+    }
+
+    string GetError() const override
+    {
+        return m_errMsg;
+    }
+
+    static string GetCacheFilePath(const string& strContentId, string& strErrMsg)
+    {
+        if (strContentId.empty())
+        {
+            strErrMsg = "Media content id is empty!";
+            return "";
+        }
+        const auto strProjCacheDir = Project::GetCacheDir();
+        if (strProjCacheDir.empty())
+        {
+            strErrMsg = "NO cache directory is available!";
+            return "";
+        }
+        return SysUtils::JoinPath(SysUtils::JoinPath(strProjCacheDir, "Waveforms"), strContentId+FILE_EXTNAME);
+    }
+
+private:
+    void SetupLevels()
+    {
+        m_aLevelLengths.resize(m_tHdr.u32LevelCount);
+        m_aLevelOffsets.resize(m_tHdr.u32LevelCount);
+        int64_t i64LevelLen = m_tHdr.i64SampleCount;
+        uint64_t u64Offset = 0;
+        for (uint32_t l = 0; l < m_tHdr.u32LevelCount; l++)
+        {
+            m_aLevelLengths[l] = i64LevelLen;
+            m_aLevelOffsets[l] = u64Offset;
+            u64Offset += 2*i64LevelLen;
+            i64LevelLen = (i64LevelLen+1)/2;
+        }
+        m_u64ChannelStride = u64Offset;
+        m_tHdr.u64DataCount = m_u64ChannelStride*m_tHdr.u32ChannelCount;
+    }
+
+    float* GetLevelData(uint32_t u32ChIdx, uint32_t u32Level)
+    {
+        return m_aData.data()+u32ChIdx*m_u64ChannelStride+m_aLevelOffsets[u32Level];
+    }
+
+    const float* GetLevelData(uint32_t u32ChIdx, uint32_t u32Level) const
+    {
+        return m_aData.data()+u32ChIdx*m_u64ChannelStride+m_aLevelOffsets[u32Level];
+    }
+
+private:
+    static constexpr uint32_t MAX_LEVEL_COUNT = 40;
+    static constexpr uint64_t MAX_CACHE_SIZE = 256ULL*1024*1024;
+    static constexpr char FILE_MAGIC[8] = {'M', 'E', 'C', 'W', 'F', 'P', 'Y', '1'};
+    static constexpr const char* FILE_EXTNAME = ".wfp";
+
+    // File layout: this header, followed by 'u64DataCount' floats. For each channel, all the levels are stored
+    // one after another, each level is an array of (max, min) pairs.
+    struct _FileHeader
+    {
+        char acMagic[8] = {'M', 'E', 'C', 'W', 'F', 'P', 'Y', '1'};
+        uint32_t u32ChannelCount{0};
+        uint32_t u32LevelCount{0};
+        int64_t i64SampleCount{0};
+        double dAggregateDuration{0};
+        double dAggregateSamples{0};
+        float fMinSample{0}, fMaxSample{0};
+        uint64_t u64DataCount{0};
+    };
+
+    string m_errMsg;
+    _FileHeader m_tHdr;
+    vector<int64_t> m_aLevelLengths;
+    vector<uint64_t> m_aLevelOffsets;
+    uint64_t m_u64ChannelStride{0};
+    vector<float> m_aData;
+};
+
+constexpr char WaveformPyramid_Impl::FILE_MAGIC[8];
+
+WaveformPyramid::Holder WaveformPyramid::Build(const MediaCore::Overview::Waveform& tWaveform)
+{
+    auto p = new WaveformPyramid_Impl();
+    if (!p->Build(tWaveform))
+    {
+        Log(WARN) << "FAILED to build waveform pyramid! Error is '" << p->GetError() << "'." << endl;
+        delete p;
+        return nullptr;
+    }
+    return WaveformPyramid::Holder(p);
+}
+
+WaveformPyramid::Holder WaveformPyramid::LoadFromCache(const string& strContentId)
+{
+    string strErrMsg;
+    const auto strFilePath = WaveformPyramid_Impl::GetCacheFilePath(strContentId, strErrMsg);
+    if (strFilePath.empty() || !SysUtils::IsFile(strFilePath))
+        return nullptr;
+    auto p = new WaveformPyramid_Impl();
+    if (!p->Load(strFilePath))
+    {
+        Log(WARN) << "FAILED to load waveform pyramid from cache, remove it. Error is '" << p->GetError() << "'." << endl;
+        delete p;
+        SysUtils::DeleteFileAt(strFilePath);
+        return nullptr;
+    }
+    // refresh the modification time, which is used as the last access time for the LRU eviction
+    error_code ec;
+    fs::last_write_time(fs::u8path(strFilePath), fs::file_time_type::clock::now(), ec);
+    return WaveformPyramid::Holder(p);
+}
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <memory>
+#include <vector>
+#include <immat.h>
+#include <BaseUtils/Logger.h>
+#include <MediaCore/Overview.h>
+
+namespace MEC
+{
+    // Identify a media file by its size and samples of its content. Returns an empty string and sets 'strErrMsg' on failure.
+    std::string GetMediaContentId(const std::string& strMediaPath, std::string& strErrMsg);
+    // Path of the low resolution proxy of a media under 'Project::GetCacheDir()', shared by all the projects like the other caches.
+    // 'strContentId' is the result of 'GetMediaContentId()'. Returns an empty string if no proxy can be cached for this media.
+    std::string GetProxyMediaPath(const std::string& strContentId);
+
+    // Persistent cache of media thumbnails, shared by all the projects. Entries are stored under
+    // 'Project::GetCacheDir()', keyed by the identity of the media content and the snapshot layout,
+    // so a media file is only decoded for thumbnails once, no matter where it is moved or which project imports it.
+    struct ThumbnailCache
+    {
+        using Holder = std::shared_ptr<ThumbnailCache>;
+        static Holder GetInstance();
+        static Holder CreateInstance(const std::string& strCacheDir);
+
+        // 'strContentId' is the result of 'GetMediaContentId()'. Returns an empty string if the content id is empty,
+        // in this case the thumbnails should not be cached.
+        virtual std::string MakeKey(const std::string& strContentId, uint32_t u32SnapWidth, uint32_t u32SnapHeight, uint32_t u32SnapCount) = 0;
+        virtual bool Load(const std::string& strKey, std::vector<ImGui::ImMat>& aSnapshots) = 0;
+        virtual bool Store(const std::string& strKey, const std::vector<ImGui::ImMat>& aSnapshots) = 0;
+        // The least recently used entries are removed when the total size of the cache exceeds this limit
+        virtual void SetMaxCacheSize(uint64_t u64MaxBytes) = 0;
+        virtual std::string GetCacheDir() const = 0;
+
+        virtual std::string GetError() const = 0;
+        virtual void SetLogLevel(Logger::Level l) = 0;
+    };
+
+    // Min/max mip pyramid of an 'Overview::Waveform'. Level 0 holds the aggregated pcm of the waveform, each following level
+    // halves the previous one, so drawing at any zoom level only reads about 2 entries per pixel. The pyramid is persisted
+    // under 'Project::GetCacheDir()' as one flat file (header followed by all the levels), and is loaded before the waveform
+    // of a media is parsed again.
+    struct WaveformPyramid
+    {
+        using Holder = std::shared_ptr<WaveformPyramid>;
+        static Holder Build(const MediaCore::Overview::Waveform& tWaveform);
+        // 'strContentId' is the result of 'GetMediaContentId()'
+        static Holder LoadFromCache(const std::string& strContentId);
+
+        virtual bool SaveToCache(const std::string& strContentId) = 0;
+        virtual uint32_t GetChannelCount() const = 0;
+        virtual int64_t GetSampleCount() const = 0;
+        virtual double GetAggregateDuration() const = 0;
+        virtual float GetMinSample() const = 0;
+        virtual float GetMaxSample() const = 0;
+        // Fill 'iSize' pixels with the max/min values of channel 'u32ChIdx', starting from level 0 sample 'i64StartOffset',
+        // each pixel covers 'dSamplesPerPixel' level 0 samples. Returns false if the pixels are not min/max pairs but
+        // single samples, with the values in 'tPlotMin', which is the same as 'waveFrameResample()'.
+        virtual bool Resample(uint32_t u32ChIdx, int64_t i64StartOffset, double dSamplesPerPixel, int iSize, ImGui::ImMat& tPlotMax, ImGui::ImMat& tPlotMin) const = 0;
+
+        virtual std::string GetError() const = 0;
+    };
+}
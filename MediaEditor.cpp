@@ -37,6 +37,7 @@
 #include "MecProject.h"
 #include "MediaTimeline.h"
 #include "EventStackFilter.h"
+#include "CpuVideoScope.h"
 #include "MediaCore/MediaEncoder.h"
 #include "MediaCore/HwaccelManager.h"
 #include "MediaCore/TextureManager.h"
@@ -410,6 +411,7 @@ struct MediaEditorSettings
     int  MediaBankViewType {0};             // Media bank view type, 0 = Media bank, 1 = embedded browser
 
     bool HardwareCodec {true};              // try HW codec
+    bool UseProxyMedia {true};              // preview decodes the proxy media if it's generated
     bool isCustomVideoFrameSize {false};    // current frame size is custom
     int VideoWidth  {1920};                 // timeline Media Width
     int VideoHeight {1080};                 // timeline Media Height
@@ -421,6 +423,8 @@ struct MediaEditorSettings
     int ColorSpaceIndex {1};                // timeline color space default is bt 709
     int ColorTransferIndex {0};             // timeline color transfer default is bt 709
     int VideoFrameCacheSize {10};           // timeline video cache size
+    int HistoryMemoryBudget {64};           // memory budget of the undo history in MB, older records are spilled into the cache dir
+    int AutoSaveInterval {5};               // interval in seconds of appending the unsaved changes to the project journal, 0 = off
     int VideoPrecision {0};                 // timelime video precision, 0 = low(8bit) 1 = high(float 32bit)
     int AudioChannels {2};                  // timeline audio channels
     int AudioSampleRate {44100};            // timeline audio sample rate
@@ -457,9 +461,9 @@ struct MediaEditorSettings
     int CIEMode {ImGui::XYY};
     int CIEGamuts {ImGui::Rec2020system};
 #else
-    int CIEColorSystem {0};
-    int CIEMode {0};
-    int CIEGamuts {0};
+    int CIEColorSystem {MEC::CpuVideoScope::Rec709system};
+    int CIEMode {MEC::CpuVideoScope::XYY};
+    int CIEGamuts {MEC::CpuVideoScope::Rec2020system};
 #endif
     float CIEContrast {0.75};
     float CIEIntensity {0.5};
@@ -469,6 +473,9 @@ struct MediaEditorSettings
     // Vector Scope tools
     float VectorIntensity {0.5};
 
+    // CPU video scopes only take 1 of every N preview frames
+    int ScopeFrameDecimation {2};
+
     // Audio Wave Scale setting
     float AudioWaveScale    {1.0};
 
@@ -540,6 +547,7 @@ struct MediaEditorSettings
     int OutputVideoBitrate {-1};
     int OutputVideoGOPSize {-1};
     int OutputVideoBFrames {0};
+    int OutputVideoSegments {1};                        // segments exported in parallel
     // Output audio configure
     int OutputAudioCodecIndex {0};
     int OutputAudioCodecTypeIndex {0};
@@ -630,6 +638,7 @@ static ImGui::Waveform_vulkan *     m_waveform {nullptr};
 static ImGui::CIE_vulkan *          m_cie {nullptr};
 static ImGui::Vector_vulkan *       m_vector {nullptr};
 #endif
+static MEC::CpuVideoScope::Holder   m_cpu_scope;
 
 #define MATVIEW_WIDTH   256
 #define MATVIEW_HEIGHT  256
@@ -917,6 +926,20 @@ static void CalculateVideoScope(const ImGui::ImMat& mat)
     if (m_cie && (scope_flags & SCOPE_VIDEO_CIE | need_update_scope)) m_cie->scope(mat, mat_cie, g_media_editor_settings.CIEIntensity, g_media_editor_settings.CIEShowColor);
     if (m_vector && (scope_flags & SCOPE_VIDEO_VECTOR | need_update_scope)) m_vector->scope(mat, mat_vector, g_media_editor_settings.VectorIntensity);
 #endif
+    if (m_cpu_scope && mat.device == IM_DD_CPU)
+    {
+        if (m_cpu_scope->GetFrameDecimation() != (uint32_t)g_media_editor_settings.ScopeFrameDecimation)
+            m_cpu_scope->SetFrameDecimation(g_media_editor_settings.ScopeFrameDecimation);
+        if (m_cpu_scope->CheckFrame(need_update_scope))
+        {
+            // about 1K samples per row is enough for the scope views, larger frames are sampled sparsely
+            m_cpu_scope->SetPixelStep((mat.w + 1023) / 1024);
+            if (scope_flags & SCOPE_VIDEO_HISTOGRAM | need_update_scope) m_cpu_scope->HistogramScope(mat, mat_histogram, 256, g_media_editor_settings.HistogramScale, g_media_editor_settings.HistogramLog);
+            if (scope_flags & SCOPE_VIDEO_WAVEFORM | need_update_scope) m_cpu_scope->WaveformScope(mat, mat_video_waveform, 256, g_media_editor_settings.WaveformIntensity, g_media_editor_settings.WaveformSeparate, g_media_editor_settings.WaveformShowY);
+            if (scope_flags & SCOPE_VIDEO_CIE | need_update_scope) m_cpu_scope->CieScope(mat, mat_cie, g_media_editor_settings.CIEIntensity, g_media_editor_settings.CIEShowColor);
+            if (scope_flags & SCOPE_VIDEO_VECTOR | need_update_scope) m_cpu_scope->VectorScope(mat, mat_vector, g_media_editor_settings.VectorIntensity);
+        }
+    }
     need_update_scope = false;
 }
 
@@ -1414,6 +1437,12 @@ static void ShowConfigure(MediaEditorSettings & config)
                 ImGui::BulletText("UI PowerSaving");
                 ImGui::ToggleButton("##ui_power_saving", &config.powerSaving);
                 ImGui::Separator();
+                ImGui::BulletText("CPU Video Scope Frame Decimation");
+                ImGui::PushItemWidth(200);
+                ImGui::SliderInt("##cpu_scope_frame_decimation", &config.ScopeFrameDecimation, 1, 10, "1/%d");
+                ImGui::PopItemWidth();
+                ImGui::ShowTooltipOnHover("Video scopes calculated on CPU only take 1 of every N preview frames.");
+                ImGui::Separator();
                 ImGui::BulletText("Bank View Style");
                 // ImGui::TextUnformatted("Bank View Style");
                 ImGui::RadioButton("Icons",  (int *)&config.BankViewStyle, 0); ImGui::SameLine();
@@ -1423,6 +1452,17 @@ static void ShowConfigure(MediaEditorSettings & config)
                 ImGui::PushItemWidth(60);
                 ImGui::InputText("##Video_cache_size", buf_cache_size, 64, ImGuiInputTextFlags_CharsDecimal);
                 config.VideoFrameCacheSize = atoi(buf_cache_size);
+                ImGui::PopItemWidth();
+                ImGui::BulletText("Undo History Memory");
+                ImGui::PushItemWidth(200);
+                ImGui::SliderInt("##history_memory_budget", &config.HistoryMemoryBudget, 8, 1024, "%d MB");
+                ImGui::PopItemWidth();
+                ImGui::ShowTooltipOnHover("The older undo records are moved into the cache directory when the history uses more memory than this.");
+                ImGui::BulletText("Auto Save Interval");
+                ImGui::PushItemWidth(200);
+                ImGui::SliderInt("##auto_save_interval", &config.AutoSaveInterval, 0, 60, config.AutoSaveInterval > 0 ? "%d s" : "Off");
+                ImGui::PopItemWidth();
+                ImGui::ShowTooltipOnHover("The unsaved changes are appended to a journal beside the project file, they are recovered if the editor exits abnormally.");
             }
             break;
             case 1:
@@ -1509,6 +1549,8 @@ static void ShowConfigure(MediaEditorSettings & config)
                 ImGui::Combo("Color Space", &config.ColorSpaceIndex, color_getter, (void *)ColorSpace, IM_ARRAYSIZE(ColorSpace));
                 ImGui::Combo("Color Transfer", &config.ColorTransferIndex, color_getter, (void *)ColorTransfer, IM_ARRAYSIZE(ColorTransfer));
                 ImGui::Checkbox("HW codec if available", &config.HardwareCodec); ImGui::SameLine(); ImGui::TextUnformatted("(Restart Application required)");
+                ImGui::Checkbox("Preview with proxy media", &config.UseProxyMedia);
+                ImGui::ShowTooltipOnHover("Decode the low resolution proxy of a media in preview once it's generated. Export always uses the original media.");
                 ImGui::Combo("Video Precision", &config.VideoPrecision, VideoPrecision, IM_ARRAYSIZE(VideoPrecision));
                 ImGui::Separator();
                 ImGui::BulletText(ICON_MEDIA_AUDIO " Audio");
@@ -1686,7 +1728,9 @@ static void NewTimeline()
     g_media_editor_settings.SyncSettingsFromTimeline(timeline);
     timeline->mhProject = g_hProject;
     timeline->mHardwareCodec = g_media_editor_settings.HardwareCodec;
+    timeline->mUseProxyMedia = g_media_editor_settings.UseProxyMedia;
     timeline->mMaxCachedVideoFrame = g_media_editor_settings.VideoFrameCacheSize > 0 ? g_media_editor_settings.VideoFrameCacheSize : MAX_VIDEO_CACHE_FRAMES;
+    timeline->mhHistoryStore->SetMemoryBudget((uint64_t)g_media_editor_settings.HistoryMemoryBudget*1024*1024);
     timeline->mShowHelpTooltips = g_media_editor_settings.ShowHelpTooltips;
     timeline->mAudioAttribute.mAudioSpectrogramLight = g_media_editor_settings.AudioSpectrogramLight;
     timeline->mAudioAttribute.mAudioSpectrogramOffset = g_media_editor_settings.AudioSpectrogramOffset;
@@ -1729,13 +1773,32 @@ static void CleanProject()
     }
 }
 
+// The media bank is checked by its signature when saving, the other changes of the timeline have to be reported
+static void MarkProjectDirty()
+{
+    if (g_hProject && (project_need_save || project_changed))
+        g_hProject->MarkDirty(MEC::Project::SECTION_TIMELINE);
+}
+
+// Called from the edit sites, so the timeline section is only serialized again by the autosave after it's really edited
+static void MarkProjectChanged(bool changed)
+{
+    if (!changed || g_project_loading)
+        return;
+    project_changed = true;
+    if (g_hProject)
+        g_hProject->MarkDirty(MEC::Project::SECTION_TIMELINE);
+}
+
 static void SaveProject()
 {
     if (!timeline || !g_hProject || !g_hProject->IsOpened())
         return;
 
     timeline->Play(false, true);
-    const auto errcode = g_hProject->Save();
+    MarkProjectDirty();
+    // the project file is written by the save worker, its result is polled by 'CheckProjectSaveResult()' on the later frames
+    const auto errcode = g_hProject->Save(true);
     if (errcode == MEC::Project::OK)
     {
         project_need_save = false;
@@ -1749,6 +1812,20 @@ static void SaveProject()
     }
 }
 
+// Returns true if a background save has failed, the changes are kept unsaved so they are saved or autosaved again
+static bool CheckProjectSaveResult()
+{
+    MEC::Project::ErrorCode errcode;
+    if (!g_hProject || !g_hProject->TakeSaveResult(errcode) || errcode == MEC::Project::OK)
+        return false;
+    Logger::Log(Logger::Error) << "FAILED to save current project! Project name is '" << g_hProject->GetProjectName()
+            << "', save job error code is " << (int)errcode << "." << std::endl;
+    project_need_save = true;
+    project_changed = true;
+    g_hProject->MarkDirty(MEC::Project::SECTION_ALL);
+    return true;
+}
+
 static void NewProject()
 {
     SaveProject();
@@ -1767,6 +1844,27 @@ static void NewProject()
     g_media_editor_settings.project_path.clear();
 }
 
+// Opening media parsers on network shares is mostly waiting for I/O, so more threads than CPU cores are allowed
+static const uint32_t MEDIA_BANK_LOADING_MAX_THREADS = 16;
+
+class MediaItemInitTask : public SysUtils::BaseAsyncTask
+{
+public:
+    MediaItemInitTask(MediaItem* pItem) : m_pItem(pItem) {}
+
+protected:
+    bool _TaskProc() override
+    {
+        // an item failed to initialize is still kept in media bank, and shown as a lost media, same as before
+        if (!m_pItem->Initialize(true))
+            Logger::Log(Logger::WARN) << "FAILED to initialize media item '" << m_pItem->mPath << "' while loading project." << std::endl;
+        return true;
+    }
+
+private:
+    MediaItem* m_pItem;
+};
+
 static void LoadProjectThread(std::string path, bool in_splash)
 {
     if (path.empty())
@@ -1809,6 +1907,14 @@ static void LoadProjectThread(std::string path, bool in_splash)
         const auto& jnMediaBank = jnProjContent[attrName].get<imgui_json::array>();
         const auto szItemCnt = jnMediaBank.size();
         float percentage = szItemCnt > 0 ?  0.6 / szItemCnt : 0;
+        // open the media parsers on a thread pool, since probing media on network shares is mostly waiting for I/O,
+        // the overviews are deferred until the items are visible in the media bank or used by the clips on timeline
+        std::vector<MediaItem*> aMediaItems;
+        std::vector<SysUtils::AsyncTask::Holder> aInitTasks;
+        auto hInitExctor = SysUtils::ThreadPoolExecutor::CreateInstance("MediaBankLoadingExctor");
+        const uint32_t u32ThreadCnt = std::min((uint32_t)std::max(szItemCnt, (size_t)1), MEDIA_BANK_LOADING_MAX_THREADS);
+        hInitExctor->SetMaxThreadCount(u32ThreadCnt);
+        hInitExctor->SetMinThreadCount(u32ThreadCnt);
         for (const auto& jnItem : jnMediaBank)
         {
             int64_t id = -1;
@@ -1850,12 +1956,22 @@ static void LoadProjectThread(std::string path, bool in_splash)
 
             MediaItem* item = new MediaItem(name, path, type, timeline);
             if (id != -1) item->mID = id;
-            item->Initialize();
             if (jnItem.contains("meta_data"))
                 item->mMetaData = jnItem["meta_data"];
-            timeline->media_items.push_back(item);
+            SysUtils::AsyncTask::Holder hTask(new MediaItemInitTask(item));
+            hInitExctor->EnqueueTask(hTask);
+            aMediaItems.push_back(item);
+            aInitTasks.push_back(hTask);
+        }
+        // add the items in the order of the project, no matter which one is ready first
+        for (size_t i = 0; i < aMediaItems.size(); i++)
+        {
+            aInitTasks[i]->WaitDone();
+            timeline->media_items.push_back(aMediaItems[i]);
+            timeline->InvalidateIndex(TimeLine::INDEX_MEDIA_ITEM);
             g_project_loading_percentage += percentage;
         }
+        hInitExctor->Terminate(true);
     }
     else
     {
@@ -1986,6 +2102,7 @@ static bool InsertMedia(const std::string path)
             MediaItem * item = new MediaItem(name, path, type, timeline);
             item->Initialize();
             timeline->media_items.push_back(item);
+            timeline->InvalidateIndex(TimeLine::INDEX_MEDIA_ITEM);
             project_need_save = true;
             return project_need_save;
         }
@@ -2030,7 +2147,7 @@ static bool ReloadMedia(std::string path, MediaItem* item)
                             if (IS_IMAGE(clip->mType))
                                 hVidClip = vidTrack->AddImageClip(clip->mID, clip->mMediaParser, clip->Start(), clip->Length());
                             else
-                                hVidClip = vidTrack->AddVideoClip(clip->mID, clip->mMediaParser, clip->Start(), clip->End(), clip->StartOffset(), clip->EndOffset(), timeline->mCurrentTime - clip->Start());
+                                hVidClip = vidTrack->AddVideoClip(clip->mID, timeline->GetPreviewParser(clip), clip->Start(), clip->End(), clip->StartOffset(), clip->EndOffset(), timeline->mCurrentTime - clip->Start());
                             VideoClip* pUiVClip = dynamic_cast<VideoClip*>(clip);
                             pUiVClip->SetDataLayer(hVidClip, true);
                         }
@@ -2208,6 +2325,7 @@ static void ShowMediaPlayWindow(bool &show)
                 MediaItem * item = new MediaItem(name, path, type, timeline);
                 item->Initialize();
                 timeline->media_items.push_back(item);
+                timeline->InvalidateIndex(TimeLine::INDEX_MEDIA_ITEM);
             }
         }
         if (could_be_added)
@@ -2438,8 +2556,11 @@ static std::vector<MediaItem *>::iterator InsertMediaIcon(std::vector<MediaItem
 {
     ImGuiIO& io = ImGui::GetIO();
     ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0, 0, 0, 0));
-    (*item)->UpdateThumbnail();
     ImVec2 icon_size = ImVec2(media_icon_size, media_icon_size);
+    // the overview of an item loaded with a project is deferred until the item is visible
+    if (ImGui::IsRectVisible(icon_pos, icon_pos + icon_size))
+        (*item)->EnsureOverview();
+    (*item)->UpdateThumbnail();
     // Draw Shadow for Icon
     draw_list->AddRectFilled(icon_pos + ImVec2(6, 6), icon_pos + ImVec2(6, 6) + icon_size, IM_COL32(16, 16, 16, 255), 8, ImDrawFlags_RoundCornersAll);
     draw_list->AddRectFilled(icon_pos + ImVec2(4, 4), icon_pos + ImVec2(4, 4) + icon_size, IM_COL32(32, 32, 48, 255), 8, ImDrawFlags_RoundCornersAll);
@@ -2655,6 +2776,24 @@ static std::vector<MediaItem *>::iterator InsertMediaIcon(std::vector<MediaItem
                     ImGui::Button((std::to_string(stream->bitDepth) + "bit").c_str(), ImVec2(24, 24));
                     ImGui::SetWindowFontScale(1.0);
                     ImGui::SameLine(0, 0);
+                    const auto eProxyState = (*item)->mProxyState;
+                    if (eProxyState != MediaItem::PROXY_NONE)
+                    {
+                        const ImVec4 proxy_color = eProxyState == MediaItem::PROXY_READY ? ImVec4(0.3f, 0.85f, 0.3f, 1.0f) :
+                                                eProxyState == MediaItem::PROXY_GENERATING ? ImVec4(0.8f, 0.8f, 0.1f, 1.0f) : ImVec4(0.85f, 0.3f, 0.3f, 1.0f);
+                        ImGui::PushStyleColor(ImGuiCol_Text, proxy_color);
+                        ImGui::SetWindowFontScale(0.6);
+                        ImGui::Button("PXY", ImVec2(24, 24));
+                        ImGui::SetWindowFontScale(1.0);
+                        ImGui::PopStyleColor();
+                        if (eProxyState == MediaItem::PROXY_READY)
+                            ImGui::ShowTooltipOnHover("Proxy is ready%s:\n%s", timeline->mUseProxyMedia ? " and used in preview" : "", (*item)->mProxyPath.c_str());
+                        else if (eProxyState == MediaItem::PROXY_GENERATING)
+                            ImGui::ShowTooltipOnHover("Proxy is generating...");
+                        else
+                            ImGui::ShowTooltipOnHover("Proxy generation FAILED! %s", (*item)->mProxyError.c_str());
+                        ImGui::SameLine(0, 0);
+                    }
                 }
             }
             if (has_audio)
@@ -2783,7 +2922,10 @@ static std::vector<MediaItem *>::iterator InsertMediaIcon(std::vector<MediaItem
                 return it->mID == lit->mID;
             });
             if (m_iter != timeline->media_items.end())
+            {
                 timeline->media_items.erase(m_iter); // first, delete this media_item from timeline->media_items
+                timeline->InvalidateIndex(TimeLine::INDEX_MEDIA_ITEM);
+            }
 
             auto f_iter = std::find_if(timeline->filter_media_items.begin(), timeline->filter_media_items.end(), [it](const MediaItem* lit)
             {
@@ -2801,13 +2943,17 @@ static std::vector<MediaItem *>::iterator InsertMediaIcon(std::vector<MediaItem
                 return it->mID == lit->mID;
             });
             if (iter != timeline->media_items.end())
+            {
                 timeline->media_items.erase(iter); // first, delete this media_item from timeline->media_items
+                timeline->InvalidateIndex(TimeLine::INDEX_MEDIA_ITEM);
+            }
 
             item = timeline->filter_media_items.erase(item); // then, delete this media_item from timeline->filter_media_items
         }
         else
         {
             item = timeline->media_items.erase(item);
+            timeline->InvalidateIndex(TimeLine::INDEX_MEDIA_ITEM);
         }
         delete it;
         // Modify by Jimmy, End
@@ -2859,6 +3005,20 @@ static void ShowMediaBankWindow(ImDrawList *_draw_list, float media_icon_size)
 
                 static float m_sceneDetectParam_fThresh = 0.4;
                 ImGui::SliderFloat("##SceneDetectParamThresh", &m_sceneDetectParam_fThresh, 0, 1, "%.3f", ImGuiSliderFlags_AlwaysClamp | ImGuiSliderFlags_Stick);
+                static int m_sceneDetectParam_iAnalysisWidth = 320;
+                ImGui::SliderInt("Analysis Width##SceneDetectParamAnalysisWidth", &m_sceneDetectParam_iAnalysisWidth, 0, 1920, m_sceneDetectParam_iAnalysisWidth > 0 ? "%d" : "Full", ImGuiSliderFlags_AlwaysClamp);
+                ImGui::ShowTooltipOnHover("Frames are downscaled to this width before scoring. '0' means using the full output size.");
+                static bool m_sceneDetectParam_bLumaOnly = true;
+                ImGui::Checkbox("Luma Only##SceneDetectParamLumaOnly", &m_sceneDetectParam_bLumaOnly);
+                static bool m_sceneDetectParam_bNativeScorer = false;
+                ImGui::Checkbox("Native Scorer##SceneDetectParamNativeScorer", &m_sceneDetectParam_bNativeScorer);
+                ImGui::ShowTooltipOnHover("Score the luma plane directly instead of using the 'select' filter of FFmpeg.");
+                static bool m_sceneDetectParam_bParallel = true;
+                ImGui::Checkbox("Parallel Detection##SceneDetectParamParallel", &m_sceneDetectParam_bParallel);
+                ImGui::ShowTooltipOnHover("Split the source into chunks and detect them on multiple threads.");
+                static bool m_sceneDetectParam_bParkWhenPaused = false;
+                ImGui::Checkbox("Park When Paused##SceneDetectParamPark", &m_sceneDetectParam_bParkWhenPaused);
+                ImGui::ShowTooltipOnHover("Release the decoders and filter graphs while the task is paused, they are rebuilt on resume.");
 
                 bCloseDlg = false;
                 MEC::BackgroundTask::Holder hTask;
@@ -2875,6 +3035,11 @@ static void ShowMediaBankWindow(ImDrawList *_draw_list, float media_icon_size)
                     jnTask["use_src_attr"] = true;
                     // send scene detect params
                     jnTask["scene_detect_thresh"] = imgui_json::number(m_sceneDetectParam_fThresh);
+                    jnTask["analysis_width"] = imgui_json::number(m_sceneDetectParam_iAnalysisWidth);
+                    jnTask["analysis_luma_only"] = m_sceneDetectParam_bLumaOnly;
+                    jnTask["scene_scorer"] = m_sceneDetectParam_bNativeScorer ? "native" : "lavfi";
+                    jnTask["parallel_chunk_count"] = imgui_json::number(m_sceneDetectParam_bParallel ? std::thread::hardware_concurrency() : 1);
+                    jnTask["park_when_paused"] = m_sceneDetectParam_bParkWhenPaused;
                     auto hSettings = timeline->mhMediaSettings->Clone();
                     hTask = MEC::BackgroundTask::CreateBackgroundTask(jnTask, hSettings, timeline->mTxMgr);
                     bCloseDlg = true;
@@ -2884,6 +3049,57 @@ static void ShowMediaBankWindow(ImDrawList *_draw_list, float media_icon_size)
                 return hTask;
             },
         },
+        {
+            "Generate Proxy", "Proxy",
+            [] (MediaItem* pMediaItem) {
+                if (!(timeline && timeline->IsProjectDirReady()))
+                    return false;
+                const auto clipType = pMediaItem->mMediaType;
+                if (!IS_VIDEO(clipType) || IS_IMAGE(clipType) || IS_IMAGESEQ(clipType) || pMediaItem->mProxyPath.empty())
+                    return false;
+                return pMediaItem->mProxyState != MediaItem::PROXY_READY && pMediaItem->mProxyState != MediaItem::PROXY_GENERATING;
+            },
+            [] (MediaItem* pMediaItem, bool& bCloseDlg) {
+                auto hParser = pMediaItem->mhParser;
+                ImColor tTagColor(KNOWNIMGUICOLOR_LIGHTGRAY);
+                ImColor tTextColor(KNOWNIMGUICOLOR_LIGHTGREEN);
+                ImGui::TextColored(tTagColor, "Source File: ");
+                ImGui::SameLine(); ImGui::TextColored(tTextColor, "%s", SysUtils::ExtractFileName(hParser->GetUrl()).c_str());
+                ImGui::ShowTooltipOnHover("Path: '%s'", hParser->GetUrl().c_str());
+                ImGui::TextColored(tTagColor, "Duration: ");
+                ImGui::SameLine(); ImGui::TextColored(tTextColor, "%s", ImGuiHelper::MillisecToString(pMediaItem->mSrcLength).c_str());
+                ImGui::TextColored(tTagColor, "Proxy File: ");
+                ImGui::SameLine(); ImGui::TextColored(tTextColor, "%s", pMediaItem->mProxyPath.c_str());
+
+                static int m_proxyParam_iHeight = 540;
+                ImGui::SliderInt("Proxy Height##ProxyParamHeight", &m_proxyParam_iHeight, 180, 1080, "%d", ImGuiSliderFlags_AlwaysClamp);
+                ImGui::ShowTooltipOnHover("Height of the proxy, the width follows the aspect ratio of the source. A source smaller than this is not upscaled.");
+
+                bCloseDlg = false;
+                MEC::BackgroundTask::Holder hTask;
+                if (ImGui::Button("   OK   "))
+                {
+                    imgui_json::value jnTask;
+                    jnTask["type"] = "Proxy";
+                    jnTask["project_dir"] = timeline->mhProject->GetProjectDir();
+                    jnTask["source_url"] = hParser->GetUrl();
+                    jnTask["media_item_id"] = imgui_json::number(pMediaItem->mID);
+                    jnTask["proxy_path"] = pMediaItem->mProxyPath;
+                    jnTask["proxy_height"] = imgui_json::number(m_proxyParam_iHeight);
+                    auto hSettings = timeline->mhMediaSettings->Clone();
+                    hTask = MEC::BackgroundTask::CreateBackgroundTask(jnTask, hSettings, timeline->mTxMgr);
+                    if (hTask)
+                    {
+                        pMediaItem->mwpProxyTask = hTask;
+                        pMediaItem->mProxyState = MediaItem::PROXY_GENERATING;
+                    }
+                    bCloseDlg = true;
+                } ImGui::SameLine(0, 10);
+                if (ImGui::Button(" Cancel "))
+                    bCloseDlg = true;
+                return hTask;
+            },
+        },
     };
     static size_t s_szBgtaskSelIdx;
     static string s_strBgtaskCreateDlgLabel;
@@ -3284,7 +3500,7 @@ static void ShowMediaBankWindow(ImDrawList *_draw_list, float media_icon_size)
         }
         ImGui::EndChild();
     }
-    if (!g_project_loading) project_changed |= changed;
+    MarkProjectChanged(changed);
 }
 
 /***************************************************************************************
@@ -4236,6 +4452,8 @@ static void ShowMediaOutputWindow(ImDrawList *_draw_list)
             }
             else
                 g_media_editor_settings.OutputVideoBFrames = 0;
+            ImGui::SliderInt("Parallel Segments##video", &g_media_editor_settings.OutputVideoSegments, 1, 32);
+            ImGui::ShowTooltipOnHover("Split the export into segments encoded in parallel, then join them without re-encoding.\nEach segment has its own render graph and encoder, 1 means exporting in one pass.");
             ImGui::EndDisabled(); // disable if disable video
             ImGui::Separator();
 
@@ -4309,12 +4527,9 @@ static void ShowMediaOutputWindow(ImDrawList *_draw_list)
             float pos_x = 0, pos_y = 0;
             if (timeline->mIsEncoding)
             {
+                // the texture is only updated when the encoding threads publish a new preview frame
                 ImGui::ImMat encMatV;
-                {
-                    std::lock_guard<std::mutex> lk(timeline->mEncodingMutex);
-                    encMatV = timeline->mEncodingVFrame;
-                }
-                if (!encMatV.empty())
+                if (timeline->mEncodingPreview.Read(encMatV) && !encMatV.empty())
                 {
                     ImGui::ImMatToTexture(encMatV, timeline->mEncodingPreviewTexture);
                 }
@@ -4367,6 +4582,14 @@ static void ShowMediaOutputWindow(ImDrawList *_draw_list)
                 float estimated_time = (1.f - timeline->mEncodingProgress) * timeline->mEncodingDuration / (encoding_speed + FLT_EPSILON);
                 ImGui::TextUnformatted("Speed:"); ImGui::SameLine(); ImGui::Text("%.2fx", encoding_speed); ImGui::SameLine();
                 ImGui::TextUnformatted("Estimated:"); ImGui::SameLine(); ImGui::Text("%s", ImGuiHelper::MillisecToString(estimated_time * 1000, 1).c_str());
+                const char* stage_names[] = { "Video", "Audio", "Encode" };
+                for (int i = 0; i < TimeLine::ENCODE_STAGE_COUNT; i++)
+                {
+                    const auto& stage_stats = timeline->mEncodeStageStats[i];
+                    if (i > 0) ImGui::SameLine(0, 20);
+                    ImGui::Text("%s: %.1f fps (stall %.0f%%)", stage_names[i], stage_stats.Fps(), stage_stats.StallRatio() * 100);
+                }
+                ImGui::ShowTooltipOnHover("Throughput of the export stages, stall is the time waiting for the other stages.");
             }
             else
             {
@@ -4448,6 +4671,7 @@ static void ShowMediaOutputWindow(ImDrawList *_draw_list)
                     audEncParams.channels = g_media_editor_settings.OutputAudioChannels;
                     audEncParams.sampleRate = g_media_editor_settings.OutputAudioSampleRate;
                     audEncParams.bitRate = 128000;
+                    timeline->mEncodingSegments = g_media_editor_settings.OutputVideoSegments;
                     if (timeline->ConfigEncoder(fullpath, vidEncParams, audEncParams, g_encoderConfigErrorMessage))
                     {
                         timeline->StartEncoding();
@@ -5057,6 +5281,7 @@ static void ShowVideoPreviewWindow(ImDrawList *draw_list, EditingVideoClip* pVid
                     const int64_t i64TickInEvent = timeline->mCurrentTime-(start+pVidEditingClip->mMaskEventStart);
                     if (pVidEditingClip->mhMaskCreator->DrawContent({offset_x, offset_y}, {tf_x-offset_x, tf_y-offset_y}, true, i64TickInEvent))
                     {
+                        pVidEditingClip->NotifyEditingMaskChanged();
                         auto pTrack = timeline->FindTrackByClipID(pVidEditingClip->mID);
                         timeline->RefreshTrackView({ pTrack->mID });
                     }
@@ -5181,7 +5406,7 @@ static void ShowClipBluePrintWindow(ImDrawList *draw_list, BaseEditingClip * edi
                 if (payload->Data)
                 {
                     clip->AppendEvent(hTargetEvent, payload->Data);
-                    project_changed = true;
+                    MarkProjectChanged(true);
                 }
             }
             ImGui::EndDragDropTarget();
@@ -5259,7 +5484,7 @@ static void DrawClipEventWindow(ImDrawList *draw_list, BaseEditingClip * pEditin
         const auto RefreshPreview = [&] ()
         {
             timeline->RefreshTrackView({trackId});
-            project_changed = true;
+            MarkProjectChanged(true);
         };
 
         const auto i64PosInClip = timeline->mCurrentTime-pUiClip->Start();
@@ -5849,6 +6074,7 @@ static void DrawClipEventWindow(ImDrawList *draw_list, BaseEditingClip * pEditin
                     {
                         bKeyFrameEnabled = !bKeyFrameEnabled_;
                         pEdtVidClip->mhMaskCreator->EnableKeyFrames(bKeyFrameEnabled);
+                        pEdtVidClip->NotifyEditingMaskChanged();
                     }
                     ImGui::EndDisabled();
                     ImGui::SetCursorScreenPos({rightIconPosX+(iconIdx++)*iconWidth, currPos.y});
@@ -5865,7 +6091,8 @@ static void DrawClipEventWindow(ImDrawList *draw_list, BaseEditingClip * pEditin
                         auto wdgWidth = sub_window_pos.x+sub_window_size.x-currPos.x-60;
                         const int64_t i64Tick = timeline->mCurrentTime-(pEdtVidClip->mStart+pEdtVidClip->mMaskEventStart);
                         int64_t i64Tick_ = i64Tick;
-                        pEdtVidClip->mhMaskCreator->DrawContourPointKeyFrames(i64Tick_, nullptr, wdgWidth);
+                        if (pEdtVidClip->mhMaskCreator->DrawContourPointKeyFrames(i64Tick_, nullptr, wdgWidth))
+                            pEdtVidClip->NotifyEditingMaskChanged();
                         if (i64Tick != i64Tick_)
                             timeline->Seek(i64Tick_+pEdtVidClip->mStart+pEdtVidClip->mMaskEventStart);
                     }
@@ -6221,7 +6448,7 @@ static void DrawClipEventWindow(ImDrawList *draw_list, BaseEditingClip * pEditin
             ImGui::PopStyleColor();
         ImGui::PopStyleColor();
     }
-    if (!g_project_loading) project_changed |= changed;
+    MarkProjectChanged(changed);
 }
 
 /****************************************************************************************
@@ -6243,7 +6470,7 @@ static bool DrawVideoClipTimelineWindow(bool& show_BP, EditingVideoClip * editin
     ImVec2 sub_window_size = ImGui::GetWindowSize();
     bool timeline_changed = false;
     auto mouse_hold = DrawClipTimeLine(timeline, editing_clip, 30, editing_clip->bEditingAttribute ? 40 : 50, show_BP, timeline_changed);
-    if (!g_project_loading) project_changed |= timeline_changed;
+    MarkProjectChanged(timeline_changed);
     return mouse_hold;
 }
 
@@ -6363,7 +6590,7 @@ static bool DrawVideoClipAttributeEditorWindow(ImDrawList* draw_list, EditingVid
         const auto pTrack = timeline->FindTrackByClipID(pVidEditingClip->mID);
         const int64_t trackId = pTrack ? pTrack->mID : -1;
         timeline->RefreshTrackView({trackId});
-        project_changed = true;
+        MarkProjectChanged(true);
     }
 
     draw_list->PopClipRect();
@@ -7353,7 +7580,7 @@ static bool DrawAudioClipTimelineWindow(bool& show_BP, EditingAudioClip * editin
     ImVec2 sub_window_size = ImGui::GetWindowSize();
     bool timeline_changed = false;
     auto mouse_hild = DrawClipTimeLine(timeline, editing_clip, 30, 50, show_BP, timeline_changed);
-    if (!g_project_loading) project_changed |= timeline_changed;
+    MarkProjectChanged(timeline_changed);
     return mouse_hild;
 }
 
@@ -8614,7 +8841,7 @@ static void ShowAudioMixingWindow(ImDrawList *draw_list, ImRect title_rect)
     ImGui::EndGroup();
 
     ImGui::PopStyleColor();
-    if (!g_project_loading) project_changed |= changed;
+    MarkProjectChanged(changed);
 }
 
 static void ShowBgtaskTab(ImDrawList *draw_list, ImRect title_rect)
@@ -8625,12 +8852,38 @@ static void ShowBgtaskTab(ImDrawList *draw_list, ImRect title_rect)
     ImGui::TextColored(ImColor(KNOWNIMGUICOLOR_GRAY), "Background Task Count: ");
     const auto szBgtaskCnt = aBgtasks.size();
     ImGui::SameLine(0, 10); ImGui::TextColored(ImColor(KNOWNIMGUICOLOR_LIGHTGREEN), "%zu", szBgtaskCnt);
+    auto hScheduler = g_hProject->GetBgtaskScheduler();
+    if (hScheduler)
+    {
+        const auto tStats = hScheduler->GetStats();
+        ImGui::TextColored(ImColor(KNOWNIMGUICOLOR_GRAY), "Queued: "); ImGui::SameLine(0, 4); ImGui::Text("%u", tStats.u32QueuedCount);
+        ImGui::SameLine(0, 16); ImGui::TextColored(ImColor(KNOWNIMGUICOLOR_GRAY), "Running: "); ImGui::SameLine(0, 4); ImGui::Text("%u", tStats.u32RunningCount);
+        ImGui::SameLine(0, 16); ImGui::TextColored(ImColor(KNOWNIMGUICOLOR_GRAY), "Finished: "); ImGui::SameLine(0, 4); ImGui::Text("%u", tStats.u32FinishedCount);
+        ImGui::SameLine(0, 16); ImGui::TextColored(ImColor(KNOWNIMGUICOLOR_GRAY), "Throughput: "); ImGui::SameLine(0, 4); ImGui::Text("%.0f/h", tStats.fThroughput);
+        ImGui::SameLine(0, 16); ImGui::TextColored(ImColor(KNOWNIMGUICOLOR_GRAY), "Avg Time: "); ImGui::SameLine(0, 4); ImGui::Text("%.1fs", tStats.fAvgRunTime);
+        ImGui::TextColored(ImColor(KNOWNIMGUICOLOR_GRAY), "CPU Units: "); ImGui::SameLine(0, 4); ImGui::Text("%u/%u", tStats.u32CpuUnitsInUse, tStats.u32CpuBudget);
+        ImGui::SameLine(0, 16); ImGui::TextColored(ImColor(KNOWNIMGUICOLOR_GRAY), "Memory: "); ImGui::SameLine(0, 4);
+        ImGui::Text("%.0f/%.0f MB", (double)tStats.szMemoryInUse/(1024*1024), (double)tStats.szMemoryBudget/(1024*1024));
+        if (hScheduler->IsThrottled())
+        {
+            ImGui::SameLine(0, 16);
+            ImGui::TextColored(ImColor(0.8f, 0.8f, 0.1f), "Throttled (%u paused)", tStats.u32ThrottledCount);
+        }
+    }
     ImGui::Dummy({0, 6});
     ImGui::BeginChild("##BgTaskList", ImVec2(0, 0), ImGuiChildFlags_Border);
     auto v2TaskViewSize = ImGui::GetContentRegionAvail();
     v2TaskViewSize.y = 0;
+    static const char* s_aPriorityNames[] = { "Low", "Normal", "High" };
     for (const auto& hTask : aBgtasks)
     {
+        int iPriorityIdx = ImClamp(hTask->GetPriority()+1, 0, 2);
+        ImGui::PushID(hTask.get());
+        ImGui::TextColored(ImColor(KNOWNIMGUICOLOR_GRAY), "Priority"); ImGui::SameLine();
+        ImGui::SetNextItemWidth(100);
+        if (ImGui::Combo("##BgtaskPriority", &iPriorityIdx, s_aPriorityNames, IM_ARRAYSIZE(s_aPriorityNames)))
+            hTask->SetPriority(iPriorityIdx-1);
+        ImGui::PopID();
         const bool bRemoveTask = hTask->DrawContent(v2TaskViewSize);
         ImGui::Separator();
         if (bRemoveTask)
@@ -9895,7 +10148,7 @@ static void ShowTextEditorWindow(ImDrawList *draw_list, ImRect title_rect, Editi
         mouse_is_dragging = false;
         ImGui::SetNextFrameWantCaptureMouse(false);
     }
-    if (!g_project_loading) project_changed |= changed;
+    MarkProjectChanged(changed);
 }
 /****************************************************************************************
  * 
@@ -9993,6 +10246,15 @@ static void ShowMediaScopeSetting(int index, bool show_tooltips = true)
                                 g_media_editor_settings.CIECorrectGamma);
             }
 #endif
+            if (cie_setting_changed && m_cpu_scope)
+            {
+                need_update_scope = true;
+                m_cpu_scope->SetCieParam(g_media_editor_settings.CIEColorSystem, 
+                                g_media_editor_settings.CIEMode, 512, 
+                                g_media_editor_settings.CIEGamuts, 
+                                g_media_editor_settings.CIEContrast, 
+                                g_media_editor_settings.CIECorrectGamma);
+            }
             if (ImGui::DragFloat("Intensity##CIEIntensity", &g_media_editor_settings.CIEIntensity, 0.01f, 0.f, 1.f, "%.2f"))
                 need_update_scope = true;
             if (show_tooltips)
@@ -10316,7 +10578,6 @@ static void ShowMediaScopeView(int index, ImVec2 pos, ImVec2 size)
         case 2:
         {
             // cie view
-#if IMGUI_VULKAN_SHADER
             ImGui::BeginGroup();
             ImGui::InvisibleButton("##cie_view", size);
             if (ImGui::IsItemHovered())
@@ -10383,11 +10644,11 @@ static void ShowMediaScopeView(int index, ImVec2 pos, ImVec2 size)
             }
             std::string X_str = "X";
             std::string Y_str = "Y";
-            if (g_media_editor_settings.CIEMode == ImGui::UCS)
+            if (g_media_editor_settings.CIEMode == MEC::CpuVideoScope::UCS)
             {
                 X_str = "U"; Y_str = "C";
             }
-            else if (g_media_editor_settings.CIEMode == ImGui::LUV)
+            else if (g_media_editor_settings.CIEMode == MEC::CpuVideoScope::LUV)
             {
                 X_str = "U"; Y_str = "V";
             }
@@ -10405,6 +10666,7 @@ static void ShowMediaScopeView(int index, ImVec2 pos, ImVec2 size)
             ImGui::SetWindowFontScale(1.0);
             ImGui::PushStyleVar(ImGuiStyleVar_TexGlyphShadowOffset, ImVec2(1, 1));
             ImGui::PushStyleColor(ImGuiCol_TexGlyphShadow, ImGui::ColorConvertU32ToFloat4(IM_COL32_BLACK));
+#if IMGUI_VULKAN_SHADER
             if (m_cie)
             {
                 ImVec2 white_point;
@@ -10418,11 +10680,25 @@ static void ShowMediaScopeView(int index, ImVec2 pos, ImVec2 size)
                 m_cie->GetGreenPoint((ImGui::ColorsSystems)g_media_editor_settings.CIEGamuts, size.x, size.y, &green_point_gamuts.x, &green_point_gamuts.y);
                 draw_list->AddText(scrop_rect.Min + green_point_gamuts, IM_COL32_WHITE, color_system_items[g_media_editor_settings.CIEGamuts]);
             }
+            else
+#endif
+            if (m_cpu_scope)
+            {
+                ImVec2 white_point;
+                m_cpu_scope->GetWhitePoint((MEC::CpuVideoScope::ColorsSystems)g_media_editor_settings.CIEColorSystem, size.x, size.y, &white_point.x, &white_point.y);
+                draw_list->AddCircle(scrop_rect.Min + white_point, 3, IM_COL32_WHITE, 0, 2);
+                draw_list->AddCircle(scrop_rect.Min + white_point, 2, IM_COL32_BLACK, 0, 1);
+                ImVec2 green_point_system;
+                m_cpu_scope->GetGreenPoint((MEC::CpuVideoScope::ColorsSystems)g_media_editor_settings.CIEColorSystem, size.x, size.y, &green_point_system.x, &green_point_system.y);
+                draw_list->AddText(scrop_rect.Min + green_point_system, IM_COL32_WHITE, color_system_items[g_media_editor_settings.CIEColorSystem]);
+                ImVec2 green_point_gamuts;
+                m_cpu_scope->GetGreenPoint((MEC::CpuVideoScope::ColorsSystems)g_media_editor_settings.CIEGamuts, size.x, size.y, &green_point_gamuts.x, &green_point_gamuts.y);
+                draw_list->AddText(scrop_rect.Min + green_point_gamuts, IM_COL32_WHITE, color_system_items[g_media_editor_settings.CIEGamuts]);
+            }
             ImGui::PopStyleColor();
             ImGui::PopStyleVar();
             draw_list->PopClipRect();
             ImGui::EndGroup();
-#endif
         }
         break;
         case 3:
@@ -11350,6 +11626,7 @@ static void MediaEditor_SetupContext(ImGuiContext* ctx, void* handle, bool in_sp
         else if (sscanf(line, "ControlPanelWidth=%f", &val_float) == 1) { setting->ControlPanelWidth = val_float; }
         else if (sscanf(line, "MainViewWidth=%f", &val_float) == 1) { setting->MainViewWidth = val_float; }
         else if (sscanf(line, "HWCodec=%d", &val_int) == 1) { setting->HardwareCodec = val_int == 1; }
+        else if (sscanf(line, "UseProxyMedia=%d", &val_int) == 1) { setting->UseProxyMedia = val_int == 1; }
         else if (sscanf(line, "CustomVideoFrameSize=%d", &val_int) == 1) { setting->isCustomVideoFrameSize = val_int == 1; }
         else if (sscanf(line, "VideoWidth=%d", &val_int) == 1) { setting->VideoWidth = val_int; }
         else if (sscanf(line, "VideoHeight=%d", &val_int) == 1) { setting->VideoHeight = val_int; }
@@ -11363,6 +11640,8 @@ static void MediaEditor_SetupContext(ImGuiContext* ctx, void* handle, bool in_sp
         else if (sscanf(line, "ColorSpaceIndex=%d", &val_int) == 1) { setting->ColorSpaceIndex = val_int; }
         else if (sscanf(line, "ColorTransferIndex=%d", &val_int) == 1) { setting->ColorTransferIndex = val_int; }
         else if (sscanf(line, "VideoFrameCache=%d", &val_int) == 1) { setting->VideoFrameCacheSize = val_int; }
+        else if (sscanf(line, "HistoryMemoryBudget=%d", &val_int) == 1) { setting->HistoryMemoryBudget = ImClamp(val_int, 8, 1024); }
+        else if (sscanf(line, "AutoSaveInterval=%d", &val_int) == 1) { setting->AutoSaveInterval = ImClamp(val_int, 0, 60); }
         else if (sscanf(line, "VideoPrecision=%d", &val_int) == 1) { setting->VideoPrecision = val_int; }
         else if (sscanf(line, "AudioChannels=%d", &val_int) == 1) { setting->AudioChannels = val_int; }
         else if (sscanf(line, "AudioSampleRate=%d", &val_int) == 1) { setting->AudioSampleRate = val_int; }
@@ -11392,6 +11671,7 @@ static void MediaEditor_SetupContext(ImGuiContext* ctx, void* handle, bool in_sp
         else if (sscanf(line, "CIEMode=%d", &val_int) == 1) { setting->CIEMode = val_int; }
         else if (sscanf(line, "CIEGamuts=%d", &val_int) == 1) { setting->CIEGamuts = val_int; }
         else if (sscanf(line, "VectorIntensity=%f", &val_float) == 1) { setting->VectorIntensity = val_float; }
+        else if (sscanf(line, "ScopeFrameDecimation=%d", &val_int) == 1) { setting->ScopeFrameDecimation = ImClamp(val_int, 1, 10); }
         else if (sscanf(line, "AudioWaveScale=%f", &val_float) == 1) { setting->AudioWaveScale = val_float; }
         else if (sscanf(line, "AudioVectorScale=%f", &val_float) == 1) { setting->AudioVectorScale = val_float; }
         else if (sscanf(line, "AudioVectorMode=%d", &val_int) == 1) { setting->AudioVectorMode = val_int; }
@@ -11452,6 +11732,7 @@ static void MediaEditor_SetupContext(ImGuiContext* ctx, void* handle, bool in_sp
         else if (sscanf(line, "OutputVideoBitrate=%d", &val_int) == 1) { setting->OutputVideoBitrate = val_int; }
         else if (sscanf(line, "OutputVideoGOPSize=%d", &val_int) == 1) { setting->OutputVideoGOPSize = val_int; }
         else if (sscanf(line, "OutputVideoBFrames=%d", &val_int) == 1) { setting->OutputVideoBFrames = val_int; }
+        else if (sscanf(line, "OutputVideoSegments=%d", &val_int) == 1) { setting->OutputVideoSegments = ImClamp(val_int, 1, 32); }
         else if (sscanf(line, "OutputAudioCodecIndex=%d", &val_int) == 1) { setting->OutputAudioCodecIndex = val_int; }
         else if (sscanf(line, "OutputAudioCodecTypeIndex=%d", &val_int) == 1) { setting->OutputAudioCodecTypeIndex = val_int; }
         else if (sscanf(line, "OutputAudioSettingAsTimeline=%d", &val_int) == 1) { setting->OutputAudioSettingAsTimeline = val_int == 1; }
@@ -11483,6 +11764,7 @@ static void MediaEditor_SetupContext(ImGuiContext* ctx, void* handle, bool in_sp
         out_buf->appendf("ControlPanelWidth=%f\n", g_media_editor_settings.ControlPanelWidth);
         out_buf->appendf("MainViewWidth=%f\n", g_media_editor_settings.MainViewWidth);
         out_buf->appendf("HWCodec=%d\n", g_media_editor_settings.HardwareCodec ? 1 : 0);
+        out_buf->appendf("UseProxyMedia=%d\n", g_media_editor_settings.UseProxyMedia ? 1 : 0);
         out_buf->appendf("CustomVideoFrameSize=%d\n", g_media_editor_settings.isCustomVideoFrameSize ? 1 : 0);
         out_buf->appendf("VideoWidth=%d\n", g_media_editor_settings.VideoWidth);
         out_buf->appendf("VideoHeight=%d\n", g_media_editor_settings.VideoHeight);
@@ -11496,6 +11778,8 @@ static void MediaEditor_SetupContext(ImGuiContext* ctx, void* handle, bool in_sp
         out_buf->appendf("ColorSpaceIndex=%d\n", g_media_editor_settings.ColorSpaceIndex);
         out_buf->appendf("ColorTransferIndex=%d\n", g_media_editor_settings.ColorTransferIndex);
         out_buf->appendf("VideoFrameCache=%d\n", g_media_editor_settings.VideoFrameCacheSize);
+        out_buf->appendf("HistoryMemoryBudget=%d\n", g_media_editor_settings.HistoryMemoryBudget);
+        out_buf->appendf("AutoSaveInterval=%d\n", g_media_editor_settings.AutoSaveInterval);
         out_buf->appendf("VideoPrecision=%d\n", g_media_editor_settings.VideoPrecision);
         out_buf->appendf("AudioChannels=%d\n", g_media_editor_settings.AudioChannels);
         out_buf->appendf("AudioSampleRate=%d\n", g_media_editor_settings.AudioSampleRate);
@@ -11525,6 +11809,7 @@ static void MediaEditor_SetupContext(ImGuiContext* ctx, void* handle, bool in_sp
         out_buf->appendf("CIEMode=%d\n", g_media_editor_settings.CIEMode);
         out_buf->appendf("CIEGamuts=%d\n", g_media_editor_settings.CIEGamuts);
         out_buf->appendf("VectorIntensity=%f\n", g_media_editor_settings.VectorIntensity);
+        out_buf->appendf("ScopeFrameDecimation=%d\n", g_media_editor_settings.ScopeFrameDecimation);
         out_buf->appendf("AudioWaveScale=%f\n", g_media_editor_settings.AudioWaveScale);
         out_buf->appendf("AudioVectorScale=%f\n", g_media_editor_settings.AudioVectorScale);
         out_buf->appendf("AudioVectorMode=%d\n", g_media_editor_settings.AudioVectorMode);
@@ -11585,6 +11870,7 @@ static void MediaEditor_SetupContext(ImGuiContext* ctx, void* handle, bool in_sp
         out_buf->appendf("OutputVideoBitrate=%d\n", g_media_editor_settings.OutputVideoBitrate);
         out_buf->appendf("OutputVideoGOPSize=%d\n", g_media_editor_settings.OutputVideoGOPSize);
         out_buf->appendf("OutputVideoBFrames=%d\n", g_media_editor_settings.OutputVideoBFrames);
+        out_buf->appendf("OutputVideoSegments=%d\n", g_media_editor_settings.OutputVideoSegments);
         out_buf->appendf("OutputAudioCodecIndex=%d\n", g_media_editor_settings.OutputAudioCodecIndex);
         out_buf->appendf("OutputAudioCodecTypeIndex=%d\n", g_media_editor_settings.OutputAudioCodecTypeIndex);
         out_buf->appendf("OutputAudioSettingAsTimeline=%d\n", g_media_editor_settings.OutputAudioSettingAsTimeline ? 1 : 0);
@@ -11619,6 +11905,12 @@ static void MediaEditor_SetupContext(ImGuiContext* ctx, void* handle, bool in_sp
                             g_media_editor_settings.CIEContrast, 
                             g_media_editor_settings.CIECorrectGamma);
 #endif
+        if (m_cpu_scope)
+            m_cpu_scope->SetCieParam(g_media_editor_settings.CIEColorSystem, 
+                            g_media_editor_settings.CIEMode, 512, 
+                            g_media_editor_settings.CIEGamuts, 
+                            g_media_editor_settings.CIEContrast, 
+                            g_media_editor_settings.CIECorrectGamma);
     };
     ctx->SettingsHandlers.push_back(setting_ini_handler);
 
@@ -11723,13 +12015,20 @@ static void MediaEditor_Initialize(void** handle)
     }
 
     g_hBgtaskExctor = SysUtils::ThreadPoolExecutor::CreateInstance("MecBgtaskExctor");
+    bool gpu_scope_available = false;
 #if IMGUI_VULKAN_SHADER
-    int gpu = ImGui::get_default_gpu_index();
-    m_histogram = new ImGui::Histogram_vulkan(gpu);
-    m_waveform = new ImGui::Waveform_vulkan(gpu);
-    m_cie = new ImGui::CIE_vulkan(gpu);
-    m_vector = new ImGui::Vector_vulkan(gpu);
+    if (ImGui::get_gpu_count() > 0)
+    {
+        int gpu = ImGui::get_default_gpu_index();
+        m_histogram = new ImGui::Histogram_vulkan(gpu);
+        m_waveform = new ImGui::Waveform_vulkan(gpu);
+        m_cie = new ImGui::CIE_vulkan(gpu);
+        m_vector = new ImGui::Vector_vulkan(gpu);
+        gpu_scope_available = true;
+    }
 #endif
+    if (!gpu_scope_available)
+        m_cpu_scope = MEC::CpuVideoScope::CreateInstance();
     g_project_loading = true;
 }
 
@@ -11742,6 +12041,7 @@ static void MediaEditor_Finalize(void** handle)
     if (m_cie) { delete m_cie; m_cie = nullptr; }
     if (m_vector) {delete m_vector; m_vector = nullptr; }
 #endif
+    m_cpu_scope = nullptr;
     ImGui::ImDestroyTexture(&histogram_texture);
     ImGui::ImDestroyTexture(&video_waveform_texture);
     ImGui::ImDestroyTexture(&cie_texture);
@@ -11827,6 +12127,8 @@ static bool MediaEditor_Frame(void * handle, bool app_will_quit)
 #if UI_PERFORMANCE_ANALYSIS
     MediaCore::AutoSection _as("MEFrm");
 #endif
+    // the project content is only edited inside the frame, the project save worker serializes it between the frames
+    MEC::Project::ContentLockGuard _content_lk;
     //static bool first_display = true;
     static bool app_done = false;
     const float media_icon_size = 96; 
@@ -11844,6 +12146,10 @@ static bool MediaEditor_Frame(void * handle, bool app_will_quit)
     static ImGui::MsgBox msgbox_overwrite;
     static const char* buttons_quit[] = { "Overwrite", "Quit", "Cancel", NULL };
     msgbox_overwrite.Init("Overwrite Exist Project?", ICON_MD_WARNING, "Are you really sure you want to overwrite project?", buttons_quit, false);
+    static bool show_save_failed_msg = false;
+    static ImGui::MsgBox msgbox_save_failed;
+    static const char* buttons_ok[] = { "OK", NULL };
+    msgbox_save_failed.Init("Save Project Failed!", ICON_MD_WARNING, "FAILED to write the project file, the changes are NOT saved. Please check the disk space and the permission of the project directory.", buttons_ok, false);
 
     auto platform_io = ImGui::GetPlatformIO();
     bool is_splitter_hold = false;
@@ -11885,6 +12191,15 @@ static bool MediaEditor_Frame(void * handle, bool app_will_quit)
     {
         ImGui::UpdateData();
     }
+    // keep the heavy background tasks away from the cpu while the preview is playing or scrubbing
+    if (g_hProject && g_hProject->GetBgtaskScheduler())
+    {
+        const bool bPreviewBusy = timeline->mIsPreviewPlaying || timeline->bSeeking || (timeline->mMediaPlayer && timeline->mMediaPlayer->IsPlaying());
+        g_hProject->GetBgtaskScheduler()->SetThrottled(bPreviewBusy);
+    }
+    // switch the preview to the proxies generated by the background tasks
+    if (timeline && !g_project_loading)
+        timeline->UpdateMediaProxies();
     ImGui::Begin("Main Editor", nullptr, flags);
 #ifdef DEBUG_IMGUI
     if (show_debug) ImGui::ShowMetricsWindow(&show_debug);
@@ -11985,7 +12300,9 @@ static bool MediaEditor_Frame(void * handle, bool app_will_quit)
                     MediaCore::VideoClip::USE_HWACCEL = g_media_editor_settings.HardwareCodec;
                     needReloadProject = true;
                 }
+                timeline->SetUseProxyMedia(g_media_editor_settings.UseProxyMedia);
                 timeline->mMaxCachedVideoFrame = g_media_editor_settings.VideoFrameCacheSize > 0 ? g_media_editor_settings.VideoFrameCacheSize : MAX_VIDEO_CACHE_FRAMES;
+                timeline->mhHistoryStore->SetMemoryBudget((uint64_t)g_media_editor_settings.HistoryMemoryBudget*1024*1024);
                 timeline->mShowHelpTooltips = g_media_editor_settings.ShowHelpTooltips;
                 timeline->mFontName = g_media_editor_settings.FontName;
 
@@ -12445,8 +12762,26 @@ static bool MediaEditor_Frame(void * handle, bool app_will_quit)
         ImGui::SetCursorScreenPos(panel_pos + ImVec2(32, 0));
         bool timeline_need_save = false;
         auto timeline_changed = DrawTimeLine(timeline,  &_expanded, timeline_need_save, !is_splitter_hold && !mouse_hold && !show_configure && !show_about && !show_file_dialog);
-        if (!g_project_loading) project_changed |= timeline_changed;
+        MarkProjectChanged(timeline_changed);
+        if (timeline_need_save && g_hProject && !g_project_loading)
+            g_hProject->MarkDirty(MEC::Project::SECTION_TIMELINE);
         project_need_save |= timeline_changed | timeline_need_save;
+        if (CheckProjectSaveResult() && !show_save_failed_msg)
+        {
+            show_save_failed_msg = true;
+            msgbox_save_failed.Open();
+        }
+        if (project_need_save && g_hProject && g_hProject->IsOpened() && !g_project_loading)
+        {
+            static double last_autosave_time = ImGui::GetTime();
+            const double now_time = ImGui::GetTime();
+            if (g_media_editor_settings.AutoSaveInterval > 0 && now_time - last_autosave_time >= g_media_editor_settings.AutoSaveInterval)
+            {
+                // skip this round if a save is in progress
+                if (g_hProject->AutoSave() != MEC::Project::NOT_READY)
+                    last_autosave_time = now_time;
+            }
+        }
         if (g_media_editor_settings.BottomViewExpanded != _expanded)
         {
             if (!_expanded)
@@ -12613,6 +12948,7 @@ static bool MediaEditor_Frame(void * handle, bool app_will_quit)
             MEC::Project::ErrorCode ec;
             if (SysUtils::IsDirectory(savePath) || (!SysUtils::Exists(savePath) && fileExt.empty()))
             {  // treat returned path as directory
+                MarkProjectDirty();
                 if (SysUtils::CheckEquivalent(savePath, g_hProject->GetProjectDir()))
                     g_hProject->Save();
                 else
@@ -12645,6 +12981,7 @@ static bool MediaEditor_Frame(void * handle, bool app_will_quit)
             }
             else
             {  // treat returned path as file
+                MarkProjectDirty();
                 if (SysUtils::CheckEquivalent(savePath, g_hProject->GetProjectFilePath()))
                     g_hProject->Save();
                 else
@@ -12707,6 +13044,9 @@ static bool MediaEditor_Frame(void * handle, bool app_will_quit)
         app_done |= app_will_quit;
     }
 
+    if (show_save_failed_msg && msgbox_save_failed.Draw() == 1)
+        show_save_failed_msg = false;
+
     if (show_overwrite_msg || show_overwrite_new_msg || show_overwrite_quit_msg)
     {
         auto msg_ret = msgbox_overwrite.Draw();
@@ -12766,6 +13106,7 @@ static bool MediaEditor_Frame(void * handle, bool app_will_quit)
         // before app quit, close the current project
         if (g_hProject && g_hProject->IsOpened() && !g_hProject->IsUntitled())
         {
+            MarkProjectDirty();
             g_hProject->Save();
             g_media_editor_settings.project_path = g_hProject->GetProjectFilePath();
         }
@@ -26,13 +26,20 @@
 #include <iomanip>
 #include <vector>
 #include <utility>
+#include <map>
+#include <algorithm>
 #include <BaseUtils/ThreadUtils.h>
+#include <BaseUtils/FileSystemUtils.h>
 #include <BaseUtils/MatUtilsImVecHelper.h>
 #include "EventStackFilter.h"
 #include "MediaCore/TextureManager.h"
 #include "MediaCore/MatUtils.h"
 #include "BaseUtils/Logger.h"
 #include "MediaCore/DebugHelper.h"
+extern "C"
+{
+#include "libavformat/avformat.h"
+}
 
 const MediaTimeline::audio_band_config DEFAULT_BAND_CFG[10] = {
     { 32,       32,         0 },        { 64,       64,         0 },
@@ -131,6 +138,16 @@ static bool waveFrameResample(float * wave, int samples, int size, int start_off
     return min_max;
 }
 
+// Resample channel 'ch' for drawing with the min/max pyramid of the media item, which only reads the entries for the visible pixels.
+// The raw waveform is scanned only if the pyramid is not built yet.
+static bool waveformResample(const MEC::WaveformPyramid::Holder& hWavePyramid, const MediaCore::Overview::Waveform::Holder& hWaveform, int ch,
+        int samples, int size, int start_offset, int zoom, ImGui::ImMat& plot_frame_max, ImGui::ImMat& plot_frame_min)
+{
+    if (hWavePyramid && ch < (int)hWavePyramid->GetChannelCount())
+        return hWavePyramid->Resample(ch, start_offset, samples, size, plot_frame_max, plot_frame_min);
+    return waveFrameResample(&hWaveform->pcm[ch][0], samples, size, start_offset, hWaveform->pcm[ch].size(), zoom, plot_frame_max, plot_frame_min);
+}
+
 static void waveformToMat(const MediaCore::Overview::Waveform::Holder wavefrom, ImGui::ImMat& mat, ImVec2 wave_size)
 {
     int channels = wavefrom->pcm.size();
@@ -212,14 +229,12 @@ bool MediaItem::ChangeSource(const std::string& name, const std::string& path)
     return Initialize();
 }
 
-bool MediaItem::Initialize()
+bool MediaItem::Initialize(bool bDeferOverview)
 {
     mValid = false;
     if (mPath.empty() || !ImGuiHelper::file_exists(mPath))
         return false;
 
-    TimeLine* timeline = (TimeLine*)mHandle;
-
     if (IS_TEXT(mMediaType))
     {
         mValid = true;
@@ -236,32 +251,138 @@ bool MediaItem::Initialize()
             if (!mhParser->IsOpened())
                 return false;
         }
-
-        mMediaOverview = MediaCore::Overview::CreateInstance();
-        mMediaOverview->EnableHwAccel(timeline->mHardwareCodec);
-        RenderUtils::TextureManager::TexturePoolAttributes tTxPoolAttrs;
-        if (mTxMgr->GetTexturePoolAttributes(VIDEOITEM_OVERVIEW_GRID_TEXTURE_POOL_NAME, tTxPoolAttrs))
-            mMediaOverview->SetSnapshotSize(tTxPoolAttrs.tTxSize.x, tTxPoolAttrs.tTxSize.y);
-        else
-            mMediaOverview->SetSnapshotResizeFactor(0.05, 0.05);
-        if (!mMediaOverview->Open(mhParser, 64))
+        // identify the media content for the persistent caches here, since it reads the media file
+        if (mContentId.empty() && !IS_IMAGESEQ(mMediaType))
+        {
+            std::string strErrMsg;
+            mContentId = MEC::GetMediaContentId(mPath, strErrMsg);
+        }
+        // the proxies are shared by the projects, pick up the one generated earlier for the same content
+        if (mProxyPath.empty() && !mContentId.empty() && IS_VIDEO(mMediaType) && !IS_IMAGE(mMediaType))
+        {
+            mProxyPath = MEC::GetProxyMediaPath(mContentId);
+            if (!mProxyPath.empty() && ImGuiHelper::file_exists(mProxyPath))
+                OpenProxy();
+        }
+        auto hMediaInfo = mhParser->GetMediaInfo();
+        mSrcLength = hMediaInfo ? hMediaInfo->duration * 1000 : 0;
+        if (bDeferOverview)
+            mOverviewDeferred = true;
+        else if (!OpenOverview())
             return false;
-        mSrcLength = mMediaOverview->GetMediaInfo()->duration * 1000;
         mValid = true;
     }
     return true;
 }
 
+bool MediaItem::OpenOverview()
+{
+    TimeLine* timeline = (TimeLine*)mHandle;
+    mMediaOverview = MediaCore::Overview::CreateInstance();
+    mMediaOverview->EnableHwAccel(timeline->mHardwareCodec);
+    uint32_t u32SnapCount = 64;
+    RenderUtils::TextureManager::TexturePoolAttributes tTxPoolAttrs;
+    if (mTxMgr->GetTexturePoolAttributes(VIDEOITEM_OVERVIEW_GRID_TEXTURE_POOL_NAME, tTxPoolAttrs))
+    {
+        mMediaOverview->SetSnapshotSize(tTxPoolAttrs.tTxSize.x, tTxPoolAttrs.tTxSize.y);
+        // try to load the thumbnails from the persistent cache, so they are shown before the overview is parsed. The overview
+        // is still opened with the whole snapshot count, it feeds the filmstrips of the clips through 'Snapshot::Generator'.
+        mThumbnailCacheKey.clear();
+        mCachedThumbnails.clear();
+        mThumbnailCacheStored = false;
+        auto hThumbCache = IS_VIDEO(mMediaType) && !IS_IMAGE(mMediaType) && !IS_IMAGESEQ(mMediaType) ? MEC::ThumbnailCache::GetInstance() : nullptr;
+        if (hThumbCache)
+        {
+            mThumbnailCacheKey = hThumbCache->MakeKey(mContentId, tTxPoolAttrs.tTxSize.x, tTxPoolAttrs.tTxSize.y, u32SnapCount);
+            if (hThumbCache->Load(mThumbnailCacheKey, mCachedThumbnails))
+                mThumbnailCacheStored = true;
+        }
+    }
+    else
+        mMediaOverview->SetSnapshotResizeFactor(0.05, 0.05);
+    if (!mMediaOverview->Open(mhParser, u32SnapCount))
+    {
+        Logger::Log(Logger::Error) << "FAILED to open 'Overview' for media item '" << mPath << "'! Error is '" << mMediaOverview->GetError() << "'." << std::endl;
+        mMediaOverview = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool MediaItem::EnsureOverview()
+{
+    if (!mOverviewDeferred)
+        return mMediaOverview != nullptr;
+    std::lock_guard<std::mutex> lk(mOverviewLock);
+    if (!mOverviewDeferred)
+        return mMediaOverview != nullptr;
+    const auto bOpened = OpenOverview();
+    mOverviewDeferred = false;
+    return bOpened;
+}
+
 void MediaItem::ReleaseItem()
 {
     mMediaOverview = nullptr;
     mMediaThumbnail.clear();
+    mCachedThumbnails.clear();
+    mThumbnailCacheKey.clear();
+    mThumbnailCacheStored = false;
+    mWaveformPyramid = nullptr;
+    mWaveformPyramidCacheChecked = false;
+    mContentId.clear();
+    mOverviewDeferred = false;
     mSrcLength = 0;
     mValid = false;
+    ReleaseProxy();
+}
+
+bool MediaItem::OpenProxy()
+{
+    auto hParser = MediaCore::MediaParser::CreateInstance();
+    if (!hParser->Open(mProxyPath) || !hParser->GetBestVideoStream())
+    {
+        mProxyError = hParser->GetError();
+        Logger::Log(Logger::WARN) << "FAILED to open proxy '" << mProxyPath << "' of media item '" << mPath << "'! Error is '" << mProxyError << "'." << std::endl;
+        mProxyState = PROXY_FAILED;
+        return false;
+    }
+    mhProxyParser = hParser;
+    mProxyError.clear();
+    mProxyState = PROXY_READY;
+    return true;
+}
+
+void MediaItem::ReleaseProxy()
+{
+    mhProxyParser = nullptr;
+    mProxyPath.clear();
+    mProxyError.clear();
+    mwpProxyTask.reset();
+    mProxyState = PROXY_NONE;
 }
 
 void MediaItem::UpdateThumbnail()
 {
+    if (!mCachedThumbnails.empty())
+    {
+        if (mMediaThumbnail.empty())
+        {
+            for (auto& m : mCachedThumbnails)
+            {
+                auto hTx = mTxMgr->GetGridTextureFromPool(VIDEOITEM_OVERVIEW_GRID_TEXTURE_POOL_NAME);
+                if (hTx)
+                {
+                    hTx->RenderMatToTexture(m);
+                    mMediaThumbnail.push_back(hTx);
+                }
+            }
+        }
+        mCachedThumbnails.clear();
+        return;
+    }
+    if (mThumbnailCacheStored)
+        return;
     if (mMediaOverview && mMediaOverview->IsOpened())
     {
         auto count = mMediaOverview->GetSnapshotCount();
@@ -282,9 +403,38 @@ void MediaItem::UpdateThumbnail()
                     }
                 }
             }
+            if (!mThumbnailCacheKey.empty() && !mThumbnailCacheStored && mMediaOverview->IsDone() && snapshots.size() >= count
+                && std::all_of(snapshots.begin(), snapshots.end(), [] (const ImGui::ImMat& m) { return !m.empty(); }))
+            {
+                auto hThumbCache = MEC::ThumbnailCache::GetInstance();
+                if (hThumbCache && !hThumbCache->Store(mThumbnailCacheKey, snapshots))
+                    Logger::Log(Logger::WARN) << "FAILED to store thumbnails of '" << mPath << "' into cache! Error is '" << hThumbCache->GetError() << "'." << std::endl;
+                mThumbnailCacheStored = true;
+            }
         }
     }
 }
+
+MEC::WaveformPyramid::Holder MediaItem::GetWaveformPyramid()
+{
+    if (mWaveformPyramid || !mMediaOverview || !mMediaOverview->IsOpened() || !mMediaOverview->HasAudio())
+        return mWaveformPyramid;
+    if (!mWaveformPyramidCacheChecked)
+    {
+        mWaveformPyramidCacheChecked = true;
+        mWaveformPyramid = MEC::WaveformPyramid::LoadFromCache(mContentId);
+        if (mWaveformPyramid)
+            return mWaveformPyramid;
+    }
+    auto hWaveform = mMediaOverview->GetWaveform();
+    if (hWaveform && hWaveform->parseDone)
+    {
+        mWaveformPyramid = MEC::WaveformPyramid::Build(*hWaveform);
+        if (mWaveformPyramid && !mContentId.empty() && !mWaveformPyramid->SaveToCache(mContentId))
+            Logger::Log(Logger::WARN) << "FAILED to save waveform pyramid of '" << mPath << "' into cache! Error is '" << mWaveformPyramid->GetError() << "'." << std::endl;
+    }
+    return mWaveformPyramid;
+}
 } //namespace MediaTimeline
 
 namespace MediaTimeline
@@ -1110,6 +1260,7 @@ void Clip::Cutting(int64_t pos, int64_t gid, int64_t newClipId, std::list<imgui_
                 {
                     if (overlap->m_Clip.first == mID) overlap->m_Clip.first = newClipId;
                     if (overlap->m_Clip.second == mID) overlap->m_Clip.second = newClipId;
+                    track->mOverlapIndexDirty = true;
                 }
             }
         }
@@ -1959,6 +2110,43 @@ VideoClip* VideoClip::CreateInstance(TimeLine* pOwner, MediaItem* pMediaItem, in
     return CreateInstance(pOwner, strClipName, pMediaItem, tClipRange.first, tClipRange.second, 0, 0);
 }
 
+// The crop of the transform filter is counted in the pixels of the decoded frame. The clip json always keeps the values for the
+// original media, only the data layer clip which decodes the proxy media carries the scaled ones.
+static bool GetFrameSizeScale(const MediaCore::MediaParser::Holder& hFromParser, const MediaCore::MediaParser::Holder& hToParser, double& dScaleX, double& dScaleY)
+{
+    if (!hFromParser || !hToParser || hFromParser == hToParser)
+        return false;
+    auto pFromVidstm = hFromParser->GetBestVideoStream();
+    auto pToVidstm = hToParser->GetBestVideoStream();
+    if (!pFromVidstm || !pToVidstm || pFromVidstm->width <= 0 || pFromVidstm->height <= 0
+        || (pFromVidstm->width == pToVidstm->width && pFromVidstm->height == pToVidstm->height))
+        return false;
+    dScaleX = (double)pToVidstm->width/pFromVidstm->width;
+    dScaleY = (double)pToVidstm->height/pFromVidstm->height;
+    return true;
+}
+
+static void ScaleTransformCrop(const MediaCore::VideoTransformFilter::Holder& hTransFilter, double dScaleX, double dScaleY)
+{
+    hTransFilter->SetCrop(
+            (uint32_t)round(hTransFilter->GetCropL()*dScaleX), (uint32_t)round(hTransFilter->GetCropT()*dScaleY),
+            (uint32_t)round(hTransFilter->GetCropR()*dScaleX), (uint32_t)round(hTransFilter->GetCropB()*dScaleY));
+    // the crop curves hold (left, top) and (right, bottom) in DIM X and Y
+    for (auto& hCurve : hTransFilter->GetKeyFramesCurveOnCrop())
+        hCurve->ScaleKeyPoints(ImGui::ImNewCurve::KeyPoint::ValType((float)dScaleX, (float)dScaleY, 1.f, 1.f));
+}
+
+imgui_json::value VideoClip::SaveTransformFilterJson() const
+{
+    auto hTransFilter = mhDataLayerClip->GetTransformFilter();
+    double dScaleX, dScaleY;
+    if (!GetFrameSizeScale(mhDataLayerClip->GetMediaParser(), mMediaParser, dScaleX, dScaleY))
+        return hTransFilter->SaveAsJson();
+    auto hOrgTransFilter = hTransFilter->Clone(((TimeLine*)mHandle)->mhMediaSettings);
+    ScaleTransformCrop(hOrgTransFilter, dScaleX, dScaleY);
+    return hOrgTransFilter->SaveAsJson();
+}
+
 imgui_json::value VideoClip::SaveAsJson()
 {
     imgui_json::value j = Clip::SaveAsJson();
@@ -1968,7 +2156,7 @@ imgui_json::value VideoClip::SaveAsJson()
 
     if (mhDataLayerClip)
     {
-        j["TransformFilter"] = mhDataLayerClip->GetTransformFilter()->SaveAsJson();
+        j["TransformFilter"] = SaveTransformFilterJson();
         const auto hVFilter = mhDataLayerClip->GetFilter();
         if (hVFilter)
             j["VideoFilter"] = hVFilter->SaveAsJson();
@@ -2024,6 +2212,14 @@ VideoClip* VideoClip::CreateInstanceFromJson(const imgui_json::value& j, TimeLin
 
 bool VideoClip::UpdateClip(MediaItem* pMediaItem)
 {
+    TimeLine* pOwner = (TimeLine*)mHandle;
+    // the overview and the snapshots are only used to draw the clip, a headless timeline never opens them
+    const bool bHeadless = pOwner && pOwner->mIsHeadless;
+    if (!bHeadless && !pMediaItem->EnsureOverview())
+    {
+        Logger::Log(Logger::Error) << "FAILED to perform 'VideoClip::UpdateClip()'! CANNOT open overview of '" << pMediaItem->mPath << "'." << std::endl;
+        return false;
+    }
     auto pVidstm = pMediaItem->mhParser->GetBestVideoStream();
     if (!pVidstm)
     {
@@ -2048,11 +2244,10 @@ bool VideoClip::UpdateClip(MediaItem* pMediaItem)
             Logger::Log(Logger::Error) << "WRONG media type! Try to use an IMAGE source to create a NON-IMAGE 'VideoClip'. Url is '" << mPath << "'." << std::endl;
             return false;
         }
-        TimeLine* pOwner = (TimeLine*)mHandle;
-        auto hSsGen = pOwner->GetSnapshotGenerator(pMediaItem->mID);
+        auto hSsGen = bHeadless ? nullptr : pOwner->GetSnapshotGenerator(pMediaItem->mID);
         if (hSsGen)
             hSsViewer = hSsGen->CreateViewer();
-        else
+        else if (!bHeadless)
         {
             Logger::Log(Logger::WARN) << "FAILED to retrieve 'Snapshot::Generator' for 'VideoClip' built on '" << mPath << "'! Then no 'Snapshot::Viewer' is available." << std::endl;
             return false;
@@ -2287,6 +2482,12 @@ void VideoClip::SyncStateToDataLayer()
             Logger::Log(Logger::WARN) << "FAILED to sync 'TransformFilter' json to 'VideoClip' on '" << mPath << "'. Transform filter json is:" << std::endl;
             Logger::Log(Logger::WARN) << jnTransformFilterJson.dump() << std::endl << std::endl;
         }
+        else
+        {
+            double dScaleX, dScaleY;
+            if (GetFrameSizeScale(mMediaParser, mhDataLayerClip->GetMediaParser(), dScaleX, dScaleY))
+                ScaleTransformCrop(mhDataLayerClip->GetTransformFilter(), dScaleX, dScaleY);
+        }
     }
 }
 
@@ -2327,7 +2528,7 @@ void VideoClip::SyncStateFromDataLayer()
     mClipJson["VideoFilter"] = hVFilter->SaveAsJson();
 
     // sync 'TransformFilter' from data-layer to clip json
-    mClipJson["TransformFilter"] = mhDataLayerClip->GetTransformFilter()->SaveAsJson();
+    mClipJson["TransformFilter"] = SaveTransformFilterJson();
 }
 } // namespace MediaTimeline
 
@@ -2452,6 +2653,14 @@ AudioClip* AudioClip::CreateInstanceFromJson(const imgui_json::value& j, TimeLin
 
 bool AudioClip::UpdateClip(MediaItem* pMediaItem)
 {
+    TimeLine* pOwner = (TimeLine*)mHandle;
+    // the overview is only used to draw the waveform, a headless timeline never opens it
+    const bool bHeadless = pOwner && pOwner->mIsHeadless;
+    if (!bHeadless && !pMediaItem->EnsureOverview())
+    {
+        Logger::Log(Logger::Error) << "FAILED to perform 'AudioClip::UpdateClip()'! CANNOT open overview of '" << pMediaItem->mPath << "'." << std::endl;
+        return false;
+    }
     auto pAudstm = pMediaItem->mhParser->GetBestAudioStream();
     if (!pAudstm)
     {
@@ -2463,7 +2672,7 @@ bool AudioClip::UpdateClip(MediaItem* pMediaItem)
     mMediaParser = pMediaItem->mhParser;
     mhOverview = pMediaItem->mMediaOverview;
     mPath = mMediaParser->GetUrl();
-    mWaveform = mhOverview->GetWaveform();
+    mWaveform = mhOverview ? mhOverview->GetWaveform() : nullptr;
     mAudioChannels = pAudstm->channels;
     mAudioChannels = pAudstm->sampleRate;
     return true;
@@ -2568,30 +2777,37 @@ void AudioClip::DrawContent(ImDrawList* drawList, const ImVec2& leftTop, const I
         ImGui::SetWindowFontScale(1.0);
         return;
     }
-    if (timeline->media_items.size() <= 0 || !mWaveform)
+    if (timeline->media_items.size() <= 0)
+        return;
+    // prefer the waveform pyramid, which is available before the waveform is parsed if it's cached,
+    // and only reads the entries for the visible pixels at any zoom level
+    auto hWavePyramid = mpMediaItem ? mpMediaItem->GetWaveformPyramid() : nullptr;
+    if (!hWavePyramid && !mWaveform)
         return;
 
     ImVec2 draw_size = rightBottom - leftTop;
 
-    if (mWaveform->pcm.size() > 0)
+    if (hWavePyramid || mWaveform->pcm.size() > 0)
     {
         std::string id_string = "##Waveform@" + std::to_string(mID);
         drawList->AddRectFilled(leftTop, rightBottom, IM_COL32(16, 16, 16, 255));
         drawList->AddRect(leftTop, rightBottom, IM_COL32_BLACK);
-        float wave_range = fmax(fabs(mWaveform->minSample), fabs(mWaveform->maxSample));
-        int sampleSize = mWaveform->pcm[0].size();
+        float wave_range = hWavePyramid ? fmax(fabs(hWavePyramid->GetMinSample()), fabs(hWavePyramid->GetMaxSample()))
+                : fmax(fabs(mWaveform->minSample), fabs(mWaveform->maxSample));
+        int sampleSize = hWavePyramid ? hWavePyramid->GetSampleCount() : mWaveform->pcm[0].size();
+        const double aggregate_duration = hWavePyramid ? hWavePyramid->GetAggregateDuration() : mWaveform->aggregateDuration;
         int64_t start_time = std::max(Start(), timeline->firstTime);
         int64_t end_time = std::min(End(), timeline->lastTime);
-        int start_offset = (int)((double)StartOffset() / 1000.f / mWaveform->aggregateDuration);
+        int start_offset = (int)((double)StartOffset() / 1000.f / aggregate_duration);
         if (Start() < timeline->firstTime)
-            start_offset = (int)((double)(timeline->firstTime - Start() + StartOffset()) / 1000.f / mWaveform->aggregateDuration);
+            start_offset = (int)((double)(timeline->firstTime - Start() + StartOffset()) / 1000.f / aggregate_duration);
         start_offset = std::max(start_offset, 0);
-        int window_length = (int)((double)(end_time - start_time) / 1000.f / mWaveform->aggregateDuration);
+        int window_length = (int)((double)(end_time - start_time) / 1000.f / aggregate_duration);
         window_length = std::min(window_length, sampleSize);
         ImVec2 customViewStart = ImVec2((start_time - timeline->firstTime) * timeline->msPixelWidthTarget + clipRect.Min.x, clipRect.Min.y);
         ImVec2 customViewEnd = ImVec2((end_time - timeline->firstTime)  * timeline->msPixelWidthTarget + clipRect.Min.x, clipRect.Max.y);
         auto window_size = customViewEnd - customViewStart;
-        if (window_size.x > 0 && mWaveform->pcm[0].size() > 0)
+        if (window_size.x > 0 && sampleSize > 0)
         {
             int sample_stride = window_length / window_size.x;
             if (sample_stride <= 0) sample_stride = 1;
@@ -2599,28 +2815,37 @@ void AudioClip::DrawContent(ImDrawList* drawList, const ImVec2& leftTop, const I
             int zoom = ImMin(sample_stride, min_zoom);
             drawList->PushClipRect(leftTop, rightBottom, true);
 #if PLOT_IMPLOT
-            start_offset = start_offset / zoom * zoom; // align start_offset
-            ImGui::SetCursorScreenPos(customViewStart);
-            ImPlot::PushStyleVar(ImPlotStyleVar_PlotPadding, {0, 0});
-            ImPlot::PushStyleVar(ImPlotStyleVar_PlotBorderSize, 0.f);
-            ImPlot::PushStyleColor(ImPlotCol_PlotBg, {0, 0, 0, 0});
-            if (ImPlot::BeginPlot(id_string.c_str(), window_size, ImPlotFlags_CanvasOnly | ImPlotFlags_NoFrame | ImPlotFlags_NoInputs))
+            if (hWavePyramid || (!mWaveform->pcm.empty() && !mWaveform->pcm[0].empty()))
             {
-                std::string plot_id = id_string + "_line";
-                ImPlot::SetupAxes(NULL, NULL, ImPlotAxisFlags_NoDecorations, ImPlotAxisFlags_NoDecorations);
-                ImPlot::SetupAxesLimits(0, window_length / zoom, -wave_range / 2, wave_range / 2, ImGuiCond_Always);
-                ImPlot::PlotLine(plot_id.c_str(), &mWaveform->pcm[0][start_offset], window_length / zoom, 1.0, 0.0, 0, 0, sizeof(float) * zoom);
-                ImPlot::EndPlot();
+                start_offset = start_offset / sample_stride * sample_stride; // align start_offset
+                ImGui::ImMat plot_frame_max, plot_frame_min;
+                waveformResample(hWavePyramid, mWaveform, 0, sample_stride, window_size.x, start_offset, zoom, plot_frame_max, plot_frame_min);
+                ImGui::SetCursorScreenPos(customViewStart);
+                ImPlot::PushStyleVar(ImPlotStyleVar_PlotPadding, {0, 0});
+                ImPlot::PushStyleVar(ImPlotStyleVar_PlotBorderSize, 0.f);
+                ImPlot::PushStyleColor(ImPlotCol_PlotBg, {0, 0, 0, 0});
+                if (ImPlot::BeginPlot(id_string.c_str(), window_size, ImPlotFlags_CanvasOnly | ImPlotFlags_NoFrame | ImPlotFlags_NoInputs))
+                {
+                    std::string plot_max_id = id_string + "_line_max";
+                    std::string plot_min_id = id_string + "_line_min";
+                    ImPlot::SetupAxes(NULL, NULL, ImPlotAxisFlags_NoDecorations, ImPlotAxisFlags_NoDecorations);
+                    ImPlot::SetupAxesLimits(0, plot_frame_max.w, -wave_range / 2, wave_range / 2, ImGuiCond_Always);
+                    ImPlot::PlotLine(plot_max_id.c_str(), (float *)plot_frame_max.data, plot_frame_max.w);
+                    ImPlot::PlotLine(plot_min_id.c_str(), (float *)plot_frame_min.data, plot_frame_min.w);
+                    ImPlot::EndPlot();
+                }
+                ImPlot::PopStyleColor();
+                ImPlot::PopStyleVar(2);
             }
-            ImPlot::PopStyleColor();
-            ImPlot::PopStyleVar(2);
 #elif PLOT_TEXTURE
-            if (!mWaveformTexture || updated || !mWaveform->parseDone)
+            const bool bWaveformUpdating = !hWavePyramid && !mWaveform->parseDone;
+            if (!mWaveformTexture || updated || bWaveformUpdating || mWaveformTextureFromPyramid != (bool)hWavePyramid)
             {
                 ImGui::ImMat plot_mat;
                 start_offset = start_offset / sample_stride * sample_stride; // align start_offset
                 ImGui::ImMat plot_frame_max, plot_frame_min;
-                auto filled = waveFrameResample(&mWaveform->pcm[0][0], sample_stride, draw_size.x, start_offset, sampleSize, zoom, plot_frame_max, plot_frame_min);
+                auto filled = waveformResample(hWavePyramid, mWaveform, 0, sample_stride, draw_size.x, start_offset, zoom, plot_frame_max, plot_frame_min);
+                mWaveformTextureFromPyramid = (bool)hWavePyramid;
                 ImGui::PushStyleColor(ImGuiCol_PlotLines, ImVec4(0.4f, 0.4f, 1.0f, 1.0f));
                 ImGui::PushStyleColor(ImGuiCol_PlotHistogram, ImVec4(0.3f, 0.3f, 0.8f, 0.5f));
                 if (filled)
@@ -2648,7 +2873,7 @@ void AudioClip::DrawContent(ImDrawList* drawList, const ImVec2& leftTop, const I
                 std::string plot_max_id = id_string + "_line_max";
                 std::string plot_min_id = id_string + "_line_min";
                 ImGui::ImMat plot_frame_max, plot_frame_min;
-                waveFrameResample(&mWaveform->pcm[0][0], sample_stride, draw_size.x, start_offset, sampleSize, zoom, plot_frame_max, plot_frame_min);
+                waveformResample(hWavePyramid, mWaveform, 0, sample_stride, draw_size.x, start_offset, zoom, plot_frame_max, plot_frame_min);
                 ImGui::SetCursorScreenPos(customViewStart);
                 ImGui::PlotLinesEx(plot_max_id.c_str(), (float *)plot_frame_max.data, plot_frame_max.w, 0, nullptr, -wave_range, wave_range, draw_size, sizeof(float), false, true);
                 ImGui::SetCursorScreenPos(customViewStart);
@@ -3064,7 +3289,7 @@ int BluePrintVideoTransition::OnBluePrintChange(int type, std::string name, void
             if (timeline) timeline->RefreshPreview();
         }
     }
-    if (timeline) timeline->mIsBluePrintChanged = true;
+    if (timeline) timeline->MarkBluePrintChanged();
     return ret;
 }
 
@@ -3172,7 +3397,7 @@ int BluePrintAudioTransition::OnBluePrintChange(int type, std::string name, void
             //if (timeline) timeline->UpdatePreview();
         }
     }
-    if (timeline) timeline->mIsBluePrintChanged = true;
+    if (timeline) timeline->MarkBluePrintChanged();
     return ret;
 }
 
@@ -3609,6 +3834,7 @@ void EditingVideoClip::CalcDisplayParams(int64_t viewWndDur)
 void EditingVideoClip::SelectEditingMask(MEC::Event::Holder hEvent, int64_t nodeId, int maskIndex, ImGui::MaskCreator::Holder hMaskCreator)
 {
     mhMaskCreator = hMaskCreator;
+    mwpMaskEvent = hEvent;
     mMaskEventId = hEvent ? hEvent->Id() : -1;
     mMaskNodeId = nodeId;
     mMaskIndex = maskIndex;
@@ -3619,11 +3845,21 @@ void EditingVideoClip::SelectEditingMask(MEC::Event::Holder hEvent, int64_t node
 void EditingVideoClip::UnselectEditingMask()
 {
     mhMaskCreator = nullptr;
+    mwpMaskEvent.reset();
     mMaskEventId = mMaskNodeId = -1;
     mMaskIndex = -1;
     mMaskEventStart = mMaskEventEnd = 0;
 }
 
+void EditingVideoClip::NotifyEditingMaskChanged()
+{
+    // opacity masks are owned by the transform filter, they are not cached as the event masks
+    auto hEvent = mwpMaskEvent.lock();
+    auto pVidEvt = dynamic_cast<MEC::VideoEvent*>(hEvent.get());
+    if (pVidEvt)
+        pVidEvt->NotifyMaskChanged();
+}
+
 bool EditingVideoClip::DrawAttributeCurves(const ImVec2& v2ViewSize, float fViewScaleX, float fViewOffsetX, bool* pCurveUpdated, ImDrawList* pDrawList)
 {
     return mhAttrCurveEditor->DrawContent("##VidClipAttrCurves", v2ViewSize, fViewScaleX, fViewOffsetX, 0, pCurveUpdated, pDrawList);
@@ -3714,6 +3950,7 @@ void EditingAudioClip::DrawContent(ImDrawList* drawList, const ImVec2& leftTop,
     if (!aclip->mWaveform || aclip->mWaveform->pcm.size() <= 0)
         return;
     MediaCore::Overview::Waveform::Holder waveform = aclip->mWaveform;
+    auto hWavePyramid = aclip->mpMediaItem ? aclip->mpMediaItem->GetWaveformPyramid() : nullptr;
     drawList->AddRectFilled(leftTop, rightBottom, IM_COL32(16, 16, 16, 255));
     drawList->AddRect(leftTop, rightBottom, IM_COL32(128, 128, 128, 255));
     float wave_range = fmax(fabs(waveform->minSample), fabs(waveform->maxSample));
@@ -3735,16 +3972,20 @@ void EditingAudioClip::DrawContent(ImDrawList* drawList, const ImVec2& leftTop,
         int min_zoom = ImMax(window_length >> 13, 16);
         int zoom = ImMin(sample_stride, min_zoom);
 #if PLOT_IMPLOT
-        start_offset = start_offset / zoom * zoom; // align start_offset
+        start_offset = start_offset / sample_stride * sample_stride; // align start_offset
+        ImGui::ImMat plot_frame_max, plot_frame_min;
+        waveformResample(hWavePyramid, waveform, i, sample_stride, window_size.x, start_offset, zoom, plot_frame_max, plot_frame_min);
         ImPlot::PushStyleVar(ImPlotStyleVar_PlotPadding, {0, 0});
         ImPlot::PushStyleVar(ImPlotStyleVar_PlotBorderSize, 0.f);
         ImPlot::PushStyleColor(ImPlotCol_PlotBg, {0, 0, 0, 0});
         if (ImPlot::BeginPlot(id_string.c_str(), window_size, ImPlotFlags_CanvasOnly | ImPlotFlags_NoFrame | ImPlotFlags_NoInputs))
         {
-            std::string plot_id = id_string + "_line";
+            std::string plot_max_id = id_string + "_line_max";
+            std::string plot_min_id = id_string + "_line_min";
             ImPlot::SetupAxes(NULL, NULL, ImPlotAxisFlags_NoDecorations, ImPlotAxisFlags_NoDecorations);
-            ImPlot::SetupAxesLimits(0, window_length / zoom, -wave_range, wave_range, ImGuiCond_Always);
-            ImPlot::PlotLine(plot_id.c_str(), &waveform->pcm[i][start_offset], window_length / zoom, 1.0, 0.0, 0, 0, sizeof(float) * zoom);
+            ImPlot::SetupAxesLimits(0, plot_frame_max.w, -wave_range, wave_range, ImGuiCond_Always);
+            ImPlot::PlotLine(plot_max_id.c_str(), (float *)plot_frame_max.data, plot_frame_max.w);
+            ImPlot::PlotLine(plot_min_id.c_str(), (float *)plot_frame_min.data, plot_frame_min.w);
             ImPlot::EndPlot();
         }
         ImPlot::PopStyleColor();
@@ -3756,7 +3997,7 @@ void EditingAudioClip::DrawContent(ImDrawList* drawList, const ImVec2& leftTop,
             ImGui::ImMat plot_mat;
             start_offset = start_offset / sample_stride * sample_stride; // align start_offset
             ImGui::ImMat plot_frame_max, plot_frame_min;
-            auto filled = waveFrameResample(&mWaveform->pcm[i][0], sample_stride, window_size.x, start_offset, sampleSize, zoom, plot_frame_max, plot_frame_min);
+            auto filled = waveformResample(hWavePyramid, waveform, i, sample_stride, window_size.x, start_offset, zoom, plot_frame_max, plot_frame_min);
             ImGui::PushStyleColor(ImGuiCol_PlotLines, ImVec4(0.4f, 0.8f, 0.4f, 1.0f));
             ImGui::PushStyleColor(ImGuiCol_PlotHistogram, ImVec4(0.3f, 0.8f, 0.3f, 0.5f));
             if (filled)
@@ -3787,7 +4028,7 @@ void EditingAudioClip::DrawContent(ImDrawList* drawList, const ImVec2& leftTop,
             std::string plot_max_id = id_string + "_line_max";
             std::string plot_min_id = id_string + "_line_min";
             ImGui::ImMat plot_frame_max, plot_frame_min;
-            waveFrameResample(&mWaveform->pcm[i][0], sample_stride, window_size.x, start_offset, sampleSize, zoom, plot_frame_max, plot_frame_min);
+            waveformResample(hWavePyramid, waveform, i, sample_stride, window_size.x, start_offset, zoom, plot_frame_max, plot_frame_min);
             ImGui::SetCursorScreenPos(leftTop + ImVec2(0, i * window_size.y));
             ImGui::PlotLinesEx(plot_max_id.c_str(), (float *)plot_frame_max.data, plot_frame_max.w, 0, nullptr, -wave_range, wave_range, window_size, sizeof(float), false, true);
             ImGui::SetCursorScreenPos(leftTop + ImVec2(0, i * window_size.y));
@@ -4563,6 +4804,7 @@ void EditingAudioOverlap::DrawContent(ImDrawList* drawList, const ImVec2& leftTo
         drawList->AddRect(leftTop, leftTop + window_size, IM_COL32(128, 128, 128, 255));
 
         MediaCore::Overview::Waveform::Holder waveform = mClip1->mWaveform;
+        auto hWavePyramid = mClip1->mpMediaItem ? mClip1->mpMediaItem->GetWaveformPyramid() : nullptr;
         float wave_range = fmax(fabs(waveform->minSample), fabs(waveform->maxSample));
         int64_t start_time = std::max(mClip1->Start(), mStart);
         int64_t end_time = std::min(mClip1->End(), mEnd);
@@ -4586,13 +4828,17 @@ void EditingAudioOverlap::DrawContent(ImDrawList* drawList, const ImVec2& leftTo
             int min_zoom = ImMax(window_length >> 13, 16);
             int zoom = ImMin(sample_stride, min_zoom);
 #if PLOT_IMPLOT
-            start_offset = start_offset / zoom * zoom; // align start_offset
+            start_offset = start_offset / sample_stride * sample_stride; // align start_offset
+            ImGui::ImMat plot_frame_max, plot_frame_min;
+            waveformResample(hWavePyramid, waveform, i, sample_stride, clip_window_size.x, start_offset, zoom, plot_frame_max, plot_frame_min);
             if (ImPlot::BeginPlot(id_string.c_str(), clip_window_size, ImPlotFlags_CanvasOnly | ImPlotFlags_NoFrame | ImPlotFlags_NoInputs))
             {
-                std::string plot_id = id_string + "_line";
+                std::string plot_max_id = id_string + "_line_max";
+                std::string plot_min_id = id_string + "_line_min";
                 ImPlot::SetupAxes(NULL, NULL, ImPlotAxisFlags_NoDecorations, ImPlotAxisFlags_NoDecorations);
-                ImPlot::SetupAxesLimits(0, window_length / zoom, -wave_range, wave_range, ImGuiCond_Always);
-                ImPlot::PlotLine(plot_id.c_str(), &waveform->pcm[i][start_offset], window_length / zoom, 1.0, 0.0, 0, 0, sizeof(float) * zoom);
+                ImPlot::SetupAxesLimits(0, plot_frame_max.w, -wave_range, wave_range, ImGuiCond_Always);
+                ImPlot::PlotLine(plot_max_id.c_str(), (float *)plot_frame_max.data, plot_frame_max.w);
+                ImPlot::PlotLine(plot_min_id.c_str(), (float *)plot_frame_min.data, plot_frame_min.w);
                 ImPlot::EndPlot();
             }
 #elif PLOT_TEXTURE
@@ -4602,7 +4848,7 @@ void EditingAudioOverlap::DrawContent(ImDrawList* drawList, const ImVec2& leftTo
                 ImGui::ImMat plot_mat;
                 start_offset = start_offset / sample_stride * sample_stride; // align start_offset
                 ImGui::ImMat plot_frame_max, plot_frame_min;
-                auto filled = waveFrameResample(&waveform->pcm[i][0], sample_stride, clip_window_size.x, start_offset, sampleSize, zoom, plot_frame_max, plot_frame_min);
+                auto filled = waveformResample(hWavePyramid, waveform, i, sample_stride, clip_window_size.x, start_offset, zoom, plot_frame_max, plot_frame_min);
                 if (filled)
                 {
                     ImGui::PlotMat(plot_mat, (float *)plot_frame_max.data, plot_frame_max.w, 0, -wave_range, wave_range, clip_window_size, sizeof(float), filled, true);
@@ -4627,7 +4873,7 @@ void EditingAudioOverlap::DrawContent(ImDrawList* drawList, const ImVec2& leftTo
                 std::string plot_max_id = id_string + "_line_max";
                 std::string plot_min_id = id_string + "_line_min";
                 ImGui::ImMat plot_frame_max, plot_frame_min;
-                waveFrameResample(&waveform->pcm[i][0], sample_stride, clip_window_size.x, start_offset, sampleSize, zoom, plot_frame_max, plot_frame_min);
+                waveformResample(hWavePyramid, waveform, i, sample_stride, clip_window_size.x, start_offset, zoom, plot_frame_max, plot_frame_min);
                 ImGui::SetCursorScreenPos(leftTop + ImVec2(0, i * clip_window_size.y));
                 ImGui::PlotLinesEx(plot_max_id.c_str(), (float *)plot_frame_max.data, plot_frame_max.w, 0, nullptr, -wave_range, wave_range, clip_window_size, sizeof(float), false, true);
                 ImGui::SetCursorScreenPos(leftTop + ImVec2(0, i * clip_window_size.y));
@@ -4648,6 +4894,7 @@ void EditingAudioOverlap::DrawContent(ImDrawList* drawList, const ImVec2& leftTo
         drawList->AddRect(clip2_pos, clip2_pos + window_size, IM_COL32(128, 128, 128, 255));
 
         MediaCore::Overview::Waveform::Holder waveform = mClip2->mWaveform;
+        auto hWavePyramid = mClip2->mpMediaItem ? mClip2->mpMediaItem->GetWaveformPyramid() : nullptr;
         float wave_range = fmax(fabs(waveform->minSample), fabs(waveform->maxSample));
         int64_t start_time = std::max(mClip2->Start(), mStart);
         int64_t end_time = std::min(mClip2->End(), mEnd);
@@ -4671,13 +4918,17 @@ void EditingAudioOverlap::DrawContent(ImDrawList* drawList, const ImVec2& leftTo
             int min_zoom = ImMax(window_length >> 13, 16);
             int zoom = ImMin(sample_stride, min_zoom);
 #if PLOT_IMPLOT
-            start_offset = start_offset / zoom * zoom; // align start_offset
+            start_offset = start_offset / sample_stride * sample_stride; // align start_offset
+            ImGui::ImMat plot_frame_max, plot_frame_min;
+            waveformResample(hWavePyramid, waveform, i, sample_stride, clip_window_size.x, start_offset, zoom, plot_frame_max, plot_frame_min);
             if (ImPlot::BeginPlot(id_string.c_str(), clip_window_size, ImPlotFlags_CanvasOnly | ImPlotFlags_NoFrame | ImPlotFlags_NoInputs))
             {
-                std::string plot_id = id_string + "_line";
+                std::string plot_max_id = id_string + "_line_max";
+                std::string plot_min_id = id_string + "_line_min";
                 ImPlot::SetupAxes(NULL, NULL, ImPlotAxisFlags_NoDecorations, ImPlotAxisFlags_NoDecorations);
-                ImPlot::SetupAxesLimits(0, window_length / zoom, -wave_range, wave_range, ImGuiCond_Always);
-                ImPlot::PlotLine(plot_id.c_str(), &waveform->pcm[i][start_offset], window_length / zoom, 1.0, 0.0, 0, 0, sizeof(float) * zoom);
+                ImPlot::SetupAxesLimits(0, plot_frame_max.w, -wave_range, wave_range, ImGuiCond_Always);
+                ImPlot::PlotLine(plot_max_id.c_str(), (float *)plot_frame_max.data, plot_frame_max.w);
+                ImPlot::PlotLine(plot_min_id.c_str(), (float *)plot_frame_min.data, plot_frame_min.w);
                 ImPlot::EndPlot();
             }
 #elif PLOT_TEXTURE
@@ -4687,7 +4938,7 @@ void EditingAudioOverlap::DrawContent(ImDrawList* drawList, const ImVec2& leftTo
                 ImGui::ImMat plot_mat;
                 start_offset = start_offset / sample_stride * sample_stride; // align start_offset
                 ImGui::ImMat plot_frame_max, plot_frame_min;
-                auto filled = waveFrameResample(&waveform->pcm[i][0], sample_stride, clip_window_size.x, start_offset, sampleSize, zoom, plot_frame_max, plot_frame_min);
+                auto filled = waveformResample(hWavePyramid, waveform, i, sample_stride, clip_window_size.x, start_offset, zoom, plot_frame_max, plot_frame_min);
                 if (filled)
                 {
                     ImGui::PlotMat(plot_mat, (float *)plot_frame_max.data, plot_frame_max.w, 0, -wave_range, wave_range, clip_window_size, sizeof(float), filled, true);
@@ -4712,7 +4963,7 @@ void EditingAudioOverlap::DrawContent(ImDrawList* drawList, const ImVec2& leftTo
                 std::string plot_max_id = id_string + "_line_max";
                 std::string plot_min_id = id_string + "_line_min";
                 ImGui::ImMat plot_frame_max, plot_frame_min;
-                waveFrameResample(&waveform->pcm[i][0], sample_stride, clip_window_size.x, start_offset, sampleSize, zoom, plot_frame_max, plot_frame_min);
+                waveformResample(hWavePyramid, waveform, i, sample_stride, clip_window_size.x, start_offset, zoom, plot_frame_max, plot_frame_min);
                 ImGui::SetCursorScreenPos(clip2_pos + ImVec2(0, i * clip_window_size.y));
                 ImGui::PlotLinesEx(plot_max_id.c_str(), (float *)plot_frame_max.data, plot_frame_max.w, 0, nullptr, -wave_range, wave_range, clip_window_size, sizeof(float), false, true);
                 ImGui::SetCursorScreenPos(clip2_pos + ImVec2(0, i * clip_window_size.y));
@@ -4881,50 +5132,106 @@ bool MediaTrack::DrawTrackControlBar(ImDrawList *draw_list, ImRect rc, bool edit
     return is_Hovered;
 }
 
-void MediaTrack::Update()
+void MediaTrack::Update(bool fullUpdate)
 {
     TimeLine * timeline = (TimeLine *)m_Handle;
     if (!timeline)
         return;
-    // sort m_Clips by clip start time
-    std::sort(m_Clips.begin(), m_Clips.end(), [](const Clip *a, const Clip* b){
+    // sort m_Clips by clip start time, the clips are usually still in order after a drag step
+    auto startLess = [](const Clip *a, const Clip* b){
         return a->Start() < b->Start();
-    });
-    
-    // check all overlaps
+    };
+    if (!std::is_sorted(m_Clips.begin(), m_Clips.end(), startLess))
+        std::sort(m_Clips.begin(), m_Clips.end(), startLess);
+
+    // find out the clips which are added or changed range since last update, and the removed ones
+    const int clipCount = m_Clips.size();
+    std::vector<bool> dirtyFlags(clipCount, fullUpdate);
+    std::unordered_set<int64_t> dirtyClipIds;
+    size_t cachedCount = 0;
+    for (int i = 0; i < clipCount; i++)
+    {
+        auto clip = m_Clips[i];
+        auto iter = mClipRangeCache.find(clip->mID);
+        if (iter != mClipRangeCache.end())
+        {
+            cachedCount++;
+            if (iter->second.first == clip->Start() && iter->second.second == clip->End() && !fullUpdate)
+                continue;
+        }
+        dirtyFlags[i] = true;
+        dirtyClipIds.insert(clip->mID);
+    }
+    if (cachedCount < mClipRangeCache.size())
+    {
+        // some clips are removed from this track
+        std::unordered_set<int64_t> clipIds;
+        for (auto clip : m_Clips)
+            clipIds.insert(clip->mID);
+        for (auto& elem : mClipRangeCache)
+        {
+            if (clipIds.find(elem.first) == clipIds.end())
+                dirtyClipIds.insert(elem.first);
+        }
+    }
+    if (dirtyClipIds.empty() && !fullUpdate)
+    {
+        // nothing changed, the overlaps are still valid
+        if (mMttReader)
+            mMttReader->GetKeyPoints()->SetTimeRange(0, timeline->mEnd - timeline->mStart, true);
+        return;
+    }
+    mClipRangeCache.clear();
+    for (auto clip : m_Clips)
+        mClipRangeCache[clip->mID] = {clip->Start(), clip->End()};
+
+    // check the overlaps on the dirty clips
     for (auto iter = m_Overlaps.begin(); iter != m_Overlaps.end();)
     {
-        if (!(*iter)->IsOverlapValid(true))
+        const bool needCheck = fullUpdate || dirtyClipIds.find((*iter)->m_Clip.first) != dirtyClipIds.end() ||
+            dirtyClipIds.find((*iter)->m_Clip.second) != dirtyClipIds.end();
+        if (needCheck && !(*iter)->IsOverlapValid(true))
         {
             int64_t id = (*iter)->mID;
             iter = m_Overlaps.erase(iter);
+            mOverlapIndexDirty = true;
             timeline->DeleteOverlap(id);
         }
         else
             ++iter;
     }
 
-    // check is there have new overlap area
-    for (auto iter = m_Clips.begin(); iter != m_Clips.end(); iter++)
+    // check is there have new overlap area, sweep over the sorted clips from each dirty clip. 'maxEnds[i]' is the max end time
+    // of clips [0, i], the backward sweep stops when no earlier clip can reach the dirty clip.
+    auto checkOverlap = [this] (Clip* front, Clip* rear) {
+        int64_t start = std::max(rear->Start(), front->Start());
+        int64_t end = std::min(front->End(), rear->End());
+        if (end > start)
+        {
+            // check it is in exist overlaps
+            auto overlap = FindExistOverlap(front->mID, rear->mID);
+            if (overlap)
+                overlap->Update(start, front->mID, end, rear->mID);
+            else
+                CreateOverlap(start, front->mID, end, rear->mID, front->mType);
+        }
+    };
+    std::vector<int64_t> maxEnds(clipCount);
+    for (int i = 0; i < clipCount; i++)
+        maxEnds[i] = i > 0 ? std::max(maxEnds[i-1], m_Clips[i]->End()) : m_Clips[i]->End();
+    for (int i = 0; i < clipCount; i++)
     {
-        for (auto next = iter + 1; next != m_Clips.end(); next++)
+        if (!dirtyFlags[i])
+            continue;
+        auto clip = m_Clips[i];
+        // the pairs of 2 dirty clips are checked by the forward sweep of the front one
+        for (int j = i-1; j >= 0 && maxEnds[j] >= clip->Start(); j--)
         {
-            if ((*iter)->End() >= (*next)->Start())
-            {
-                // it is a overlap area
-                int64_t start = std::max((*next)->Start(), (*iter)->Start());
-                int64_t end = std::min((*iter)->End(), (*next)->End());
-                if (end > start)
-                {
-                    // check it is in exist overlaps
-                    auto overlap = FindExistOverlap((*iter)->mID, (*next)->mID);
-                    if (overlap)
-                        overlap->Update(start, (*iter)->mID, end, (*next)->mID);
-                    else
-                        CreateOverlap(start, (*iter)->mID, end, (*next)->mID, (*iter)->mType);
-                }
-            }
+            if (!dirtyFlags[j] && m_Clips[j]->End() >= clip->Start())
+                checkOverlap(m_Clips[j], clip);
         }
+        for (int j = i+1; j < clipCount && m_Clips[j]->Start() <= clip->End(); j++)
+            checkOverlap(clip, m_Clips[j]);
     }
     // update curve range
     if (mMttReader)
@@ -4939,7 +5246,10 @@ void MediaTrack::CreateOverlap(int64_t start, int64_t start_clip_id, int64_t end
 
     Overlap * new_overlap = new Overlap(start, end, start_clip_id, end_clip_id, type, timeline);
     timeline->m_Overlaps.push_back(new_overlap);
+    timeline->InvalidateIndex(TimeLine::INDEX_OVERLAP);
     m_Overlaps.push_back(new_overlap);
+    if (!mOverlapIndexDirty)
+        mOverlapIndex.emplace(std::minmax(start_clip_id, end_clip_id), new_overlap);
     // sort track overlap by overlap start time
     std::sort(m_Overlaps.begin(), m_Overlaps.end(), [](const Overlap *a, const Overlap *b){
         return a->mStart < b->mStart;
@@ -4948,17 +5258,25 @@ void MediaTrack::CreateOverlap(int64_t start, int64_t start_clip_id, int64_t end
 
 Overlap * MediaTrack::FindExistOverlap(int64_t start_clip_id, int64_t end_clip_id)
 {
-    Overlap * found_overlap = nullptr;
-    for (auto overlap : m_Overlaps)
+    if (mOverlapIndexDirty)
     {
-        if ((overlap->m_Clip.first == start_clip_id && overlap->m_Clip.second == end_clip_id) ||
-            (overlap->m_Clip.first == end_clip_id && overlap->m_Clip.second == start_clip_id))
-        {
-            found_overlap = overlap;
-            break;
-        }
-
-    }
+        mOverlapIndex.clear();
+        for (auto overlap : m_Overlaps)
+            mOverlapIndex.emplace(std::minmax(overlap->m_Clip.first, overlap->m_Clip.second), overlap);
+        mOverlapIndexDirty = false;
+    }
+    auto iter = mOverlapIndex.find(std::minmax(start_clip_id, end_clip_id));
+    Overlap * found_overlap = iter != mOverlapIndex.end() ? iter->second : nullptr;
+#ifdef TIMELINE_INDEX_CHECK
+    auto iter2 = std::find_if(m_Overlaps.begin(), m_Overlaps.end(), [start_clip_id, end_clip_id] (const Overlap* overlap) {
+        return (overlap->m_Clip.first == start_clip_id && overlap->m_Clip.second == end_clip_id) ||
+            (overlap->m_Clip.first == end_clip_id && overlap->m_Clip.second == start_clip_id);
+    });
+    const Overlap* expected = iter2 != m_Overlaps.end() ? *iter2 : nullptr;
+    if (found_overlap != expected)
+        Logger::Log(Logger::Error) << "Timeline index MISMATCH! FindExistOverlap(" << start_clip_id << ", " << end_clip_id << ") of track id=" << mID
+            << " returns " << (void*)found_overlap << " but " << (void*)expected << " is expected." << std::endl;
+#endif
     return found_overlap;
 }
 
@@ -4983,6 +5301,7 @@ void MediaTrack::DeleteClip(int64_t id)
             }
         }
         m_Clips.erase(iter);
+        timeline->InvalidateIndex(TimeLine::INDEX_CLIP_TRACK);
     }
 }
 
@@ -5025,6 +5344,7 @@ void MediaTrack::InsertClip(Clip* clip, int64_t pos, bool update, std::list<imgu
         clip->ConfigViewWindow(mViewWndDur, mPixPerMs);
         clip->SetTrackHeight(mTrackHeight);
         m_Clips.push_back(clip);
+        timeline->InvalidateIndex(TimeLine::INDEX_CLIP_TRACK);
         if (pActionList)
         {
             imgui_json::value action;
@@ -5036,12 +5356,11 @@ void MediaTrack::InsertClip(Clip* clip, int64_t pos, bool update, std::list<imgu
         }
     }
     // also insert this clip into TimeLine::m_Clips array
-    auto& aTlClips = timeline->m_Clips;
-    auto iter2 = std::find_if(aTlClips.begin(), aTlClips.end(), [clip] (const auto& elem) {
-        return elem->mID == clip->mID;
-    });
-    if (iter2 == aTlClips.end())
-        aTlClips.push_back(clip);
+    if (!timeline->FindClipByID(clip->mID))
+    {
+        timeline->m_Clips.push_back(clip);
+        timeline->InvalidateIndex(TimeLine::INDEX_CLIP);
+    }
     if (update) Update();
 }
 
@@ -5273,39 +5592,21 @@ void MediaTrack::SelectEditingOverlap(Overlap * overlap)
     }
 }
 
-void MediaTrack::CalculateAudioScopeData(ImGui::ImMat& mat_in)
+void MediaTrack::CalculateAudioScopeData(const AudioScopePcmBlock& block)
 {
-    ImGui::ImMat mat;
-    if (mat_in.empty() || mat_in.w < 64)
-        return;
-    int fft_size = mat_in.w  > 256 ? 256 : mat_in.w > 128 ? 128 : 64;
-    if (mat_in.elempack > 1)
-    {
-        mat.create_type(fft_size, 1, mat_in.c, mat_in.type);
-        float * data = (float *)mat_in.data;
-        for (int x = 0; x < mat.w; x++)
-        {
-            for (int i = 0; i < mat.c; i++)
-            {
-                mat.at<float>(x, 0, i) = data[x * mat.c + i];
-            }
-        }
-    }
-    else
-    {
-        //mat = mat_in;
-        mat.create_type(fft_size, 1, mat_in.c, mat_in.data, mat_in.type);
-    }
-    for (int i = 0; i < mat.c; i++)
+    for (int i = 0; i < block.channels; i++)
     {
-        if (i < mAudioChannels)
+        if (i < mAudioChannels && i < (int)mAudioTrackAttribute.channel_data.size())
         {
             // we only calculate decibel for now
             auto & channel_data = mAudioTrackAttribute.channel_data[i];
-            channel_data.m_wave.clone_from(mat.channel(i));
-            channel_data.m_fft.clone_from(mat.channel(i));
+            const float* pcm = block.data + block.samples * i;
+            channel_data.m_wave.create_type(block.samples, 1, IM_DT_FLOAT32);
+            memcpy(channel_data.m_wave.data, pcm, block.samples * sizeof(float));
+            channel_data.m_fft.create_type(block.samples, 1, IM_DT_FLOAT32);
+            memcpy(channel_data.m_fft.data, pcm, block.samples * sizeof(float));
             ImGui::ImRFFT((float *)channel_data.m_fft.data, channel_data.m_fft.w, true);
-            channel_data.m_decibel = ImGui::ImDoDecibel((float*)channel_data.m_fft.data, mat.w);
+            channel_data.m_decibel = ImGui::ImDoDecibel((float*)channel_data.m_fft.data, block.samples);
         }
     }
 }
@@ -5704,7 +6005,7 @@ EditingItem::EditingItem(uint32_t media_type, BaseEditingClip * clip)
     }
     else if (IS_AUDIO(media_type))
     {
-        auto wavefrom = item->mMediaOverview->GetWaveform();
+        auto wavefrom = item->EnsureOverview() ? item->mMediaOverview->GetWaveform() : nullptr;
         if (wavefrom && wavefrom->pcm.size() > 0)
         {
             ImGui::ImMat plot_mat;
@@ -5790,8 +6091,8 @@ EditingItem::EditingItem(uint32_t media_type, BaseEditingOverlap * overlap)
     else if (IS_AUDIO(media_type))
     {
         ImGui::ImMat first_mat, second_mat;
-        auto first_wavefrom = first_item->mMediaOverview->GetWaveform();
-        auto second_wavefrom = second_item->mMediaOverview->GetWaveform();
+        auto first_wavefrom = first_item->EnsureOverview() ? first_item->mMediaOverview->GetWaveform() : nullptr;
+        auto second_wavefrom = second_item->EnsureOverview() ? second_item->mMediaOverview->GetWaveform() : nullptr;
         ImVec2 wave_size(96, 48);
         if (first_wavefrom && first_wavefrom->pcm.size() > 0)
         {
@@ -5896,37 +6197,41 @@ int TimeLine::OnBluePrintChange(int type, std::string name, void* handle)
         {
         }
     }
-    if (timeline) timeline->mIsBluePrintChanged = true;
+    if (timeline) timeline->MarkBluePrintChanged();
     return ret;
 }
 
-TimeLine::TimeLine()
-    : mStart(0), mEnd(0), mPcmStream(this)
+TimeLine::TimeLine(bool bHeadless)
+    : mIsHeadless(bHeadless), mStart(0), mEnd(0), mPcmStream(this)
 {
     std::srand(std::time(0)); // init std::rand
 
     mTxMgr = RenderUtils::TextureManager::GetDefaultInstance();
-    if (!mTxMgr->CreateTexturePool(PREVIEW_TEXTURE_POOL_NAME, {1920, 1080}, IM_DT_INT8, 0))
-        Logger::Log(Logger::WARN) << "FAILED to create texture pool '" << PREVIEW_TEXTURE_POOL_NAME << "'! Error is '" << mTxMgr->GetError() << "'." << std::endl;
-    if (!mTxMgr->CreateTexturePool(ARBITRARY_SIZE_TEXTURE_POOL_NAME, {0, 0}, IM_DT_INT8, 0))
-        Logger::Log(Logger::WARN) << "FAILED to create texture pool '" << ARBITRARY_SIZE_TEXTURE_POOL_NAME << "'! Error is '" << mTxMgr->GetError() << "'." << std::endl;
-    MatUtils::Size2i snapshotGridTextureSize;
-    snapshotGridTextureSize = {64*16/9, 64};
-    if (!mTxMgr->CreateGridTexturePool(VIDEOITEM_OVERVIEW_GRID_TEXTURE_POOL_NAME, snapshotGridTextureSize, IM_DT_INT8, {8, 8}, 1))
-        Logger::Log(Logger::WARN) << "FAILED to create grid texture pool '" << VIDEOITEM_OVERVIEW_GRID_TEXTURE_POOL_NAME << "'! Error is '" << mTxMgr->GetError() << "'." << std::endl;
-    else
-    {
-        RenderUtils::TextureManager::TexturePoolAttributes tTxPoolAttrs;
-        mTxMgr->GetTexturePoolAttributes(VIDEOITEM_OVERVIEW_GRID_TEXTURE_POOL_NAME, tTxPoolAttrs);
-        tTxPoolAttrs.bKeepAspectRatio = true;
-        mTxMgr->SetTexturePoolAttributes(VIDEOITEM_OVERVIEW_GRID_TEXTURE_POOL_NAME, tTxPoolAttrs);
+    // the texture pools only hold the preview, the thumbnails and the snapshots drawn on the ui
+    if (!mIsHeadless)
+    {
+        if (!mTxMgr->CreateTexturePool(PREVIEW_TEXTURE_POOL_NAME, {1920, 1080}, IM_DT_INT8, 0))
+            Logger::Log(Logger::WARN) << "FAILED to create texture pool '" << PREVIEW_TEXTURE_POOL_NAME << "'! Error is '" << mTxMgr->GetError() << "'." << std::endl;
+        if (!mTxMgr->CreateTexturePool(ARBITRARY_SIZE_TEXTURE_POOL_NAME, {0, 0}, IM_DT_INT8, 0))
+            Logger::Log(Logger::WARN) << "FAILED to create texture pool '" << ARBITRARY_SIZE_TEXTURE_POOL_NAME << "'! Error is '" << mTxMgr->GetError() << "'." << std::endl;
+        MatUtils::Size2i snapshotGridTextureSize;
+        snapshotGridTextureSize = {64*16/9, 64};
+        if (!mTxMgr->CreateGridTexturePool(VIDEOITEM_OVERVIEW_GRID_TEXTURE_POOL_NAME, snapshotGridTextureSize, IM_DT_INT8, {8, 8}, 1))
+            Logger::Log(Logger::WARN) << "FAILED to create grid texture pool '" << VIDEOITEM_OVERVIEW_GRID_TEXTURE_POOL_NAME << "'! Error is '" << mTxMgr->GetError() << "'." << std::endl;
+        else
+        {
+            RenderUtils::TextureManager::TexturePoolAttributes tTxPoolAttrs;
+            mTxMgr->GetTexturePoolAttributes(VIDEOITEM_OVERVIEW_GRID_TEXTURE_POOL_NAME, tTxPoolAttrs);
+            tTxPoolAttrs.bKeepAspectRatio = true;
+            mTxMgr->SetTexturePoolAttributes(VIDEOITEM_OVERVIEW_GRID_TEXTURE_POOL_NAME, tTxPoolAttrs);
+        }
+        snapshotGridTextureSize = {DEFAULT_VIDEO_TRACK_HEIGHT*16/9, DEFAULT_VIDEO_TRACK_HEIGHT};
+        if (!mTxMgr->CreateGridTexturePool(VIDEOCLIP_SNAPSHOT_GRID_TEXTURE_POOL_NAME, snapshotGridTextureSize, IM_DT_INT8, {8, 8}, 1))
+            Logger::Log(Logger::WARN) << "FAILED to create grid texture pool '" << VIDEOCLIP_SNAPSHOT_GRID_TEXTURE_POOL_NAME << "'! Error is '" << mTxMgr->GetError() << "'." << std::endl;
+        snapshotGridTextureSize = {50*16/9, 50};
+        if (!mTxMgr->CreateGridTexturePool(EDITING_VIDEOCLIP_SNAPSHOT_GRID_TEXTURE_POOL_NAME, snapshotGridTextureSize, IM_DT_INT8, {8, 8}, 1))
+            Logger::Log(Logger::WARN) << "FAILED to create grid texture pool '" << EDITING_VIDEOCLIP_SNAPSHOT_GRID_TEXTURE_POOL_NAME << "'! Error is '" << mTxMgr->GetError() << "'." << std::endl;
     }
-    snapshotGridTextureSize = {DEFAULT_VIDEO_TRACK_HEIGHT*16/9, DEFAULT_VIDEO_TRACK_HEIGHT};
-    if (!mTxMgr->CreateGridTexturePool(VIDEOCLIP_SNAPSHOT_GRID_TEXTURE_POOL_NAME, snapshotGridTextureSize, IM_DT_INT8, {8, 8}, 1))
-        Logger::Log(Logger::WARN) << "FAILED to create grid texture pool '" << VIDEOCLIP_SNAPSHOT_GRID_TEXTURE_POOL_NAME << "'! Error is '" << mTxMgr->GetError() << "'." << std::endl;
-    snapshotGridTextureSize = {50*16/9, 50};
-    if (!mTxMgr->CreateGridTexturePool(EDITING_VIDEOCLIP_SNAPSHOT_GRID_TEXTURE_POOL_NAME, snapshotGridTextureSize, IM_DT_INT8, {8, 8}, 1))
-        Logger::Log(Logger::WARN) << "FAILED to create grid texture pool '" << EDITING_VIDEOCLIP_SNAPSHOT_GRID_TEXTURE_POOL_NAME << "'! Error is '" << mTxMgr->GetError() << "'." << std::endl;
 
     mhMediaSettings = MediaCore::SharedSettings::CreateInstance();
     mhMediaSettings->SetHwaccelManager(MediaCore::HwaccelManager::GetDefaultInstance());
@@ -5948,11 +6253,14 @@ TimeLine::TimeLine()
     // preview use the same settings of timeline as default
     mhPreviewSettings = mhMediaSettings->Clone();
 
-    mAudioRender = MediaCore::AudioRender::CreateInstance();
-    if (!mAudioRender)
-        throw std::runtime_error("FAILED to create AudioRender instance!");
-    if (!mAudioRender->OpenDevice(mhPreviewSettings->AudioOutSampleRate(), mhPreviewSettings->AudioOutChannels(), mAudioRenderFormat, &mPcmStream))
-        throw std::runtime_error("FAILED to open audio render device!");
+    if (!mIsHeadless)
+    {
+        mAudioRender = MediaCore::AudioRender::CreateInstance();
+        if (!mAudioRender)
+            throw std::runtime_error("FAILED to create AudioRender instance!");
+        if (!mAudioRender->OpenDevice(mhPreviewSettings->AudioOutSampleRate(), mhPreviewSettings->AudioOutChannels(), mAudioRenderFormat, &mPcmStream))
+            throw std::runtime_error("FAILED to open audio render device!");
+    }
 
     auto exec_path = ImGuiHelper::exec_path();
     m_BP_UI.Initialize();
@@ -5963,13 +6271,22 @@ TimeLine::TimeLine()
     mAudioAttribute.channel_data.resize(mhMediaSettings->AudioOutChannels());
     memcpy(&mAudioAttribute.mBandCfg, &DEFAULT_BAND_CFG, sizeof(mAudioAttribute.mBandCfg));
 
-    mhPreviewTx = mTxMgr->GetTextureFromPool(PREVIEW_TEXTURE_POOL_NAME);
-    mRecordIter = mHistoryRecords.begin();
-    mMediaPlayer = new MEC::MediaPlayer(mTxMgr);
+    // a headless timeline is only loaded and exported, it has no preview, no undo history and no media player
+    if (!mIsHeadless)
+    {
+        mhPreviewTx = mTxMgr->GetTextureFromPool(PREVIEW_TEXTURE_POOL_NAME);
+        const auto strCacheDir = MEC::Project::GetCacheDir();
+        mhHistoryStore = MEC::HistoryStore::CreateInstance(strCacheDir.empty() ? "" : SysUtils::JoinPath(strCacheDir, "History"));
+        mMediaPlayer = new MEC::MediaPlayer(mTxMgr);
+        mAudioScopeThread = std::thread(&TimeLine::_AudioScopeProc, this);
+    }
 }
 
 TimeLine::~TimeLine()
 {    
+    mQuitAudioScope = true;
+    if (mAudioScopeThread.joinable())
+        mAudioScopeThread.join();
     ImGui::ImDestroyTexture(&mEncodingPreviewTexture);
     mAudioAttribute.channel_data.clear();
     ImGui::ImDestroyTexture(&mAudioAttribute.m_audio_vector_texture);
@@ -5998,9 +6315,12 @@ TimeLine::~TimeLine()
     }
     mEncoder = nullptr;
 
-    mTxMgr->ReleaseTexturePool(VIDEOITEM_OVERVIEW_GRID_TEXTURE_POOL_NAME);
-    mTxMgr->ReleaseTexturePool(VIDEOCLIP_SNAPSHOT_GRID_TEXTURE_POOL_NAME);
-    mTxMgr->ReleaseTexturePool(EDITING_VIDEOCLIP_SNAPSHOT_GRID_TEXTURE_POOL_NAME);
+    if (!mIsHeadless)
+    {
+        mTxMgr->ReleaseTexturePool(VIDEOITEM_OVERVIEW_GRID_TEXTURE_POOL_NAME);
+        mTxMgr->ReleaseTexturePool(VIDEOCLIP_SNAPSHOT_GRID_TEXTURE_POOL_NAME);
+        mTxMgr->ReleaseTexturePool(EDITING_VIDEOCLIP_SNAPSHOT_GRID_TEXTURE_POOL_NAME);
+    }
     mMtvReader = nullptr;
     mMtaReader = nullptr;
 
@@ -6029,6 +6349,7 @@ bool TimeLine::AddMediaItem(MediaCore::MediaParser::Holder hParser)
         return false;
     }
     media_items.push_back(pNewMitem);
+    InvalidateIndex(INDEX_MEDIA_ITEM);
     return true;
 }
 
@@ -6068,6 +6389,155 @@ const imgui_json::value& TimeLine::CheckMediaItemMetaData(const std::string& fil
     return EMPTY_JSON;
 }
 
+MediaCore::MediaParser::Holder TimeLine::GetPreviewParser(Clip* pClip)
+{
+    if (!mUseProxyMedia || !IS_VIDEO(pClip->mType) || IS_IMAGE(pClip->mType))
+        return pClip->mMediaParser;
+    auto pMediaItem = FindMediaItemByID(pClip->mMediaID);
+    if (!pMediaItem || pMediaItem->mProxyState != MediaItem::PROXY_READY || !pMediaItem->mhProxyParser)
+        return pClip->mMediaParser;
+    return pMediaItem->mhProxyParser;
+}
+
+int TimeLine::SwitchClipSources(MediaCore::MultiTrackVideoReader::Holder hMtvReader, bool bUseProxy)
+{
+    if (!hMtvReader)
+        return 0;
+    const bool bIsPreviewReader = hMtvReader == mMtvReader;
+    int iSwitchedCount = 0;
+    for (auto trackIter = hMtvReader->TrackListBegin(); trackIter != hMtvReader->TrackListEnd(); trackIter++)
+    {
+        auto& hVidTrack = *trackIter;
+        // the overlaps are rebuilt on the new clip instances, keep their ids and transitions by the clip pair
+        std::map<std::pair<int64_t, int64_t>, MediaCore::VideoOverlap::Holder> aOldOverlaps;
+        for (auto& hOverlap : hVidTrack->GetOverlapList())
+            aOldOverlaps[{hOverlap->FrontClip()->Id(), hOverlap->RearClip()->Id()}] = hOverlap;
+        bool bTrackChanged = false;
+        for (auto& hClip : hVidTrack->GetClipList())
+        {
+            if (hClip->IsImage())
+                continue;
+            auto pUiClip = dynamic_cast<VideoClip*>(FindClipByID(hClip->Id()));
+            if (!pUiClip || !pUiClip->mMediaParser)
+                continue;
+            auto hParser = bUseProxy ? GetPreviewParser(pUiClip) : pUiClip->mMediaParser;
+            if (hParser == hClip->GetMediaParser())
+                continue;
+            const int64_t readPos = bIsPreviewReader ? mCurrentTime-hClip->Start() : 0;
+            auto hNewClip = MediaCore::VideoClip::CreateVideoInstance(
+                    hClip->Id(), hParser, hMtvReader->GetSharedSettings(),
+                    hClip->Start(), hClip->End(), hClip->StartOffset(), hClip->EndOffset(), readPos, hVidTrack->Direction());
+            if (!hNewClip)
+            {
+                Logger::Log(Logger::WARN) << "FAILED to switch the source of video clip #" << hClip->Id() << " to '" << hParser->GetUrl() << "'." << std::endl;
+                continue;
+            }
+            hNewClip->SetFilter(hClip->GetFilter());
+            auto hNewTransFilter = hNewClip->GetTransformFilter();
+            hNewTransFilter->LoadFromJson(hClip->GetTransformFilter()->SaveAsJson());
+            // the crop is counted in the pixels of the source frame, scale it to the frame size of the new source. the position
+            // offset is counted in the pixels of the output canvas, which is the same for the proxy and the original media.
+            double dScaleX, dScaleY;
+            if (GetFrameSizeScale(hClip->GetMediaParser(), hParser, dScaleX, dScaleY))
+                ScaleTransformCrop(hNewTransFilter, dScaleX, dScaleY);
+            hVidTrack->RemoveClipById(hClip->Id());
+            hVidTrack->InsertClip(hNewClip);
+            if (bIsPreviewReader)
+                pUiClip->SetDataLayer(hNewClip, false);
+            bTrackChanged = true;
+            iSwitchedCount++;
+        }
+        if (!bTrackChanged)
+            continue;
+        hVidTrack->UpdateClipState();
+        for (auto& hOverlap : hVidTrack->GetOverlapList())
+        {
+            auto iter = aOldOverlaps.find({hOverlap->FrontClip()->Id(), hOverlap->RearClip()->Id()});
+            if (iter == aOldOverlaps.end())
+                continue;
+            hOverlap->SetId(iter->second->Id());
+            auto hTrans = iter->second->GetTransition();
+            if (hTrans)
+                hOverlap->SetTransition(hTrans);
+        }
+    }
+    return iSwitchedCount;
+}
+
+void TimeLine::SetUseProxyMedia(bool bUseProxy)
+{
+    if (mUseProxyMedia == bUseProxy)
+        return;
+    mUseProxyMedia = bUseProxy;
+    if (mMtvReader && SwitchClipSources(mMtvReader, bUseProxy) > 0)
+        RefreshPreview(false);
+}
+
+void TimeLine::UpdateMediaProxies()
+{
+    // relink the proxy tasks to the media items after the task list is changed, e.g. a project is loaded with unfinished tasks
+    auto aTasks = mhProject ? mhProject->GetBackgroundTaskList() : std::list<MEC::BackgroundTask::Holder>();
+    if (aTasks.size() != mProxyTaskListSize)
+    {
+        mProxyTaskListSize = aTasks.size();
+        for (auto& hTask : aTasks)
+        {
+            imgui_json::value jnTask;
+            if (!hTask->SaveAsJson(jnTask) || !jnTask.contains("type") || jnTask["type"].get<imgui_json::string>() != "Proxy")
+                continue;
+            const auto strSrcUrl = jnTask["source_url"].get<imgui_json::string>();
+            auto iter = std::find_if(media_items.begin(), media_items.end(), [&strSrcUrl] (const MediaItem* pItem) {
+                return pItem->mPath == strSrcUrl;
+            });
+            if (iter != media_items.end() && (*iter)->mProxyState != MediaItem::PROXY_READY)
+                (*iter)->mwpProxyTask = hTask;
+        }
+    }
+
+    bool bProxyOpened = false;
+    for (auto pItem : media_items)
+    {
+        if (pItem->mProxyState == MediaItem::PROXY_READY)
+            continue;
+        auto hTask = pItem->mwpProxyTask.lock();
+        if (!hTask)
+        {
+            if (pItem->mProxyState == MediaItem::PROXY_GENERATING)
+                pItem->mProxyState = MediaItem::PROXY_NONE;
+            continue;
+        }
+        if (hTask->IsFailed())
+        {
+            pItem->mProxyError = hTask->GetError();
+            pItem->mProxyState = MediaItem::PROXY_FAILED;
+            pItem->mwpProxyTask.reset();
+        }
+        else if (hTask->IsDone())
+        {
+            pItem->mwpProxyTask.reset();
+            if (!pItem->mProxyPath.empty() && ImGuiHelper::file_exists(pItem->mProxyPath))
+                bProxyOpened |= pItem->OpenProxy();
+            else if (!hTask->GetError().empty())
+            {
+                // a failed task restored from the project is in DONE state with its error message
+                pItem->mProxyError = hTask->GetError();
+                pItem->mProxyState = MediaItem::PROXY_FAILED;
+            }
+            else
+                pItem->mProxyState = MediaItem::PROXY_NONE;
+        }
+        else if (hTask->IsCancelled())
+        {
+            pItem->mProxyState = MediaItem::PROXY_NONE;
+            pItem->mwpProxyTask.reset();
+        }
+        else
+            pItem->mProxyState = MediaItem::PROXY_GENERATING;
+    }
+    if (bProxyOpened && mUseProxyMedia && mMtvReader && SwitchClipSources(mMtvReader, true) > 0)
+        RefreshPreview(false);
+}
+
 int64_t TimeLine::AlignTime(int64_t time, int mode)
 {
     const auto frameRate = mhMediaSettings->VideoOutFrameRate();
@@ -6122,14 +6592,14 @@ void TimeLine::UpdateRange()
     }
 }
 
-void TimeLine::Update()
+void TimeLine::Update(bool fullUpdate)
 {
     UpdateRange();
 
     // update track
     for (auto track : m_Tracks)
     {
-        track->Update();
+        track->Update(fullUpdate);
     }
 }
 
@@ -6280,6 +6750,7 @@ int64_t TimeLine::DeleteTrack(int index, std::list<imgui_json::value>* pActionLi
     }
     // remove this track from array
     m_Tracks.erase(m_Tracks.begin() + index);
+    InvalidateIndex(INDEX_TRACK|INDEX_CLIP_TRACK);
     delete pTrack;
     if (m_Tracks.size() == 0)
     {
@@ -6333,6 +6804,7 @@ int TimeLine::NewTrack(const std::string& name, uint32_t type, bool expand, int6
             searchIter = m_Tracks.end()-1;
         }
     }
+    InvalidateIndex(INDEX_TRACK|INDEX_CLIP_TRACK);
     Update();
 
     if (pActionList)
@@ -6415,6 +6887,7 @@ bool TimeLine::RestoreTrack(imgui_json::value& action)
             if (c)
             {
                 m_Clips.push_back(c);
+                InvalidateIndex(INDEX_CLIP);
                 // restore group
                 if (c->mGroupID != -1)
                 {
@@ -6461,7 +6934,10 @@ bool TimeLine::RestoreTrack(imgui_json::value& action)
         {
             Overlap* o = Overlap::Load(overlapJson, this);
             if (o)
+            {
                 m_Overlaps.push_back(o);
+                InvalidateIndex(INDEX_OVERLAP);
+            }
         }
     }
     // restore the removed track
@@ -6492,6 +6968,7 @@ bool TimeLine::RestoreTrack(imgui_json::value& action)
         }
         searchIter = m_Tracks.insert(iter, t);
     }
+    InvalidateIndex(INDEX_TRACK|INDEX_CLIP_TRACK);
     int64_t afterTrackId = -2;
     if (searchIter != m_Tracks.begin())
     {
@@ -6521,7 +6998,7 @@ bool TimeLine::RestoreTrack(imgui_json::value& action)
             if (IS_IMAGE(c->mType))
                 hVidClip = hVidTrk->AddImageClip(c->mID, c->mMediaParser, c->Start(), c->Length());
             else
-                hVidClip = hVidTrk->AddVideoClip(c->mID, c->mMediaParser, c->Start(), c->End(), c->StartOffset(), c->EndOffset(), mCurrentTime-c->Start());
+                hVidClip = hVidTrk->AddVideoClip(c->mID, GetPreviewParser(c), c->Start(), c->End(), c->StartOffset(), c->EndOffset(), mCurrentTime-c->Start());
             VideoClip* pUiVClip = dynamic_cast<VideoClip*>(c);
             pUiVClip->SetDataLayer(hVidClip, true);
         }
@@ -6550,6 +7027,8 @@ bool TimeLine::RestoreTrack(imgui_json::value& action)
         mMtaReader->SeekTo(mCurrentTime);
     }
 
+    // the overlaps restored from json are not validated against the restored clips yet
+    t->Update(true);
     SyncDataLayer(true);
     return true;
 }
@@ -6667,6 +7146,7 @@ void TimeLine::MovingClip(int64_t id, int from_track_index, int to_track_index)
         if ((*iter)->mID == id)
         {
             iter = track->m_Clips.erase(iter);
+            InvalidateIndex(INDEX_CLIP_TRACK);
         }
         else
             ++iter;
@@ -6708,6 +7188,7 @@ bool TimeLine::DeleteClip(int64_t id, std::list<imgui_json::value>* pActionList)
     {
         auto clip = *iter;
         m_Clips.erase(iter);
+        InvalidateIndex(INDEX_CLIP);
 
         auto found = FindEditingItem(EDITING_CLIP, clip->mID);
         if (found != -1)
@@ -6750,6 +7231,7 @@ void TimeLine::DeleteOverlap(int64_t id)
         {
             Overlap * overlap = *iter;
             iter = m_Overlaps.erase(iter);
+            InvalidateIndex(INDEX_OVERLAP);
             auto found = FindEditingItem(EDITING_TRANSITION, overlap->mID);
             if (found != -1)
             {
@@ -6895,6 +7377,7 @@ std::vector<MediaCore::CorrelativeFrame> TimeLine::GetPreviewFrame(bool blocking
             mPreviewResumePos = mCurrentTime;
             if (mAudioRender)
                 mAudioRender->Pause();
+            DiscardAudioScopePcm();
             for (auto& audio : mAudioAttribute.channel_data) audio.m_decibel = 0;
             for (auto track : m_Tracks)
             {
@@ -6918,6 +7401,8 @@ std::vector<MediaCore::CorrelativeFrame> TimeLine::GetPreviewFrame(bool blocking
 bool TimeLine::UpdatePreviewTexture(bool blocking)
 {
     bool bTxUpdated = false;
+    if (!mhPreviewTx)
+        return bTxUpdated;
     maCurrFrames = GetPreviewFrame(blocking);
     if (maCurrFrames.empty())
         return bTxUpdated;
@@ -7013,6 +7498,7 @@ void TimeLine::Play(bool play, bool forward)
             mPreviewResumePos = mCurrentTime;
             if (mAudioRender)
                 mAudioRender->Pause();
+            DiscardAudioScopePcm();
             for (int i = 0; i < mAudioAttribute.channel_data.size(); i++) SetAudioLevel(i, 0);
             for (auto track : m_Tracks)
             {
@@ -7175,44 +7661,159 @@ MediaItem* TimeLine::FindMediaItemByName(std::string name)
     return nullptr;
 }
 
-MediaItem* TimeLine::FindMediaItemByID(int64_t id)
+template <typename T>
+static T* LookupIndex(const std::unordered_map<int64_t, T*>& index, int64_t id)
 {
-    auto iter = std::find_if(media_items.begin(), media_items.end(), [id](const MediaItem* item)
-    {
-        return item->mID == id;
-    });
-    if (iter != media_items.end())
-        return *iter;
-    return nullptr;
+    auto iter = index.find(id);
+    return iter != index.end() ? iter->second : nullptr;
 }
 
-void TimeLine::SortMediaItemByID()
+#ifdef TIMELINE_INDEX_CHECK
+template <typename T>
+static void CheckIndexLookup(const char* name, const std::vector<T*>& array, int64_t id, const T* found)
 {
-    std::sort(media_items.begin(), media_items.end(), [](const MediaItem* lit, const MediaItem* rit)
-    {
-        return lit->mID < rit->mID;
+    auto iter = std::find_if(array.begin(), array.end(), [id](const T* elem) {
+        return elem->mID == id;
     });
+    const T* expected = iter != array.end() ? *iter : nullptr;
+    if (found != expected)
+        Logger::Log(Logger::Error) << "Timeline index MISMATCH! " << name << "(" << id << ") returns " << (void*)found << " but " << (void*)expected << " is expected." << std::endl;
 }
+#endif
 
-void TimeLine::SortMediaItemByName()
+void TimeLine::UpdateIndex()
 {
-    std::sort(media_items.begin(), media_items.end(), [](const MediaItem* lit, const MediaItem* rit)
+    // 'emplace()' keeps the first element for duplicated ids, the same as what the linear search returns
+    const uint32_t flags = mIndexDirtyFlags.exchange(0);
+    if (flags & INDEX_MEDIA_ITEM)
     {
-        return lit->mName < rit->mName;
-    });
-}
-
-void TimeLine::SortMediaItemByType()
-{
-    std::sort(media_items.begin(), media_items.end(), [](const MediaItem* lit, const MediaItem* rit)
+        mMediaItemIndex.clear();
+        for (auto item : media_items)
+            mMediaItemIndex.emplace(item->mID, item);
+    }
+    if (flags & INDEX_TRACK)
     {
-        return lit->mMediaType < rit->mMediaType;
-    });
+        mTrackIndex.clear();
+        for (auto track : m_Tracks)
+            mTrackIndex.emplace(track->mID, track);
+    }
+    if (flags & INDEX_CLIP)
+    {
+        mClipIndex.clear();
+        for (auto clip : m_Clips)
+            mClipIndex.emplace(clip->mID, clip);
+    }
+    if (flags & INDEX_OVERLAP)
+    {
+        mOverlapIndex.clear();
+        for (auto overlap : m_Overlaps)
+            mOverlapIndex.emplace(overlap->mID, overlap);
+    }
+    if (flags & INDEX_CLIP_TRACK)
+    {
+        mClipTrackIndex.clear();
+        for (auto track : m_Tracks)
+            for (auto clip : track->m_Clips)
+                mClipTrackIndex.emplace(clip->mID, track);
+    }
 }
 
-void TimeLine::FilterMediaItemByType(uint32_t mediaType)
+bool TimeLine::CheckIndexConsistency()
 {
-    for (auto media_item : media_items)
+    std::lock_guard<std::mutex> lk(mIndexLock);
+    UpdateIndex();
+    bool consistent = true;
+    auto checkArray = [&consistent] (const char* name, const auto& array, const auto& index) {
+        size_t count = 0;
+        for (auto elem : array)
+        {
+            auto iter = index.find(elem->mID);
+            if (iter == index.end())
+            {
+                Logger::Log(Logger::Error) << "Timeline index MISMATCH! " << name << " id=" << elem->mID << " is NOT indexed." << std::endl;
+                consistent = false;
+            }
+            else if (iter->second == elem)
+                count++;
+        }
+        if (count != index.size())
+        {
+            Logger::Log(Logger::Error) << "Timeline index MISMATCH! " << name << " index has " << index.size() << " entries, but "
+                << count << " of " << array.size() << " elements are matched." << std::endl;
+            consistent = false;
+        }
+    };
+    checkArray("media item", media_items, mMediaItemIndex);
+    checkArray("track", m_Tracks, mTrackIndex);
+    checkArray("clip", m_Clips, mClipIndex);
+    checkArray("overlap", m_Overlaps, mOverlapIndex);
+    size_t trackClipCount = 0;
+    for (auto track : m_Tracks)
+    {
+        for (auto clip : track->m_Clips)
+        {
+            trackClipCount++;
+            auto iter = mClipTrackIndex.find(clip->mID);
+            if (iter == mClipTrackIndex.end())
+            {
+                Logger::Log(Logger::Error) << "Timeline index MISMATCH! Clip id=" << clip->mID << " of track id=" << track->mID << " is NOT indexed." << std::endl;
+                consistent = false;
+            }
+            else if (iter->second != track)
+            {
+                Logger::Log(Logger::Error) << "Timeline index MISMATCH! Clip id=" << clip->mID << " is contained by track id=" << track->mID
+                    << ", but indexed to track id=" << iter->second->mID << "." << std::endl;
+                consistent = false;
+            }
+        }
+    }
+    if (mClipTrackIndex.size() > trackClipCount)
+    {
+        Logger::Log(Logger::Error) << "Timeline index MISMATCH! Clip->track index has " << mClipTrackIndex.size() << " entries, but only "
+            << trackClipCount << " clips are in the tracks." << std::endl;
+        consistent = false;
+    }
+    return consistent;
+}
+
+MediaItem* TimeLine::FindMediaItemByID(int64_t id)
+{
+    std::lock_guard<std::mutex> lk(mIndexLock);
+    UpdateIndex();
+    auto item = LookupIndex(mMediaItemIndex, id);
+#ifdef TIMELINE_INDEX_CHECK
+    CheckIndexLookup("FindMediaItemByID", media_items, id, item);
+#endif
+    return item;
+}
+
+void TimeLine::SortMediaItemByID()
+{
+    std::sort(media_items.begin(), media_items.end(), [](const MediaItem* lit, const MediaItem* rit)
+    {
+        return lit->mID < rit->mID;
+    });
+}
+
+void TimeLine::SortMediaItemByName()
+{
+    std::sort(media_items.begin(), media_items.end(), [](const MediaItem* lit, const MediaItem* rit)
+    {
+        return lit->mName < rit->mName;
+    });
+}
+
+void TimeLine::SortMediaItemByType()
+{
+    std::sort(media_items.begin(), media_items.end(), [](const MediaItem* lit, const MediaItem* rit)
+    {
+        return lit->mMediaType < rit->mMediaType;
+    });
+}
+
+void TimeLine::FilterMediaItemByType(uint32_t mediaType)
+{
+    for (auto media_item : media_items)
     {
         if (media_item->mMediaType == mediaType)
             filter_media_items.push_back(media_item);
@@ -7221,17 +7822,21 @@ void TimeLine::FilterMediaItemByType(uint32_t mediaType)
 
 MediaTrack * TimeLine::FindTrackByID(int64_t id)
 {
-    auto iter = std::find_if(m_Tracks.begin(), m_Tracks.end(), [id](const MediaTrack* track)
-    {
-        return track->mID == id;
-    });
-    if (iter != m_Tracks.end())
-        return *iter;
-    return nullptr;
+    std::lock_guard<std::mutex> lk(mIndexLock);
+    UpdateIndex();
+    auto track = LookupIndex(mTrackIndex, id);
+#ifdef TIMELINE_INDEX_CHECK
+    CheckIndexLookup("FindTrackByID", m_Tracks, id, track);
+#endif
+    return track;
 }
 
 MediaTrack * TimeLine::FindTrackByClipID(int64_t id)
 {
+    std::lock_guard<std::mutex> lk(mIndexLock);
+    UpdateIndex();
+    auto track = LookupIndex(mClipTrackIndex, id);
+#ifdef TIMELINE_INDEX_CHECK
     auto iter = std::find_if(m_Tracks.begin(), m_Tracks.end(), [id](const MediaTrack* track)
     {
         auto iter_clip = std::find_if(track->m_Clips.begin(), track->m_Clips.end(), [id](const Clip* clip)
@@ -7240,9 +7845,11 @@ MediaTrack * TimeLine::FindTrackByClipID(int64_t id)
         });
         return iter_clip != track->m_Clips.end();
     });
-    if (iter != m_Tracks.end())
-        return *iter;
-    return nullptr;
+    const MediaTrack* expected = iter != m_Tracks.end() ? *iter : nullptr;
+    if (track != expected)
+        Logger::Log(Logger::Error) << "Timeline index MISMATCH! FindTrackByClipID(" << id << ") returns " << (void*)track << " but " << (void*)expected << " is expected." << std::endl;
+#endif
+    return track;
 }
 
 MediaTrack * TimeLine::FindTrackByName(std::string name)
@@ -7269,39 +7876,34 @@ MediaTrack * TimeLine::FindEmptyTrackByType(uint32_t type)
 
 int TimeLine::FindTrackIndexByClipID(int64_t id)
 {
-    int track_found = -1;
     auto track = FindTrackByClipID(id);
-    for (int i = 0; i < m_Tracks.size(); i++)
-    {
-        if (track && m_Tracks[i]->mID == track->mID)
-        {
-            track_found = i;
-            break;
-        }
-    }
-    return track_found;
+    if (!track)
+        return -1;
+    // only the track array is scanned, the track count is small
+    auto iter = std::find(m_Tracks.begin(), m_Tracks.end(), track);
+    return iter != m_Tracks.end() ? (int)(iter - m_Tracks.begin()) : -1;
 }
 
 Clip * TimeLine::FindClipByID(int64_t id)
 {
-    auto iter = std::find_if(m_Clips.begin(), m_Clips.end(), [id](const Clip* clip)
-    {
-        return clip->mID == id;
-    });
-    if (iter != m_Clips.end())
-        return *iter;
-    return nullptr;
+    std::lock_guard<std::mutex> lk(mIndexLock);
+    UpdateIndex();
+    auto clip = LookupIndex(mClipIndex, id);
+#ifdef TIMELINE_INDEX_CHECK
+    CheckIndexLookup("FindClipByID", m_Clips, id, clip);
+#endif
+    return clip;
 }
 
 Overlap * TimeLine::FindOverlapByID(int64_t id)
 {
-    auto iter = std::find_if(m_Overlaps.begin(), m_Overlaps.end(), [id](const Overlap* overlap)
-    {
-        return overlap->mID == id;
-    });
-    if (iter != m_Overlaps.end())
-        return *iter;
-    return nullptr;
+    std::lock_guard<std::mutex> lk(mIndexLock);
+    UpdateIndex();
+    auto overlap = LookupIndex(mOverlapIndex, id);
+#ifdef TIMELINE_INDEX_CHECK
+    CheckIndexLookup("FindOverlapByID", m_Overlaps, id, overlap);
+#endif
+    return overlap;
 }
 
 Overlap * TimeLine::FindEditingOverlap()
@@ -8025,15 +8627,21 @@ int TimeLine::Load(const imgui_json::value& value)
     mhPreviewSettings->SetVideoOutWidth(previewSize.x);
     mhPreviewSettings->SetVideoOutHeight(previewSize.y);
     mhPreviewSettings->SyncAudioSettingsFrom(mhMediaSettings.get());
-    RenderUtils::TextureManager::TexturePoolAttributes tTxPoolAttrs;
-    mTxMgr->GetTexturePoolAttributes(PREVIEW_TEXTURE_POOL_NAME, tTxPoolAttrs);
-    tTxPoolAttrs.tTxSize = previewSize;
-    mTxMgr->SetTexturePoolAttributes(PREVIEW_TEXTURE_POOL_NAME, tTxPoolAttrs);
-    mhPreviewTx = mTxMgr->GetTextureFromPool(PREVIEW_TEXTURE_POOL_NAME);
-    mAudioRender->CloseDevice();
-    mPcmStream.Flush();
-    if (!mAudioRender->OpenDevice(mhPreviewSettings->AudioOutSampleRate(), mhPreviewSettings->AudioOutChannels(), mAudioRenderFormat, &mPcmStream))
-        throw std::runtime_error("FAILED to open audio render device!");
+    if (!mIsHeadless)
+    {
+        RenderUtils::TextureManager::TexturePoolAttributes tTxPoolAttrs;
+        mTxMgr->GetTexturePoolAttributes(PREVIEW_TEXTURE_POOL_NAME, tTxPoolAttrs);
+        tTxPoolAttrs.tTxSize = previewSize;
+        mTxMgr->SetTexturePoolAttributes(PREVIEW_TEXTURE_POOL_NAME, tTxPoolAttrs);
+        mhPreviewTx = mTxMgr->GetTextureFromPool(PREVIEW_TEXTURE_POOL_NAME);
+    }
+    if (mAudioRender)
+    {
+        mAudioRender->CloseDevice();
+        mPcmStream.Flush();
+        if (!mAudioRender->OpenDevice(mhPreviewSettings->AudioOutSampleRate(), mhPreviewSettings->AudioOutChannels(), mAudioRenderFormat, &mPcmStream))
+            throw std::runtime_error("FAILED to open audio render device!");
+    }
     mAudioAttribute.channel_data.clear();
     mAudioAttribute.channel_data.resize(mhMediaSettings->AudioOutChannels());
 
@@ -8060,7 +8668,10 @@ int TimeLine::Load(const imgui_json::value& value)
             else if (IS_TEXT(type))
                 pClip = TextClip::CreateInstanceFromJson(jnClipJson, this);
             if (pClip)
+            {
                 m_Clips.push_back(pClip);
+                InvalidateIndex(INDEX_CLIP);
+            }
         }
     }
 
@@ -8084,7 +8695,10 @@ int TimeLine::Load(const imgui_json::value& value)
         {
             Overlap * new_overlap = Overlap::Load(overlap, this);
             if (new_overlap)
+            {
                 m_Overlaps.push_back(new_overlap);
+                InvalidateIndex(INDEX_OVERLAP);
+            }
         }
     }
 
@@ -8098,6 +8712,7 @@ int TimeLine::Load(const imgui_json::value& value)
             if (media_track)
             {
                 m_Tracks.push_back(media_track);
+                InvalidateIndex(INDEX_TRACK|INDEX_CLIP_TRACK);
             }
         }
     }
@@ -8327,7 +8942,7 @@ int TimeLine::Load(const imgui_json::value& value)
                 if (IS_IMAGE(pUiClip->mType))
                     hVidClip = vidTrack->AddImageClip(pUiClip->mID, pUiClip->mMediaParser, pUiClip->Start(), pUiClip->Length());
                 else
-                    hVidClip = vidTrack->AddVideoClip(pUiClip->mID, pUiClip->mMediaParser, pUiClip->Start(), pUiClip->End(), pUiClip->StartOffset(), pUiClip->EndOffset(), mCurrentTime-pUiClip->Start());
+                    hVidClip = vidTrack->AddVideoClip(pUiClip->mID, GetPreviewParser(pUiClip), pUiClip->Start(), pUiClip->End(), pUiClip->StartOffset(), pUiClip->EndOffset(), mCurrentTime-pUiClip->Start());
                 VideoClip* pUiVClip = dynamic_cast<VideoClip*>(pUiClip);
                 pUiVClip->SetDataLayer(hVidClip, true);
             }
@@ -8407,10 +9022,22 @@ int TimeLine::Load(const imgui_json::value& value)
     mMtaReader->UpdateDuration();
     mMtaReader->SeekTo(mCurrentTime, false);
     SyncDataLayer(true);
+#ifdef TIMELINE_INDEX_CHECK
+    CheckIndexConsistency();
+#endif
     return 0;
 }
 
 void TimeLine::Save(imgui_json::value& value)
+{
+    SyncEditingItems();
+    imgui_json::array media_clips;
+    SaveClips(media_clips, 0, INT64_MAX);
+    SaveExceptClips(value);
+    if (!media_clips.empty()) value["MediaClip"] = std::move(media_clips);
+}
+
+void TimeLine::SyncEditingItems()
 {
     // save editing item
     for (auto item : mEditingItems)
@@ -8419,15 +9046,23 @@ void TimeLine::Save(imgui_json::value& value)
         if (item->mEditingOverlap) item->mEditingOverlap->Save();
     }
     // TODO::Dicky editing item save editing item into json?
+}
 
-    // save media clip
-    imgui_json::value media_clips;
-    for (auto clip : m_Clips)
+size_t TimeLine::SaveClips(imgui_json::array& aClips, size_t szStart, int64_t i64DeadlineUs)
+{
+    // save media clip, at least one clip is saved in each call
+    size_t i = szStart;
+    while (i < m_Clips.size())
     {
-        media_clips.push_back(clip->SaveAsJson());
+        aClips.push_back(m_Clips[i++]->SaveAsJson());
+        if ((int64_t)ImGui::get_current_time_usec() >= i64DeadlineUs)
+            break;
     }
-    if (m_Clips.size() > 0) value["MediaClip"] = media_clips;
+    return i;
+}
 
+void TimeLine::SaveExceptClips(imgui_json::value& value)
+{
     // save clip group
     imgui_json::value clip_groups;
     for (auto group : m_Groups)
@@ -8632,7 +9267,7 @@ void TimeLine::PerformVideoAction(imgui_json::value& action)
         auto pUiVClip = dynamic_cast<VideoClip*>(FindClipByID(clipId));
         IM_ASSERT(pUiVClip);
         MediaCore::VideoClip::Holder hVidClip = MediaCore::VideoClip::CreateVideoInstance(
-            pUiVClip->mID, pUiVClip->mMediaParser, mMtvReader->GetSharedSettings(),
+            pUiVClip->mID, GetPreviewParser(pUiVClip), mMtvReader->GetSharedSettings(),
             pUiVClip->Start(), pUiVClip->End(), pUiVClip->StartOffset(), pUiVClip->EndOffset(), mCurrentTime-pUiVClip->Start(), vidTrack->Direction());
         pUiVClip->SetDataLayer(hVidClip, false);
         vidTrack->InsertClip(hVidClip);
@@ -9102,7 +9737,7 @@ int TimeLine::OnVideoEventStackFilterBpChanged(int type, std::string name, void*
         auto trackId = pClip->TrackId();
         timeline->mNeedUpdateTrackIds.insert(trackId);
     }
-    if (timeline) timeline->mIsBluePrintChanged = true;
+    if (timeline) timeline->MarkBluePrintChanged();
     return ret;
 }
 
@@ -9137,7 +9772,7 @@ int TimeLine::OnAudioEventStackFilterBpChanged(int type, std::string name, void*
     {
         Logger::Log(Logger::WARN) << "---> Ignore 'OnAudioEventStackFilterBpChanged' change type " << type << "." << std::endl;
     }
-    if (timeline) timeline->mIsBluePrintChanged = true;
+    if (timeline) timeline->MarkBluePrintChanged();
     return ret;
 }
 
@@ -9265,6 +9900,8 @@ MediaCore::Snapshot::Generator::Holder TimeLine::GetSnapshotGenerator(int64_t me
         return nullptr;
     if (!IS_VIDEO(mi->mMediaType) || IS_IMAGE(mi->mMediaType))
         return nullptr;
+    if (!mi->EnsureOverview())
+        return nullptr;
     MediaCore::Snapshot::Generator::Holder hSsGen = MediaCore::Snapshot::Generator::CreateInstance();
     hSsGen->SetOverview(mi->mMediaOverview);
     hSsGen->EnableHwAccel(mHardwareCodec);
@@ -9419,26 +10056,13 @@ uint32_t TimeLine::SimplePcmStream::Read(uint8_t* buff, uint32_t buffSize, bool
             m_amat = amats[0].frame;
             // if (!m_amat.empty())
             //     Logger::Log(Logger::INFO) << "=======> m_amat.timestamp=" << m_amat.time_stamp << std::endl;
-            if (m_owner->mAudioAttribute.audio_mutex.try_lock())
-            {
-                m_owner->CalculateAudioScopeData(m_amat);
-                m_owner->mAudioAttribute.audio_mutex.unlock();
-            }
+            // only queue the pcm for the audio scopes here, they are calculated on the audio scope thread
+            m_owner->PushAudioScopePcm(-1, m_amat);
             // channel audio
-            for (auto amat : amats)
+            for (const auto& amat : amats)
             {
                 if (amat.phase == MediaCore::CorrelativeFrame::PHASE_AFTER_TRANSITION)
-                {
-                    auto track = m_owner->FindTrackByID(amat.trackId);
-                    if (track && IS_AUDIO(track->mType))
-                    {
-                        if (track->mAudioTrackAttribute.audio_mutex.try_lock())
-                        {
-                            track->CalculateAudioScopeData(amat.frame);
-                            track->mAudioTrackAttribute.audio_mutex.unlock();
-                        }
-                    }
-                }
+                    m_owner->PushAudioScopePcm(amat.trackId, amat.frame);
             }
             m_readPosInAmat = 0;
         }
@@ -9457,88 +10081,97 @@ void TimeLine::SimplePcmStream::Flush()
     m_amat.release();
     m_readPosInAmat = 0;
     m_tsValid = false;
+    m_owner->DiscardAudioScopePcm();
 }
 
-void TimeLine::CalculateAudioScopeData(ImGui::ImMat& mat_in)
+void TimeLine::PushAudioScopePcm(int64_t trackId, const ImGui::ImMat& amat)
 {
-    if (mat_in.empty() || mat_in.w < 64)
+    if (amat.empty() || amat.w < 64 || amat.c <= 0)
         return;
-    const int fft_size = mat_in.w  > 256 ? 256 : mat_in.w > 128 ? 128 : 64;
-    const int ch = mat_in.c;
-    ImGui::ImMat mat;
-    mat.create_type(fft_size, 1, ch, IM_DT_FLOAT32);
-    // copy fft_size samples from input mat, and convert them into float type
+    if (amat.type != IM_DT_FLOAT32 && amat.type != IM_DT_INT16)
+        return;
+    auto block = mAudioScopeRing.BeginWrite();
+    if (!block)
+        return;
+    const int fft_size = amat.w  > 256 ? 256 : amat.w > 128 ? 128 : 64;
+    const int ch = std::min(amat.c, AUDIO_SCOPE_MAX_CHANNELS);
+    block->trackId = trackId;
+    block->channels = ch;
+    block->samples = fft_size;
+    // convert the first fft_size samples into planar float
+    for (int i = 0; i < ch; i++)
+    {
+        float* pDst = block->data + fft_size * i;
+        const size_t srcStep = amat.elempack > 1 ? amat.c : 1;
+        const size_t srcOffset = amat.elempack > 1 ? i : (size_t)amat.w * i;
+        if (amat.type == IM_DT_FLOAT32)
+        {
+            const float* pSrc = (const float*)amat.data + srcOffset;
+            for (int j = 0; j < fft_size; j++)
+                pDst[j] = pSrc[j * srcStep];
+        }
+        else
+        {
+            const int16_t* pSrc = (const int16_t*)amat.data + srcOffset;
+            for (int j = 0; j < fft_size; j++)
+                pDst[j] = (float)pSrc[j * srcStep] / INT16_MAX;
+        }
+    }
+    mAudioScopeRing.EndWrite();
+}
+
+void TimeLine::_AudioScopeProc()
+{
+    const auto interval = std::chrono::milliseconds(15);
+    while (!mQuitAudioScope)
     {
-        float** ppDstPtrs = new float*[ch];
-        for (int i = 0; i < ch; i++)
-            ppDstPtrs[i] = (float*)mat.data+mat.w*i;
-        if (mat_in.elempack > 1)
+        const bool discard = mAudioScopeDiscard.exchange(false);
+        const AudioScopePcmBlock* block;
+        while (!mQuitAudioScope && (block = mAudioScopeRing.BeginRead()) != nullptr)
         {
-            if (mat_in.type == IM_DT_FLOAT32)
+            if (!discard)
             {
-                const float* pSrcPtr = (const float*)mat_in.data;
-                for (int i = 0; i < fft_size; i++)
+                if (block->trackId == -1)
                 {
-                    for (int j = 0; j < ch; j++)
-                    {
-                        auto& pDstPtr = ppDstPtrs[j];
-                        *pDstPtr++ = *pSrcPtr++;
-                    }
+                    std::lock_guard<std::mutex> lk(mAudioAttribute.audio_mutex);
+                    CalculateAudioScopeData(*block);
                 }
-            }
-            else if (mat_in.type == IM_DT_INT16)
-            {
-                const int16_t* pSrcPtr = (const int16_t*)mat_in.data;
-                for (int i = 0; i < fft_size; i++)
+                else
                 {
-                    for (int j = 0; j < ch; j++)
+                    auto track = FindTrackByID(block->trackId);
+                    if (track && IS_AUDIO(track->mType))
                     {
-                        auto& pDstPtr = ppDstPtrs[j];
-                        *pDstPtr++ = (float)(*pSrcPtr++)/INT16_MAX;
+                        std::lock_guard<std::mutex> lk(track->mAudioTrackAttribute.audio_mutex);
+                        track->CalculateAudioScopeData(*block);
                     }
                 }
             }
-            else
-                throw std::runtime_error("This PCM format is NOT SUPPORTED yet!");
+            mAudioScopeRing.EndRead();
         }
-        else
-        {
-            if (mat_in.type == IM_DT_FLOAT32)
-            {
-                const float** ppSrcPtrs = new const float*[ch];
-                for (int i = 0; i < ch; i++)
-                    ppSrcPtrs[i] = (const float*)mat_in.data+mat_in.w*i;
-                for (int i = 0; i < ch; i++)
-                    memcpy(ppDstPtrs[i], ppSrcPtrs[i], fft_size*sizeof(float));
-                delete [] ppSrcPtrs;
-            }
-            else if (mat_in.type == IM_DT_INT16)
-            {
-                const int16_t** ppSrcPtrs = new const int16_t*[ch];
-                for (int i = 0; i < ch; i++)
-                    ppSrcPtrs[i] = (const int16_t*)mat_in.data+mat_in.w*i;
-                for (int i = 0; i < ch; i++)
-                {
-                    auto& pDstPtr = ppDstPtrs[i];
-                    auto& pSrcPtr = ppSrcPtrs[i];
-                    for (int j = 0; j < fft_size; j++)
-                        *pDstPtr++ = (float)(*pSrcPtr++)/INT16_MAX;
-                }
-                delete [] ppSrcPtrs;
-            }
-            else
-                throw std::runtime_error("This PCM format is NOT SUPPORTED yet!");
-        }
-        delete [] ppDstPtrs;
+        std::this_thread::sleep_for(interval);
     }
+}
+
+void TimeLine::CalculateAudioScopeData(const AudioScopePcmBlock& block)
+{
+    if (block.samples <= 0 || block.channels <= 0)
+        return;
+    // wrap the planar pcm of the block, no copy
+    ImGui::ImMat mat;
+    mat.create_type(block.samples, 1, block.channels, (void*)block.data, IM_DT_FLOAT32);
 
     for (int i = 0; i < mat.c; i++)
     {
         if (i >= (int)mhMediaSettings->AudioOutChannels())
             break;
+        if (i >= (int)mAudioAttribute.channel_data.size())
+            break;
         auto & channel_data = mAudioAttribute.channel_data[i];
-        channel_data.m_wave.clone_from(mat.channel(i));
-        channel_data.m_fft.clone_from(mat.channel(i));
+        const float* pcm = (const float*)mat.channel(i).data;
+        channel_data.m_wave.create_type(mat.w, 1, IM_DT_FLOAT32);
+        memcpy(channel_data.m_wave.data, pcm, mat.w * sizeof(float));
+        channel_data.m_fft.create_type(mat.w, 1, IM_DT_FLOAT32);
+        memcpy(channel_data.m_fft.data, pcm, mat.w * sizeof(float));
         ImGui::ImRFFT((float *)channel_data.m_fft.data, channel_data.m_fft.w, true);
         channel_data.m_db.create_type((mat.w >> 1) + 1, IM_DT_FLOAT32);
         channel_data.m_DBMaxIndex = ImGui::ImReComposeDB((float*)channel_data.m_fft.data, (float *)channel_data.m_db.data, mat.w, false);
@@ -9570,7 +10203,7 @@ void TimeLine::CalculateAudioScopeData(ImGui::ImMat& mat_in)
             channel_data.m_Spectrogram.flags |= IM_MAT_FLAGS_CUSTOM_UPDATED;
         }
     }
-    if (mat.c >= 2)
+    if (mat.c >= 2 && mAudioAttribute.channel_data.size() >= 2)
     {
         if (mAudioAttribute.m_audio_vector.empty())
         {
@@ -9631,6 +10264,18 @@ bool TimeLine::ConfigEncoder(const std::string& outputPath, VideoEncoderParams&
         errMsg = "At least one video or audio stream is going to be encoded!";
         return false;
     }
+    mEncSegments.clear();
+    mEncAudioPath.clear();
+    mEncOutputPath = outputPath;
+    mEncMtvReader = nullptr;
+    mEncMtaReader = nullptr;
+    if (vidEncParams.encodeVideo && mEncodingSegments > 1)
+    {
+        if (!ConfigSegmentEncoders(outputPath, vidEncParams, audEncParams, errMsg))
+            return false;
+        if (!mEncSegments.empty())
+            return true;
+    }
     mEncoder = MediaCore::MediaEncoder::CreateInstance();
     if (!mEncoder->Open(outputPath))
     {
@@ -9648,7 +10293,12 @@ bool TimeLine::ConfigEncoder(const std::string& outputPath, VideoEncoderParams&
             errMsg = mEncoder->GetError();
             return false;
         }
-        mEncMtvReader = mMtvReader->CloneAndConfigure(vidEncParams.width, vidEncParams.height, vidEncParams.frameRate);
+        if (!mEncMtvReader)
+        {
+            mEncMtvReader = mMtvReader->CloneAndConfigure(vidEncParams.width, vidEncParams.height, vidEncParams.frameRate);
+            // the preview may decode the proxies, export always reads the original media
+            SwitchClipSources(mEncMtvReader, false);
+        }
     }
 
     if (audEncParams.encodeAudio)
@@ -9666,6 +10316,99 @@ bool TimeLine::ConfigEncoder(const std::string& outputPath, VideoEncoderParams&
     return true;
 }
 
+bool TimeLine::ConfigSegmentEncoders(const std::string& outputPath, VideoEncoderParams& vidEncParams, AudioEncoderParams& audEncParams, std::string& errMsg)
+{
+    auto hMtvReader = mMtvReader->CloneAndConfigure(vidEncParams.width, vidEncParams.height, vidEncParams.frameRate);
+    if (!hMtvReader)
+    {
+        errMsg = mMtvReader->GetError();
+        return false;
+    }
+    // the preview may decode the proxies, export always reads the original media
+    SwitchClipSources(hMtvReader, false);
+    // every segment should be long enough to amortize the extra reader and encoder, otherwise export in one pass
+    const int64_t firstFrameIndex = hMtvReader->MillsecToFrameIndex(mEncodingStart);
+    const int64_t totalFrames = hMtvReader->MillsecToFrameIndex(mEncodingEnd, 2) - firstFrameIndex;
+    const int64_t minSegmentFrames = std::max<int64_t>(1, (int64_t)vidEncParams.frameRate.num * ENCODE_SEGMENT_MIN_SECONDS / vidEncParams.frameRate.den);
+    const int segmentCount = (int)std::min<int64_t>(mEncodingSegments, totalFrames / minSegmentFrames);
+    if (segmentCount < 2)
+    {
+        mEncMtvReader = hMtvReader;
+        return true;
+    }
+
+    const auto dirPath = SysUtils::ExtractDirectoryPath(outputPath);
+    const auto baseName = SysUtils::ExtractFileBaseName(outputPath);
+    const auto extName = SysUtils::ExtractFileExtName(outputPath);
+    std::string imageFormat;
+    for (int i = 0; i < segmentCount; i++)
+    {
+        auto hSeg = std::make_shared<EncodeSegment>();
+        hSeg->firstFrameIndex = firstFrameIndex + totalFrames * i / segmentCount;
+        hSeg->frameCount = firstFrameIndex + totalFrames * (i + 1) / segmentCount - hSeg->firstFrameIndex;
+        hSeg->path = SysUtils::JoinPath(dirPath, "." + baseName + ".seg" + std::to_string(i) + extName);
+        hSeg->hReader = i == 0 ? hMtvReader : mMtvReader->CloneAndConfigure(vidEncParams.width, vidEncParams.height, vidEncParams.frameRate);
+        if (!hSeg->hReader)
+        {
+            errMsg = mMtvReader->GetError();
+            mEncSegments.clear();
+            return false;
+        }
+        if (i > 0)
+            SwitchClipSources(hSeg->hReader, false);
+        hSeg->hEncoder = MediaCore::MediaEncoder::CreateInstance();
+        imageFormat = vidEncParams.imageFormat;
+        if (!hSeg->hEncoder->Open(hSeg->path) || !hSeg->hEncoder->ConfigureVideoStream(
+            vidEncParams.codecName, imageFormat, vidEncParams.width, vidEncParams.height,
+            vidEncParams.frameRate, vidEncParams.bitRate, &vidEncParams.extraOpts))
+        {
+            errMsg = hSeg->hEncoder->GetError();
+            mEncSegments.clear();
+            return false;
+        }
+        mEncSegments.push_back(hSeg);
+    }
+    vidEncParams.imageFormat = imageFormat;
+    mEncFrameRate = vidEncParams.frameRate;
+
+    mEncoder = nullptr;
+    if (audEncParams.encodeAudio)
+    {
+        mEncAudioPath = SysUtils::JoinPath(dirPath, "." + baseName + ".audio" + extName);
+        mEncoder = MediaCore::MediaEncoder::CreateInstance();
+        if (!mEncoder->Open(mEncAudioPath) || !mEncoder->ConfigureAudioStream(
+            audEncParams.codecName, audEncParams.sampleFormat, audEncParams.channels,
+            audEncParams.sampleRate, audEncParams.bitRate))
+        {
+            errMsg = mEncoder->GetError();
+            mEncSegments.clear();
+            return false;
+        }
+        mEncMtaReader = mMtaReader->CloneAndConfigure(audEncParams.channels, audEncParams.sampleRate, audEncParams.sampleFormat, audEncParams.samplesPerFrame);
+    }
+    Logger::Log(Logger::INFO) << "Export " << totalFrames << " frames in " << segmentCount << " parallel segments." << std::endl;
+    return true;
+}
+
+void TimeLine::UpdateEncodingPreview(const ImGui::ImMat& vmat)
+{
+    auto pSlot = mEncodingPreview.BeginWrite();
+    if (!pSlot)
+        return;
+    // gpu frames are shown as they are, downscaling them would need a round trip to the cpu
+    if (vmat.device == IM_DD_CPU && vmat.h > ENCODE_PREVIEW_MAX_HEIGHT && vmat.w > 1 && (vmat.dims == 2 || vmat.dims == 3))
+    {
+        const float fScale = (float)ENCODE_PREVIEW_MAX_HEIGHT/vmat.h;
+        *pSlot = vmat.resize(std::max(1.f, std::round(vmat.w*fScale)), (float)ENCODE_PREVIEW_MAX_HEIGHT, IM_INTERPOLATE_BILINEAR);
+        pSlot->time_stamp = vmat.time_stamp;
+    }
+    else
+    {
+        *pSlot = vmat;
+    }
+    mEncodingPreview.EndWrite(!pSlot->empty());
+}
+
 void TimeLine::StartEncoding()
 {
     if (mEncodingThread.joinable())
@@ -9677,9 +10420,13 @@ void TimeLine::StartEncoding()
     mEncodeProcErrMsg.clear();
     mEncodingProgress = 0;
     mEncodingDuration = (double)ValidDuration()/1000.f;
+    mEncodingPreview.Reset();
     mQuitEncoding = false;
     mIsEncoding = true;
-    mEncodingThread = std::thread(&TimeLine::_EncodeProc, this);
+    if (mEncSegments.empty())
+        mEncodingThread = std::thread(&TimeLine::_EncodeProc, this);
+    else
+        mEncodingThread = std::thread(&TimeLine::_SegmentEncodeProc, this);
     SysUtils::SetThreadName(mEncodingThread, "TL-EncProc");
 }
 
@@ -9695,185 +10442,615 @@ void TimeLine::StopEncoding()
     mEncoder = nullptr;
     mEncMtvReader = nullptr;
     mEncMtaReader = nullptr;
+    mEncSegments.clear();
+}
+
+static inline int64_t EncodeStageElapsedUs(std::chrono::steady_clock::time_point& t)
+{
+    const auto now = std::chrono::steady_clock::now();
+    const int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(now-t).count();
+    t = now;
+    return us;
+}
+
+void TimeLine::_EncodeVideoRenderProc()
+{
+    auto& stats = mEncodeStageStats[ENCODE_STAGE_VIDEO];
+    int64_t vidFrameCount = mEncMtvReader->MillsecToFrameIndex(mEncodingStart);
+    auto t = std::chrono::steady_clock::now();
+    while (!mQuitEncoding)
+    {
+        const int64_t vidpos = mEncMtvReader->FrameIndexToMillsec(vidFrameCount);
+        if (vidpos >= mEncodingEnd)
+            break;
+        ImGui::ImMat vmat;
+        if (!mEncMtvReader->ReadVideoFrameByIdx(vidFrameCount, vmat))
+        {
+            std::ostringstream oss;
+            oss << "[video] '" << mEncMtvReader->GetError() << "'.";
+            mEncVideoErrMsg = oss.str();
+            break;
+        }
+        stats.busyUs += EncodeStageElapsedUs(t);
+        if (vmat.empty())
+            continue;
+        vmat.time_stamp = (double)(vidpos-mEncStartTimeOffset)/1000.;
+        vidFrameCount++;
+        const bool pushed = mEncVideoQueue.Push(vmat);
+        stats.stallUs += EncodeStageElapsedUs(t);
+        if (!pushed)
+            break;
+        stats.frames++;
+    }
+    mEncVideoQueue.Close();
+}
+
+void TimeLine::_EncodeAudioRenderProc()
+{
+    auto& stats = mEncodeStageStats[ENCODE_STAGE_AUDIO];
+    auto t = std::chrono::steady_clock::now();
+    while (!mQuitEncoding)
+    {
+        ImGui::ImMat amat;
+        bool eof = false;
+        if (!mEncMtaReader->ReadAudioSamples(amat, eof) && !eof)
+        {
+            std::ostringstream oss;
+            oss << "[audio] '" << mEncMtaReader->GetError() << "'.";
+            mEncAudioErrMsg = oss.str();
+            break;
+        }
+        stats.busyUs += EncodeStageElapsedUs(t);
+        if (eof)
+            break;
+        if (amat.empty())
+            continue;
+        const int64_t audpos = amat.time_stamp * 1000;
+        if (audpos > mEncodingEnd)
+            break;
+        amat.time_stamp = (double)(audpos-mEncStartTimeOffset)/1000.;
+        const bool pushed = mEncAudioQueue.Push(amat);
+        stats.stallUs += EncodeStageElapsedUs(t);
+        if (!pushed)
+            break;
+        stats.frames++;
+    }
+    mEncAudioQueue.Close();
 }
 
 void TimeLine::_EncodeProc()
 {
     Logger::Log(Logger::DEBUG) << ">>>>>>>>>>> Enter encoding proc >>>>>>>>>>>>" << std::endl;
     mEncoder->Start();
+    for (auto& stats : mEncodeStageStats)
+        stats.Reset();
+    mEncVideoQueue.Reset();
+    mEncAudioQueue.Reset();
+    mEncVideoErrMsg.clear();
+    mEncAudioErrMsg.clear();
     bool vidInputEof = false;
     bool audInputEof = false;
     int nextLoopEncodeType = 0;  // 0: no hint, 1: video, 2: audio
     int64_t audpos = 0, vidpos = 0;
-    double maxEncodeDuration = 0;
-    MediaCore::Ratio outFrameRate = mEncoder->GetVideoFrameRate();
     ImGui::ImMat vmat, amat;
-    uint32_t pcmbufSize = 8192;
-    uint8_t* pcmbuf = new uint8_t[pcmbufSize];
     auto dur = ValidDuration();
     int64_t encpos = 0;
-    int64_t vidFrameCount = 0;
-    int64_t startTimeOffset = 0;
-    if (mEncMtvReader) {
+    mEncStartTimeOffset = 0;
+    std::thread vidRenderThread, audRenderThread;
+    if (mEncMtvReader)
+    {
         mEncMtvReader->SeekTo(mEncodingStart);
-        vidFrameCount = mEncMtvReader->MillsecToFrameIndex(mEncodingStart);
-        startTimeOffset = mEncMtvReader->FrameIndexToMillsec(vidFrameCount);
+        mEncStartTimeOffset = mEncMtvReader->FrameIndexToMillsec(mEncMtvReader->MillsecToFrameIndex(mEncodingStart));
         mEncMtvReader->SetCacheFrameNum(8);
+        vidRenderThread = std::thread(&TimeLine::_EncodeVideoRenderProc, this);
+        SysUtils::SetThreadName(vidRenderThread, "TL-EncVidRnd");
     }
     else
         vidInputEof = true;
     if (mEncMtaReader)
+    {
         mEncMtaReader->SeekTo(mEncodingStart);
+        audRenderThread = std::thread(&TimeLine::_EncodeAudioRenderProc, this);
+        SysUtils::SetThreadName(audRenderThread, "TL-EncAudRnd");
+    }
     else
         audInputEof = true;
+
+    // encode/mux stage, the frames are taken from the render stages and fed to the encoder in timestamp order
+    auto& stats = mEncodeStageStats[ENCODE_STAGE_MUX];
+    auto t = std::chrono::steady_clock::now();
     while (!mQuitEncoding && (!vidInputEof || !audInputEof))
     {
-        bool idleLoop = true;
-        if (!vidInputEof && (nextLoopEncodeType == 1 || audInputEof || (nextLoopEncodeType == 0 && vidpos <= audpos)))
+        bool vidEof = false, audEof = false;
+        if (!vidInputEof && vmat.empty() && !mEncVideoQueue.Pop(vmat, vidEof))
+            break;
+        if (!audInputEof && amat.empty() && !mEncAudioQueue.Pop(amat, audEof))
+            break;
+        stats.stallUs += EncodeStageElapsedUs(t);
+        if (vidEof)
         {
-            vidpos = mEncMtvReader->FrameIndexToMillsec(vidFrameCount);
-            bool eof = vidpos >= mEncodingEnd;
-            if (!eof)
+            if (!mEncVideoErrMsg.empty())
+                break;
+            bool consumed = false;
+            if (!mEncoder->EncodeVideoFrame(vmat, consumed))
             {
-                if (vmat.empty())
-                {
-                    if (!mEncMtvReader->ReadVideoFrameByIdx(vidFrameCount, vmat))
-                    {
-                        std::ostringstream oss;
-                        oss << "[video] '" << mEncMtvReader->GetError() << "'.";
-                        mEncodeProcErrMsg = oss.str();
-                        break;
-                    }
-                    if (!vmat.empty())
-                    {
-                        vmat.time_stamp = (double)(vidpos-startTimeOffset)/1000.;
-                        vidFrameCount++;
-                    }
-                }
-                if (!vmat.empty())
-                {
-                    {
-                        std::lock_guard<std::mutex> lk(mEncodingMutex);
-                        mEncodingVFrame = vmat;
-                    }
-                    bool consumed = false;
-                    if (!mEncoder->EncodeVideoFrame(vmat, consumed, false))
-                    {
-                        std::ostringstream oss;
-                        oss << "[video] '" << mEncoder->GetError() << "'.";
-                        mEncodeProcErrMsg = oss.str();
-                        break;
-                    }
-                    if (consumed)
-                    {
-                        vmat.release();
-                        nextLoopEncodeType = 0;
-                    }
-                    else
-                        nextLoopEncodeType = 2;
-                    if (vidpos > encpos)
-                    {
-                        encpos = vidpos;
-                        mEncodingProgress = (float)((double)(encpos - startTimeOffset) / dur);
-                    }
-                }
+                std::ostringstream oss;
+                oss << "[video] '" << mEncoder->GetError() << "'.";
+                mEncodeProcErrMsg = oss.str();
+                break;
             }
-            else
+            vidInputEof = true;
+        }
+        if (audEof)
+        {
+            if (!mEncAudioErrMsg.empty())
+                break;
+            bool consumed = false;
+            if (!mEncoder->EncodeAudioSamples(amat, consumed))
             {
-                vmat.release();
-                bool consumed = false;
-                if (!mEncoder->EncodeVideoFrame(vmat, consumed))
-                {
-                    std::ostringstream oss;
-                    oss << "[video] '" << mEncoder->GetError() << "'.";
-                    mEncodeProcErrMsg = oss.str();
-                    break;
-                }
-                vidInputEof = true;
+                std::ostringstream oss;
+                oss << "[audio] '" << mEncoder->GetError() << "'.";
+                mEncodeProcErrMsg = oss.str();
+                break;
             }
+            audInputEof = true;
         }
-        else
+        if (!vmat.empty())
+            vidpos = vmat.time_stamp * 1000 + mEncStartTimeOffset;
+        if (!amat.empty())
+            audpos = amat.time_stamp * 1000 + mEncStartTimeOffset;
+
+        bool consumed = false;
+        if (!vmat.empty() && (nextLoopEncodeType == 1 || amat.empty() || (nextLoopEncodeType == 0 && vidpos <= audpos)))
         {
-            bool eof;
-            uint32_t readSize = pcmbufSize;
-            if (amat.empty() && !mEncMtaReader->ReadAudioSamples(amat, eof) && !eof)
+            UpdateEncodingPreview(vmat);
+            if (!mEncoder->EncodeVideoFrame(vmat, consumed, false))
             {
                 std::ostringstream oss;
-                oss << "[audio] '" << mEncMtaReader->GetError() << "'.";
+                oss << "[video] '" << mEncoder->GetError() << "'.";
                 mEncodeProcErrMsg = oss.str();
                 break;
             }
-            if (audpos > mEncodingEnd) eof = true;
-            if (!eof && !amat.empty())
+            if (consumed)
             {
-                audpos = amat.time_stamp * 1000;
-                amat.time_stamp = (double)(audpos-startTimeOffset)/1000.;
-                bool consumed = false;
-                if (!mEncoder->EncodeAudioSamples(amat, consumed, false))
-                {
-                    std::ostringstream oss;
-                    oss << "[audio] '" << mEncoder->GetError() << "'.";
-                    mEncodeProcErrMsg = oss.str();
-                    break;
-                }
-                if (consumed)
-                {
-                    amat.release();
-                    nextLoopEncodeType = 0;
-                }
-                else
-                    nextLoopEncodeType = 1;
-                if (audpos > encpos)
-                {
-                    encpos = audpos;
-                    mEncodingProgress = (float)((double)(encpos - startTimeOffset) / dur);
-                }
+                vmat.release();
+                nextLoopEncodeType = 0;
+                if (vidpos > encpos)
+                    encpos = vidpos;
             }
             else
+                nextLoopEncodeType = amat.empty() ? 0 : 2;
+        }
+        else if (!amat.empty())
+        {
+            if (!mEncoder->EncodeAudioSamples(amat, consumed, false))
+            {
+                std::ostringstream oss;
+                oss << "[audio] '" << mEncoder->GetError() << "'.";
+                mEncodeProcErrMsg = oss.str();
+                break;
+            }
+            if (consumed)
             {
                 amat.release();
-                // {
-                //     std::lock_guard<std::mutex> lk(mEncodingMutex);
-                //     mEncodingAFrame = amat;
-                // }
-                bool consumed = false;
-                if (!mEncoder->EncodeAudioSamples(amat, consumed))
-                {
-                    std::ostringstream oss;
-                    oss << "[audio] '" << mEncoder->GetError() << "'.";
-                    mEncodeProcErrMsg = oss.str();
-                    break;
-                }
-                audInputEof = true;
+                nextLoopEncodeType = 0;
+                if (audpos > encpos)
+                    encpos = audpos;
             }
+            else
+                nextLoopEncodeType = vmat.empty() ? 0 : 1;
+        }
+        else
+            continue;
+        if (consumed)
+        {
+            stats.frames++;
+            mEncodingProgress = (float)((double)(encpos - mEncStartTimeOffset) / dur);
+            stats.busyUs += EncodeStageElapsedUs(t);
+        }
+        else
+        {
+            // the encoder is busy with the other stream, don't spin on it
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            stats.stallUs += EncodeStageElapsedUs(t);
         }
     }
+    mEncVideoQueue.Abort();
+    mEncAudioQueue.Abort();
+    if (vidRenderThread.joinable())
+        vidRenderThread.join();
+    if (audRenderThread.joinable())
+        audRenderThread.join();
+    if (mEncodeProcErrMsg.empty())
+        mEncodeProcErrMsg = !mEncVideoErrMsg.empty() ? mEncVideoErrMsg : mEncAudioErrMsg;
     if (!mQuitEncoding && mEncodeProcErrMsg.empty())
     {
         mEncodingProgress = 1;
     }
     mEncoder->FinishEncoding();
     mEncoder->Close();
+    const char* stageNames[ENCODE_STAGE_COUNT] = { "video render", "audio render", "encode/mux" };
+    for (int i = 0; i < ENCODE_STAGE_COUNT; i++)
+    {
+        const auto& stageStats = mEncodeStageStats[i];
+        Logger::Log(Logger::INFO) << "Export stage '" << stageNames[i] << "': " << stageStats.frames << " frames, "
+                << std::fixed << std::setprecision(1) << stageStats.Fps() << " fps, busy " << stageStats.busyUs/1000 << "ms, stall "
+                << stageStats.stallUs/1000 << "ms (" << stageStats.StallRatio()*100 << "%)." << std::endl;
+    }
     mIsEncoding = false;
     Logger::Log(Logger::DEBUG) << "<<<<<<<<<<<<< Quit encoding proc <<<<<<<<<<<<<<<<" << std::endl;
 }
 
+void TimeLine::_EncodeSegmentProc(EncodeSegment* pSeg)
+{
+    auto& vidStats = mEncodeStageStats[ENCODE_STAGE_VIDEO];
+    auto& encStats = mEncodeStageStats[ENCODE_STAGE_MUX];
+    auto& hReader = pSeg->hReader;
+    auto& hEncoder = pSeg->hEncoder;
+    hEncoder->Start();
+    hReader->SeekToByIdx(pSeg->firstFrameIndex);
+    hReader->SetCacheFrameNum(8);
+    // each segment starts at time 0, the segments are rebased when they are concatenated
+    const int64_t segStartPos = hReader->FrameIndexToMillsec(pSeg->firstFrameIndex);
+    auto t = std::chrono::steady_clock::now();
+    int64_t i = 0;
+    while (!mQuitEncoding && i < pSeg->frameCount)
+    {
+        const int64_t frameIndex = pSeg->firstFrameIndex + i;
+        ImGui::ImMat vmat;
+        if (!hReader->ReadVideoFrameByIdx(frameIndex, vmat))
+        {
+            std::ostringstream oss;
+            oss << "[video] '" << hReader->GetError() << "'.";
+            pSeg->errMsg = oss.str();
+            break;
+        }
+        vidStats.busyUs += EncodeStageElapsedUs(t);
+        if (vmat.empty())
+            continue;
+        vmat.time_stamp = (double)(hReader->FrameIndexToMillsec(frameIndex) - segStartPos) / 1000.;
+        UpdateEncodingPreview(vmat);
+        bool consumed = false;
+        if (!hEncoder->EncodeVideoFrame(vmat, consumed))
+        {
+            std::ostringstream oss;
+            oss << "[video] '" << hEncoder->GetError() << "'.";
+            pSeg->errMsg = oss.str();
+            break;
+        }
+        encStats.busyUs += EncodeStageElapsedUs(t);
+        vidStats.frames++;
+        encStats.frames++;
+        pSeg->encodedFrames++;
+        i++;
+    }
+    if (pSeg->errMsg.empty() && !mQuitEncoding)
+    {
+        ImGui::ImMat vmat;
+        bool consumed = false;
+        if (!hEncoder->EncodeVideoFrame(vmat, consumed))
+        {
+            std::ostringstream oss;
+            oss << "[video] '" << hEncoder->GetError() << "'.";
+            pSeg->errMsg = oss.str();
+        }
+    }
+    hEncoder->FinishEncoding();
+    hEncoder->Close();
+    // stop the other segments on failure
+    if (!pSeg->errMsg.empty())
+        mQuitEncoding = true;
+}
+
+void TimeLine::_SegmentEncodeProc()
+{
+    Logger::Log(Logger::DEBUG) << ">>>>>>>>>>> Enter segment encoding proc >>>>>>>>>>>>" << std::endl;
+    for (auto& stats : mEncodeStageStats)
+        stats.Reset();
+    const auto& hFirstSeg = mEncSegments.front();
+    mEncStartTimeOffset = hFirstSeg->hReader->FrameIndexToMillsec(hFirstSeg->firstFrameIndex);
+    int64_t totalFrames = 0;
+    std::vector<std::thread> segThreads;
+    for (size_t i = 0; i < mEncSegments.size(); i++)
+    {
+        totalFrames += mEncSegments[i]->frameCount;
+        segThreads.push_back(std::thread(&TimeLine::_EncodeSegmentProc, this, mEncSegments[i].get()));
+        SysUtils::SetThreadName(segThreads.back(), "TL-EncSeg" + std::to_string(i));
+    }
+
+    // the audio is encoded in one pass on this thread, while the video segments are encoded in parallel
+    bool audInputEof = !mEncoder;
+    if (mEncoder)
+    {
+        mEncoder->Start();
+        mEncMtaReader->SeekTo(mEncodingStart);
+    }
+    auto& audStats = mEncodeStageStats[ENCODE_STAGE_AUDIO];
+    auto dur = ValidDuration();
+    int64_t audpos = mEncStartTimeOffset;
+    auto t = std::chrono::steady_clock::now();
+    while (!mQuitEncoding)
+    {
+        int64_t encodedFrames = 0;
+        for (auto& hSeg : mEncSegments)
+            encodedFrames += hSeg->encodedFrames;
+        const float vidProgress = totalFrames > 0 ? (float)encodedFrames / totalFrames : 1.f;
+        const float audProgress = audInputEof ? 1.f : (float)((double)(audpos - mEncStartTimeOffset) / dur);
+        mEncodingProgress = std::min(vidProgress, audProgress);
+        if (audInputEof)
+        {
+            if (encodedFrames >= totalFrames)
+                break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            continue;
+        }
+
+        ImGui::ImMat amat;
+        bool eof = false;
+        if (!mEncMtaReader->ReadAudioSamples(amat, eof) && !eof)
+        {
+            std::ostringstream oss;
+            oss << "[audio] '" << mEncMtaReader->GetError() << "'.";
+            mEncodeProcErrMsg = oss.str();
+            mQuitEncoding = true;
+            break;
+        }
+        if (!eof && !amat.empty())
+        {
+            audpos = amat.time_stamp * 1000;
+            eof = audpos > mEncodingEnd;
+        }
+        if (!eof && amat.empty())
+            continue;
+        if (eof)
+            amat.release();
+        else
+            amat.time_stamp = (double)(audpos - mEncStartTimeOffset) / 1000.;
+        bool consumed = false;
+        if (!mEncoder->EncodeAudioSamples(amat, consumed))
+        {
+            std::ostringstream oss;
+            oss << "[audio] '" << mEncoder->GetError() << "'.";
+            mEncodeProcErrMsg = oss.str();
+            mQuitEncoding = true;
+            break;
+        }
+        audStats.busyUs += EncodeStageElapsedUs(t);
+        if (eof)
+            audInputEof = true;
+        else
+            audStats.frames++;
+    }
+    for (auto& th : segThreads)
+        th.join();
+    if (mEncoder)
+    {
+        mEncoder->FinishEncoding();
+        mEncoder->Close();
+    }
+    for (auto& hSeg : mEncSegments)
+    {
+        if (mEncodeProcErrMsg.empty() && !hSeg->errMsg.empty())
+            mEncodeProcErrMsg = hSeg->errMsg;
+    }
+    if (!mQuitEncoding && mEncodeProcErrMsg.empty())
+    {
+        std::string errMsg;
+        if (ConcatEncodedSegments(errMsg))
+            mEncodingProgress = 1;
+        else
+            mEncodeProcErrMsg = errMsg;
+    }
+    RemoveEncodedSegments();
+    const char* stageNames[ENCODE_STAGE_COUNT] = { "video render", "audio", "video encode" };
+    for (int i = 0; i < ENCODE_STAGE_COUNT; i++)
+    {
+        const auto& stageStats = mEncodeStageStats[i];
+        Logger::Log(Logger::INFO) << "Export stage '" << stageNames[i] << "': " << stageStats.frames << " frames, busy "
+                << stageStats.busyUs/1000 << "ms over " << mEncSegments.size() << " segments." << std::endl;
+    }
+    mIsEncoding = false;
+    Logger::Log(Logger::DEBUG) << "<<<<<<<<<<<<< Quit segment encoding proc <<<<<<<<<<<<<<<<" << std::endl;
+}
+
+// Remux the encoded video segments and the audio file into 'mEncOutputPath' without re-encoding. Each segment starts at
+// time 0, so its timestamps are shifted by the position of its first frame. Every segment is encoded by its own encoder,
+// thus starts with a key frame and doesn't reference frames of the other segments.
+bool TimeLine::ConcatEncodedSegments(std::string& errMsg)
+{
+    if (SysUtils::IsFile(mEncOutputPath))
+        SysUtils::DeleteFileAt(mEncOutputPath);
+    AVFormatContext* pOutFmtCtx = nullptr;
+    int fferr = avformat_alloc_output_context2(&pOutFmtCtx, nullptr, nullptr, mEncOutputPath.c_str());
+    if (fferr < 0 || !pOutFmtCtx)
+    {
+        std::ostringstream oss; oss << "FAILED to allocate output format context for '" << mEncOutputPath << "'! fferr=" << fferr << ".";
+        errMsg = oss.str();
+        return false;
+    }
+
+    struct ConcatInput
+    {
+        AVFormatContext* pFmtCtx {nullptr};
+        AVStream* pInStm {nullptr};
+        AVStream* pOutStm {nullptr};
+        AVPacket* pPkt {nullptr};
+        bool bPktReady {false};
+        bool bEof {false};
+        int64_t i64Offset {0};
+    };
+    std::ostringstream oss;
+    auto OpenInput = [&] (ConcatInput& tInput, const std::string& strPath, AVMediaType eMediaType) {
+        fferr = avformat_open_input(&tInput.pFmtCtx, strPath.c_str(), nullptr, nullptr);
+        if (fferr < 0)
+        {
+            oss << "FAILED to open '" << strPath << "'! fferr=" << fferr << ".";
+            return false;
+        }
+        fferr = avformat_find_stream_info(tInput.pFmtCtx, nullptr);
+        const int iStmIdx = fferr < 0 ? fferr : av_find_best_stream(tInput.pFmtCtx, eMediaType, -1, -1, nullptr, 0);
+        if (iStmIdx < 0)
+        {
+            oss << "FAILED to find " << av_get_media_type_string(eMediaType) << " stream in '" << strPath << "'! fferr=" << iStmIdx << ".";
+            avformat_close_input(&tInput.pFmtCtx);
+            return false;
+        }
+        tInput.pInStm = tInput.pFmtCtx->streams[iStmIdx];
+        return true;
+    };
+    auto CreateOutStream = [&] (ConcatInput& tInput) {
+        tInput.pOutStm = avformat_new_stream(pOutFmtCtx, nullptr);
+        if (!tInput.pOutStm || avcodec_parameters_copy(tInput.pOutStm->codecpar, tInput.pInStm->codecpar) < 0)
+        {
+            oss << "FAILED to create output stream!";
+            return false;
+        }
+        tInput.pOutStm->codecpar->codec_tag = 0;
+        tInput.pOutStm->time_base = tInput.pInStm->time_base;
+        tInput.pOutStm->avg_frame_rate = tInput.pInStm->avg_frame_rate;
+        return true;
+    };
+
+    ConcatInput tVidInput, tAudInput;
+    tVidInput.pPkt = av_packet_alloc();
+    tAudInput.pPkt = av_packet_alloc();
+    tAudInput.bEof = mEncAudioPath.empty();
+    size_t segIdx = 0;
+    bool bHeaderWritten = false;
+    const AVRational tFrameTb = { mEncFrameRate.den, mEncFrameRate.num };
+    // read the next packet of 'tInput', the video input moves on to the next segment at the end of each segment
+    auto ReadPacket = [&] (ConcatInput& tInput, bool bIsVideo) {
+        while (true)
+        {
+            fferr = av_read_frame(tInput.pFmtCtx, tInput.pPkt);
+            if (fferr == AVERROR_EOF)
+            {
+                avformat_close_input(&tInput.pFmtCtx);
+                if (!bIsVideo || ++segIdx >= mEncSegments.size())
+                {
+                    tInput.bEof = true;
+                    return true;
+                }
+                if (!OpenInput(tInput, mEncSegments[segIdx]->path, AVMEDIA_TYPE_VIDEO))
+                    return false;
+                tInput.i64Offset = av_rescale_q(mEncSegments[segIdx]->firstFrameIndex - mEncSegments[0]->firstFrameIndex, tFrameTb, tInput.pOutStm->time_base);
+                continue;
+            }
+            if (fferr < 0)
+            {
+                oss << "FAILED to read packet for concatenation! fferr=" << fferr << ".";
+                return false;
+            }
+            if (tInput.pPkt->stream_index != tInput.pInStm->index)
+            {
+                av_packet_unref(tInput.pPkt);
+                continue;
+            }
+            av_packet_rescale_ts(tInput.pPkt, tInput.pInStm->time_base, tInput.pOutStm->time_base);
+            if (tInput.pPkt->pts != AV_NOPTS_VALUE)
+                tInput.pPkt->pts += tInput.i64Offset;
+            if (tInput.pPkt->dts != AV_NOPTS_VALUE)
+                tInput.pPkt->dts += tInput.i64Offset;
+            tInput.pPkt->stream_index = tInput.pOutStm->index;
+            tInput.pPkt->pos = -1;
+            tInput.bPktReady = true;
+            return true;
+        }
+    };
+
+    bool bOk = OpenInput(tVidInput, mEncSegments[0]->path, AVMEDIA_TYPE_VIDEO) && CreateOutStream(tVidInput);
+    if (bOk && !tAudInput.bEof)
+        bOk = OpenInput(tAudInput, mEncAudioPath, AVMEDIA_TYPE_AUDIO) && CreateOutStream(tAudInput);
+    if (bOk)
+    {
+        if (!(pOutFmtCtx->oformat->flags&AVFMT_NOFILE))
+            fferr = avio_open(&pOutFmtCtx->pb, mEncOutputPath.c_str(), AVIO_FLAG_WRITE);
+        if (fferr >= 0)
+            fferr = avformat_write_header(pOutFmtCtx, nullptr);
+        if (fferr < 0)
+        {
+            oss << "FAILED to write the header of '" << mEncOutputPath << "'! fferr=" << fferr << ".";
+            bOk = false;
+        }
+        else
+            bHeaderWritten = true;
+    }
+    // write the packets of the 2 streams in dts order
+    while (bOk && (!tVidInput.bEof || !tAudInput.bEof))
+    {
+        if (!tVidInput.bEof && !tVidInput.bPktReady && !ReadPacket(tVidInput, true))
+            break;
+        if (!tAudInput.bEof && !tAudInput.bPktReady && !ReadPacket(tAudInput, false))
+            break;
+        ConcatInput* pInput = nullptr;
+        if (tVidInput.bPktReady && tAudInput.bPktReady)
+        {
+            const int64_t i64VidTs = tVidInput.pPkt->dts != AV_NOPTS_VALUE ? tVidInput.pPkt->dts : tVidInput.pPkt->pts;
+            const int64_t i64AudTs = tAudInput.pPkt->dts != AV_NOPTS_VALUE ? tAudInput.pPkt->dts : tAudInput.pPkt->pts;
+            pInput = av_compare_ts(i64VidTs, tVidInput.pOutStm->time_base, i64AudTs, tAudInput.pOutStm->time_base) <= 0 ? &tVidInput : &tAudInput;
+        }
+        else if (tVidInput.bPktReady)
+            pInput = &tVidInput;
+        else if (tAudInput.bPktReady)
+            pInput = &tAudInput;
+        else
+            continue;
+        pInput->bPktReady = false;
+        fferr = av_interleaved_write_frame(pOutFmtCtx, pInput->pPkt);
+        if (fferr < 0)
+        {
+            oss << "FAILED to write packet into '" << mEncOutputPath << "'! fferr=" << fferr << ".";
+            break;
+        }
+    }
+    if (tVidInput.pFmtCtx)
+        avformat_close_input(&tVidInput.pFmtCtx);
+    if (tAudInput.pFmtCtx)
+        avformat_close_input(&tAudInput.pFmtCtx);
+    av_packet_free(&tVidInput.pPkt);
+    av_packet_free(&tAudInput.pPkt);
+    if (bHeaderWritten)
+    {
+        fferr = av_write_trailer(pOutFmtCtx);
+        if (fferr < 0 && oss.str().empty())
+            oss << "FAILED to write the trailer of '" << mEncOutputPath << "'! fferr=" << fferr << ".";
+    }
+    if (pOutFmtCtx->pb)
+        avio_closep(&pOutFmtCtx->pb);
+    avformat_free_context(pOutFmtCtx);
+    if (!oss.str().empty())
+    {
+        errMsg = oss.str();
+        return false;
+    }
+    return true;
+}
+
+void TimeLine::RemoveEncodedSegments()
+{
+    for (auto& hSeg : mEncSegments)
+    {
+        if (SysUtils::IsFile(hSeg->path))
+            SysUtils::DeleteFileAt(hSeg->path);
+    }
+    if (!mEncAudioPath.empty() && SysUtils::IsFile(mEncAudioPath))
+        SysUtils::DeleteFileAt(mEncAudioPath);
+}
+
 void TimeLine::AddNewRecord(imgui_json::value& record)
 {
-    // truncate the history record list if needed
-    if (mRecordIter != mHistoryRecords.end())
-        mHistoryRecords.erase(mRecordIter, mHistoryRecords.end());
-    mHistoryRecords.push_back(std::move(record));
-    mRecordIter = mHistoryRecords.end();
+    // the redo records are discarded by the history store
+    if (!mhHistoryStore)
+        return;
+    if (!mhHistoryStore->AddRecord(record))
+        Logger::Log(Logger::WARN) << "FAILED to add history record! Error is '" << mhHistoryStore->GetError() << "'." << std::endl;
 }
 
 bool TimeLine::UndoOneRecord()
 {
-    if (mRecordIter == mHistoryRecords.begin())
+    imgui_json::value record;
+    if (!mhHistoryStore || !mhHistoryStore->Undo(record))
         return false;
-
-    mRecordIter--;
-    auto& record = *mRecordIter;
     auto& actions = record["actions"].get<imgui_json::array>();
     PrintActionList("UNDO record", actions);
     auto iter = actions.end();
@@ -9912,7 +11089,7 @@ bool TimeLine::UndoOneRecord()
         else if (actionName == "ADD_CLIP")
         {
             DeleteClip(action["clip_json"]["ID"].get<imgui_json::number>(), nullptr);
-            Update();
+            Update(true);
             imgui_json::value undoAction;
             undoAction["action"] = "REMOVE_CLIP";
             undoAction["media_type"] = action["media_type"];
@@ -9923,7 +11100,7 @@ bool TimeLine::UndoOneRecord()
         else if (actionName == "REMOVE_CLIP")
         {
             AddNewClip(action["clip_json"], action["from_track_id"].get<imgui_json::number>());
-            Update();
+            Update(true);
             imgui_json::value undoAction;
             undoAction["action"] = "ADD_CLIP";
             undoAction["media_type"] = action["media_type"];
@@ -9958,7 +11135,7 @@ bool TimeLine::UndoOneRecord()
             Clip* clip = FindClipByID(clipId);
             clip->ChangeStart(orgStart);
             MovingClip(clipId, toTrackIndex, fromTrackIndex);
-            Update();
+            Update(true);
 
             imgui_json::value undoAction;
             undoAction["action"] = "MOVE_CLIP";
@@ -10169,17 +11346,18 @@ bool TimeLine::UndoOneRecord()
             Logger::Log(Logger::WARN) << "Unhandled UNDO action '" << actionName << "'!" << std::endl;
         }
     }
+#ifdef TIMELINE_INDEX_CHECK
+    CheckIndexConsistency();
+#endif
     return true;
 }
 
 bool TimeLine::RedoOneRecord()
 {
-    if (mRecordIter == mHistoryRecords.end())
+    imgui_json::value record;
+    if (!mhHistoryStore || !mhHistoryStore->Redo(record))
         return false;
-
-    auto& record = *mRecordIter;
     auto& actions = record["actions"].get<imgui_json::array>();
-    mRecordIter++;
     ImU32 groupColor = 0;
     PrintActionList("REDO record", actions);
     for (auto& action : actions)
@@ -10217,14 +11395,14 @@ bool TimeLine::RedoOneRecord()
         else if (actionName == "ADD_CLIP")
         {
             AddNewClip(action["clip_json"], action["to_track_id"].get<imgui_json::number>());
-            Update();
+            Update(true);
             mUiActions.push_back(action);
         }
         else if (actionName == "REMOVE_CLIP")
         {
             int64_t clipId = action["clip_json"]["ID"].get<imgui_json::number>();
             DeleteClip(clipId, nullptr);
-            Update();
+            Update(true);
             mUiActions.push_back(action);
         }
         else if (actionName == "MOVE_CLIP")
@@ -10254,7 +11432,7 @@ bool TimeLine::RedoOneRecord()
             Clip* clip = FindClipByID(clipId);
             clip->ChangeStart(newStart);
             MovingClip(clipId, fromTrackIndex, toTrackIndex);
-            Update();
+            Update(true);
             mUiActions.push_back(action);
         }
         else if (actionName == "CROP_CLIP")
@@ -10413,6 +11591,9 @@ bool TimeLine::RedoOneRecord()
             Logger::Log(Logger::WARN) << "Unhandled REDO action '" << actionName << "'!" << std::endl;
         }
     }
+#ifdef TIMELINE_INDEX_CHECK
+    CheckIndexConsistency();
+#endif
     return true;
 }
 
@@ -10439,6 +11620,7 @@ int64_t TimeLine::AddNewClip(const imgui_json::value& jnClipJson, int64_t track_
         break;
     }
     m_Clips.push_back(pUiNewClip);
+    InvalidateIndex(INDEX_CLIP);
     track->InsertClip(pUiNewClip, pUiNewClip->Start(), true, pActionList);
 
     int64_t groupId = jnClipJson["GroupID"].get<imgui_json::number>();
@@ -10492,6 +11674,7 @@ int64_t TimeLine::AddNewClip(
     }
     // newClip->ChangeStart(start);
     m_Clips.push_back(newClip);
+    InvalidateIndex(INDEX_CLIP);
     track->InsertClip(newClip, start, true, pActionList);
     if (group_id != -1)
     {
@@ -10825,6 +12008,14 @@ bool DrawTimeLine(TimeLine *timeline, bool *expanded, bool& need_save, bool edit
                 ImGui::PopItemWidth();
                 ImGui::EndGroup(); ImGui::SameLine();
                 ImGui::Dummy({0, 0});
+                static bool m_vidstabParam_bSpoolDetectFrames = false;
+                ImGui::Checkbox("Spool Detect Frames##VidstabParamSpool", &m_vidstabParam_bSpoolDetectFrames);
+                ImGui::ShowTooltipOnHover("Keep a lossless copy of the frames decoded in the detect pass, so the transform pass doesn't decode the source again.\n"
+                        "It may take up to the raw size of the scaled frames in the task directory until the task is done, and it's skipped if that is not free.\n"
+                        "It pays off when the source is expensive to decode, e.g. a long-GOP high resolution source, compare the pass times in the task log.");
+                static bool m_vidstabParam_bParkWhenPaused = false;
+                ImGui::Checkbox("Park When Paused##VidstabParamPark", &m_vidstabParam_bParkWhenPaused);
+                ImGui::ShowTooltipOnHover("Release the decoder, filter graph and encoder while the transform pass is paused, they are rebuilt on resume.");
 
                 bCloseDlg = false;
                 MEC::BackgroundTask::Holder hTask;
@@ -10854,6 +12045,8 @@ bool DrawTimeLine(TimeLine *timeline, bool *expanded, bool& need_save, bool edit
                     jnTask["vidstab_arg_optzoom"] = imgui_json::number(m_vidstabParam_iAutoZoomMode);
                     jnTask["vidstab_arg_zoomspeed"] = imgui_json::number(m_vidstabParam_fAutoZoomSpeed);
                     jnTask["vidstab_arg_interp"] = imgui_json::number(m_vidstabParam_iInterpolationMode);
+                    jnTask["spool_detect_frames"] = m_vidstabParam_bSpoolDetectFrames;
+                    jnTask["park_when_paused"] = m_vidstabParam_bParkWhenPaused;
                     auto hSettings = timeline->mhMediaSettings->Clone();
                     hTask = MEC::BackgroundTask::CreateBackgroundTask(jnTask, hSettings, timeline->mTxMgr);
                     bCloseDlg = true;
@@ -12774,6 +13967,7 @@ bool DrawTimeLine(TimeLine *timeline, bool *expanded, bool& need_save, bool edit
                     pNewTextClip->mhDataLayerClip = hSubClip;
                     pNewTextClip->mTrack = newTrack;
                     timeline->m_Clips.push_back(pNewTextClip);
+                    timeline->InvalidateIndex(TimeLine::INDEX_CLIP);
                     newTrack->InsertClip(pNewTextClip, hSubClip->StartTime(), false);
                     hSubClip = newTrack->mMttReader->GetNextClip();
                 }
@@ -12829,6 +14023,7 @@ bool DrawTimeLine(TimeLine *timeline, bool *expanded, bool& need_save, bool edit
                 {
                     item->Initialize();
                     timeline->media_items.push_back(item);
+                    timeline->InvalidateIndex(TimeLine::INDEX_MEDIA_ITEM);
                     insert_item_into_timeline(item, track);
                 }
             }
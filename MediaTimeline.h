@@ -33,13 +33,19 @@
 #include "MecProject.h"
 #include "Event.h"
 #include "EventStackFilter.h"
+#include "MediaCache.h"
 #include "VideoTransformFilterUiCtrl.h"
 #include "MediaPlayer.h"
+#include "HistoryStore.h"
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include <string>
 #include <vector>
 #include <list>
 #include <unordered_set>
+#include <unordered_map>
 #include <chrono>
 
 #define PLOT_IMPLOT   0
@@ -411,13 +417,38 @@ struct MediaItem
     RenderUtils::TextureManager::Holder mTxMgr;
     std::vector<RenderUtils::ManagedTexture::Holder> mMediaThumbnail;
     std::vector<ImTextureID> mWaveformTextures;
+    std::string mThumbnailCacheKey;                 // key of the thumbnails in 'MEC::ThumbnailCache', empty if not cacheable
+    std::vector<ImGui::ImMat> mCachedThumbnails;    // thumbnails loaded from cache, waiting to be rendered into textures
+    bool mThumbnailCacheStored {false};
+    MEC::WaveformPyramid::Holder mWaveformPyramid;  // min/max pyramid of the overview waveform, loaded from cache or built after parsing
+    bool mWaveformPyramidCacheChecked {false};
+    std::string mContentId;                         // 'MEC::GetMediaContentId()' of the media file, empty if it's not a regular file
+    std::atomic_bool mOverviewDeferred {false};     // overview is not opened until the item is visible or used by a clip
+    std::mutex mOverviewLock;
+    enum ProxyState
+    {
+        PROXY_NONE = 0,
+        PROXY_GENERATING,
+        PROXY_READY,
+        PROXY_FAILED,
+    };
+    ProxyState mProxyState {PROXY_NONE};
+    std::string mProxyPath;                         // 'MEC::GetProxyMediaPath()' of the media, empty if no proxy can be cached
+    std::string mProxyError;
+    MediaCore::MediaParser::Holder mhProxyParser;   // parser of the low resolution proxy, only valid if 'mProxyState' is PROXY_READY
+    std::weak_ptr<MEC::BackgroundTask> mwpProxyTask;
     MediaItem(const std::string& name, const std::string& path, uint32_t type, void* handle);
     MediaItem(MediaCore::MediaParser::Holder hParser, void* handle);
     ~MediaItem();
-    bool Initialize();
+    bool Initialize(bool bDeferOverview = false);
+    bool EnsureOverview();
+    bool OpenOverview();
     bool ChangeSource(const std::string& name, const std::string& path);
     void ReleaseItem();
+    bool OpenProxy();
+    void ReleaseProxy();
     void UpdateThumbnail();
+    MEC::WaveformPyramid::Holder GetWaveformPyramid();
 
     imgui_json::value mMetaData;
 
@@ -637,6 +668,7 @@ private:
     bool UpdateClip(MediaItem* pMediaItem);
     void SyncStateToDataLayer() override;
     void SyncStateFromDataLayer() override;
+    imgui_json::value SaveTransformFilterJson() const;  // the crop is saved in the pixels of the original media, even if the data layer decodes the proxy
 
 private:
     float mSnapWidth                {0};
@@ -654,6 +686,7 @@ struct AudioClip : Clip
     MediaCore::Overview::Waveform::Holder mWaveform {nullptr};  // clip audio snapshot
     MediaCore::Overview::Holder mOverview;
     ImTextureID mWaveformTexture {nullptr}; // clip waveform texture
+    bool mWaveformTextureFromPyramid {false};   // clip waveform texture is drawn from the media item waveform pyramid
 
     static AudioClip* CreateInstance(TimeLine* pOwner, const std::string& strName, MediaItem* pMediaItem, int64_t i64Start, int64_t i64End, int64_t i64StartOffset = 0, int64_t i64EndOffset = 0);
     static AudioClip* CreateInstance(TimeLine* pOwner, MediaItem* pMediaItem, int64_t i64Start);
@@ -854,6 +887,7 @@ struct EditingVideoClip : BaseEditingClip
     BluePrint::BluePrintUI* mFilterBp {nullptr};
     ImGui::KeyPointEditor* mFilterKp {nullptr};
     ImGui::MaskCreator::Holder mhMaskCreator;
+    std::weak_ptr<MEC::Event> mwpMaskEvent;
     int64_t mMaskEventId {-1}, mMaskNodeId {-1};
     int mMaskIndex {-1};
     int64_t mMaskEventStart, mMaskEventEnd;
@@ -870,6 +904,7 @@ public:
     void DrawContent(ImDrawList* drawList, const ImVec2& leftTop, const ImVec2& rightBottom, bool updated = false) override;
     void SelectEditingMask(MEC::Event::Holder hEvent, int64_t nodeId, int maskIndex, ImGui::MaskCreator::Holder hMaskCreator = nullptr);
     void UnselectEditingMask();
+    void NotifyEditingMaskChanged();
     MEC::VideoTransformFilterUiCtrl* GetTransformFilterUiCtrl() { return mpTransFilterUiCtrl; }
     bool DrawAttributeCurves(const ImVec2& v2ViewSize, float fViewScaleX, float fViewOffsetX, bool* pCurveUpdated, ImDrawList* pDrawList);
     ImGui::ImNewCurve::Editor::Holder GetAttributeCurveEditor() const { return mhAttrCurveEditor; }
@@ -1050,6 +1085,204 @@ public:
     }
 };
 
+#define ENCODE_SEGMENT_MIN_SECONDS      10
+#define AUDIO_SCOPE_MAX_CHANNELS        8
+#define AUDIO_SCOPE_BLOCK_SAMPLES       256
+#define AUDIO_SCOPE_RING_CAPACITY       64
+// Planar float pcm taken from the audio output, for the audio scopes. 'trackId' is -1 for the master output.
+struct AudioScopePcmBlock
+{
+    int64_t trackId {-1};
+    int channels {0};
+    int samples {0};
+    float data[AUDIO_SCOPE_MAX_CHANNELS*AUDIO_SCOPE_BLOCK_SAMPLES];
+};
+
+// Lock-free single producer single consumer ring of preallocated pcm blocks. The audio render thread is the
+// producer and never waits, a block is dropped if the ring is full.
+class AudioScopePcmRing
+{
+public:
+    AudioScopePcmRing() : m_aBlocks(AUDIO_SCOPE_RING_CAPACITY) {}
+
+    // producer side
+    AudioScopePcmBlock* BeginWrite()
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if ((head+1)%m_aBlocks.size() == m_tail.load(std::memory_order_acquire))
+            return nullptr;
+        return &m_aBlocks[head];
+    }
+    void EndWrite()
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        m_head.store((head+1)%m_aBlocks.size(), std::memory_order_release);
+    }
+
+    // consumer side
+    const AudioScopePcmBlock* BeginRead()
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire))
+            return nullptr;
+        return &m_aBlocks[tail];
+    }
+    void EndRead()
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        m_tail.store((tail+1)%m_aBlocks.size(), std::memory_order_release);
+    }
+
+private:
+    std::vector<AudioScopePcmBlock> m_aBlocks;
+    std::atomic<size_t> m_head {0};
+    std::atomic<size_t> m_tail {0};
+};
+
+// Bounded frame queue connecting the export stages. 'Push()' blocks while the queue is full and 'Pop()' blocks while
+// it is empty, both return false once the queue is aborted. The producer calls 'Close()' at the end of its stream.
+class EncodeFrameQueue
+{
+public:
+    EncodeFrameQueue(size_t capacity) : m_capacity(capacity) {}
+
+    bool Push(const ImGui::ImMat& mat)
+    {
+        std::unique_lock<std::mutex> lk(m_mtx);
+        m_cvNotFull.wait(lk, [this] { return m_aborted || m_frames.size() < m_capacity; });
+        if (m_aborted)
+            return false;
+        m_frames.push_back(mat);
+        m_cvNotEmpty.notify_one();
+        return true;
+    }
+    // 'eof' is set to true if the queue is closed and all the frames have been popped
+    bool Pop(ImGui::ImMat& mat, bool& eof)
+    {
+        std::unique_lock<std::mutex> lk(m_mtx);
+        m_cvNotEmpty.wait(lk, [this] { return m_aborted || m_closed || !m_frames.empty(); });
+        if (m_aborted)
+            return false;
+        eof = m_frames.empty();
+        if (!eof)
+        {
+            mat = m_frames.front();
+            m_frames.pop_front();
+            m_cvNotFull.notify_one();
+        }
+        return true;
+    }
+    void Close()
+    {
+        std::lock_guard<std::mutex> lk(m_mtx);
+        m_closed = true;
+        m_cvNotEmpty.notify_all();
+    }
+    void Abort()
+    {
+        std::lock_guard<std::mutex> lk(m_mtx);
+        m_aborted = true;
+        m_cvNotFull.notify_all();
+        m_cvNotEmpty.notify_all();
+    }
+    void Reset()
+    {
+        std::lock_guard<std::mutex> lk(m_mtx);
+        m_frames.clear();
+        m_closed = m_aborted = false;
+    }
+    size_t Size()
+    {
+        std::lock_guard<std::mutex> lk(m_mtx);
+        return m_frames.size();
+    }
+
+private:
+    const size_t m_capacity;
+    std::list<ImGui::ImMat> m_frames;
+    std::mutex m_mtx;
+    std::condition_variable m_cvNotFull, m_cvNotEmpty;
+    bool m_closed {false};
+    bool m_aborted {false};
+};
+
+#define ENCODE_PREVIEW_MAX_HEIGHT       480
+#define ENCODE_PREVIEW_FPS              5
+// Latest downscaled export frame for the preview of the output window. The encoding threads publish at most
+// ENCODE_PREVIEW_FPS frames per second without waiting: a frame is written into the back slot, which is then exchanged
+// with the middle one. The UI takes the middle slot only if a new frame has been published there since its last read.
+// When several encoding threads are running, only one of them produces a preview frame at a time and the others skip it.
+class EncodePreviewBuffer
+{
+public:
+    // producer side, returns nullptr if it's not the time for a new frame or another thread is producing one
+    ImGui::ImMat* BeginWrite()
+    {
+        const int64_t nowUs = NowUs();
+        if (nowUs < m_nextTimeUs.load(std::memory_order_relaxed))
+            return nullptr;
+        if (m_writing.exchange(true, std::memory_order_acquire))
+            return nullptr;
+        if (nowUs < m_nextTimeUs.load(std::memory_order_relaxed))
+        {
+            m_writing.store(false, std::memory_order_release);
+            return nullptr;
+        }
+        m_nextTimeUs.store(nowUs+1000000/ENCODE_PREVIEW_FPS, std::memory_order_relaxed);
+        return &m_slots[m_back];
+    }
+    void EndWrite(bool publish = true)
+    {
+        if (publish)
+            m_back = m_middle.exchange(m_back|NEW_FRAME, std::memory_order_acq_rel)&SLOT_MASK;
+        m_writing.store(false, std::memory_order_release);
+    }
+
+    // consumer side, returns false if no new frame has been published since the last call
+    bool Read(ImGui::ImMat& mat)
+    {
+        if ((m_middle.load(std::memory_order_relaxed)&NEW_FRAME) == 0)
+            return false;
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel)&SLOT_MASK;
+        mat = m_slots[m_front];
+        return true;
+    }
+
+    // only when no producer is running
+    void Reset()
+    {
+        for (auto& slot : m_slots)
+            slot.release();
+        m_back = 0; m_middle = 1; m_front = 2;
+        m_nextTimeUs = 0;
+    }
+
+private:
+    static int64_t NowUs() { return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+
+    static constexpr int SLOT_MASK = 0x3;
+    static constexpr int NEW_FRAME = 0x4;
+    ImGui::ImMat m_slots[3];
+    int m_back {0};                             // owned by the producer holding 'm_writing'
+    std::atomic<int> m_middle {1};              // slot index, with NEW_FRAME set if it's not read yet
+    int m_front {2};                            // owned by the consumer
+    std::atomic<bool> m_writing {false};
+    std::atomic<int64_t> m_nextTimeUs {0};
+};
+
+// Throughput of one export stage. 'busyUs' is the time spent on its own work, 'stallUs' is the time spent waiting
+// for the neighbouring stages (queue full/empty, or the encoder not consuming).
+struct EncodeStageStats
+{
+    std::atomic<int64_t> frames {0};
+    std::atomic<int64_t> busyUs {0};
+    std::atomic<int64_t> stallUs {0};
+
+    void Reset() { frames = 0; busyUs = 0; stallUs = 0; }
+    double Fps() const { const int64_t t = busyUs+stallUs; return t > 0 ? (double)frames*1e6/t : 0; }
+    float StallRatio() const { const int64_t t = busyUs+stallUs; return t > 0 ? (float)stallUs/t : 0; }
+};
+
 struct audio_channel_data
 {
     ImGui::ImMat m_wave;
@@ -1155,6 +1388,18 @@ struct MediaTrack
     float mPixPerMs         {0};
     MediaCore::SubtitleTrackHolder mMttReader {nullptr};
     bool mTextTrackScaleLink {true};
+
+    // overlap index keyed by the sorted clip id pair, for 'FindExistOverlap()'. Code which adds/removes overlaps of 'm_Overlaps'
+    // or changes their clip pair must set 'mOverlapIndexDirty', so the index is rebuilt by the next lookup
+    struct ClipIdPairHash
+    {
+        size_t operator()(const std::pair<int64_t, int64_t>& p) const
+        { return std::hash<int64_t>()(p.first) ^ (std::hash<int64_t>()(p.second) * 0x9e3779b97f4a7c15ULL); }
+    };
+    std::unordered_map<std::pair<int64_t, int64_t>, Overlap *, ClipIdPairHash> mOverlapIndex;
+    bool mOverlapIndexDirty {true};
+    std::unordered_map<int64_t, std::pair<int64_t, int64_t>> mClipRangeCache;  // clip ranges at the last 'Update()', to find the changed clips
+
     MediaTrack(std::string name, uint32_t type, void * handle);
     ~MediaTrack();
 
@@ -1171,11 +1416,13 @@ struct MediaTrack
     void CreateOverlap(int64_t start, int64_t start_clip_id, int64_t end, int64_t end_clip_id, uint32_t type);
     Overlap * FindExistOverlap(int64_t start_clip_id, int64_t end_clip_id);
     
-    void CalculateAudioScopeData(ImGui::ImMat& mat_in);
+    void CalculateAudioScopeData(const AudioScopePcmBlock& block);
     float GetAudioLevel(int channel);
     void SetAudioLevel(int channel, float level);
 
-    void Update();                                  // update track clip include clip order and overlap area
+    // update track clip include clip order and overlap area. Only the overlaps around the clips which are added, removed or changed
+    // range since last update are re-evaluated, unless 'fullUpdate' is true
+    void Update(bool fullUpdate = false);
     static MediaTrack* Load(const imgui_json::value& value, void * handle);
     void Save(imgui_json::value& value);
 
@@ -1223,8 +1470,10 @@ typedef struct TimeLineCallbackFunctions
 struct TimeLine
 {
 #define MAX_VIDEO_CACHE_FRAMES  3
-    TimeLine();
+    // a headless timeline has no audio render device and no audio scopes, it's only used for export (see 'MecRender.cpp')
+    TimeLine(bool bHeadless = false);
     ~TimeLine();
+    const bool mIsHeadless;
     IDGenerator m_IDGenerator;              // Timeline ID generator
     std::vector<MediaItem *> media_items;   // Media Bank, project saved
     std::vector<MediaTrack *> m_Tracks;     // timeline tracks, project saved
@@ -1238,6 +1487,7 @@ struct TimeLine
 
     bool mShowHelpTooltips      {true};     // timeline show help tooltips, project saved, configured
     bool mHardwareCodec         {true};     // timeline Video/Audio decode/encode try to enable HW if available;
+    bool mUseProxyMedia         {true};     // timeline preview decodes the proxy media if it's ready, export always uses the originals
     float mPreviewScale {0.5};              // timeline preview video size scale, usually < 1.0, default is 0.5
     int mMaxCachedVideoFrame {MAX_VIDEO_CACHE_FRAMES};  // timeline Media Video Frame cache size, project saved, configured
     float mSnapShotWidth        {60.0};
@@ -1264,6 +1514,13 @@ struct TimeLine
     bool UpdateMediaItemMetaData(const std::string& fileUrl, const std::string& metaName, const imgui_json::value& metaValue);
     const imgui_json::value& CheckMediaItemMetaData(const std::string& fileUrl, const std::string& metaName);
 
+    // proxy media handling
+    MediaCore::MediaParser::Holder GetPreviewParser(Clip* pClip);   // parser used by the preview data layer of the clip, the proxy if it's ready
+    int SwitchClipSources(MediaCore::MultiTrackVideoReader::Holder hMtvReader, bool bUseProxy); // returns the number of the switched clips
+    void SetUseProxyMedia(bool bUseProxy);
+    void UpdateMediaProxies();                                      // pick up the proxy tasks' results, called on UI thread every frame
+    size_t mProxyTaskListSize {0};
+
     // sutitle Setting
     std::string mFontName;
     // Output Setting
@@ -1306,8 +1563,41 @@ struct TimeLine
     void StartEncoding();
     void StopEncoding();
     void _EncodeProc();
+    void _EncodeVideoRenderProc();
+    void _EncodeAudioRenderProc();
     // encoding 
     std::thread mEncodingThread;
+    // the export runs as a video render stage and an audio render stage, feeding the encode/mux stage in '_EncodeProc()'
+    enum { ENCODE_STAGE_VIDEO = 0, ENCODE_STAGE_AUDIO, ENCODE_STAGE_MUX, ENCODE_STAGE_COUNT };
+    EncodeStageStats mEncodeStageStats[ENCODE_STAGE_COUNT];
+    EncodeFrameQueue mEncVideoQueue {8};
+    EncodeFrameQueue mEncAudioQueue {32};
+    std::string mEncVideoErrMsg;
+    std::string mEncAudioErrMsg;
+    int64_t mEncStartTimeOffset {0};
+    // segment-parallel export: the video is split into 'mEncodingSegments' segments at frame boundaries, each one rendered
+    // by its own cloned reader and encoded by its own encoder, while 'mEncoder' encodes the audio into a separate file.
+    // The results are remuxed into the output file without re-encoding.
+    struct EncodeSegment
+    {
+        int64_t firstFrameIndex {0};
+        int64_t frameCount {0};
+        std::string path;
+        MediaCore::MultiTrackVideoReader::Holder hReader;
+        MediaCore::MediaEncoder::Holder hEncoder;
+        std::atomic<int64_t> encodedFrames {0};
+        std::string errMsg;
+    };
+    int mEncodingSegments {1};
+    MediaCore::Ratio mEncFrameRate;
+    std::string mEncOutputPath;
+    std::string mEncAudioPath;
+    std::vector<std::shared_ptr<EncodeSegment>> mEncSegments;
+    bool ConfigSegmentEncoders(const std::string& outputPath, VideoEncoderParams& vidEncParams, AudioEncoderParams& audEncParams, std::string& errMsg);
+    void _SegmentEncodeProc();
+    void _EncodeSegmentProc(EncodeSegment* pSeg);
+    bool ConcatEncodedSegments(std::string& errMsg);
+    void RemoveEncodedSegments();
     bool mIsEncoding {false};
     bool mQuitEncoding {false};
     bool mEncodingInRange {false};
@@ -1316,12 +1606,20 @@ struct TimeLine
     std::string mEncodeProcErrMsg;
     float mEncodingProgress {0};
     float mEncodingDuration {0};
-    std::mutex mEncodingMutex;
-    ImGui::ImMat mEncodingVFrame;
     ImGui::ImMat mEncodingAFrame;
-    ImTextureID mEncodingPreviewTexture {nullptr};  // encoding preview texture
-
-    void CalculateAudioScopeData(ImGui::ImMat& mat);
+    EncodePreviewBuffer mEncodingPreview;           // downscaled frames published by the encoding threads
+    ImTextureID mEncodingPreviewTexture {nullptr};  // encoding preview texture, only updated with a new preview frame
+    void UpdateEncodingPreview(const ImGui::ImMat& vmat);
+
+    // the audio scopes are calculated on a worker thread, with the pcm blocks queued by 'SimplePcmStream::Read()'
+    void CalculateAudioScopeData(const AudioScopePcmBlock& block);
+    void PushAudioScopePcm(int64_t trackId, const ImGui::ImMat& amat);
+    void DiscardAudioScopePcm() { mAudioScopeDiscard = true; }
+    void _AudioScopeProc();
+    AudioScopePcmRing mAudioScopeRing;
+    std::thread mAudioScopeThread;
+    std::atomic_bool mQuitAudioScope {false};
+    std::atomic_bool mAudioScopeDiscard {false};
 
     int64_t attract_docking_pixels {20};    // clip attract docking sucking in pixels range
     int disattract_docking_rate {5};        // pulling range is 1/5
@@ -1415,6 +1713,12 @@ struct TimeLine
     
     // BP CallBacks
     bool mIsBluePrintChanged {false};
+    void MarkBluePrintChanged()
+    {
+        mIsBluePrintChanged = true;
+        if (mhProject)
+            mhProject->MarkDirty(MEC::Project::SECTION_TIMELINE);
+    }
     static int OnBluePrintChange(int type, std::string name, void* handle);
     // This callback can only be assigned to a EventStackFilter, since it will interpret the 'handle' as a 'MEC::EventStackFilterContext' pointer
     static int OnVideoEventStackFilterBpChanged(int type, std::string name, void* handle);
@@ -1437,7 +1741,7 @@ struct TimeLine
     void SetStart(int64_t pos) { mStart = pos; }
     void SetEnd(int64_t pos) { mEnd = pos; }
     size_t GetCustomHeight(int index) { return (index < m_Tracks.size() && m_Tracks[index]->mExpanded) ? m_Tracks[index]->mTrackHeight : 0; }
-    void Update();
+    void Update(bool fullUpdate = false);   // 'fullUpdate' re-evaluates all the overlaps, used after the tracks are restored by undo/redo
     void UpdateRange();
     int64_t AlignTime(int64_t time, int mode = 0);  // mode: 0=floor, 1=round, 2=ceil
     int64_t AlignTimeToPrevFrame(int64_t time);
@@ -1496,7 +1800,7 @@ struct TimeLine
     void SortMediaItemByName();
     void SortMediaItemByType();
     void FilterMediaItemByType(uint32_t mediaType);     // Media Bank, filter
-    MEC::MediaPlayer * mMediaPlayer;                    // Media Player
+    MEC::MediaPlayer * mMediaPlayer {nullptr};         // Media Player, null on a headless timeline
     // Add By Jimmy: End
 
     MediaItem* mOpenCtxMenuMediaItem {nullptr};         // save the pointer to the MediaItem which its context menu is opened
@@ -1508,6 +1812,29 @@ struct TimeLine
     int FindTrackIndexByClipID(int64_t id);             // Find track by clip ID
     Clip * FindClipByID(int64_t id);                    // Find clip with clip ID
     Overlap * FindOverlapByID(int64_t id);              // Find overlap with overlap ID
+
+    // ID -> object hash indices used by the find functions above. They are rebuilt lazily by the next lookup after being invalidated,
+    // so any code adding/removing elements of 'media_items', 'm_Tracks', 'm_Clips', 'm_Overlaps' or 'MediaTrack::m_Clips' must call
+    // 'InvalidateIndex()' with the matching flags. Define 'TIMELINE_INDEX_CHECK' to cross-check every lookup with a linear search.
+    enum IndexFlags : uint32_t
+    {
+        INDEX_MEDIA_ITEM    = 0x1,
+        INDEX_TRACK         = 0x2,
+        INDEX_CLIP          = 0x4,
+        INDEX_OVERLAP       = 0x8,
+        INDEX_CLIP_TRACK    = 0x10,
+        INDEX_ALL           = 0x1F,
+    };
+    void InvalidateIndex(uint32_t flags = INDEX_ALL) { mIndexDirtyFlags.fetch_or(flags); }
+    bool CheckIndexConsistency();                       // Compare all the indices with the arrays, return false and log the errors if mismatched
+    std::mutex mIndexLock;
+    std::atomic<uint32_t> mIndexDirtyFlags {INDEX_ALL};
+    std::unordered_map<int64_t, MediaItem *> mMediaItemIndex;
+    std::unordered_map<int64_t, MediaTrack *> mTrackIndex;
+    std::unordered_map<int64_t, Clip *> mClipIndex;
+    std::unordered_map<int64_t, Overlap *> mOverlapIndex;
+    std::unordered_map<int64_t, MediaTrack *> mClipTrackIndex;
+    void UpdateIndex();                                 // Rebuild the invalidated indices, called with 'mIndexLock' locked
     Overlap * FindEditingOverlap();                     // Find overlap which is editing
     int GetSelectedClipCount();                         // Get current selected clip count
     int64_t NextClipStart(Clip * clip);                 // Get next clip start pos by clip, if don't have next clip, then return -1
@@ -1519,6 +1846,11 @@ struct TimeLine
     ImU32 GetGroupColor(int64_t group_id);              // Get Group color by id
     int Load(const imgui_json::value& value);
     void Save(imgui_json::value& value);
+    // 'Save()' in pieces, used by the project save worker to serialize the timeline in slices. 'SyncEditingItems()' must be
+    // called on the UI thread before, the others only need the content lock of 'MEC::Project'.
+    void SyncEditingItems();
+    size_t SaveClips(imgui_json::array& aClips, size_t szStart, int64_t i64DeadlineUs);   // returns the index of the next clip
+    void SaveExceptClips(imgui_json::value& value);
 
     void ConfigureDataLayer();
     void SyncDataLayer(bool forceRefresh = false);
@@ -1529,8 +1861,7 @@ struct TimeLine
     void UpdateVideoSettings(MediaCore::SharedSettings::Holder hSettings, float previewScale);
     void UpdateAudioSettings(MediaCore::SharedSettings::Holder hSettings, MediaCore::AudioRender::PcmFormat pcmFormat);
 
-    std::list<imgui_json::value> mHistoryRecords;
-    std::list<imgui_json::value>::iterator mRecordIter;
+    MEC::HistoryStore::Holder mhHistoryStore;          // undo history, bounded by 'SetMemoryBudget()', the older records are spilled into the cache dir
     void AddNewRecord(imgui_json::value& record);
     bool UndoOneRecord();
     bool RedoOneRecord();
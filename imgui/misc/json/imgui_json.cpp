@@ -362,6 +362,9 @@ void value::dump(dump_context_t& context, int level) const
     }
 }
 
+// Single pass parser, it never backtracks so the input can be streamed from a file in chunks. Number and string tokens
+// are scanned in place, the object members are inserted with a hint at the end (dumped objects have sorted keys) and
+// the array elements are collected on a shared stack to allocate each array once with the exact size.
 struct value::parser
 {
     parser(const char* begin, const char* end)
@@ -370,6 +373,16 @@ struct value::parser
     {
     }
 
+# if JSON_IO
+    parser(FILE* file)
+        : m_Cursor(nullptr)
+        , m_End(nullptr)
+        , m_File(file)
+    {
+        m_Buffer.reset(new char[c_ChunkSize]);
+    }
+# endif
+
     value parse()
     {
         value v;
@@ -378,8 +391,15 @@ struct value::parser
         auto previous_locale = std::setlocale(LC_NUMERIC, "C");
 
         // Accept single value only when end of the stream is reached.
-        if (!accept_element(v) || !eof())
+        skip_ws();
+        if (!parse_value(v))
             v = value(type_t::discarded);
+        else
+        {
+            skip_ws();
+            if (peek() != -1)
+                v = value(type_t::discarded);
+        }
 
         if (previous_locale && strcmp(previous_locale, "C") != 0)
             std::setlocale(LC_NUMERIC, previous_locale);
@@ -387,555 +407,355 @@ struct value::parser
         return v;
     }
 
+# if JSON_IO
+    bool read_failed() const { return m_ReadFailed || m_BytesRead == 0; }
+# endif
+
 private:
-    struct cursor_state
+    bool parse_value(value& result)
     {
-        cursor_state(parser* p)
-            : m_Owner(p)
-            , m_LastCursor(p->m_Cursor)
-        {
-        }
-
-        void reset()
+        switch (peek())
         {
-            m_Owner->m_Cursor = m_LastCursor;
-        }
-
-        bool operator()(bool accept)
-        {
-            if (!accept)
-                reset();
-            else
-                m_LastCursor = m_Owner->m_Cursor;
-            return accept;
+            case '{': return parse_object(result);
+            case '[': return parse_array(result);
+            case '\"':
+                result = string();
+                return parse_string(*string_ptr(result.m_Storage));
+            case '-': case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9':
+            {
+                number n;
+                if (!parse_number(n))
+                    return false;
+                result = n;
+                return true;
+            }
+            case 't': if (!accept("true"))  return false; result = true;    return true;
+            case 'f': if (!accept("false")) return false; result = false;   return true;
+            case 'n': if (!accept("null"))  return false; result = nullptr; return true;
+            case 'p': if (!accept("point")) return false; result = nullptr; return true;
+            case '(': return parse_vec(result);
+            default: return false;
         }
-
-    private:
-        parser*     m_Owner;
-        const char* m_LastCursor;
-    };
-
-    cursor_state state()
-    {
-        return cursor_state(this);
     }
 
-    bool accept_value(value& result)
+    bool parse_object(value& result)
     {
-        return accept_object(result)
-            || accept_array(result)
-            || accept_string(result)
-            || accept_number(result)
-            || accept_boolean(result)
-            || accept_point(result)
-            || accept_vec2(result)
-            || accept_vec4(result)
-            || accept_null(result);
-    }
-
-    bool accept_object(value& result)
-    {
-        auto s = state();
-
-        object o;
-        if (s(accept('{') && accept_ws() && accept('}')))
-        {
-            result = o;
-            return true;
-        }
-        else if (s(accept('{') && accept_members(o) && accept('}')))
-        {
-            result = std::move(o);
+        advance();
+        result = object();
+        auto& o = *object_ptr(result.m_Storage);
+        skip_ws();
+        if (accept('}'))
             return true;
-        }
-
-        return false;
-    }
-
-    bool accept_members(object& o)
-    {
-        if (!accept_member(o))
-            return false;
 
+        string key;
         while (true)
         {
-            auto s = state();
-            if (!s(accept(',') && accept_member(o)))
-                break;
+            if (peek() != '\"')
+                return false;
+            key.clear();
+            if (!parse_string(key))
+                return false;
+            skip_ws();
+            if (!accept(':'))
+                return false;
+            skip_ws();
+            const auto size = o.size();
+            auto it = o.emplace_hint(o.end(), std::move(key), value());
+            if (o.size() != size)
+            {
+                if (!parse_value(it->second))
+                    return false;
+            }
+            else
+            {
+                // the first member wins for duplicated keys
+                value duplicated;
+                if (!parse_value(duplicated))
+                    return false;
+            }
+            skip_ws();
+            if (accept(','))
+            {
+                skip_ws();
+                continue;
+            }
+            return accept('}');
         }
-
-        return true;
     }
 
-    bool accept_member(object& o)
+    bool parse_array(value& result)
     {
-        auto s = state();
-
-        value key;
-        value v;
-        if (s(accept_ws() && accept_string(key) && accept_ws() && accept(':') && accept_element(v)))
+        advance();
+        skip_ws();
+        if (accept(']'))
         {
-            o.emplace(std::move(key.get<string>()), std::move(v));
+            result = array();
             return true;
         }
 
-        return false;
-    }
-
-    bool accept_array(value& result)
-    {
-        auto s = state();
-
-        if (s(accept('[') && accept_ws() && accept(']')))
+        const auto base = m_Stack.size();
+        bool succeeded = false;
+        while (true)
         {
-            result = array();
-            return true;
+            value v;
+            if (!parse_value(v))
+                break;
+            m_Stack.emplace_back(std::move(v));
+            skip_ws();
+            if (accept(','))
+            {
+                skip_ws();
+                continue;
+            }
+            succeeded = accept(']');
+            break;
         }
-
-        array a;
-        if (s(accept('[') && accept_elements(a) && accept(']')))
+        if (succeeded)
         {
+            array a;
+            a.reserve(m_Stack.size() - base);
+            for (auto i = base; i < m_Stack.size(); ++i)
+                a.emplace_back(std::move(m_Stack[i]));
             result = std::move(a);
-            return true;
         }
-
-        return false;
+        m_Stack.resize(base);
+        return succeeded;
     }
 
-    bool accept_elements(array& a)
+    bool parse_string(string& result)
     {
-        value v;
-        if (!accept_element(v))
-            return false;
-
-        a.emplace_back(std::move(v));
+        advance();
         while (true)
         {
-            auto s = state();
-            v = nullptr;
-            if (!s(accept(',') && accept_element(v)))
-                break;
-            a.emplace_back(std::move(v));
-        }
-
-        return true;
-    }
-
-    bool accept_elements(vec2& a)
-    {
-        value v = nullptr;
-        auto s = state();
-        if (s(accept_number(v) && accept(',')))
-            a.x = v.get<number>();
-        else
-            return false;
-        s = state();
-        if (s(accept(' ') && accept_number(v)))
-            a.y = v.get<number>();
-        else
-            return false;
-
-        return true;
-    }
-
-    bool accept_elements(vec4& a)
-    {
-        value v = nullptr;
-        auto s = state();
-        if (s(accept_number(v) && accept(',')))
-            a.x = v.get<number>();
-        else
-            return false;
-        s = state();
-        if (s(accept(' ') && accept_number(v) && accept(',')))
-            a.y = v.get<number>();
-        else
-            return false;
-
-        s = state();
-        if (s(accept(' ') && accept_number(v) && accept(',')))
-            a.z = v.get<number>();
-        else
-            return false;
-        
-        s = state();
-        if (s(accept(' ') && accept_number(v)))
-            a.w = v.get<number>();
-        else
-            return false;
-
-        return true;
-    }
+            if (m_Cursor == m_End && !fill())
+                return false;
 
-    bool accept_element(value& result)
-    {
-        auto s = state();
-        return s(accept_ws() && accept_value(result) && accept_ws());
-    }
+            // copy the run of plain characters at once
+            auto run_end = m_Cursor;
+            while (run_end != m_End && *run_end != '\"' && *run_end != '\\')
+                ++run_end;
+            result.append(m_Cursor, run_end);
+            m_Cursor = run_end;
+            if (m_Cursor == m_End)
+                continue;
 
-    bool accept_string(value& result)
-    {
-        auto s = state();
+            if (*m_Cursor++ == '\"')
+                return true;
 
-        string v;
-        if (s(accept('\"') && accept_characters(v) && accept('\"')))
-        {
-            result = std::move(v);
-            return true;
+            int c = peek();
+            advance();
+            switch (c)
+            {
+                case '\"': result.push_back('\"'); break;
+                case '\\': result.push_back('\\'); break;
+                case '/':  result.push_back('/');  break;
+                case 'b':  result.push_back('\b'); break;
+                case 'f':  result.push_back('\f'); break;
+                case 'n':  result.push_back('\n'); break;
+                case 'r':  result.push_back('\r'); break;
+                case 't':  result.push_back('\t'); break;
+                case 'u':
+                {
+                    int v = 0;
+                    for (int i = 0; i < 4; ++i)
+                    {
+                        c = peek();
+                        if      (c >= '0' && c <= '9') v = v * 16 + (c - '0');
+                        else if (c >= 'A' && c <= 'F') v = v * 16 + (c - 'A' + 10);
+                        else if (c >= 'a' && c <= 'f') v = v * 16 + (c - 'a' + 10);
+                        else return false;
+                        advance();
+                    }
+                    // TODO::Dicky json accept_characters for UTF-8
+                    result.push_back(static_cast<char>(v));
+                    break;
+                }
+                default: return false;
+            }
         }
-        else
-            return false;
     }
 
-    bool accept_characters(string& result)
+    bool accept_digits(int& count)
     {
+        count = 0;
         int c;
-        while (accept_character(c))
+        while ((c = peek()) >= '0' && c <= '9')
         {
-            //JSON_ASSERT(c < 128);
-            // disable check character is ascii in case we using UTF-8
-            // this will cause problem when UTF-8 character contain '"'
-            // TODO::Dicky json accept_characters for UTF-8
-            result.push_back(static_cast<char>(c));
+            m_Number.push_back(static_cast<char>(c));
+            advance();
+            ++count;
         }
-
-        return true;
+        return count > 0;
     }
 
-    bool accept_character(int& c)
+    bool parse_number(number& result)
     {
-        auto s = state();
+        m_Number.clear();
+        bool negative = false;
+        if (accept('-'))
+        {
+            m_Number.push_back('-');
+            negative = true;
+        }
 
-        if (accept('\\'))
+        int int_digits = 0;
+        if (accept('0'))
         {
-            return accept_escape(c);
+            m_Number.push_back('0');
+            int_digits = 1;
         }
-        else if (expect('\"'))
+        else if (!accept_digits(int_digits))
             return false;
 
-        // Handle UTF-8 sequences. only eof will return -1.
-        return s((c = peek()) != -1) && advance();
-    }
-
-    bool accept_escape(int& c)
-    {
-        if (accept('\"')) { c = '\"'; return true; }
-        if (accept('\\')) { c = '\\'; return true; }
-        if (accept('/'))  { c = '/';  return true; }
-        if (accept('b'))  { c = '\b'; return true; }
-        if (accept('f'))  { c = '\f'; return true; }
-        if (accept('n'))  { c = '\n'; return true; }
-        if (accept('r'))  { c = '\r'; return true; }
-        if (accept('t'))  { c = '\t'; return true; }
-
-        auto s = state();
-
-        string hex;
-        hex.reserve(4);
-        if (s(accept('u') && accept_hex(hex) && accept_hex(hex) && accept_hex(hex) && accept_hex(hex)))
+        bool is_integer = true;
+        int digits = 0;
+        if (accept('.'))
         {
-            char* end = nullptr;
-            auto v = std::strtol(hex.c_str(), &end, 16);
-            if (end != hex.c_str() + hex.size())
+            m_Number.push_back('.');
+            if (!accept_digits(digits))
                 return false;
-
-            c = v;
-            return true;
+            is_integer = false;
         }
-
-        return false;
-    }
-
-    bool accept_hex(string& result)
-    {
-        if (accept_digit(result))
-            return true;
-
         auto c = peek();
-        if ((c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f'))
+        if (c == 'e' || c == 'E')
         {
+            m_Number.push_back(static_cast<char>(c));
             advance();
-            result.push_back(static_cast<char>(c));
-            return true;
-        }
-
-        return false;
-    }
-
-    bool accept_number(value& result)
-    {
-        auto s = state();
-
-        string n;
-        if (s(accept_int(n) && accept_frac(n) && accept_exp(n)))
-        {
-            char* end = nullptr;
-            auto v = std::strtod(n.c_str(), &end);
-            if (end != n.c_str() + n.size())
-                return false;
-
-            if (v != 0 && !std::isnormal(v))
+            c = peek();
+            if (c == '+' || c == '-')
+            {
+                m_Number.push_back(static_cast<char>(c));
+                advance();
+            }
+            if (!accept_digits(digits))
                 return false;
-
-            result = v;
-            return true;
-        }
-
-        return false;
-    }
-
-    bool accept_int(string& result)
-    {
-        auto s = state();
-
-        string part;
-        if (s(accept_onenine(part) && accept_digits(part)))
-        {
-            result += std::move(part);
-            return true;
+            is_integer = false;
         }
 
-        part.resize(0);
-        if (accept_digit(part))
+        // integers which fit in the mantissa are converted exactly without strtod
+        if (is_integer && int_digits <= 15)
         {
-            result += std::move(part);
+            int64_t v = 0;
+            for (auto ch : m_Number)
+                if (ch != '-')
+                    v = v * 10 + (ch - '0');
+            result = negative ? -static_cast<number>(v) : static_cast<number>(v);
             return true;
         }
 
-        part.resize(0);
-        if (s(accept('-') && accept_onenine(part) && accept_digits(part)))
-        {
-            result += '-';
-            result += std::move(part);
-            return true;
-        }
-
-        part.resize(0);
-        if (s(accept('-') && accept_digit(part)))
-        {
-            result += '-';
-            result += std::move(part);
-            return true;
-        }
-
-        return false;
-    }
-
-    bool accept_digits(string& result)
-    {
-        string part;
-        if (!accept_digit(part))
+        char* end = nullptr;
+        auto v = std::strtod(m_Number.c_str(), &end);
+        if (end != m_Number.c_str() + m_Number.size())
             return false;
 
-        while (accept_digit(part))
-            ;
-
-        result += std::move(part);
-
-        return true;
-    }
-
-    bool accept_digit(string& result)
-    {
-        if (accept('0'))
-        {
-            result.push_back('0');
-            return true;
-        }
-        else if (accept_onenine(result))
-            return true;
-
-        return false;
-    }
-
-    bool accept_onenine(string& result)
-    {
-        auto c = peek();
-        if (c >= '1' && c <= '9')
-        {
-            result.push_back(static_cast<char>(c));
-            return advance();
-        }
-
-        return false;
-    }
-
-    bool accept_frac(string& result)
-    {
-        auto s = state();
-
-        string part;
-        if (s(accept('.') && accept_digits(part)))
-        {
-            result += '.';
-            result += std::move(part);
-        }
+        if (v != 0 && !std::isnormal(v))
+            return false;
 
+        result = v;
         return true;
     }
 
-    bool accept_exp(string& result)
+    // "(x, y)" for vec2 and "(x, y, z, w)" for vec4
+    bool parse_vec(value& result)
     {
-        auto s = state();
-
-        string part;
-        if (s(accept('e') && accept_sign(part) && accept_digits(part)))
-        {
-            result += 'e';
-            result += std::move(part);
-            return true;
-        }
-        part.resize(0);
-        if (s(accept('E') && accept_sign(part) && accept_digits(part)))
+        advance();
+        number v[4];
+        int count = 0;
+        while (true)
         {
-            result += 'E';
-            result += std::move(part);
+            if (!parse_number(v[count++]))
+                return false;
+            if (accept(')'))
+                break;
+            if (count == 4 || !accept(',') || !accept(' '))
+                return false;
         }
-
-        return true;
-    }
-
-    bool accept_sign(string& result)
-    {
-        if (accept('+'))
-            result.push_back('+');
-        else if (accept('-'))
-            result.push_back('-');
-
-        return true;
-    }
-
-    bool accept_ws()
-    {
-        while (expect('\x09') || expect('\x0A') || expect('\x0D') || expect('\x20'))
-            advance();
+        if (count == 2)
+            result = vec2(static_cast<float>(v[0]), static_cast<float>(v[1]));
+        else if (count == 4)
+            result = vec4(static_cast<float>(v[0]), static_cast<float>(v[1]), static_cast<float>(v[2]), static_cast<float>(v[3]));
+        else
+            return false;
         return true;
     }
 
-    bool accept_boolean(value& result)
-    {
-        if (accept("true"))
-        {
-            result = true;
-            return true;
-        }
-        else if (accept("false"))
-        {
-            result = false;
-            return true;
-        }
-
-        return false;
-    }
-
-    bool accept_point(value& result)
-    {
-        if (accept("point"))
-        {
-            result = nullptr;
-            return true;
-        }
-
-        return false;
-    }
-
-    bool accept_vec2(value& result)
-    {
-        auto s = state();
-        vec2 v;
-        if (s(accept('(') && accept_elements(v) && accept(')')))
-        {
-            result = v;
-            return true;
-        }
-
-        return false;
-    }
-
-    bool accept_vec4(value& result)
-    {
-        auto s = state();
-        vec4 v;
-        if (s(accept('(') && accept_elements(v) && accept(')')))
-        {
-            result = v;
-            return true;
-        }
-
-        return false;
-    }
-
-    bool accept_null(value& result)
+    void skip_ws()
     {
-        if (accept("null"))
+        while (true)
         {
-            result = nullptr;
-            return true;
+            while (m_Cursor != m_End && (*m_Cursor == '\x20' || *m_Cursor == '\x0A' || *m_Cursor == '\x0D' || *m_Cursor == '\x09'))
+                ++m_Cursor;
+            if (m_Cursor != m_End || !fill())
+                return;
         }
-
-        return false;
     }
 
     bool accept(char c)
     {
-        if (expect(c))
-            return advance();
-        else
+        if (peek() != static_cast<unsigned char>(c))
             return false;
+        ++m_Cursor;
+        return true;
     }
 
     bool accept(const char* str)
     {
-        auto last = m_Cursor;
-
         while (*str)
         {
-            if (eof() || *str != *m_Cursor)
-            {
-                m_Cursor = last;
+            if (!accept(*str))
                 return false;
-            }
-
-            advance();
             ++str;
         }
 
         return true;
     }
 
-    int peek() const
+    int peek()
     {
-        if (!eof())
-            return *m_Cursor;
-        else
+        if (m_Cursor == m_End && !fill())
             return -1;
+        return static_cast<unsigned char>(*m_Cursor);
     }
 
-    bool expect(char c)
+    void advance()
     {
-        return peek() == c;
+        if (m_Cursor != m_End)
+            ++m_Cursor;
     }
 
-    bool advance(int count = 1)
+    // Read the next chunk of the file, returns false at the end of the stream
+    bool fill()
     {
-        if (m_Cursor + count > m_End)
+# if JSON_IO
+        if (!m_File)
+            return false;
+        const auto size = fread(m_Buffer.get(), 1, c_ChunkSize, m_File);
+        if (size == 0)
         {
-            m_Cursor = m_End;
+            m_ReadFailed = m_ReadFailed || ferror(m_File) != 0;
+            m_File = nullptr;
             return false;
         }
-
-        m_Cursor += count;
-
+        m_BytesRead += size;
+        m_Cursor = m_Buffer.get();
+        m_End = m_Cursor + size;
         return true;
-    }
-
-    bool eof() const
-    {
-        return m_Cursor == m_End;
+# else
+        return false;
+# endif
     }
 
     const char* m_Cursor;
     const char* m_End;
+    string      m_Number;
+    array       m_Stack;
+# if JSON_IO
+    static constexpr size_t c_ChunkSize = 256 * 1024;
+    FILE*                   m_File = nullptr;
+    std::unique_ptr<char[]> m_Buffer;
+    size_t                  m_BytesRead = 0;
+    bool                    m_ReadFailed = false;
+# endif
 };
 
 value value::parse(const string& data)
@@ -964,16 +784,13 @@ std::pair<value, bool> value::load(const string& path)
     if (!file)
         return {value{}, false};
 
-    fseek(file.get(), 0, SEEK_END);
-    auto size = static_cast<size_t>(ftell(file.get()));
-    fseek(file.get(), 0, SEEK_SET);
-
-    string data;
-    data.resize(size);
-    if (fread(const_cast<char*>(data.data()), size, 1, file.get()) != 1)
+    // the file is parsed while it's read in chunks, the whole content is never held in memory
+    auto p = parser(file.get());
+    auto v = p.parse();
+    if (p.read_failed())
         return {value{}, false};
 
-    return {parse(data), true};
+    return {std::move(v), true};
 }
 
 bool value::save(const string& path, const int indent, const char indent_char) const
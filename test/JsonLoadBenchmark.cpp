@@ -0,0 +1,256 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <filesystem>
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+#include <imgui_json.h>
+
+using namespace std;
+
+// Measure the parse time and the peak memory of loading a large synthetic project file with 'imgui_json::value::load()'.
+// Usage: json_load_benchmark [clip count] [iterations] [mep file path]
+// Without a file path a synthetic project with media items, clips carrying key points, blueprints and analysis data is
+// generated into the temp directory. It's written piece by piece, so the generation doesn't raise the peak memory.
+
+static uint32_t s_u32Seed = 0x12345678;
+static double RandNum(double dMin, double dMax)
+{
+    s_u32Seed = s_u32Seed*1664525u+1013904223u;
+    return dMin+(dMax-dMin)*(double)(s_u32Seed>>8)/(double)(1<<24);
+}
+
+static imgui_json::value MakeMediaItem(int i)
+{
+    imgui_json::value jnItem;
+    jnItem["id"] = imgui_json::number(1000+i);
+    jnItem["name"] = "clip_"+to_string(i)+".mp4";
+    jnItem["path"] = "/home/user/Videos/footage/day"+to_string(i%7)+"/clip_"+to_string(i)+".mp4";
+    jnItem["type"] = imgui_json::number(i%3);
+    imgui_json::value jnMeta;
+    imgui_json::array aScenes;
+    for (int j = 0; j < 200; j++)
+        aScenes.push_back(imgui_json::number(RandNum(0, 600000)));
+    jnMeta["scene_detect"] = aScenes;
+    imgui_json::array aTransforms;
+    for (int j = 0; j < 100; j++)
+    {
+        imgui_json::value jnTrans;
+        jnTrans["dx"] = imgui_json::number(RandNum(-8, 8));
+        jnTrans["dy"] = imgui_json::number(RandNum(-8, 8));
+        jnTrans["da"] = imgui_json::number(RandNum(-0.1, 0.1));
+        aTransforms.push_back(jnTrans);
+    }
+    jnMeta["vidstab_transforms"] = aTransforms;
+    jnItem["meta_data"] = jnMeta;
+    return jnItem;
+}
+
+static imgui_json::value MakeKeyPoints(int iCurveCount, int iPointCount)
+{
+    imgui_json::value jnKp;
+    imgui_json::array aCurves;
+    for (int c = 0; c < iCurveCount; c++)
+    {
+        imgui_json::value jnCurve;
+        jnCurve["Name"] = "Curve_"+to_string(c);
+        jnCurve["Type"] = imgui_json::number(c%4);
+        jnCurve["Color"] = imgui_json::vec4(1.f, 0.5f, 0.25f, 1.f);
+        jnCurve["Visible"] = true;
+        imgui_json::array aPoints;
+        for (int p = 0; p < iPointCount; p++)
+        {
+            imgui_json::value jnPoint;
+            jnPoint["Point"] = imgui_json::vec4((float)RandNum(0, 1), (float)RandNum(0, 1), 0.f, (float)(p*40));
+            jnPoint["Type"] = imgui_json::number(p%3);
+            aPoints.push_back(jnPoint);
+        }
+        jnCurve["KeyPoints"] = aPoints;
+        aCurves.push_back(jnCurve);
+    }
+    jnKp["Curves"] = aCurves;
+    jnKp["Range"] = imgui_json::vec2(0.f, 10000.f);
+    return jnKp;
+}
+
+static imgui_json::value MakeBluePrint(int iNodeCount)
+{
+    imgui_json::value jnBp;
+    imgui_json::array aNodes;
+    for (int n = 0; n < iNodeCount; n++)
+    {
+        imgui_json::value jnNode;
+        jnNode["id"] = imgui_json::number(5000+n);
+        jnNode["name"] = "Filter Node "+to_string(n);
+        jnNode["type_info"]["id"] = imgui_json::number(0x7a3c0000+n);
+        jnNode["type_info"]["name"] = "Filter \"Node\"\tType";
+        jnNode["location"] = imgui_json::vec2((float)RandNum(0, 2000), (float)RandNum(0, 2000));
+        jnNode["enabled"] = n%5 != 0;
+        imgui_json::array aPins;
+        for (int p = 0; p < 4; p++)
+        {
+            imgui_json::value jnPin;
+            jnPin["id"] = imgui_json::number(9000+n*4+p);
+            jnPin["name"] = "pin"+to_string(p);
+            jnPin["link"] = p == 0 ? imgui_json::value(nullptr) : imgui_json::value(imgui_json::number(9000+n*4+p-1));
+            aPins.push_back(jnPin);
+        }
+        jnNode["pins"] = aPins;
+        jnNode["settings"]["strength"] = imgui_json::number(RandNum(0, 1));
+        jnNode["settings"]["radius"] = imgui_json::number(RandNum(0, 64));
+        aNodes.push_back(jnNode);
+    }
+    jnBp["document"]["blueprint"]["nodes"] = aNodes;
+    jnBp["document"]["view"]["scroll"] = imgui_json::vec2(0.f, 0.f);
+    jnBp["document"]["view"]["zoom"] = imgui_json::number(1);
+    return jnBp;
+}
+
+static imgui_json::value MakeClip(int i, int iMediaCount)
+{
+    imgui_json::value jnClip;
+    jnClip["ID"] = imgui_json::number(100000+i);
+    jnClip["MediaID"] = imgui_json::number(1000+i%iMediaCount);
+    jnClip["Name"] = "clip_"+to_string(i%iMediaCount)+".mp4";
+    jnClip["Start"] = imgui_json::number(i*5000);
+    jnClip["End"] = imgui_json::number(i*5000+4800);
+    jnClip["StartOffset"] = imgui_json::number(1200);
+    jnClip["EndOffset"] = imgui_json::number(3400);
+    jnClip["GroupID"] = imgui_json::number(-1);
+    jnClip["KeyPoint"] = MakeKeyPoints(6, 12);
+    jnClip["FilterBP"] = MakeBluePrint(8);
+    return jnClip;
+}
+
+static bool WriteSyntheticProject(const string& strPath, int iClipCount)
+{
+    auto fp = fopen(strPath.c_str(), "wb");
+    if (!fp)
+        return false;
+    const int iMediaCount = max(1, iClipCount/4);
+    auto fnWrite = [fp] (const string& str) { fwrite(str.data(), 1, str.size(), fp); };
+    fnWrite("{\n    \"bg_tasks\": [],\n    \"mec_proj_version\": 16842752,\n    \"proj_content\":\n    {\n        \"MediaBank\":\n        [\n");
+    for (int i = 0; i < iMediaCount; i++)
+    {
+        fnWrite(MakeMediaItem(i).dump(4));
+        fnWrite(i+1 < iMediaCount ? ",\n" : "\n");
+    }
+    fnWrite("        ],\n        \"TimeLine\":\n        {\n            \"Clip\":\n            [\n");
+    for (int i = 0; i < iClipCount; i++)
+    {
+        fnWrite(MakeClip(i, iMediaCount).dump(4));
+        fnWrite(i+1 < iClipCount ? ",\n" : "\n");
+    }
+    fnWrite("            ],\n            \"Start\": 0,\n            \"End\": "+to_string(iClipCount*5000)+"\n        }\n    },\n    \"proj_name\": \"Benchmark\"\n}\n");
+    return fclose(fp) == 0;
+}
+
+// Peak resident set size of this process in KB
+static int64_t GetPeakRssKB()
+{
+#if defined(__linux__)
+    auto fp = fopen("/proc/self/status", "r");
+    if (fp)
+    {
+        char line[256];
+        int64_t i64Kb = -1;
+        while (fgets(line, sizeof(line), fp))
+        {
+            if (sscanf(line, "VmHWM: %lld kB", (long long*)&i64Kb) == 1)
+                break;
+        }
+        fclose(fp);
+        if (i64Kb >= 0)
+            return i64Kb;
+    }
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    struct rusage tUsage;
+    if (getrusage(RUSAGE_SELF, &tUsage) == 0)
+#if defined(__APPLE__)
+        return (int64_t)tUsage.ru_maxrss/1024;
+#else
+        return (int64_t)tUsage.ru_maxrss;
+#endif
+#endif
+    return -1;
+}
+
+static size_t CountValues(const imgui_json::value& jnValue)
+{
+    size_t szCount = 1;
+    if (jnValue.is_object())
+        for (const auto& member : jnValue.get<imgui_json::object>())
+            szCount += CountValues(member.second);
+    else if (jnValue.is_array())
+        for (const auto& item : jnValue.get<imgui_json::array>())
+            szCount += CountValues(item);
+    return szCount;
+}
+
+int main(int argc, char** argv)
+{
+    const int iClipCount = argc > 1 ? max(1, atoi(argv[1])) : 2000;
+    const int iIterations = argc > 2 ? max(1, atoi(argv[2])) : 5;
+    string strPath = argc > 3 ? argv[3] : "";
+    bool bRemoveFile = false;
+    if (strPath.empty())
+    {
+        strPath = (filesystem::temp_directory_path()/"json_load_benchmark.mep").string();
+        if (!WriteSyntheticProject(strPath, iClipCount))
+        {
+            cout << "FAILED to write synthetic project at '" << strPath << "'!" << endl;
+            return -1;
+        }
+        bRemoveFile = true;
+    }
+    error_code ec;
+    const auto u64FileSize = filesystem::file_size(strPath, ec);
+    if (ec)
+    {
+        cout << "CANNOT access file '" << strPath << "'!" << endl;
+        return -1;
+    }
+    cout << "File '" << strPath << "', " << fixed << setprecision(2) << (double)u64FileSize/(1024*1024) << " MB, " << iIterations << " iterations" << endl;
+
+    const auto i64BaseRssKB = GetPeakRssKB();
+    double dTotalMs = 0, dMinMs = 0;
+    size_t szValueCount = 0;
+    for (int i = 0; i < iIterations; i++)
+    {
+        const auto tStart = chrono::steady_clock::now();
+        auto res = imgui_json::value::load(strPath);
+        const double dElapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now()-tStart).count();
+        if (!res.second || res.first.is_discarded())
+        {
+            cout << "FAILED to parse '" << strPath << "'!" << endl;
+            return -1;
+        }
+        if (i == 0)
+            szValueCount = CountValues(res.first);
+        dTotalMs += dElapsedMs;
+        dMinMs = i == 0 ? dElapsedMs : min(dMinMs, dElapsedMs);
+    }
+    const auto i64PeakRssKB = GetPeakRssKB();
+    if (bRemoveFile)
+        filesystem::remove(strPath, ec);
+
+    const double dFileMB = (double)u64FileSize/(1024*1024);
+    cout << setw(24) << left << "values" << szValueCount << endl;
+    cout << setw(24) << left << "parse time (avg)" << setprecision(3) << dTotalMs/iIterations << " ms" << endl;
+    cout << setw(24) << left << "parse time (min)" << dMinMs << " ms" << endl;
+    cout << setw(24) << left << "throughput" << setprecision(2) << dFileMB*1000/dMinMs << " MB/s" << endl;
+    if (i64BaseRssKB >= 0 && i64PeakRssKB >= 0)
+    {
+        const double dLoadPeakMB = (double)(i64PeakRssKB-i64BaseRssKB)/1024;
+        cout << setw(24) << left << "peak rss of loading" << dLoadPeakMB << " MB (" << dLoadPeakMB/dFileMB << "x file size)" << endl;
+    }
+    return 0;
+}
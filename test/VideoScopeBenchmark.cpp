@@ -0,0 +1,113 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <cstdlib>
+#include <cstdint>
+#include <immat.h>
+#if IMGUI_VULKAN_SHADER
+#include <ImVulkanShader/ImVulkanShader.h>
+#include <ImVulkanShader/shader/scopes/Histogram_vulkan.h>
+#include <ImVulkanShader/shader/scopes/Waveform_vulkan.h>
+#include <ImVulkanShader/shader/scopes/CIE_vulkan.h>
+#include <ImVulkanShader/shader/scopes/Vector_vulkan.h>
+#endif
+#include "CpuVideoScope.h"
+
+using namespace std;
+
+// Compare the CPU video scopes with the Vulkan ones on a synthetic frame.
+// Usage: video_scope_benchmark [width] [height] [iterations]
+
+static ImGui::ImMat MakeTestFrame(int iWidth, int iHeight)
+{
+    ImGui::ImMat tFrame;
+    tFrame.create(iWidth, iHeight, 4, (size_t)1, 4);
+    uint32_t u32Seed = 0x12345678;
+    for (int y = 0; y < iHeight; y++)
+    {
+        uint8_t* pRow = (uint8_t*)tFrame.data+(size_t)y*iWidth*4;
+        for (int x = 0; x < iWidth; x++)
+        {
+            u32Seed = u32Seed*1664525u+1013904223u;
+            const int iNoise = (int)(u32Seed>>28)-8;
+            pRow[x*4]   = (uint8_t)max(0, min(255, x*255/iWidth+iNoise));
+            pRow[x*4+1] = (uint8_t)max(0, min(255, y*255/iHeight+iNoise));
+            pRow[x*4+2] = (uint8_t)max(0, min(255, 255-(x+y)*255/(iWidth+iHeight)+iNoise));
+            pRow[x*4+3] = 255;
+        }
+    }
+    return tFrame;
+}
+
+static void RunCase(const string& strName, int iIterations, const function<double()>& fnRun)
+{
+    fnRun();  // warm up
+    const auto tStart = chrono::steady_clock::now();
+    for (int i = 0; i < iIterations; i++)
+    {
+        if (fnRun() < 0)
+        {
+            cout << setw(40) << left << strName << "FAILED" << endl;
+            return;
+        }
+    }
+    const double dTotalMs = chrono::duration<double, milli>(chrono::steady_clock::now()-tStart).count();
+    cout << setw(40) << left << strName << fixed << setprecision(3) << dTotalMs/iIterations << " ms/frame" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+    const int iWidth = argc > 1 ? atoi(argv[1]) : 1920;
+    const int iHeight = argc > 2 ? atoi(argv[2]) : 1080;
+    const int iIterations = argc > 3 ? atoi(argv[3]) : 50;
+    if (iWidth <= 0 || iHeight <= 0 || iIterations <= 0)
+    {
+        cerr << "Usage: " << argv[0] << " [width] [height] [iterations]" << endl;
+        return -1;
+    }
+    const auto tFrame = MakeTestFrame(iWidth, iHeight);
+    ImGui::ImMat mat_histogram, mat_waveform, mat_cie, mat_vector;
+    cout << "Frame " << iWidth << "x" << iHeight << ", " << iIterations << " iterations" << endl;
+
+    struct CpuConfig { uint32_t u32Threads; uint32_t u32Step; };
+    const vector<CpuConfig> aCpuConfigs = { {1, 1}, {0, 1}, {0, 2} };
+    for (const auto& tConfig : aCpuConfigs)
+    {
+        auto hScope = MEC::CpuVideoScope::CreateInstance(tConfig.u32Threads);
+        hScope->SetPixelStep(tConfig.u32Step);
+        ostringstream oss;
+        oss << "CPU(" << (tConfig.u32Threads == 0 ? string("auto") : to_string(tConfig.u32Threads)) << " threads, step " << tConfig.u32Step << ") ";
+        const string strPrefix = oss.str();
+        RunCase(strPrefix+"histogram", iIterations, [&] () { return hScope->HistogramScope(tFrame, mat_histogram, 256, 0.05f, false); });
+        RunCase(strPrefix+"waveform", iIterations, [&] () { return hScope->WaveformScope(tFrame, mat_waveform, 256, 10.f, false, false); });
+        RunCase(strPrefix+"cie", iIterations, [&] () { return hScope->CieScope(tFrame, mat_cie, 0.5f, true); });
+        RunCase(strPrefix+"vector", iIterations, [&] () { return hScope->VectorScope(tFrame, mat_vector, 0.5f); });
+    }
+
+#if IMGUI_VULKAN_SHADER
+    ImGui::create_gpu_instance();
+    if (ImGui::get_gpu_count() > 0)
+    {
+        const int gpu = ImGui::get_default_gpu_index();
+        {
+            ImGui::Histogram_vulkan tHistogram(gpu);
+            ImGui::Waveform_vulkan tWaveform(gpu);
+            ImGui::CIE_vulkan tCie(gpu);
+            ImGui::Vector_vulkan tVector(gpu);
+            tCie.SetParam(ImGui::Rec709system, ImGui::XYY, 512, ImGui::Rec2020system, 0.75f, false);
+            RunCase("GPU histogram", iIterations, [&] () { tHistogram.scope(tFrame, mat_histogram, 256, 0.05f, false); return 0.0; });
+            RunCase("GPU waveform", iIterations, [&] () { tWaveform.scope(tFrame, mat_waveform, 256, 10.f, false, false); return 0.0; });
+            RunCase("GPU cie", iIterations, [&] () { tCie.scope(tFrame, mat_cie, 0.5f, true); return 0.0; });
+            RunCase("GPU vector", iIterations, [&] () { tVector.scope(tFrame, mat_vector, 0.5f); return 0.0; });
+        }
+    }
+    else
+        cout << "No gpu available, skip the Vulkan scopes." << endl;
+    ImGui::destroy_gpu_instance();
+#endif
+    return 0;
+}